@@ -37,6 +37,42 @@ static int draw_condition_fallback(ivl_expr_t expr)
       return use_flag;
 }
 
+/*
+ * Compare the vec4 values of le and re for equality at the given
+ * width, leaving the result in flags 4 and 6.
+ */
+static void draw_condition_compare_vec4(ivl_expr_t le, ivl_expr_t re,
+					unsigned use_wid, char use_opcode)
+{
+	/* If the le is constant, then swap the operands so that we
+	   can possibly take advantage of the immediate version of the
+	   %cmp instruction. */
+      if (ivl_expr_width(le)==use_wid && test_immediate_vec4_ok(le)) {
+	    ivl_expr_t tmp = le;
+	    le = re;
+	    re = tmp;
+      }
+
+      draw_eval_vec4(le);
+      resize_vec4_wid(le, use_wid);
+
+      if (ivl_expr_width(re)==use_wid && test_immediate_vec4_ok(re)) {
+	      /* Special case: If the right operand can be handled as
+		 an immediate operand, then use that instead. */
+	    if (use_opcode=='n' || use_opcode=='N')
+		  draw_immediate_vec4(re, "%cmpi/ne");
+	    else
+		  draw_immediate_vec4(re, "%cmpi/e");
+      } else {
+	    draw_eval_vec4(re);
+	    resize_vec4_wid(re, use_wid);
+	    if (use_opcode=='n' || use_opcode=='N')
+		  fprintf(vvp_out, "    %%cmp/ne;\n");
+	    else
+		  fprintf(vvp_out, "    %%cmp/e;\n");
+      }
+}
+
 static int draw_condition_binary_compare(ivl_expr_t expr)
 {
       ivl_expr_t le = ivl_expr_oper1(expr);
@@ -71,35 +107,21 @@ static int draw_condition_binary_compare(ivl_expr_t expr)
       if (ivl_expr_width(re) > use_wid)
 	    use_wid = ivl_expr_width(re);
 
-	/* If the le is constant, then swap the operands so that we
-	   can possibly take advantage of the immediate version of the
-	   %cmp instruction. */
-      if (ivl_expr_width(le)==use_wid && test_immediate_vec4_ok(le)) {
-	    ivl_expr_t tmp = le;
-	    le = re;
-	    re = tmp;
-      }
-
-      draw_eval_vec4(le);
-      resize_vec4_wid(le, use_wid);
-
       char use_opcode = ivl_expr_opcode(expr);
 
+	/* If both operands are 2-state values of the same width, then
+	   compare them on the vec2 stack. */
+      if (test_vec2_ok(le, use_wid) && test_vec2_ok(re, use_wid)) {
+	    draw_eval_vec2(le);
+	    draw_eval_vec2(re);
+	    fprintf(vvp_out, "    %%cmp/vec2/u %u;\n", use_wid);
+	    if (use_opcode=='n')
+		  fprintf(vvp_out, "    %%flag_inv 4;\n");
+	    if (use_opcode=='N')
+		  fprintf(vvp_out, "    %%flag_inv 6;\n");
 
-      if (ivl_expr_width(re)==use_wid && test_immediate_vec4_ok(re)) {
-	      /* Special case: If the right operand can be handled as
-		 an immediate operand, then use that instead. */
-	    if (use_opcode=='n' || use_opcode=='N')
-		  draw_immediate_vec4(re, "%cmpi/ne");
-	    else
-		  draw_immediate_vec4(re, "%cmpi/e");
       } else {
-	    draw_eval_vec4(re);
-	    resize_vec4_wid(re, use_wid);
-	    if (use_opcode=='n' || use_opcode=='N')
-		  fprintf(vvp_out, "    %%cmp/ne;\n");
-	    else
-		  fprintf(vvp_out, "    %%cmp/e;\n");
+	    draw_condition_compare_vec4(le, re, use_wid, use_opcode);
       }
 
       switch (ivl_expr_opcode(expr)) {
@@ -240,17 +262,25 @@ static int draw_condition_binary_le(ivl_expr_t expr)
       if (ivl_expr_width(re) > use_wid)
 	    use_wid = ivl_expr_width(re);
 
-      draw_eval_vec4(le);
-      resize_vec4_wid(le, use_wid);
+      if (test_vec2_ok(le, use_wid) && test_vec2_ok(re, use_wid)) {
+	      /* Both operands are 2-state values of the same width,
+		 so compare them on the vec2 stack. */
+	    draw_eval_vec2(le);
+	    draw_eval_vec2(re);
+	    fprintf(vvp_out, "    %%cmp/vec2/%c %u;\n", s_flag, use_wid);
 
-      if (ivl_expr_width(re)==use_wid && test_immediate_vec4_ok(re)) {
+      } else if (ivl_expr_width(re)==use_wid && test_immediate_vec4_ok(re)) {
 	      /* Special case: If the right operand can be handled as
 		 an immediate operand, then use that instead. */
 	    char opcode[8];
+	    draw_eval_vec4(le);
+	    resize_vec4_wid(le, use_wid);
 	    snprintf(opcode, sizeof opcode, "%%cmpi/%c", s_flag);
 	    draw_immediate_vec4(re, opcode);
 
       } else {
+	    draw_eval_vec4(le);
+	    resize_vec4_wid(le, use_wid);
 	    draw_eval_vec4(re);
 	    resize_vec4_wid(re, use_wid);
 
@@ -1288,6 +1288,146 @@ static void draw_unary_vec4(ivl_expr_t expr)
       }
 }
 
+/*
+ * Test if the expression can be evaluated with the vec2 instructions
+ * at the given width. That is true of 2-state variables, numbers
+ * without x or z bits, and the arithmetic and bitwise operators that
+ * keep the low bits of the result independent of the high bits of
+ * their operands, if everything has the same width of at most 64
+ * bits. Signed and unsigned need not be distinguished for these.
+ */
+int test_vec2_ok(ivl_expr_t expr, unsigned wid)
+{
+      ivl_signal_t sig;
+
+      if (wid == 0 || wid > 64 || ivl_expr_width(expr) != wid)
+	    return 0;
+
+      switch (ivl_expr_type(expr)) {
+	  case IVL_EX_SIGNAL:
+	    sig = ivl_expr_signal(expr);
+	    if (ivl_signal_data_type(sig) != IVL_VT_BOOL)
+		  return 0;
+	    if (ivl_signal_type(sig) != IVL_SIT_REG)
+		  return 0;
+	    if (ivl_signal_dimensions(sig) != 0)
+		  return 0;
+	    if (ivl_signal_width(sig) != wid)
+		  return 0;
+	    if (signal_is_return_value(sig))
+		  return 0;
+	    return 1;
+
+	  case IVL_EX_NUMBER:
+	    return ! number_is_unknown(expr);
+
+	  case IVL_EX_BINARY:
+	    switch (ivl_expr_opcode(expr)) {
+		case '+':
+		case '-':
+		case '*':
+		case '&':
+		case '|':
+		case '^':
+		  return test_vec2_ok(ivl_expr_oper1(expr), wid)
+		        && test_vec2_ok(ivl_expr_oper2(expr), wid);
+		default:
+		  return 0;
+	    }
+
+	  case IVL_EX_UNARY:
+	    switch (ivl_expr_opcode(expr)) {
+		case '~':
+		case '-':
+		  return test_vec2_ok(ivl_expr_oper1(expr), wid);
+		default:
+		  return 0;
+	    }
+
+	  default:
+	    return 0;
+      }
+}
+
+static void draw_number_vec2(ivl_expr_t expr)
+{
+      const char*bits = ivl_expr_bits(expr);
+      unsigned long low = 0, high = 0;
+      unsigned idx;
+
+      for (idx = 0 ; idx < ivl_expr_width(expr) ; idx += 1) {
+	    if (bits[idx] != '1')
+		  continue;
+	    if (idx < 32)
+		  low |= 1UL << idx;
+	    else
+		  high |= 1UL << (idx-32);
+      }
+
+      fprintf(vvp_out, "    %%pushi/vec2 %lu, %lu;\n", low, high);
+}
+
+/*
+ * Evaluate an expression that test_vec2_ok accepted, and leave the
+ * result on the vec2 stack.
+ */
+void draw_eval_vec2(ivl_expr_t expr)
+{
+      switch (ivl_expr_type(expr)) {
+	  case IVL_EX_SIGNAL:
+	    fprintf(vvp_out, "    %%load/vec2 v%p_0;\n", ivl_expr_signal(expr));
+	    break;
+
+	  case IVL_EX_NUMBER:
+	    draw_number_vec2(expr);
+	    break;
+
+	  case IVL_EX_BINARY:
+	    draw_eval_vec2(ivl_expr_oper1(expr));
+	    draw_eval_vec2(ivl_expr_oper2(expr));
+	    switch (ivl_expr_opcode(expr)) {
+		case '+':
+		  fprintf(vvp_out, "    %%add/vec2;\n");
+		  break;
+		case '-':
+		  fprintf(vvp_out, "    %%sub/vec2;\n");
+		  break;
+		case '*':
+		  fprintf(vvp_out, "    %%mul/vec2;\n");
+		  break;
+		case '&':
+		  fprintf(vvp_out, "    %%and/vec2;\n");
+		  break;
+		case '|':
+		  fprintf(vvp_out, "    %%or/vec2;\n");
+		  break;
+		case '^':
+		  fprintf(vvp_out, "    %%xor/vec2;\n");
+		  break;
+		default:
+		  assert(0);
+		  break;
+	    }
+	    break;
+
+	  case IVL_EX_UNARY:
+	    if (ivl_expr_opcode(expr) == '-') {
+		  fprintf(vvp_out, "    %%pushi/vec2 0, 0;\n");
+		  draw_eval_vec2(ivl_expr_oper1(expr));
+		  fprintf(vvp_out, "    %%sub/vec2;\n");
+	    } else {
+		  assert(ivl_expr_opcode(expr) == '~');
+		  draw_eval_vec2(ivl_expr_oper1(expr));
+		  fprintf(vvp_out, "    %%inv/vec2;\n");
+	    }
+	    break;
+
+	  default:
+	    assert(0);
+	    break;
+      }
+}
+
 void draw_eval_vec4(ivl_expr_t expr)
 {
       if (debug_draw) {
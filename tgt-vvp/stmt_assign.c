@@ -481,6 +481,90 @@ static void store_vec4_to_lval(ivl_statement_t net)
       }
 }
 
+/*
+ * An assignment to all of a 2-state variable of up to 64 bits, from
+ * an expression that draw_eval_vec2 can evaluate, can be done on the
+ * vec2 stack. This includes the compressed assignments whose operator
+ * draw_eval_vec2 supports.
+ */
+static int test_assign_vec2_ok(ivl_statement_t net)
+{
+      ivl_lval_t lval;
+      ivl_signal_t lsig;
+      unsigned lwid;
+
+      if (ivl_stmt_lvals(net) != 1)
+	    return 0;
+
+      lval = ivl_stmt_lval(net, 0);
+      lsig = ivl_lval_sig(lval);
+      if (lsig == 0 || ivl_lval_nest(lval) || ivl_lval_part_off(lval)
+	  || ivl_lval_idx(lval))
+	    return 0;
+
+      lwid = ivl_lval_width(lval);
+      if (ivl_signal_data_type(lsig) != IVL_VT_BOOL
+	  || ivl_signal_type(lsig) != IVL_SIT_REG
+	  || ivl_signal_dimensions(lsig) != 0
+	  || ivl_signal_width(lsig) != lwid
+	  || signal_is_return_value(lsig))
+	    return 0;
+
+      switch (ivl_stmt_opcode(net)) {
+	  case 0:
+	  case '+':
+	  case '-':
+	  case '*':
+	  case '&':
+	  case '|':
+	  case '^':
+	    break;
+	  default:
+	    return 0;
+      }
+
+      return test_vec2_ok(ivl_stmt_rval(net), lwid);
+}
+
+static void show_stmt_assign_vec2(ivl_statement_t net)
+{
+      ivl_signal_t lsig = ivl_lval_sig(ivl_stmt_lval(net, 0));
+      unsigned lwid = ivl_lval_width(ivl_stmt_lval(net, 0));
+
+      if (ivl_stmt_opcode(net) != 0)
+	    fprintf(vvp_out, "    %%load/vec2 v%p_0;\n", lsig);
+
+      draw_eval_vec2(ivl_stmt_rval(net));
+
+      switch (ivl_stmt_opcode(net)) {
+	  case 0:
+	    break;
+	  case '+':
+	    fprintf(vvp_out, "    %%add/vec2;\n");
+	    break;
+	  case '-':
+	    fprintf(vvp_out, "    %%sub/vec2;\n");
+	    break;
+	  case '*':
+	    fprintf(vvp_out, "    %%mul/vec2;\n");
+	    break;
+	  case '&':
+	    fprintf(vvp_out, "    %%and/vec2;\n");
+	    break;
+	  case '|':
+	    fprintf(vvp_out, "    %%or/vec2;\n");
+	    break;
+	  case '^':
+	    fprintf(vvp_out, "    %%xor/vec2;\n");
+	    break;
+	  default:
+	    assert(0);
+	    break;
+      }
+
+      fprintf(vvp_out, "    %%store/vec2 v%p_0, %u;\n", lsig, lwid);
+}
+
 static int show_stmt_assign_vector(ivl_statement_t net)
 {
       ivl_expr_t rval = ivl_stmt_rval(net);
@@ -489,6 +573,11 @@ static int show_stmt_assign_vector(ivl_statement_t net)
       struct vec_slice_info*slices = 0;
       int idx_reg;
 
+      if (test_assign_vec2_ok(net)) {
+	    show_stmt_assign_vec2(net);
+	    return 0;
+      }
+
 	/* If this is a compressed assignment, then get the contents
 	   of the l-value. We need these values as part of the r-value
 	   calculation. */
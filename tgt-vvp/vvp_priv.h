@@ -226,6 +226,14 @@ extern uint64_t get_number_immediate64(ivl_expr_t ex);
 extern void draw_eval_vec4(ivl_expr_t ex);
 extern void resize_vec4_wid(ivl_expr_t expr, unsigned wid);
 
+/*
+ * test_vec2_ok tests if the expression is a 2-state expression of the
+ * given width (at most 64 bits) that draw_eval_vec2 can evaluate onto
+ * the vec2 stack.
+ */
+extern int test_vec2_ok(ivl_expr_t ex, unsigned wid);
+extern void draw_eval_vec2(ivl_expr_t ex);
+
 /*
  * draw_eval_real evaluates real value expressions. The result of the
  * evaluation is the real result in the top of the real expression stack.
@@ -84,6 +84,8 @@ static void my_mcd_rawwrite(PLI_UINT32 mcd, const char*buf, size_t count)
 
 struct timeformat_info_s timeformat_info = { 0, 0, 0, 20 };
 
+struct display_arg_s;
+
 struct strobe_cb_info {
       const char*name;
       char*filename;
@@ -93,8 +95,75 @@ struct strobe_cb_info {
       vpiHandle*items;
       unsigned nitems;
       unsigned fd_mcd;
+	/* Optional details of the items that are worked out once, when
+	 * the same items are displayed many times. */
+      struct display_arg_s*args;
+};
+
+/*
+ * A format string is compiled into a list of these items. A literal
+ * item holds a run of text that is copied to the output, the others
+ * hold the flags, width and precision of a conversion. The text points
+ * into the copy of the format string that the program keeps.
+ */
+struct format_item_s {
+      int literal;
+      int ljust, plus, ld_zero, width, prec;
+      char fmt;
+      const char*text;
+      unsigned len;
+};
+
+struct format_prog_s {
+      char*text;
+      struct format_item_s*items;
+      unsigned nitems;
+};
+
+/*
+ * The type of each display argument, the width of its decimal value and
+ * the compiled format of a constant format string.
+ */
+struct display_arg_s {
+      PLI_INT32 type;
+      int dec_size;
+      struct format_prog_s*prog;
+};
+
+/*
+ * The output is built up in this buffer, which grows as needed and can
+ * be reused for the next display. It is not necessarily terminated,
+ * since %u and %z can put NULL characters into the stream.
+ */
+struct display_out_s {
+      char*str;
+      unsigned len;
+      unsigned size;
 };
 
+static char* display_reserve(struct display_out_s*out, unsigned cnt)
+{
+      if (out->len + cnt + 1 > out->size) {
+	    out->size = 2*out->size + cnt + 1;
+	    out->str = realloc(out->str, out->size);
+      }
+      return out->str + out->len;
+}
+
+static void display_append(struct display_out_s*out, const char*text,
+                           unsigned cnt)
+{
+      memcpy(display_reserve(out, cnt), text, cnt);
+      out->len += cnt;
+}
+
+/* Terminate the output for callers that want a string. */
+static char* display_finish(struct display_out_s*out)
+{
+      *display_reserve(out, 0) = '\0';
+      return out->str;
+}
+
 /*
  * The number of decimal digits needed to represent a
  * nr_bits binary number is floor(nr_bits*log_10(2))+1,
@@ -135,8 +204,22 @@ static int vpi_get_dec_size(vpiHandle item)
 	);
 }
 
+static PLI_INT32 item_type(const struct strobe_cb_info*info, unsigned idx)
+{
+      if (info->args) return info->args[idx].type;
+      return vpi_get(vpiType, info->items[idx]);
+}
+
+static int item_dec_size(const struct strobe_cb_info*info, unsigned idx)
+{
+      if (info->args && info->args[idx].dec_size >= 0)
+	    return info->args[idx].dec_size;
+      return vpi_get_dec_size(info->items[idx]);
+}
+
 static void array_from_iterator(struct strobe_cb_info*info, vpiHandle argv)
 {
+      info->args = 0;
       if (argv) {
 	    vpiHandle item;
 	    unsigned nitems = 1;
@@ -293,7 +376,7 @@ static void get_time_real(char *rtn, double value, int prec,
   sprintf(rtn, "%0.*f%s", prec, value, timeformat_info.suff);
 }
 
-static unsigned int get_format_char(char **rtn, int ljust, int plus,
+static unsigned int get_format_char(struct display_out_s *out, int ljust, int plus,
                                     int ld_zero, int width, int prec,
                                     char fmt, const struct strobe_cb_info *info,
                                     unsigned int *idx)
@@ -486,7 +569,7 @@ static unsigned int get_format_char(char **rtn, int ljust, int plus,
            * Icarus is 1 the string length will set the width of a real
            * displayed using %d. */
           if (width == -1) {
-            width = (ld_zero == 1) ? 0 : vpi_get_dec_size(info->items[*idx]);
+            width = (ld_zero == 1) ? 0 : item_dec_size(info, *idx);
           }
 
           /* If the default buffer is too small make it big enough. */
@@ -628,7 +711,7 @@ static unsigned int get_format_char(char **rtn, int ljust, int plus,
         PLI_INT32 type;
 
         /* Get the argument type and value. */
-        type = vpi_get(vpiType, info->items[*idx]);
+        type = item_type(info, *idx);
         if (((type == vpiConstant || type == vpiParameter) &&
              vpi_get(vpiConstType, info->items[*idx]) == vpiRealConst) ||
             type == vpiRealVar || (type == vpiSysFuncCall &&
@@ -872,139 +955,199 @@ static unsigned int get_format_char(char **rtn, int ljust, int plus,
       break;
   }
   free(fmtb);
-  /* We can't use strdup here since %u and %z can insert NULL
+  /* We can't use strlen here since %u and %z can insert NULL
    * characters into the stream. */
-  *rtn = malloc(size*sizeof(char));
-  memcpy(*rtn, result, size);
+  display_append(out, result, size - 1);
   free(result);
   return size - 1;
 }
 
-/* We can't use the normal str functions on the return value since
- * %u and %z can insert NULL characters into the stream. */
-static unsigned int get_format(char **rtn, char *fmt,
-                               const struct strobe_cb_info *info, unsigned int *idx)
+/*
+ * Split a format string into runs of literal text and the conversions
+ * with their flags, so the string only needs to be scanned once.
+ */
+static struct format_prog_s* compile_format(const char*fmt)
 {
-  char *cp = fmt;
-  unsigned int size;
+  struct format_prog_s*prog = malloc(sizeof(struct format_prog_s));
+  char *cp;
 
-  *rtn = strdup("");
-  size = 1;
+  prog->text = strdup(fmt);
+  prog->items = 0;
+  prog->nitems = 0;
+
+  cp = prog->text;
   while (*cp) {
+    struct format_item_s*item;
     size_t cnt = strcspn(cp, "%");
 
+    prog->items = realloc(prog->items,
+                          (prog->nitems+1)*sizeof(struct format_item_s));
+    item = prog->items + prog->nitems;
+    prog->nitems += 1;
+
     if (cnt > 0) {
-      *rtn = realloc(*rtn, (size+cnt)*sizeof(char));
-      memcpy(*rtn+size-1, cp, cnt);
-      size += cnt;
+      item->literal = 1;
+      item->text = cp;
+      item->len = cnt;
       cp += cnt;
     } else {
-      int ljust = 0, plus = 0, ld_zero = 0, width = -1, prec = -1;
-      char *result;
+      item->literal = 0;
+      item->ljust = 0;
+      item->plus = 0;
+      item->ld_zero = 0;
+      item->width = -1;
+      item->prec = -1;
 
       cp += 1;
       while ((*cp == '-') || (*cp == '+')) {
-        if (*cp == '-') ljust = 1;
-        else plus = 1;
+        if (*cp == '-') item->ljust = 1;
+        else item->plus = 1;
         cp += 1;
       }
       if (*cp == '0') {
-        ld_zero = 1;
+        item->ld_zero = 1;
         cp += 1;
       }
-      if (isdigit((int)*cp)) width = strtoul(cp, &cp, 10);
+      if (isdigit((int)*cp)) item->width = strtoul(cp, &cp, 10);
       if (*cp == '.') {
         cp += 1;
-        prec = strtoul(cp, &cp, 10);
+        item->prec = strtoul(cp, &cp, 10);
       }
-      cnt = get_format_char(&result, ljust, plus, ld_zero, width, prec, *cp,
-                            info, idx);
-      *rtn = realloc(*rtn, (size+cnt)*sizeof(char));
-      memcpy(*rtn+size-1, result, cnt);
-      free(result);
-      size += cnt;
+      item->fmt = *cp;
       if (*cp) cp += 1;
     }
   }
-  *(*rtn+size-1) = '\0';
-  return size - 1;
+
+  return prog;
 }
 
-static unsigned int get_numeric(char **rtn, const struct strobe_cb_info *info,
-                                vpiHandle item)
+static void free_format(struct format_prog_s*prog)
+{
+  free(prog->text);
+  free(prog->items);
+  free(prog);
+}
+
+static unsigned int run_format(struct display_out_s *out,
+                               const struct format_prog_s *prog,
+                               const struct strobe_cb_info *info,
+                               unsigned int *idx)
+{
+  unsigned int start = out->len;
+  unsigned int cur;
+
+  for (cur = 0; cur < prog->nitems; cur += 1) {
+    const struct format_item_s*item = prog->items + cur;
+    if (item->literal) {
+      display_append(out, item->text, item->len);
+    } else {
+      get_format_char(out, item->ljust, item->plus, item->ld_zero,
+                      item->width, item->prec, item->fmt, info, idx);
+    }
+  }
+  return out->len - start;
+}
+
+/* We can't use the normal str functions on the return value since
+ * %u and %z can insert NULL characters into the stream. */
+static unsigned int get_format(char **rtn, char *fmt,
+                               const struct strobe_cb_info *info, unsigned int *idx)
+{
+  struct display_out_s out = { 0, 0, 0 };
+  struct format_prog_s*prog = compile_format(fmt);
+
+  run_format(&out, prog, info, idx);
+  free_format(prog);
+  *rtn = display_finish(&out);
+  return out.len;
+}
+
+static void get_numeric(struct display_out_s *out,
+                        const struct strobe_cb_info *info, unsigned int idx)
 {
   int size, min;
   s_vpi_value val;
 
   val.format = info->default_format;
-  vpi_get_value(item, &val);
+  vpi_get_value(info->items[idx], &val);
 
   switch(info->default_format){
     case vpiDecStrVal:
-      size = vpi_get_dec_size(item);
+      size = item_dec_size(info, idx);
 	/* -1 can be represented as a one bit signed value. This returns
 	 * a size of 1 which is too small for the -1 string value so make
 	 * the string width the minimum display width. */
       min = strlen(val.value.str);
       if (size < min) size = min;
-      *rtn = malloc((size+1)*sizeof(char));
-      sprintf(*rtn, "%*s", size, val.value.str);
+      sprintf(display_reserve(out, size), "%*s", size, val.value.str);
+      out->len += size;
       break;
     default:
-      *rtn = strdup(val.value.str);
+      display_append(out, val.value.str, strlen(val.value.str));
+  }
+}
+
+static void display_real(struct display_out_s *out, double real)
+{
+  char buf[256];
+#if !defined(__GNUC__)
+  if (compatible_flag)
+    sprintf(buf, "%g", real);
+  else {
+    if (real == 0.0 || real == -0.0)
+      sprintf(buf, "%.05f", real);
+    else
+      sprintf(buf, "%#g", real);
   }
+#else
+  sprintf(buf, compatible_flag ? "%g" : "%#g", real);
+#endif
+  display_append(out, buf, strlen(buf));
+}
 
-  return strlen(*rtn);
+static void display_padded(struct display_out_s *out, const char *str,
+                           unsigned int width)
+{
+  unsigned int len = strlen(str);
+  if (width < len) width = len;
+  sprintf(display_reserve(out, width), "%*s", width, str);
+  out->len += width;
 }
 
 /* In many places we can't use the normal str functions since %u and %z
- * can insert NULL characters into the stream. */
-static char *get_display(unsigned int *rtnsz, const struct strobe_cb_info *info)
+ * can insert NULL characters into the stream. This appends the display
+ * of the items to the output. */
+static void display_items(struct display_out_s *out,
+                          const struct strobe_cb_info *info)
 {
-  char *result, *fmt, *rtn, *func_name;
-  const char *cresult;
+  char *func_name;
   s_vpi_value value;
-  unsigned int idx, size, width;
+  unsigned int idx;
   char buf[256];
 
-  rtn = strdup("");
-  size = 1;
   for  (idx = 0; idx < info->nitems; idx += 1) {
     vpiHandle item = info->items[idx];
 
-    switch (vpi_get(vpiType, item)) {
+    switch (item_type(info, idx)) {
 
       case vpiConstant:
       case vpiParameter:
-        if (vpi_get(vpiConstType, item) == vpiStringConst) {
+        if (info->args && info->args[idx].prog) {
+          run_format(out, info->args[idx].prog, info, &idx);
+        } else if (vpi_get(vpiConstType, item) == vpiStringConst) {
+          struct format_prog_s*prog;
           value.format = vpiStringVal;
           vpi_get_value(item, &value);
-          fmt = strdup(value.value.str);
-          width = get_format(&result, fmt, info, &idx);
-          free(fmt);
+          prog = compile_format(value.value.str);
+          run_format(out, prog, info, &idx);
+          free_format(prog);
         } else if (vpi_get(vpiConstType, item) == vpiRealConst) {
           value.format = vpiRealVal;
           vpi_get_value(item, &value);
-#if !defined(__GNUC__)
-		  if(compatible_flag)
-			  sprintf(buf, "%g", value.value.real);
-		  else {
-			  if(value.value.real == 0.0 || value.value.real == -0.0)
-				  sprintf(buf, "%.05f", value.value.real);
-			  else
-				  sprintf(buf, "%#g", value.value.real);
-		  }
-#else
-          sprintf(buf, compatible_flag ? "%g" : "%#g", value.value.real);
-#endif
-          result = strdup(buf);
-          width = strlen(result);
+          display_real(out, value.value.real);
         } else {
-          width = get_numeric(&result, info, item);
+          get_numeric(out, info, idx);
         }
-        rtn = realloc(rtn, (size+width)*sizeof(char));
-        memcpy(rtn+size-1, result, width);
-        free(result);
         break;
 
       case vpiNet:
@@ -1017,10 +1160,7 @@ static char *get_display(unsigned int *rtnsz, const struct strobe_cb_info *info)
       case vpiIntegerVar:
       case vpiMemoryWord:
       case vpiPartSelect:
-        width = get_numeric(&result, info, item);
-        rtn = realloc(rtn, (size+width)*sizeof(char));
-        memcpy(rtn+size-1, result, width);
-        free(result);
+        get_numeric(out, info, idx);
         break;
 
       /* It appears that this is not currently used! A time variable is
@@ -1031,71 +1171,44 @@ static char *get_display(unsigned int *rtnsz, const struct strobe_cb_info *info)
         vpi_get_value(item, &value);
         get_time(buf, value.value.str, timeformat_info.prec,
                  vpi_get(vpiTimeUnit, info->scope));
-        width = strlen(buf);
-        if (width  < timeformat_info.width) width = timeformat_info.width;
-        rtn = realloc(rtn, (size+width)*sizeof(char));
-        sprintf(rtn+size-1, "%*s", width, buf);
+        display_padded(out, buf, timeformat_info.width);
         break;
 
       /* Realtime variables are also processed here. */
       case vpiRealVar:
         value.format = vpiRealVal;
         vpi_get_value(item, &value);
-#if !defined(__GNUC__)
-		if (compatible_flag)
-			sprintf(buf, "%g", value.value.real);
-		else {
-			if (value.value.real == 0.0 || value.value.real == -0.0)
-				sprintf(buf, "%.05f", value.value.real);
-			else
-				sprintf(buf, "%#g", value.value.real);
-		}
-#else
-        sprintf(buf, compatible_flag ? "%g" : "%#g", value.value.real);
-#endif
-        width = strlen(buf);
-        rtn = realloc(rtn, (size+width)*sizeof(char));
-        memcpy(rtn+size-1, buf, width);
+        display_real(out, value.value.real);
         break;
 
        /* Process string variables like string constants: interpret
 	  the contained strings like format strings. */
-      case vpiStringVar:
+      case vpiStringVar: {
+	struct format_prog_s*prog;
 	value.format = vpiStringVal;
 	vpi_get_value(item, &value);
-	fmt = strdup(value.value.str);
-	width = get_format(&result, fmt, info, &idx);
-	free(fmt);
-        rtn = realloc(rtn, (size+width)*sizeof(char));
-        memcpy(rtn+size-1, result, width);
-        free(result);
+	prog = compile_format(value.value.str);
+	run_format(out, prog, info, &idx);
+	free_format(prog);
 	break;
+      }
 
       case vpiSysFuncCall:
         func_name = vpi_get_str(vpiName, item);
         if (strcmp(func_name, "$time") == 0) {
           value.format = vpiDecStrVal;
           vpi_get_value(item, &value);
-          width = strlen(value.value.str);
-          if (width  < 20) width = 20;
-          rtn = realloc(rtn, (size+width)*sizeof(char));
-          sprintf(rtn+size-1, "%*s", width, value.value.str);
+          display_padded(out, value.value.str, 20);
 
         } else if (strcmp(func_name, "$stime") == 0) {
           value.format = vpiDecStrVal;
           vpi_get_value(item, &value);
-          width = strlen(value.value.str);
-          if (width  < 10) width = 10;
-          rtn = realloc(rtn, (size+width)*sizeof(char));
-          sprintf(rtn+size-1, "%*s", width, value.value.str);
+          display_padded(out, value.value.str, 10);
 
         } else if (strcmp(func_name, "$simtime") == 0) {
           value.format = vpiDecStrVal;
           vpi_get_value(item, &value);
-          width = strlen(value.value.str);
-          if (width  < 20) width = 20;
-          rtn = realloc(rtn, (size+width)*sizeof(char));
-          sprintf(rtn+size-1, "%*s", width, value.value.str);
+          display_padded(out, value.value.str, 20);
 
         } else if (strcmp(func_name, "$realtime") == 0) {
           /* Use the local scope precision. */
@@ -1105,17 +1218,12 @@ static char *get_display(unsigned int *rtnsz, const struct strobe_cb_info *info)
           value.format = vpiRealVal;
           vpi_get_value(item, &value);
           sprintf(buf, "%.*f", use_prec, value.value.real);
-          width = strlen(buf);
-          rtn = realloc(rtn, (size+width)*sizeof(char));
-          sprintf(rtn+size-1, "%*s", width, buf);
+          display_append(out, buf, strlen(buf));
 
         } else {
           vpi_printf("WARNING: %s:%d: %s does not support %s as an argument!\n",
                      info->filename, info->lineno, info->name, func_name);
-          strcpy(buf, "<?>");
-          width = strlen(buf);
-          rtn = realloc(rtn, (size+width)*sizeof(char));
-          memcpy(rtn+size-1, buf, width);
+          display_append(out, "<?>", 3);
         }
         break;
 
@@ -1123,17 +1231,74 @@ static char *get_display(unsigned int *rtnsz, const struct strobe_cb_info *info)
         vpi_printf("WARNING: %s:%d: unknown argument type (%s) given to %s!\n",
                    info->filename, info->lineno, vpi_get_str(vpiType, item),
                    info->name);
-        cresult = "<?>";
-        width = strlen(cresult);
-        rtn = realloc(rtn, (size+width)*sizeof(char));
-        memcpy(rtn+size-1, cresult, width);
+        display_append(out, "<?>", 3);
         break;
     }
-    size += width;
   }
-  rtn[size-1] = '\0';
-  *rtnsz = size - 1;
-  return rtn;
+}
+
+/* Return the display of the items as a string that the caller frees.
+ * Because %u and %z may put embedded NULL characters into the string,
+ * strlen() may not match the real size returned in rtnsz. */
+static char *get_display(unsigned int *rtnsz, const struct strobe_cb_info *info)
+{
+  struct display_out_s out = { 0, 0, 0 };
+
+  display_items(&out, info);
+  *rtnsz = out.len;
+  return display_finish(&out);
+}
+
+/*
+ * Work out the type and decimal width of each item, and compile the
+ * constant format strings. Strings that come from the thread stack are
+ * constants too, but they change from call to call so are left to be
+ * worked out when they are displayed, as are string variables.
+ */
+static void compile_display_args(struct strobe_cb_info*info)
+{
+      unsigned idx;
+
+      info->args = calloc(info->nitems, sizeof(struct display_arg_s));
+      for (idx = 0 ;  idx < info->nitems ;  idx += 1) {
+	    vpiHandle item = info->items[idx];
+	    struct display_arg_s*arg = info->args + idx;
+	    s_vpi_value value;
+
+	    arg->type = vpi_get(vpiType, item);
+	    arg->dec_size = -1;
+	    arg->prog = 0;
+
+	    if (arg->type == vpiStringVar)
+		  continue;
+
+	    if ((arg->type == vpiConstant || arg->type == vpiParameter)
+		&& vpi_get(vpiConstType, item) == vpiStringConst) {
+#ifdef BR916_STOPGAP_FIX
+		  if (vpi_get(_vpiFromThr, item) != _vpiNoThr)
+			continue;
+		  value.format = vpiStringVal;
+		  vpi_get_value(item, &value);
+		  arg->prog = compile_format(value.value.str);
+#else
+		  continue;
+#endif
+	    }
+
+	    arg->dec_size = vpi_get_dec_size(item);
+      }
+}
+
+static void free_display_args(struct strobe_cb_info*info)
+{
+      unsigned idx;
+
+      if (info->args == 0) return;
+      for (idx = 0 ;  idx < info->nitems ;  idx += 1) {
+	    if (info->args[idx].prog) free_format(info->args[idx].prog);
+      }
+      free(info->args);
+      info->args = 0;
 }
 
 #ifdef BR916_STOPGAP_FIX
@@ -1262,8 +1427,86 @@ static PLI_INT32 sys_common_compiletf(ICARUS_VPI_CONST PLI_BYTE8*name, int no_au
       return 0;
 }
 
+/*
+ * The $display, $write, $fdisplay, $fwrite and $sformatf based tasks
+ * keep the details of each call in the user data of the call handle,
+ * so the arguments and the constant format strings are only worked out
+ * once. The output buffer is kept for the next call as well, unless the
+ * call is displaying a $sformatf that uses the same call site.
+ */
+struct display_site_s {
+      struct strobe_cb_info info;
+      vpiHandle fd_arg;
+      int newline;
+      int busy;
+      struct display_out_s out;
+};
+
+static struct display_site_s**display_sites = 0;
+static unsigned display_sites_count = 0;
+
+static struct display_site_s* make_display_site(ICARUS_VPI_CONST PLI_BYTE8*name,
+                                                vpiHandle callh)
+{
+      struct display_site_s*site = calloc(1, sizeof(struct display_site_s));
+      vpiHandle argv = vpi_iterate(vpiArgument, callh);
+
+      if (name[1] == 'f' && argv) {
+	    site->fd_arg = vpi_scan(argv);
+	      /* vpi_scan() returning 0 (NULL) has already freed argv. */
+	    if (site->fd_arg == 0) argv = 0;
+      }
+
+	/* We could use vpi_get_str(vpiName, callh) to get the task name,
+	 * but name is already defined. */
+      site->info.name = name;
+      site->info.filename = strdup(vpi_get_str(vpiFile, callh));
+      site->info.lineno = (int)vpi_get(vpiLineNo, callh);
+      site->info.default_format = get_default_format(name);
+      site->info.scope = vpi_handle(vpiScope, callh);
+      assert(site->info.scope);
+      array_from_iterator(&site->info, argv);
+      compile_display_args(&site->info);
+
+      site->newline = (strncmp(name,"$display",8) == 0) ||
+                      (strncmp(name,"$fdisplay",9) == 0);
+
+      vpi_put_userdata(callh, site);
+      display_sites_count += 1;
+      display_sites = realloc(display_sites,
+                              display_sites_count*sizeof(struct display_site_s*));
+      display_sites[display_sites_count-1] = site;
+      return site;
+}
+
+static void free_display_sites(void)
+{
+      unsigned idx;
+
+      for (idx = 0 ;  idx < display_sites_count ;  idx += 1) {
+	    struct display_site_s*site = display_sites[idx];
+	    free_display_args(&site->info);
+	    free(site->info.filename);
+	    free(site->info.items);
+	    free(site->out.str);
+	    free(site);
+      }
+      free(display_sites);
+      display_sites = 0;
+      display_sites_count = 0;
+}
+
 /* Check the $display, $write, $fdisplay and $fwrite based tasks. */
 static PLI_INT32 sys_display_compiletf(ICARUS_VPI_CONST PLI_BYTE8*name)
+{
+	/* These tasks can have automatic variables and are not monitor. */
+      sys_common_compiletf(name, 0, 0);
+      make_display_site(name, vpi_handle(vpiSysTfCall, 0));
+      return 0;
+}
+
+/* Check the $error, $warning and $info tasks. */
+static PLI_INT32 sys_severity_compiletf(ICARUS_VPI_CONST PLI_BYTE8*name)
 {
 	/* These tasks can have automatic variables and are not monitor. */
       return sys_common_compiletf(name, 0, 0);
@@ -1273,38 +1516,35 @@ static PLI_INT32 sys_display_compiletf(ICARUS_VPI_CONST PLI_BYTE8*name)
  * and the $write/$fwrite based tasks. */
 static PLI_INT32 sys_display_calltf(ICARUS_VPI_CONST PLI_BYTE8 *name)
 {
-      vpiHandle callh, argv, scope;
-      struct strobe_cb_info info;
-      char* result;
-      unsigned int size;
+      vpiHandle callh;
+      struct display_site_s*site;
+      struct display_out_s tmp_out = { 0, 0, 0 };
+      struct display_out_s*out;
       PLI_UINT32 fd_mcd;
       s_vpi_value val;
 
       callh = vpi_handle(vpiSysTfCall, 0);
-      argv = vpi_iterate(vpiArgument, callh);
+      site = (struct display_site_s*)vpi_get_userdata(callh);
+	/* $sformatf has its own compiletf, so the site is made here. */
+      if (site == 0) site = make_display_site(name, callh);
 
 	/* Get the file/MC descriptor and verify it is valid. */
       if(name[1] == 'f') {
 	      errno = 0;
-	      vpiHandle arg = vpi_scan(argv);
 	      val.format = vpiIntVal;
-	      vpi_get_value(arg, &val);
+	      vpi_get_value(site->fd_arg, &val);
 	      fd_mcd = val.value.integer;
 
 		/* If the MCD is zero we have nothing to do so just return. */
-	      if (fd_mcd == 0)  {
-		    vpi_free_object(argv);
-		    return 0;
-	      }
+	      if (fd_mcd == 0) return 0;
 
 	      if ((! IS_MCD(fd_mcd) && vpi_get_file(fd_mcd) == NULL) ||
 	          ( IS_MCD(fd_mcd) && my_mcd_printf(fd_mcd, "") == EOF)) {
-		    vpi_printf("WARNING: %s:%d: ", vpi_get_str(vpiFile, callh),
-		               (int)vpi_get(vpiLineNo, callh));
+		    vpi_printf("WARNING: %s:%d: ", site->info.filename,
+		               site->info.lineno);
 		    vpi_printf("invalid file descriptor/MCD (0x%x) given "
 		               "to %s.\n", (unsigned int)fd_mcd, name);
 		    errno = EBADF;
-		    vpi_free_object(argv);
 		    return 0;
 	      }
       } else if(strncmp(name,"$sformatf",9) == 0) {
@@ -1315,35 +1555,32 @@ static PLI_INT32 sys_display_calltf(ICARUS_VPI_CONST PLI_BYTE8 *name)
 	      fd_mcd = 1;
       }
 
-      scope = vpi_handle(vpiScope, callh);
-      assert(scope);
-	/* We could use vpi_get_str(vpiName, callh) to get the task name,
-	 * but name is already defined. */
-      info.name = name;
-      info.filename = strdup(vpi_get_str(vpiFile, callh));
-      info.lineno = (int)vpi_get(vpiLineNo, callh);
-      info.default_format = get_default_format(name);
-      info.scope = scope;
-      array_from_iterator(&info, argv);
+	/* An argument may call back into this site, so only use the
+	 * kept buffer if it is not already in use. */
+      if (site->busy) {
+	    out = &tmp_out;
+      } else {
+	    out = &site->out;
+	    out->len = 0;
+	    site->busy = 1;
+      }
 
 	/* Because %u and %z may put embedded NULL characters into the
-	 * returned string strlen() may not match the real size! */
-      result = get_display(&size, &info);
+	 * output strlen() may not match the real size! */
+      display_items(out, &site->info);
 
       if(fd_mcd > 0) {
-	      my_mcd_rawwrite(fd_mcd, result, size);
-	      if ((strncmp(name,"$display",8) == 0) ||
-	          (strncmp(name,"$fdisplay",9) == 0)) my_mcd_rawwrite(fd_mcd, "\n", 1);
+	      if (site->newline) display_append(out, "\n", 1);
+	      my_mcd_rawwrite(fd_mcd, out->str, out->len);
       } else {
 	      /* Return as a string ($sformatf) */
 	      val.format = vpiStringVal;
-	      val.value.str = result;
+	      val.value.str = display_finish(out);
 	      vpi_put_value(callh, &val, 0, vpiNoDelay);
       }
 
-      free(result);
-      free(info.filename);
-      free(info.items);
+      if (out == &tmp_out) free(tmp_out.str);
+      else site->busy = 0;
       return 0;
 }
 
@@ -1463,7 +1700,8 @@ static PLI_INT32 sys_strobe_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
  * though that monitor may be watching many variables).
  */
 
-static struct strobe_cb_info monitor_info = { 0, 0, 0, 0, 0, 0, 0, 0 };
+static struct strobe_cb_info monitor_info = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+static vpiHandle monitor_callh = 0;
 static vpiHandle *monitor_callbacks = 0;
 static int monitor_scheduled = 0;
 static int monitor_enabled = 1;
@@ -1528,16 +1766,16 @@ static PLI_INT32 sys_monitor_compiletf(ICARUS_VPI_CONST PLI_BYTE8 *name)
       return 0;
 }
 
-static PLI_INT32 sys_monitor_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
+/*
+ * Make the callh the current $monitor, and attach its callbacks.
+ */
+static void monitor_start(vpiHandle callh, const char*name)
 {
-      vpiHandle callh, argv, scope;
+      vpiHandle argv, scope;
       unsigned idx;
       struct t_cb_data cb;
       struct t_vpi_time timerec;
 
-      (void)name; /* Parameter is not used. */
-
-      callh = vpi_handle(vpiSysTfCall, 0);
       argv = vpi_iterate(vpiArgument, callh);
 
 	/* If there was a previous $monitor, then remove the callbacks
@@ -1567,6 +1805,7 @@ static PLI_INT32 sys_monitor_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       monitor_info.default_format = get_default_format(name);
       monitor_info.scope = scope;
       monitor_info.fd_mcd = 1;
+      monitor_callh = callh;
 
 	/* Attach callbacks to all the parameters that might change. */
       monitor_callbacks = calloc(monitor_info.nitems, sizeof(vpiHandle));
@@ -1606,6 +1845,11 @@ static PLI_INT32 sys_monitor_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
 
 	    }
       }
+}
+
+static PLI_INT32 sys_monitor_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
+{
+      monitor_start(vpi_handle(vpiSysTfCall, 0), name);
 
 	/* When the $monitor is called, it schedules a first display
 	   for the end of the current time, like a $strobe. */
@@ -1629,6 +1873,66 @@ static PLI_INT32 sys_monitoroff_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       return 0;
 }
 
+/*
+ * A checkpoint saves the $monitor as the number of its call, and the
+ * $timeformat settings. The restart attaches the $monitor again, but
+ * does not display it, because the saved run already did.
+ */
+static PLI_INT32 sys_display_start_of_save(p_cb_data cb)
+{
+      PLI_INT32 id = vpi_get(vpiSaveRestartID, 0);
+      PLI_INT32 data[6];
+
+      (void)cb; /* Parameter is not used. */
+
+      data[0] = monitor_callh ? vpip_systf_call_id(monitor_callh) : 0;
+      data[1] = monitor_enabled;
+      data[2] = timeformat_info.units;
+      data[3] = (PLI_INT32)timeformat_info.prec;
+      data[4] = (PLI_INT32)timeformat_info.width;
+      data[5] = (PLI_INT32)strlen(timeformat_info.suff);
+      vpi_put_data(id, (PLI_BYTE8*)data, sizeof data);
+      vpi_put_data(id, timeformat_info.suff, data[5]);
+      return 0;
+}
+
+static PLI_INT32 sys_display_start_of_restart(p_cb_data cb)
+{
+      static const char*monitor_names[] = {
+	    "$monitor", "$monitorb", "$monitoro", "$monitorh", 0
+      };
+      PLI_INT32 id = vpi_get(vpiSaveRestartID, 0);
+      PLI_INT32 data[6];
+      vpiHandle callh;
+      unsigned idx;
+
+      (void)cb; /* Parameter is not used. */
+
+      if (vpi_get_data(id, (PLI_BYTE8*)data, sizeof data) != sizeof data)
+	    return 0;
+
+      free(timeformat_info.suff);
+      timeformat_info.suff = malloc(data[5] + 1);
+      vpi_get_data(id, timeformat_info.suff, data[5]);
+      timeformat_info.suff[data[5]] = 0;
+      timeformat_info.units = data[2];
+      timeformat_info.prec = (unsigned)data[3];
+      timeformat_info.width = (unsigned)data[4];
+      monitor_enabled = data[1];
+
+      callh = data[0] ? vpip_systf_call_by_id(data[0]) : 0;
+      if (callh == 0)
+	    return 0;
+
+      for (idx = 0 ;  monitor_names[idx] ;  idx += 1) {
+	    if (strcmp(vpi_get_str(vpiName, callh), monitor_names[idx]) == 0) {
+		  monitor_start(callh, monitor_names[idx]);
+		  break;
+	    }
+      }
+      return 0;
+}
+
 static PLI_INT32 sys_swrite_compiletf(ICARUS_VPI_CONST PLI_BYTE8 *name)
 {
   vpiHandle callh = vpi_handle(vpiSysTfCall, 0);
@@ -2173,11 +2477,13 @@ static PLI_INT32 sys_end_of_simulation(p_cb_data cb_data)
       (void)cb_data; /* Parameter is not used. */
       free(monitor_callbacks);
       monitor_callbacks = 0;
+      free_display_sites();
       free(monitor_info.filename);
       free(monitor_info.items);
       monitor_info.items = 0;
       monitor_info.nitems = 0;
       monitor_info.name = 0;
+      monitor_callh = 0;
 
       free(timeformat_info.suff);
       timeformat_info.suff = 0;
@@ -2557,7 +2863,7 @@ void sys_display_register(void)
       tf_data.type      = vpiSysTask;
       tf_data.tfname    = "$error";
       tf_data.calltf    = sys_severity_calltf;
-      tf_data.compiletf = sys_display_compiletf;
+      tf_data.compiletf = sys_severity_compiletf;
       tf_data.sizetf    = 0;
       tf_data.user_data = "$error";
       res = vpi_register_systf(&tf_data);
@@ -2566,7 +2872,7 @@ void sys_display_register(void)
       tf_data.type      = vpiSysTask;
       tf_data.tfname    = "$warning";
       tf_data.calltf    = sys_severity_calltf;
-      tf_data.compiletf = sys_display_compiletf;
+      tf_data.compiletf = sys_severity_compiletf;
       tf_data.sizetf    = 0;
       tf_data.user_data = "$warning";
       res = vpi_register_systf(&tf_data);
@@ -2575,7 +2881,7 @@ void sys_display_register(void)
       tf_data.type      = vpiSysTask;
       tf_data.tfname    = "$info";
       tf_data.calltf    = sys_severity_calltf;
-      tf_data.compiletf = sys_display_compiletf;
+      tf_data.compiletf = sys_severity_compiletf;
       tf_data.sizetf    = 0;
       tf_data.user_data = "$info";
       res = vpi_register_systf(&tf_data);
@@ -2591,4 +2897,14 @@ void sys_display_register(void)
       cb_data.cb_rtn = sys_end_of_simulation;
       cb_data.user_data = "system";
       vpi_register_cb(&cb_data);
+
+      cb_data.reason = cbStartOfSave;
+      cb_data.cb_rtn = sys_display_start_of_save;
+      cb_data.user_data = "system";
+      vpi_register_cb(&cb_data);
+
+      cb_data.reason = cbStartOfRestart;
+      cb_data.cb_rtn = sys_display_start_of_restart;
+      cb_data.user_data = "system";
+      vpi_register_cb(&cb_data);
 }
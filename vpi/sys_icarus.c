@@ -17,7 +17,10 @@
  */
 
 #include "sys_priv.h"
+#include "vcd_priv.h"
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 
 static PLI_INT32 finish_and_return_calltf(ICARUS_VPI_CONST PLI_BYTE8* name)
 {
@@ -52,6 +55,58 @@ static PLI_INT32 task_not_implemented_compiletf(ICARUS_VPI_CONST PLI_BYTE8* name
       return 0;
 }
 
+/*
+ * $save and $restart take the name of a checkpoint file. The runtime
+ * writes the checkpoint at the end of the current time step, or
+ * replaces the running simulation with the saved one.
+ */
+static PLI_INT32 save_restart_calltf(ICARUS_VPI_CONST PLI_BYTE8* name)
+{
+      vpiHandle callh = vpi_handle(vpiSysTfCall, 0);
+      vpiHandle argv = vpi_iterate(vpiArgument, callh);
+      char *path = get_filename(callh, name, vpi_scan(argv));
+
+      vpi_free_object(argv);
+      if (path == 0) return 0;
+
+      if (strcmp(name, "$save") == 0) vpip_save_checkpoint(path);
+      else vpip_restart_checkpoint(path);
+
+      free(path);
+      return 0;
+}
+
+/*
+ * $fork_sim takes the name of a file that lists the variants to run.
+ * The runtime forks one child per variant, and this returns in each
+ * child to continue its simulation. The children would all write to
+ * a dump file that is already open, so that is refused here.
+ */
+static PLI_INT32 fork_sim_calltf(ICARUS_VPI_CONST PLI_BYTE8* name)
+{
+      vpiHandle callh = vpi_handle(vpiSysTfCall, 0);
+      vpiHandle argv = vpi_iterate(vpiArgument, callh);
+      const char *dump;
+      char *path = get_filename(callh, name, vpi_scan(argv));
+
+      vpi_free_object(argv);
+      if (path == 0) return 0;
+
+      if ((dump = vcd_dumpfile_open())) {
+	    vpi_printf("ERROR: %s:%d: ", vpi_get_str(vpiFile, callh),
+	               (int)vpi_get(vpiLineNo, callh));
+	    vpi_printf("%s: dump file \"%s\" is open; the variants cannot "
+	               "share it.\n", name, dump);
+	    free(path);
+	    return 0;
+      }
+
+      vpip_fork_sim(path);
+
+      free(path);
+      return 0;
+}
+
 /*
  * This is used to warn the user that the specified optional system
  * task/function is not available (from Annex C 1364-2005).
@@ -218,6 +273,26 @@ void sys_special_register(void)
       tf_data.tfname      = "$dumpportsflush";
       tf_data.user_data   = "$dumpportsflush";
       res = vpi_register_systf(&tf_data);
+      vpip_make_systf_system_defined(res);
+
+      tf_data.type        = vpiSysTask;
+      tf_data.calltf      = save_restart_calltf;
+      tf_data.sizetf      = 0;
+      tf_data.compiletf   = sys_one_string_arg_compiletf;
+      tf_data.tfname      = "$save";
+      tf_data.user_data   = "$save";
+      res = vpi_register_systf(&tf_data);
+      vpip_make_systf_system_defined(res);
+
+      tf_data.tfname      = "$restart";
+      tf_data.user_data   = "$restart";
+      res = vpi_register_systf(&tf_data);
+      vpip_make_systf_system_defined(res);
+
+      tf_data.calltf      = fork_sim_calltf;
+      tf_data.tfname      = "$fork_sim";
+      tf_data.user_data   = "$fork_sim";
+      res = vpi_register_systf(&tf_data);
       vpip_make_systf_system_defined(res);
 
 	/* The following optional system tasks/functions are not implemented
@@ -257,16 +332,6 @@ void sys_special_register(void)
       res = vpi_register_systf(&tf_data);
       vpip_make_systf_system_defined(res);
 
-      tf_data.tfname      = "$save";
-      tf_data.user_data   = "$save";
-      res = vpi_register_systf(&tf_data);
-      vpip_make_systf_system_defined(res);
-
-      tf_data.tfname      = "$restart";
-      tf_data.user_data   = "$restart";
-      res = vpi_register_systf(&tf_data);
-      vpip_make_systf_system_defined(res);
-
       tf_data.tfname      = "$incsave";
       tf_data.user_data   = "$incsave";
       res = vpi_register_systf(&tf_data);
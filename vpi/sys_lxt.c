@@ -443,6 +443,11 @@ static void *close_dumpfile(void)
 static void open_dumpfile(vpiHandle callh)
 {
       if (dump_path == 0) dump_path = strdup("dump.lxt");
+      {
+	    char*path = vpip_fork_file_name(dump_path);
+	    free(dump_path);
+	    dump_path = path;
+      }
 
       dump_file = lt_init(dump_path);
 
@@ -459,6 +464,7 @@ static void open_dumpfile(vpiHandle callh)
 
 	    vpi_printf("LXT info: dumpfile %s opened for output.\n",
 	               dump_path);
+	    vcd_dumpfile_opened(dump_path);
 
 	    assert(prec >= -15);
 	    lt_set_timescale(dump_file, prec);
@@ -788,11 +794,49 @@ static PLI_INT32 sys_dumpvars_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       return 0;
 }
 
+/*
+ * The LXT writer cannot continue a file that a restart reopens, so
+ * a checkpoint is refused once $dumpvars has opened the dump file.
+ * Before that only the name given by $dumpfile is saved.
+ */
+static PLI_INT32 sys_lxt_start_of_save(p_cb_data cause)
+{
+      PLI_INT32 id = vpi_get(vpiSaveRestartID, 0);
+      PLI_INT32 len = dump_path ? (PLI_INT32)strlen(dump_path) : -1;
+
+      (void)cause; /* Parameter is not used. */
+
+      if (dumpvars_status != 0) return 1;
+
+      vpi_put_data(id, (PLI_BYTE8*)&len, sizeof len);
+      if (len > 0) vpi_put_data(id, dump_path, len);
+      return 0;
+}
+
+static PLI_INT32 sys_lxt_start_of_restart(p_cb_data cause)
+{
+      PLI_INT32 id = vpi_get(vpiSaveRestartID, 0);
+      PLI_INT32 len;
+
+      (void)cause; /* Parameter is not used. */
+
+      if (vpi_get_data(id, (PLI_BYTE8*)&len, sizeof len) != sizeof len)
+	    return 0;
+      if (len < 0) return 0;
+
+      free(dump_path);
+      dump_path = malloc(len + 1);
+      vpi_get_data(id, dump_path, len);
+      dump_path[len] = 0;
+      return 0;
+}
+
 void sys_lxt_register(void)
 {
       int idx;
       struct t_vpi_vlog_info vlog_info;
       s_vpi_systf_data tf_data;
+      s_cb_data cb_data;
       vpiHandle res;
 
 
@@ -874,4 +918,16 @@ void sys_lxt_register(void)
       tf_data.user_data = "$dumpvars";
       res = vpi_register_systf(&tf_data);
       vpip_make_systf_system_defined(res);
+
+      cb_data.reason = cbStartOfSave;
+      cb_data.cb_rtn = sys_lxt_start_of_save;
+      cb_data.obj = 0;
+      cb_data.time = 0;
+      cb_data.value = 0;
+      cb_data.user_data = "system";
+      vpi_register_cb(&cb_data);
+
+      cb_data.reason = cbStartOfRestart;
+      cb_data.cb_rtn = sys_lxt_start_of_restart;
+      vpi_register_cb(&cb_data);
 }
@@ -480,6 +480,11 @@ static void open_dumpfile(vpiHandle callh)
 {
       off_t use_file_size_limit = lxt2_file_size_limit;
       if (dump_path == 0) dump_path = strdup("dump.lx2");
+      {
+	    char*path = vpip_fork_file_name(dump_path);
+	    free(dump_path);
+	    dump_path = path;
+      }
 
       dump_file = lxt2_wr_init(dump_path);
 
@@ -509,6 +514,7 @@ static void open_dumpfile(vpiHandle callh)
 
 	    vpi_printf("LXT2 info: dumpfile %s opened for output.\n",
 	               dump_path);
+	    vcd_dumpfile_opened(dump_path);
 
 	    assert(prec >= -15);
 	    lxt2_wr_set_timescale(dump_file, prec);
@@ -859,6 +865,13 @@ static void* lxt2_thread(void*arg)
 	    switch (cell->type) {
 		case WT_NONE:
 		  break;
+		  /* These are only used by the VCD dumper. */
+		case WT_EMIT_VECTOR:
+		case WT_EMIT_TIME:
+		case WT_EMIT_TEXT:
+		case WT_STEP_BEGIN:
+		case WT_STEP_END:
+		  break;
 		case WT_FLUSH:
 		  lxt2_wr_flush(dump_file);
 		  break;
@@ -887,11 +900,49 @@ static void* lxt2_thread(void*arg)
       return 0;
 }
 
+/*
+ * The LXT2 writer cannot continue a file that a restart reopens, so
+ * a checkpoint is refused once $dumpvars has opened the dump file.
+ * Before that only the name given by $dumpfile is saved.
+ */
+static PLI_INT32 sys_lxt2_start_of_save(p_cb_data cause)
+{
+      PLI_INT32 id = vpi_get(vpiSaveRestartID, 0);
+      PLI_INT32 len = dump_path ? (PLI_INT32)strlen(dump_path) : -1;
+
+      (void)cause; /* Parameter is not used. */
+
+      if (dumpvars_status != 0) return 1;
+
+      vpi_put_data(id, (PLI_BYTE8*)&len, sizeof len);
+      if (len > 0) vpi_put_data(id, dump_path, len);
+      return 0;
+}
+
+static PLI_INT32 sys_lxt2_start_of_restart(p_cb_data cause)
+{
+      PLI_INT32 id = vpi_get(vpiSaveRestartID, 0);
+      PLI_INT32 len;
+
+      (void)cause; /* Parameter is not used. */
+
+      if (vpi_get_data(id, (PLI_BYTE8*)&len, sizeof len) != sizeof len)
+	    return 0;
+      if (len < 0) return 0;
+
+      free(dump_path);
+      dump_path = malloc(len + 1);
+      vpi_get_data(id, dump_path, len);
+      dump_path[len] = 0;
+      return 0;
+}
+
 void sys_lxt2_register(void)
 {
       int idx;
       struct t_vpi_vlog_info vlog_info;
       s_vpi_systf_data tf_data;
+      s_cb_data cb_data;
       vpiHandle res;
 
 	/* Scan the extended arguments, looking for lxt2 optimization flags. */
@@ -978,4 +1029,16 @@ void sys_lxt2_register(void)
       tf_data.user_data = "$dumpvars";
       res = vpi_register_systf(&tf_data);
       vpip_make_systf_system_defined(res);
+
+      cb_data.reason = cbStartOfSave;
+      cb_data.cb_rtn = sys_lxt2_start_of_save;
+      cb_data.obj = 0;
+      cb_data.time = 0;
+      cb_data.value = 0;
+      cb_data.user_data = "system";
+      vpi_register_cb(&cb_data);
+
+      cb_data.reason = cbStartOfRestart;
+      cb_data.cb_rtn = sys_lxt2_start_of_restart;
+      vpi_register_cb(&cb_data);
 }
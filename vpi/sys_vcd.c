@@ -29,6 +29,7 @@
 # include  <string.h>
 # include  <assert.h>
 # include  <time.h>
+# include  <unistd.h>
 # include  "ivl_alloc.h"
 
 static char *dump_path = NULL;
@@ -36,6 +37,12 @@ static FILE *dump_file = NULL;
 
 static struct t_vpi_time zero_delay = { vpiSimTime, 0, 0, 0.0 };
 
+enum vcd_kind_e {
+      VCD_KIND_VECTOR,
+      VCD_KIND_REAL,
+      VCD_KIND_EVENT
+};
+
 struct vcd_info {
       vpiHandle item;
       vpiHandle cb;
@@ -43,6 +50,8 @@ struct vcd_info {
       const char *ident;
       struct vcd_info *next;
       struct vcd_info *dmp_next;
+      unsigned size;
+      enum vcd_kind_e kind;
       int scheduled;
 };
 
@@ -55,6 +64,40 @@ static long dump_limit = 0;
 static int dump_is_full = 0;
 static int finish_status = 0;
 
+/*
+ * The value changes are normally captured on the simulation thread
+ * and sent through the work queue (see vcd_priv2.cc) to a work thread
+ * that formats and writes them. The +vcd-sync plusarg writes them
+ * directly from the simulation thread instead, and so does a machine
+ * with only one CPU, where the work thread would only add overhead.
+ * The header is always written directly, and the work thread is
+ * started after it.
+ */
+static int vcd_sync_flag = 0;
+static int vcd_async = 0;
+
+/*
+ * Only the work thread knows the file position, so when it is running
+ * it checks the dump limit itself, at the start of the value changes
+ * of each time step. Once the limit is passed it writes the comment,
+ * drops the value changes of this and later time steps, and sets
+ * vcd_limit_hit. The simulation thread stops sending value changes
+ * when it sees that flag. This way a dump limit does not make each
+ * value change wait for the work thread, and the file gets the same
+ * contents as with +vcd-sync.
+ */
+static int vcd_limit_hit = 0;
+static int vcd_limit_warned = 0;
+
+static int use_work_thread(void)
+{
+      if (vcd_sync_flag) return 0;
+#if defined(_SC_NPROCESSORS_ONLN)
+      if (sysconf(_SC_NPROCESSORS_ONLN) < 2) return 0;
+#endif
+      return 1;
+}
+
 
 static const char*units_names[] = {
       "s",
@@ -101,43 +144,234 @@ static char *truncate_bitvec(char *s)
       }
 }
 
+/*
+ * Write a vector value in the aval/bval form of vpiVectorVal. This is
+ * called by the work thread, or by the simulation thread if there is
+ * no work thread, so only one thread at a time uses the buffer.
+ */
+static char *vector_buf = 0;
+static unsigned vector_buf_size = 0;
+
+/*
+ * The characters for 4 bits at a time, indexed by the aval bits in the
+ * low nibble and the bval bits in the high nibble. The most significant
+ * bit is first so the characters can be copied straight to the output.
+ */
+static char nibble_chars[256][4];
+
+static void init_nibble_chars(void)
+{
+      static const char bit_chars[4] = { '0', '1', 'z', 'x' };
+      unsigned idx, bit;
+
+      for (idx = 0 ;  idx < 256 ;  idx += 1) {
+	    for (bit = 0 ;  bit < 4 ;  bit += 1) {
+		  unsigned code = ((idx >> bit) & 1) | (((idx >> (bit+4)) & 1) << 1);
+		  nibble_chars[idx][3-bit] = bit_chars[code];
+	    }
+      }
+}
+
+static void write_vector(const char*ident, unsigned wid,
+			 const s_vpi_vecval*vec)
+{
+      unsigned idx;
+      char*cp;
+
+      if (wid+1 > vector_buf_size) {
+	    vector_buf_size = wid+1;
+	    vector_buf = realloc(vector_buf, vector_buf_size);
+      }
+
+	/* Fill the buffer from the least significant end, 4 bits at a
+	   time, and finish the last word a bit at a time. */
+      cp = vector_buf + wid;
+      *cp = 0;
+      for (idx = 0 ;  idx < wid ;  idx += 32) {
+	    PLI_UINT32 aval = vec[idx/32].aval;
+	    PLI_UINT32 bval = vec[idx/32].bval;
+	    unsigned cnt = wid - idx < 32 ? wid - idx : 32;
+	    while (cnt >= 4) {
+		  cp -= 4;
+		  memcpy(cp, nibble_chars[(aval&15) | ((bval&15)<<4)], 4);
+		  aval >>= 4;
+		  bval >>= 4;
+		  cnt -= 4;
+	    }
+	    while (cnt > 0) {
+		  *--cp = nibble_chars[(aval&1) | ((bval&1)<<4)][3];
+		  aval >>= 1;
+		  bval >>= 1;
+		  cnt -= 1;
+	    }
+      }
+
+      if (wid == 1)
+	    fprintf(dump_file, "%s%s\n", vector_buf, ident);
+      else
+	    fprintf(dump_file, "b%s %s\n", truncate_bitvec(vector_buf), ident);
+}
+
+static void write_text(const char*text, const char*ident)
+{
+      fputs(text, dump_file);
+      if (ident) fprintf(dump_file, "%s\n", ident);
+}
+
+static int dump_limit_passed(void)
+{
+      long limit = __atomic_load_n(&dump_limit, __ATOMIC_RELAXED);
+
+      if ((limit <= 0) || (ftell(dump_file) <= limit)) return 0;
+
+      fprintf(dump_file, "$comment Dump file limit (%ld bytes) "
+                         "exceeded. $end\n", limit);
+      __atomic_store_n(&vcd_limit_hit, 1, __ATOMIC_RELEASE);
+      return 1;
+}
+
+static void warn_dump_limit(void)
+{
+      if (vcd_limit_warned) return;
+      vcd_limit_warned = 1;
+      vpi_printf("WARNING: Dump file limit (%ld bytes) "
+                         "exceeded.\n", dump_limit);
+}
+
+static void* vcd_thread(void*arg)
+{
+      int run_flag = 1;
+      int limit_flag = 0;
+      int skip_flag = 0;
+
+      (void)arg; /* Parameter is not used. */
+
+      while (run_flag) {
+	    struct vcd_work_item_s*cell = vcd_work_thread_peek();
+
+	    switch (cell->type) {
+		case WT_STEP_BEGIN:
+		  if (cell->wid && !limit_flag)
+			limit_flag = dump_limit_passed();
+		  skip_flag = limit_flag;
+		  vcd_work_thread_pop();
+		  continue;
+		case WT_STEP_END:
+		  skip_flag = 0;
+		  vcd_work_thread_pop();
+		  continue;
+		default:
+		  break;
+	    }
+
+	    if (skip_flag) {
+		  vcd_work_thread_pop();
+		  continue;
+	    }
+
+	    switch (cell->type) {
+		case WT_EMIT_VECTOR:
+		  write_vector(cell->sym_.vcd, cell->wid,
+			       cell->wid <= 32 ? &cell->op_.val_word
+			                       : cell->op_.val_vec);
+		  break;
+		case WT_EMIT_DOUBLE:
+		  fprintf(dump_file, "r%.16g %s\n", cell->op_.val_double,
+			  cell->sym_.vcd);
+		  break;
+		case WT_EMIT_TIME:
+		  fprintf(dump_file, "#%" PLI_UINT64_FMT "\n",
+			  (PLI_UINT64)cell->time);
+		  break;
+		case WT_EMIT_TEXT:
+		  write_text(cell->op_.val_text, cell->sym_.vcd);
+		  break;
+		case WT_FLUSH:
+		  fflush(dump_file);
+		  break;
+		case WT_TERMINATE:
+		  run_flag = 0;
+		  break;
+		  /* These are not used by the VCD dumper. */
+		case WT_NONE:
+		case WT_EMIT_BITS:
+		case WT_DUMPON:
+		case WT_DUMPOFF:
+		case WT_STEP_BEGIN:
+		case WT_STEP_END:
+		  break;
+	    }
+
+	    vcd_work_thread_pop();
+      }
+
+      return 0;
+}
+
+/*
+ * Send output to the work thread if it is running, otherwise write it
+ * directly.
+ */
+static void emit_time(PLI_UINT64 now)
+{
+      if (vcd_async) {
+	    vcd_work_set_time(now);
+	    vcd_work_emit_time();
+      } else {
+	    fprintf(dump_file, "#%" PLI_UINT64_FMT "\n", now);
+      }
+}
+
+static void emit_text(const char*text, const char*ident)
+{
+      if (vcd_async) vcd_work_emit_text(text, ident);
+      else write_text(text, ident);
+}
+
 static void show_this_item(struct vcd_info*info)
 {
       s_vpi_value value;
-      PLI_INT32 type = vpi_get(vpiType, info->item);
 
-      if (type == vpiRealVar) {
+      switch (info->kind) {
+	  case VCD_KIND_REAL:
 	    value.format = vpiRealVal;
 	    vpi_get_value(info->item, &value);
-	    fprintf(dump_file, "r%.16g %s\n", value.value.real, info->ident);
-      } else if (type == vpiNamedEvent) {
-	    fprintf(dump_file, "1%s\n", info->ident);
-      } else if (vpi_get(vpiSize, info->item) == 1) {
-	    value.format = vpiBinStrVal;
-	    vpi_get_value(info->item, &value);
-	    fprintf(dump_file, "%s%s\n", value.value.str, info->ident);
-      } else {
-	    value.format = vpiBinStrVal;
+	    if (vcd_async)
+		  vcd_work_emit_vcd_double(info->ident, value.value.real);
+	    else
+		  fprintf(dump_file, "r%.16g %s\n", value.value.real,
+			  info->ident);
+	    break;
+	  case VCD_KIND_EVENT:
+	    emit_text("1", info->ident);
+	    break;
+	  case VCD_KIND_VECTOR:
+	    value.format = vpiVectorVal;
 	    vpi_get_value(info->item, &value);
-	    fprintf(dump_file, "b%s %s\n", truncate_bitvec(value.value.str),
-		    info->ident);
+	    if (vcd_async)
+		  vcd_work_emit_vector(info->ident, info->size,
+				       value.value.vector);
+	    else
+		  write_vector(info->ident, info->size, value.value.vector);
+	    break;
       }
 }
 
 /* Dump values for a $dumpoff. */
 static void show_this_item_x(struct vcd_info*info)
 {
-      PLI_INT32 type = vpi_get(vpiType, info->item);
-
-      if (type == vpiRealVar) {
+      switch (info->kind) {
+	  case VCD_KIND_REAL:
 	      /* Some tools dump nothing here...? */
-	    fprintf(dump_file, "rNaN %s\n", info->ident);
-      } else if (type == vpiNamedEvent) {
-	    /* Do nothing for named events. */
-      } else if (vpi_get(vpiSize, info->item) == 1) {
-	    fprintf(dump_file, "x%s\n", info->ident);
-      } else {
-	    fprintf(dump_file, "bx %s\n", info->ident);
+	    emit_text("rNaN ", info->ident);
+	    break;
+	  case VCD_KIND_EVENT:
+	      /* Do nothing for named events. */
+	    break;
+	  case VCD_KIND_VECTOR:
+	    if (info->size == 1) emit_text("x", info->ident);
+	    else emit_text("bx ", info->ident);
+	    break;
       }
 }
 
@@ -182,8 +416,10 @@ static PLI_INT32 variable_cb_2(p_cb_data cause)
       struct vcd_info* info = vcd_dmp_list;
       PLI_UINT64 now = timerec_to_time64(cause->time);
 
+      if (vcd_async) vcd_work_step_begin(1);
+
       if (now != vcd_cur_time) {
-	    fprintf(dump_file, "#%" PLI_UINT64_FMT "\n", now);
+	    emit_time(now);
 	    vcd_cur_time = now;
       }
 
@@ -192,6 +428,8 @@ static PLI_INT32 variable_cb_2(p_cb_data cause)
            info->scheduled = 0;
       } while ((info = info->dmp_next) != 0);
 
+      if (vcd_async) vcd_work_step_end();
+
       vcd_dmp_list = 0;
 
       return 0;
@@ -207,10 +445,15 @@ static PLI_INT32 variable_cb_1(p_cb_data cause)
       if (dump_header_pending()) return 0;
       if (info->scheduled) return 0;
 
-      if ((dump_limit > 0) && (ftell(dump_file) > dump_limit)) {
+      if (vcd_async) {
+	    if (__atomic_load_n(&vcd_limit_hit, __ATOMIC_ACQUIRE)) {
+		  dump_is_full = 1;
+		  warn_dump_limit();
+		  return 0;
+	    }
+      } else if ((dump_limit > 0) && (ftell(dump_file) > dump_limit)) {
             dump_is_full = 1;
-            vpi_printf("WARNING: Dump file limit (%ld bytes) "
-                               "exceeded.\n", dump_limit);
+            warn_dump_limit();
             fprintf(dump_file, "$comment Dump file limit (%ld bytes) "
                                "exceeded. $end\n", dump_limit);
             return 0;
@@ -242,11 +485,16 @@ static PLI_INT32 dumpvars_cb(p_cb_data cause)
 
       fprintf(dump_file, "$enddefinitions $end\n");
 
+      if (use_work_thread()) {
+	    vcd_work_start(vcd_thread, 0);
+	    vcd_async = 1;
+      }
+
       if (!dump_is_off) {
-	    fprintf(dump_file, "#%" PLI_UINT64_FMT "\n", dumpvars_time);
-	    fprintf(dump_file, "$dumpvars\n");
+	    emit_time(dumpvars_time);
+	    emit_text("$dumpvars\n", 0);
 	    vcd_checkpoint();
-	    fprintf(dump_file, "$end\n");
+	    emit_text("$end\n", 0);
       }
 
       return 0;
@@ -263,7 +511,16 @@ static PLI_INT32 finish_cb(p_cb_data cause)
       dumpvars_time = timerec_to_time64(cause->time);
 
       if (!dump_is_off && !dump_is_full && dumpvars_time != vcd_cur_time) {
-	    fprintf(dump_file, "#%" PLI_UINT64_FMT "\n", dumpvars_time);
+	      /* This is skipped if the work thread found the file full. */
+	    if (vcd_async) vcd_work_step_begin(0);
+	    emit_time(dumpvars_time);
+	    if (vcd_async) vcd_work_step_end();
+      }
+
+      if (vcd_async) {
+	    vcd_work_terminate();
+	    vcd_async = 0;
+	    if (vcd_limit_hit) warn_dump_limit();
       }
 
       fclose(dump_file);
@@ -279,6 +536,9 @@ static PLI_INT32 finish_cb(p_cb_data cause)
       nexus_ident_delete();
       free(dump_path);
       dump_path = 0;
+      free(vector_buf);
+      vector_buf = 0;
+      vector_buf_size = 0;
 
       return 0;
 }
@@ -332,13 +592,13 @@ static PLI_INT32 sys_dumpoff_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       now64 = timerec_to_time64(&now);
 
       if (now64 > vcd_cur_time) {
-	    fprintf(dump_file, "#%" PLI_UINT64_FMT "\n", now64);
+	    emit_time(now64);
 	    vcd_cur_time = now64;
       }
 
-      fprintf(dump_file, "$dumpoff\n");
+      emit_text("$dumpoff\n", 0);
       vcd_checkpoint_x();
-      fprintf(dump_file, "$end\n");
+      emit_text("$end\n", 0);
 
       return 0;
 }
@@ -362,13 +622,13 @@ static PLI_INT32 sys_dumpon_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       now64 = timerec_to_time64(&now);
 
       if (now64 > vcd_cur_time) {
-	    fprintf(dump_file, "#%" PLI_UINT64_FMT "\n", now64);
+	    emit_time(now64);
 	    vcd_cur_time = now64;
       }
 
-      fprintf(dump_file, "$dumpon\n");
+      emit_text("$dumpon\n", 0);
       vcd_checkpoint();
-      fprintf(dump_file, "$end\n");
+      emit_text("$end\n", 0);
 
       return 0;
 }
@@ -389,13 +649,13 @@ static PLI_INT32 sys_dumpall_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       now64 = timerec_to_time64(&now);
 
       if (now64 > vcd_cur_time) {
-	    fprintf(dump_file, "#%" PLI_UINT64_FMT "\n", now64);
+	    emit_time(now64);
 	    vcd_cur_time = now64;
       }
 
-      fprintf(dump_file, "$dumpall\n");
+      emit_text("$dumpall\n", 0);
       vcd_checkpoint();
-      fprintf(dump_file, "$end\n");
+      emit_text("$end\n", 0);
 
       return 0;
 }
@@ -403,6 +663,12 @@ static PLI_INT32 sys_dumpall_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
 static void open_dumpfile(vpiHandle callh)
 {
       if (dump_path == 0) dump_path = strdup("dump.vcd");
+	/* Each $fork_sim variant writes its own dump file. */
+      {
+	    char*path = vpip_fork_file_name(dump_path);
+	    free(dump_path);
+	    dump_path = path;
+      }
 
       dump_file = fopen(dump_path, "w");
 
@@ -422,6 +688,7 @@ static void open_dumpfile(vpiHandle callh)
 
 	    vpi_printf("VCD info: dumpfile %s opened for output.\n",
 	               dump_path);
+	    vcd_dumpfile_opened(dump_path);
 
 	    time(&walltime);
 
@@ -485,7 +752,14 @@ static PLI_INT32 sys_dumpfile_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
 static PLI_INT32 sys_dumpflush_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
 {
       (void)name; /* Parameter is not used. */
-      if (dump_file) fflush(dump_file);
+      if (dump_file == 0) return 0;
+
+      if (vcd_async) {
+	    vcd_work_flush();
+	    vcd_work_sync();
+      } else {
+	    fflush(dump_file);
+      }
 
       return 0;
 }
@@ -501,7 +775,7 @@ static PLI_INT32 sys_dumplimit_calltf(ICARUS_VPI_CONST PLI_BYTE8 *name)
       /* Get the value and set the dump limit. */
       val.format = vpiIntVal;
       vpi_get_value(vpi_scan(argv), &val);
-      dump_limit = val.value.integer;
+      __atomic_store_n(&dump_limit, (long)val.value.integer, __ATOMIC_RELAXED);
 
       vpi_free_object(argv);
       return 0;
@@ -645,6 +919,20 @@ static void scan_item(unsigned depth, vpiHandle item, int skip)
 		  info->item  = item;
 		  info->ident = ident;
 		  info->scheduled = 0;
+		  switch (item_type) {
+		      case vpiRealVar:
+			info->kind = VCD_KIND_REAL;
+			info->size = 1;
+			break;
+		      case vpiNamedEvent:
+			info->kind = VCD_KIND_EVENT;
+			info->size = 1;
+			break;
+		      default:
+			info->kind = VCD_KIND_VECTOR;
+			info->size = vpi_get(vpiSize, item);
+			break;
+		  }
 
 		  cb.time      = &info->time;
 		  cb.user_data = (char*)info;
@@ -869,11 +1157,218 @@ static PLI_INT32 sys_dumpvars_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       return 0;
 }
 
+/*
+ * A checkpoint saves the position in the dump file and the list of
+ * dumped variables, by name. The restart cuts the file back to the
+ * saved position and attaches the value change callbacks again, so
+ * the restarted run continues the dump where the saved run was.
+ */
+struct vcd_save_s {
+      PLI_UINT64 offset;
+      PLI_UINT64 cur_time;
+      PLI_UINT64 dumpvars_time;
+      long dump_limit;
+      PLI_INT32 dumpvars_status;
+      PLI_INT32 dump_is_off;
+      PLI_INT32 dump_is_full;
+      PLI_INT32 limit_hit;
+      PLI_INT32 limit_warned;
+      PLI_INT32 nitems;
+};
+
+static void vcd_put_str(PLI_INT32 id, const char*str)
+{
+      PLI_INT32 len = str ? (PLI_INT32)strlen(str) : -1;
+
+      vpi_put_data(id, (PLI_BYTE8*)&len, sizeof len);
+      if (len > 0) vpi_put_data(id, (PLI_BYTE8*)str, len);
+}
+
+static char* vcd_get_str(PLI_INT32 id)
+{
+      PLI_INT32 len;
+      char*str;
+
+      if (vpi_get_data(id, (PLI_BYTE8*)&len, sizeof len) != sizeof len)
+	    return 0;
+      if (len < 0) return 0;
+
+      str = malloc(len + 1);
+      vpi_get_data(id, str, len);
+      str[len] = 0;
+      return str;
+}
+
+static PLI_INT32 sys_vcd_start_of_save(p_cb_data cause)
+{
+      PLI_INT32 id = vpi_get(vpiSaveRestartID, 0);
+      struct vcd_save_s data;
+      struct vcd_info*cur;
+
+      (void)cause; /* Parameter is not used. */
+
+	/* The header is written at the end of the time step that
+	 * called $dumpvars, so there is nothing to save before. */
+      if (dumpvars_status == 1 || finish_status != 0) return 1;
+
+      if (dump_file) {
+	    if (vcd_async) {
+		  vcd_work_flush();
+		  vcd_work_sync();
+	    } else {
+		  fflush(dump_file);
+	    }
+      }
+
+      memset(&data, 0, sizeof data);
+      data.offset = dump_file ? (PLI_UINT64)ftell(dump_file) : 0;
+      data.cur_time = vcd_cur_time;
+      data.dumpvars_time = dumpvars_time;
+      data.dump_limit = __atomic_load_n(&dump_limit, __ATOMIC_RELAXED);
+      data.dumpvars_status = dumpvars_status;
+      data.dump_is_off = dump_is_off;
+      data.dump_is_full = dump_is_full;
+      data.limit_hit = __atomic_load_n(&vcd_limit_hit, __ATOMIC_ACQUIRE);
+      data.limit_warned = vcd_limit_warned;
+      for (cur = vcd_list ;  cur ;  cur = cur->next)
+	    data.nitems += 1;
+
+      vpi_put_data(id, (PLI_BYTE8*)&data, sizeof data);
+      vcd_put_str(id, dump_path);
+
+	/* An array word is saved as the array and the word index. */
+      for (cur = vcd_list ;  cur ;  cur = cur->next) {
+	    PLI_INT32 item[3];
+	    vpiHandle obj = cur->item;
+	    item[0] = cur->kind;
+	    item[1] = cur->size;
+	    item[2] = -1;
+	    if (vpi_get(vpiType, obj) == vpiMemoryWord) {
+		  item[2] = vpi_get(vpiIndex, obj);
+		  obj = vpi_handle(vpiParent, obj);
+	    }
+	    vpi_put_data(id, (PLI_BYTE8*)item, sizeof item);
+	    vcd_put_str(id, vpi_get_str(vpiFullName, obj));
+	    vcd_put_str(id, cur->ident);
+      }
+
+      return 0;
+}
+
+static PLI_INT32 sys_vcd_start_of_restart(p_cb_data cause)
+{
+      PLI_INT32 id = vpi_get(vpiSaveRestartID, 0);
+      struct vcd_save_s data;
+      struct vcd_info*tail = 0;
+      struct t_cb_data cb;
+      PLI_INT32 idx;
+
+      (void)cause; /* Parameter is not used. */
+
+      if (vpi_get_data(id, (PLI_BYTE8*)&data, sizeof data) != sizeof data)
+	    return 0;
+
+      free(dump_path);
+      dump_path = vcd_get_str(id);
+      __atomic_store_n(&dump_limit, data.dump_limit, __ATOMIC_RELAXED);
+      dump_is_off = data.dump_is_off;
+
+      if (data.dumpvars_status != 2) return 0;
+
+      dump_file = fopen(dump_path, "r+b");
+      if (dump_file == 0 || fseek(dump_file, (long)data.offset, SEEK_SET) != 0
+	  || ftruncate(fileno(dump_file), (off_t)data.offset) != 0) {
+	    vpi_printf("VCD Error: Unable to reopen %s for the restart.\n",
+	               dump_path);
+	    vpi_control(vpiFinish, 1);
+	    if (dump_file) fclose(dump_file);
+	    dump_file = 0;
+	    return 0;
+      }
+      vcd_dumpfile_opened(dump_path);
+
+      vcd_cur_time = data.cur_time;
+      dumpvars_time = data.dumpvars_time;
+      dumpvars_status = 2;
+      dump_is_full = data.dump_is_full;
+      vcd_limit_hit = data.limit_hit;
+      vcd_limit_warned = data.limit_warned;
+
+      for (idx = 0 ;  idx < data.nitems ;  idx += 1) {
+	    PLI_INT32 item[3];
+	    char*name;
+	    struct vcd_info*info;
+	    vpiHandle obj;
+
+	    vpi_get_data(id, (PLI_BYTE8*)item, sizeof item);
+	    name = vcd_get_str(id);
+	    obj = vpi_handle_by_name(name, 0);
+	    if (obj && item[2] >= 0) obj = vpi_handle_by_index(obj, item[2]);
+	    if (obj == 0) {
+		  vpi_printf("VCD warning: %s is not dumped after the "
+		             "restart.\n", name);
+		  free(name);
+		  free(vcd_get_str(id));
+		  continue;
+	    }
+	    free(name);
+
+	    info = malloc(sizeof(*info));
+	    info->time.type = vpiSimTime;
+	    info->item  = obj;
+	    info->ident = vcd_get_str(id);
+	    info->scheduled = 0;
+	    info->kind = (enum vcd_kind_e)item[0];
+	    info->size = item[1];
+	    info->dmp_next = 0;
+	    info->next = 0;
+	    if (tail) tail->next = info;
+	    else vcd_list = info;
+	    tail = info;
+
+	    cb.time      = &info->time;
+	    cb.user_data = (char*)info;
+	    cb.value     = NULL;
+	    cb.obj       = obj;
+	    cb.reason    = cbValueChange;
+	    cb.cb_rtn    = variable_cb_1;
+	    info->cb     = vpi_register_cb(&cb);
+      }
+
+      cb.time = &zero_delay;
+      cb.reason = cbEndOfSimulation;
+      cb.cb_rtn = finish_cb;
+      cb.user_data = 0x0;
+      cb.obj = 0x0;
+      vpi_register_cb(&cb);
+
+      if (use_work_thread()) {
+	    vcd_work_start(vcd_thread, 0);
+	    vcd_async = 1;
+      }
+
+      return 0;
+}
+
 void sys_vcd_register(void)
 {
+      int idx;
+      struct t_vpi_vlog_info vlog_info;
       s_vpi_systf_data tf_data;
+      s_cb_data cb_data;
       vpiHandle res;
 
+	/* Scan the extended arguments, looking for the flag that turns
+	   off the VCD work thread. */
+      vpi_get_vlog_info(&vlog_info);
+
+      for (idx = 0 ;  idx < vlog_info.argc ;  idx += 1) {
+	    if (strcmp(vlog_info.argv[idx],"+vcd-sync") == 0)
+		  vcd_sync_flag = 1;
+      }
+
+      init_nibble_chars();
+
       /* All the compiletf routines are located in vcd_priv.c. */
 
       tf_data.type      = vpiSysTask;
@@ -938,4 +1433,16 @@ void sys_vcd_register(void)
       tf_data.user_data = "$dumpvars";
       res = vpi_register_systf(&tf_data);
       vpip_make_systf_system_defined(res);
+
+      cb_data.reason = cbStartOfSave;
+      cb_data.cb_rtn = sys_vcd_start_of_save;
+      cb_data.obj = 0;
+      cb_data.time = 0;
+      cb_data.value = 0;
+      cb_data.user_data = "system";
+      vpi_register_cb(&cb_data);
+
+      cb_data.reason = cbStartOfRestart;
+      cb_data.cb_rtn = sys_vcd_start_of_restart;
+      vpi_register_cb(&cb_data);
 }
@@ -217,3 +217,16 @@ PLI_INT32 sys_dumpvars_compiletf(ICARUS_VPI_CONST PLI_BYTE8 *name)
 
       return 0;
 }
+
+static char*dumpfile_open = 0;
+
+void vcd_dumpfile_opened(const char*path)
+{
+      free(dumpfile_open);
+      dumpfile_open = strdup(path);
+}
+
+const char*vcd_dumpfile_open(void)
+{
+      return dumpfile_open;
+}
@@ -65,15 +65,27 @@ EXTERN void vcd_scope_names_delete(void);
 /*
  * Implement a work queue that can be used to send commands to a
  * dumper thread.
+ *
+ * The WT_EMIT_VECTOR, WT_EMIT_TIME and WT_EMIT_TEXT items are only
+ * used by the VCD dumper. A vector of up to 32 bits is carried in the
+ * val_word member, and a wider one in a copy at val_vec that the work
+ * queue releases. The text of a WT_EMIT_TEXT item is a constant
+ * string, followed by the VCD identifier and a newline if there is
+ * an identifier.
  */
 
 typedef enum vcd_work_item_type_e {
       WT_NONE,
       WT_EMIT_BITS,
       WT_EMIT_DOUBLE,
+      WT_EMIT_VECTOR,
+      WT_EMIT_TIME,
+      WT_EMIT_TEXT,
       WT_DUMPON,
       WT_DUMPOFF,
       WT_FLUSH,
+      WT_STEP_BEGIN,
+      WT_STEP_END,
       WT_TERMINATE
 } vcd_work_item_type_t;
 
@@ -81,14 +93,19 @@ struct lxt2_wr_symbol;
 
 struct vcd_work_item_s {
       vcd_work_item_type_t type;
+      unsigned wid;
       uint64_t time;
       union {
 	    struct lxt2_wr_symbol*lxt2;
+	    const char*vcd;
       } sym_;
 
       union {
 	    double val_double;
 	    char*val_char;
+	    const char*val_text;
+	    s_vpi_vecval val_word;
+	    s_vpi_vecval*val_vec;
       } op_;
 };
 
@@ -126,6 +143,25 @@ EXTERN void vcd_work_dumpoff(void);
 EXTERN void vcd_work_emit_double(struct lxt2_wr_symbol*sym, double val);
 EXTERN void vcd_work_emit_bits(struct lxt2_wr_symbol*sym, const char*bits);
 
+/* These are the VCD dumper versions of the emit functions. */
+EXTERN void vcd_work_emit_vcd_double(const char*ident, double val);
+EXTERN void vcd_work_emit_vector(const char*ident, unsigned wid,
+				 const s_vpi_vecval*val);
+EXTERN void vcd_work_emit_time(void);
+EXTERN void vcd_work_emit_text(const char*text, const char*ident);
+  /* Bracket the value changes of a time step. The work thread can
+     check the dump limit at the start of the step and drop the step. */
+EXTERN void vcd_work_step_begin(int check_limit);
+EXTERN void vcd_work_step_end(void);
+
+/*
+ * The dumpers record the name of the dump file when they open it. A
+ * process that has a dump file open cannot be forked by $fork_sim, as
+ * the variants would all write to the same file.
+ */
+EXTERN void vcd_dumpfile_opened(const char*path);
+EXTERN const char*vcd_dumpfile_open(void);
+
 /* The compiletf routines are common for the VCD, LXT and LXT2 dumpers. */
 EXTERN PLI_INT32 sys_dumpvars_compiletf(ICARUS_VPI_CONST PLI_BYTE8 *name);
 
@@ -85,147 +85,180 @@ extern "C" void vcd_scope_names_delete(void)
 
 static pthread_t work_thread;
 
+/*
+ * The work queue is a ring with one producer (the simulation thread)
+ * and one consumer (the work thread). work_queue_head counts the items
+ * the producer has published and work_queue_tail counts the items the
+ * consumer has finished with. Each side only writes its own counter,
+ * so passing items needs no lock. The mutex and the condition
+ * variables are only used when one side must sleep because the ring
+ * is empty or full. A side that goes to sleep first sets its waiting
+ * flag, and the other side takes the lock to wake it only when it
+ * sees that flag.
+ *
+ * The counters run freely and wrap, so the size must be a power of 2.
+ */
 static const unsigned WORK_QUEUE_SIZE = 128*1024;
+static const unsigned WORK_QUEUE_MASK = WORK_QUEUE_SIZE - 1;
 static const unsigned WORK_QUEUE_BATCH_MIN = 4*1024;
 static const unsigned WORK_QUEUE_BATCH_MAX = 32*1024;
 
 static struct vcd_work_item_s work_queue[WORK_QUEUE_SIZE];
-static volatile unsigned work_queue_next = 0;
-static volatile unsigned work_queue_fill = 0;
+static unsigned work_queue_head = 0;
+static unsigned work_queue_tail = 0;
+static int work_queue_consumer_waiting = 0;
+static int work_queue_producer_waiting = 0;
 
 static pthread_mutex_t work_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  work_queue_is_empty_sig = PTHREAD_COND_INITIALIZER;
 static pthread_cond_t  work_queue_notempty_sig = PTHREAD_COND_INITIALIZER;
 static pthread_cond_t  work_queue_minfree_sig = PTHREAD_COND_INITIALIZER;
 
+static inline unsigned load_counter(const unsigned*ptr)
+{
+      return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+static inline void store_counter(unsigned*ptr, unsigned val)
+{
+      __atomic_store_n(ptr, val, __ATOMIC_SEQ_CST);
+}
+
+static inline int load_flag(const int*ptr)
+{
+      return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+static inline void store_flag(int*ptr, int val)
+{
+      __atomic_store_n(ptr, val, __ATOMIC_SEQ_CST);
+}
 
 extern "C" struct vcd_work_item_s* vcd_work_thread_peek(void)
 {
-	// There must always only be 1 vcd work thread, and only the
-	// work thread decreases the fill, so if the work_queue_fill
-	// is non-zero, I can reliably assume that there is at least
-	// one item that I can peek at. I only need to lock if I must
-	// wait for the work_queue_fill to become non-zero.
-      if (work_queue_fill == 0) {
+	// Only the work thread moves the tail, so if the head is
+	// past it there is at least one item that I can peek at.
+      unsigned tail = work_queue_tail;
+      if (load_counter(&work_queue_head) == tail) {
 	    pthread_mutex_lock(&work_queue_mutex);
-	    while (work_queue_fill == 0)
+	    store_flag(&work_queue_consumer_waiting, 1);
+	    while (load_counter(&work_queue_head) == tail)
 		  pthread_cond_wait(&work_queue_notempty_sig, &work_queue_mutex);
+	    store_flag(&work_queue_consumer_waiting, 0);
 	    pthread_mutex_unlock(&work_queue_mutex);
       }
 
-      return work_queue + work_queue_next;
+      return work_queue + (tail & WORK_QUEUE_MASK);
 }
 
 extern "C" void vcd_work_thread_pop(void)
 {
-      pthread_mutex_lock(&work_queue_mutex);
+      unsigned tail = work_queue_tail;
 
-      unsigned use_fill = work_queue_fill - 1;
-      work_queue_fill = use_fill;
-
-      unsigned use_next = work_queue_next;
-
-      struct vcd_work_item_s*cell = work_queue + use_next;
+      struct vcd_work_item_s*cell = work_queue + (tail & WORK_QUEUE_MASK);
       if (cell->type == WT_EMIT_BITS) {
 	    free(cell->op_.val_char);
+      } else if (cell->type == WT_EMIT_VECTOR && cell->wid > 32) {
+	    free(cell->op_.val_vec);
       }
 
-      use_next += 1;
-      if (use_next >= WORK_QUEUE_SIZE)
-	    use_next = 0;
-      work_queue_next = use_next;
-
-      if (use_fill == WORK_QUEUE_SIZE-WORK_QUEUE_BATCH_MIN)
-	    pthread_cond_signal(&work_queue_minfree_sig);
-      else if (use_fill == 0)
-	    pthread_cond_signal(&work_queue_is_empty_sig);
-
-      pthread_mutex_unlock(&work_queue_mutex);
+      tail += 1;
+      store_counter(&work_queue_tail, tail);
+
+	// The producer waits for a batch worth of room, or for the
+	// ring to drain. Wake it when either of those happens.
+      if (load_flag(&work_queue_producer_waiting)) {
+	    unsigned use_fill = load_counter(&work_queue_head) - tail;
+	    if (use_fill == WORK_QUEUE_SIZE-WORK_QUEUE_BATCH_MIN || use_fill == 0) {
+		  pthread_mutex_lock(&work_queue_mutex);
+		  if (use_fill == 0)
+			pthread_cond_signal(&work_queue_is_empty_sig);
+		  else
+			pthread_cond_signal(&work_queue_minfree_sig);
+		  pthread_mutex_unlock(&work_queue_mutex);
+	    }
+      }
 }
 
 /*
- * Work queue items are created in batches to reduce thread
- * bouncing. When the producer gets a free work item, it actually
- * locks the queue in order to produce a batch. The queue stays locked
- * until the batch is complete. Then the releases the whole lot to the
- * consumer.
+ * Work queue items are written in batches to reduce thread
+ * bouncing. The producer writes items past the published head into
+ * the room that it knows is free, and only publishes them when the
+ * batch is complete or it is asked to flush. The consumer never looks
+ * past the published head, so the producer can write those items
+ * without a lock.
  */
 static uint64_t work_queue_next_time = 0;
-static unsigned current_batch_cnt = 0;
-static unsigned current_batch_alloc = 0;
-static unsigned current_batch_base = 0;
+static unsigned work_queue_write = 0;
+static unsigned work_queue_room = 0;
 
 extern "C" void vcd_work_start( void* (*fun) (void*), void*arg )
 {
       pthread_create(&work_thread, 0, fun, arg);
 }
 
-static struct vcd_work_item_s* grab_item(void)
+static void publish_batch(void)
 {
-      if (current_batch_alloc == 0) {
-	     pthread_mutex_lock(&work_queue_mutex);
-	     while ((WORK_QUEUE_SIZE-work_queue_fill) < WORK_QUEUE_BATCH_MIN)
-		  pthread_cond_wait(&work_queue_minfree_sig, &work_queue_mutex);
-
-	     current_batch_base = work_queue_next + work_queue_fill;
-	     current_batch_alloc = WORK_QUEUE_SIZE - work_queue_fill;
+      if (work_queue_write == work_queue_head)
+	    return;
 
-	     pthread_mutex_unlock(&work_queue_mutex);
+      store_counter(&work_queue_head, work_queue_write);
 
-	     if (current_batch_base >= WORK_QUEUE_SIZE)
-		   current_batch_base -= WORK_QUEUE_SIZE;
-	     if (current_batch_alloc > WORK_QUEUE_BATCH_MAX)
-		   current_batch_alloc = WORK_QUEUE_BATCH_MAX;
-	     current_batch_cnt = 0;
+      if (load_flag(&work_queue_consumer_waiting)) {
+	    pthread_mutex_lock(&work_queue_mutex);
+	    pthread_cond_signal(&work_queue_notempty_sig);
+	    pthread_mutex_unlock(&work_queue_mutex);
       }
+}
 
-      assert(current_batch_cnt < current_batch_alloc);
-
-      unsigned cur = current_batch_base + current_batch_cnt;
-      if (cur >= WORK_QUEUE_SIZE)
-	    cur -= WORK_QUEUE_SIZE;
+static struct vcd_work_item_s* grab_item(void)
+{
+      if (work_queue_room == 0) {
+	    publish_batch();
+
+	    unsigned use_fill = work_queue_write - load_counter(&work_queue_tail);
+	    if ((WORK_QUEUE_SIZE-use_fill) < WORK_QUEUE_BATCH_MIN) {
+		  pthread_mutex_lock(&work_queue_mutex);
+		  store_flag(&work_queue_producer_waiting, 1);
+		  for (;;) {
+			use_fill = work_queue_write - load_counter(&work_queue_tail);
+			if ((WORK_QUEUE_SIZE-use_fill) >= WORK_QUEUE_BATCH_MIN)
+			      break;
+			pthread_cond_wait(&work_queue_minfree_sig, &work_queue_mutex);
+		  }
+		  store_flag(&work_queue_producer_waiting, 0);
+		  pthread_mutex_unlock(&work_queue_mutex);
+	    }
+
+	    work_queue_room = WORK_QUEUE_SIZE - use_fill;
+	    if (work_queue_room > WORK_QUEUE_BATCH_MAX)
+		  work_queue_room = WORK_QUEUE_BATCH_MAX;
+      }
 
 	// Write the new timestamp into the work item.
-      struct vcd_work_item_s*cell = work_queue + cur;
+      struct vcd_work_item_s*cell = work_queue + (work_queue_write & WORK_QUEUE_MASK);
       cell->time = work_queue_next_time;
       return cell;
 }
 
-static void end_batch(void)
-{
-      pthread_mutex_lock(&work_queue_mutex);
-
-      unsigned use_fill = work_queue_fill;
-      bool was_empty_flag = (use_fill==0) && (current_batch_cnt > 0);
-
-      use_fill += current_batch_cnt;
-      work_queue_fill = use_fill;
-
-      current_batch_alloc = 0;
-      current_batch_cnt = 0;
-
-      if (was_empty_flag)
-	    pthread_cond_signal(&work_queue_notempty_sig);
-
-      pthread_mutex_unlock(&work_queue_mutex);
-}
-
 static inline void unlock_item(bool flush_batch =false)
 {
-      current_batch_cnt += 1;
-      if (current_batch_cnt == current_batch_alloc || flush_batch)
-	    end_batch();
+      work_queue_write += 1;
+      work_queue_room -= 1;
+      if (work_queue_room == 0 || flush_batch)
+	    publish_batch();
 }
 
 extern "C" void vcd_work_sync(void)
 {
-      if (current_batch_alloc > 0)
-	    end_batch();
+      publish_batch();
 
-      if (work_queue_fill > 0) {
+      if (load_counter(&work_queue_tail) != work_queue_write) {
 	    pthread_mutex_lock(&work_queue_mutex);
-	    while (work_queue_fill > 0)
+	    store_flag(&work_queue_producer_waiting, 1);
+	    while (load_counter(&work_queue_tail) != work_queue_write)
 		  pthread_cond_wait(&work_queue_is_empty_sig, &work_queue_mutex);
+	    store_flag(&work_queue_producer_waiting, 0);
 	    pthread_mutex_unlock(&work_queue_mutex);
       }
 }
@@ -276,6 +309,63 @@ extern "C" void vcd_work_emit_bits(struct lxt2_wr_symbol*sym, const char* val)
       unlock_item();
 }
 
+extern "C" void vcd_work_emit_vcd_double(const char*ident, double val)
+{
+      struct vcd_work_item_s*cell = grab_item();
+      cell->type = WT_EMIT_DOUBLE;
+      cell->sym_.vcd = ident;
+      cell->op_.val_double = val;
+      unlock_item();
+}
+
+extern "C" void vcd_work_emit_vector(const char*ident, unsigned wid,
+				     const s_vpi_vecval*val)
+{
+      struct vcd_work_item_s*cell = grab_item();
+      cell->type = WT_EMIT_VECTOR;
+      cell->wid = wid;
+      cell->sym_.vcd = ident;
+      if (wid <= 32) {
+	    cell->op_.val_word = val[0];
+      } else {
+	    size_t nbytes = (wid+31)/32 * sizeof(s_vpi_vecval);
+	    cell->op_.val_vec = (s_vpi_vecval*)malloc(nbytes);
+	    memcpy(cell->op_.val_vec, val, nbytes);
+      }
+      unlock_item();
+}
+
+extern "C" void vcd_work_emit_time(void)
+{
+      struct vcd_work_item_s*cell = grab_item();
+      cell->type = WT_EMIT_TIME;
+      unlock_item();
+}
+
+extern "C" void vcd_work_emit_text(const char*text, const char*ident)
+{
+      struct vcd_work_item_s*cell = grab_item();
+      cell->type = WT_EMIT_TEXT;
+      cell->sym_.vcd = ident;
+      cell->op_.val_text = text;
+      unlock_item();
+}
+
+extern "C" void vcd_work_step_begin(int check_limit)
+{
+      struct vcd_work_item_s*cell = grab_item();
+      cell->type = WT_STEP_BEGIN;
+      cell->wid = check_limit;
+      unlock_item();
+}
+
+extern "C" void vcd_work_step_end(void)
+{
+      struct vcd_work_item_s*cell = grab_item();
+      cell->type = WT_STEP_END;
+      unlock_item();
+}
+
 extern "C" void vcd_work_terminate(void)
 {
       struct vcd_work_item_s*cell = grab_item();
@@ -392,6 +392,7 @@ typedef struct t_vpi_delay  {
 #define vpiConstantSelect 53
 #define vpiSigned         65
 #define vpiLocalParam     70
+#define vpiSaveRestartID 536
 /* IVL private properties, also see vvp/vpi_priv.h for other properties */
 #define _vpiNexusId        0x1000000
 /* used in vvp/vpi_priv.h  0x1000001 */
@@ -583,6 +584,14 @@ extern PLI_INT32 vpi_compare_objects(vpiHandle obj1, vpiHandle obj2);
 extern PLI_INT32 vpi_put_userdata(vpiHandle obj, void*data);
 extern void*vpi_get_userdata(vpiHandle obj);
 
+/*
+ * These functions save and restore the data of a module in the
+ * cbStartOfSave and cbStartOfRestart callbacks. The id is the value
+ * of vpi_get(vpiSaveRestartID, NULL) in the callback.
+ */
+extern PLI_INT32 vpi_put_data(PLI_INT32 id, PLI_BYTE8*dataLoc, PLI_INT32 numOfBytes);
+extern PLI_INT32 vpi_get_data(PLI_INT32 id, PLI_BYTE8*dataLoc, PLI_INT32 numOfBytes);
+
 /*
  * Support for handling errors.
  */
@@ -647,6 +656,27 @@ extern void vpip_mcd_rawwrite(PLI_UINT32 mcd, const char*buf, size_t count);
 extern void vpip_count_drivers(vpiHandle ref, unsigned idx,
                                unsigned counts[4]);
 
+  /* Implement $save and $restart. The save is done at the end of the
+     current time step, and $restart replaces the running simulation
+     with the state in the file. */
+extern void vpip_save_checkpoint(const char*path);
+extern void vpip_restart_checkpoint(const char*path);
+
+  /* Number the system task and function calls of the design, so that
+     a module can save a call in a checkpoint and find it again after
+     the restart. The numbers start at 1, and 0 is no call. A non-zero
+     return from a cbStartOfSave callback refuses the save. */
+extern PLI_INT32 vpip_systf_call_id(vpiHandle ref);
+extern vpiHandle vpip_systf_call_by_id(PLI_INT32 id);
+
+  /* Implement $fork_sim, which runs the rest of the simulation once for
+     each variant listed in the file, in forked child processes. The
+     child processes add their number to the names of the files they
+     open, and vpip_fork_file_name returns the name (malloc'ed) that
+     the current process should use for the named file. */
+extern void vpip_fork_sim(const char*path);
+extern char* vpip_fork_file_name(const char*name);
+
 /*
  * Stopgap fix for br916. We need to reject any attempt to pass a thread
  * variable to $strobe or $monitor. To do this, we use some private VPI
@@ -24,6 +24,7 @@
 # include  "vpi_priv.h"
 # include  "vvp_net_sig.h"
 # include  "vvp_darray.h"
+# include  "checkpoint.h"
 # include  "config.h"
 #ifdef CHECK_WITH_VALGRIND
 #include  "vvp_cleanup.h"
@@ -32,6 +33,7 @@
 # include  <cstring>
 # include  <climits>
 # include  <iostream>
+# include  <vector>
 # include  "compile.h"
 # include  <cassert>
 # include  "ivl_alloc.h"
@@ -40,10 +42,15 @@ unsigned long count_net_arrays = 0;
 unsigned long count_net_array_words = 0;
 unsigned long count_var_arrays = 0;
 unsigned long count_var_array_words = 0;
+unsigned long count_var_arrays_sparse = 0;
+unsigned long count_var_arrays_packed = 0;
 unsigned long count_real_arrays = 0;
 unsigned long count_real_array_words = 0;
 
 static symbol_map_s<struct __vpiArray>* array_table =0;
+  // All the arrays, in the order they were made. Checkpoints refer to
+  // arrays by their position in this list.
+static std::vector<vvp_array_t> array_list;
 
 class vvp_fun_arrayport;
 static void array_attach_port(vvp_array_t, vvp_fun_arrayport*);
@@ -260,6 +267,30 @@ vpiHandle __vpiArray::get_iter_index(struct __vpiArrayIterator*, int idx)
 
       assert(vals4 || vals);
 
+      return word_handle(idx);
+}
+
+/*
+ * Return the handle for a word of a variable array. Making a handle
+ * for each word of a sparse memory would take more memory than the
+ * words that are actually used, so those handles are made for a page
+ * of words at a time.
+ */
+vpiHandle __vpiArray::word_handle(unsigned idx)
+{
+      if (word_pages) {
+	    const unsigned page_words = vvp_vector4array_sparse::PAGE_WORDS;
+	    struct __vpiArrayWord*&page = word_pages[idx / page_words];
+	    if (page == 0) {
+		  unsigned long base = idx - idx % page_words;
+		  unsigned count = page_words;
+		  if (base + count > get_size())
+			count = get_size() - base;
+		  page = array_make_words(this, base, count);
+	    }
+	    return &(page[idx % page_words].as_word);
+      }
+
       if (vals_words == 0) make_vals_words();
 
       return &(vals_words[idx].as_word);
@@ -328,10 +359,7 @@ vpiHandle __vpiArray::vpi_index(int index)
 	    return nets[index];
       }
 
-      if (vals_words == 0)
-	    make_vals_words();
-
-      return &(vals_words[index].as_word);
+      return word_handle(index);
 }
 
 int __vpiArrayWord::as_word_t::vpi_get(int code)
@@ -778,6 +806,7 @@ vpiHandle vpip_make_array(char*label, const char*name,
       obj->vals  = 0;
       obj->vals_width = 0;
       obj->vals_words = 0;
+      obj->word_pages = 0;
 
 	// Initialize (clear) the read-ports list.
       obj->ports_ = 0;
@@ -789,6 +818,7 @@ vpiHandle vpip_make_array(char*label, const char*name,
 
       assert(!array_find(label));
       array_table->sym_set_value(label, obj);
+      array_list.push_back(obj);
 
 	/* Add this into the table of VPI objects. This is used for
 	   contexts that try to look up VPI objects in
@@ -845,6 +875,161 @@ void __vpiArray::attach_word(unsigned addr, vpiHandle word)
       }
 }
 
+/*
+ * Checkpoints save the words of the variable arrays. Net arrays get
+ * their values from their drivers, and aliases share the words of
+ * the array they alias, so neither is saved. The words of arrays in
+ * automatic scopes belong to the running threads.
+ */
+enum { CKPT_ARRAY_VEC4 = 1, CKPT_ARRAY_REAL, CKPT_ARRAY_STRING,
+       CKPT_ARRAY_VEC4_SPARSE };
+
+void array_checkpoint_put(checkpoint_out&out, vvp_array_t mem)
+{
+      for (size_t idx = 0 ; idx < array_list.size() ; idx += 1) {
+	    if (array_list[idx] == mem) {
+		  out.put_uint(idx);
+		  return;
+	    }
+      }
+      out.refuse("an assignment to an unknown array is scheduled");
+      out.put_uint(0);
+}
+
+vvp_array_t array_checkpoint_get(checkpoint_in&in)
+{
+      uint64_t idx = in.get_uint();
+      if (idx >= array_list.size())
+	    in.corrupt("array number out of range");
+      return array_list[idx];
+}
+
+void array_checkpoint_save(checkpoint_out&out)
+{
+      for (size_t idx = 0 ; idx < array_list.size() ; idx += 1) {
+	    vvp_array_t mem = array_list[idx];
+	    if (mem->nets || mem->get_scope()->is_automatic())
+		  continue;
+	      // Aliases share the words of an earlier array.
+	    bool alias = false;
+	    for (size_t adx = 0 ; adx < idx && !alias ; adx += 1)
+		  alias = (mem->vals4 && array_list[adx]->vals4 == mem->vals4)
+			|| (mem->vals && array_list[adx]->vals == mem->vals);
+	    if (alias)
+		  continue;
+
+	    unsigned size = mem->get_size();
+	    if (mem->vals && dynamic_cast<vvp_darray_real*>(mem->vals)) {
+		  out.put_uint(CKPT_ARRAY_REAL);
+		  out.put_uint(idx);
+		  for (unsigned adr = 0 ; adr < size ; adr += 1)
+			out.put_real(mem->get_word_r(adr));
+
+	    } else if (mem->vals && dynamic_cast<vvp_darray_string*>(mem->vals)) {
+		  out.put_uint(CKPT_ARRAY_STRING);
+		  out.put_uint(idx);
+		  for (unsigned adr = 0 ; adr < size ; adr += 1)
+			out.put_str(mem->get_word_str(adr));
+
+	    } else if (mem->vals && dynamic_cast<vvp_darray_object*>(mem->vals)) {
+		  for (unsigned adr = 0 ; adr < size ; adr += 1) {
+			vvp_object_t obj;
+			mem->get_word_obj(adr, obj);
+			if (! obj.test_nil()) {
+			      out.refuse("array %s holds class or dynamic "
+					 "array objects", mem->name);
+			      return;
+			}
+		  }
+
+	    } else if (vvp_vector4array_sparse*sparse =
+		       dynamic_cast<vvp_vector4array_sparse*>(mem->vals4)) {
+		    // Only save the words of the allocated pages, as
+		    // (address+1, value) pairs that end with a 0.
+		  out.put_uint(CKPT_ARRAY_VEC4_SPARSE);
+		  out.put_uint(idx);
+		  for (unsigned adr = sparse->next_allocated_word(0)
+			     ; adr < size ; adr = sparse->next_allocated_word(adr+1)) {
+			out.put_uint(adr+1);
+			out.put_vec4(mem->get_word(adr));
+		  }
+		  out.put_uint(0);
+
+	    } else {
+		  out.put_uint(CKPT_ARRAY_VEC4);
+		  out.put_uint(idx);
+		  for (unsigned adr = 0 ; adr < size ; adr += 1)
+			out.put_vec4(mem->get_word(adr));
+	    }
+      }
+}
+
+void array_checkpoint_load(checkpoint_in&in)
+{
+      while (uint64_t kind = in.get_uint()) {
+	    vvp_array_t mem = array_checkpoint_get(in);
+	    unsigned size = mem->get_size();
+	    switch (kind) {
+		case CKPT_ARRAY_VEC4:
+		  if (mem->vals4 == 0 && mem->vals == 0)
+			in.corrupt("array is not a variable array");
+		  for (unsigned adr = 0 ; adr < size ; adr += 1) {
+			vvp_vector4_t val = in.get_vec4();
+			if (val.size() != mem->vals_width)
+			      in.corrupt("array word width does not match");
+			mem->set_word(adr, 0, val);
+		  }
+		  break;
+		case CKPT_ARRAY_VEC4_SPARSE:
+		  if (dynamic_cast<vvp_vector4array_sparse*>(mem->vals4) == 0)
+			in.corrupt("array is not a sparse array");
+		  while (uint64_t adr = in.get_uint()) {
+			if (adr > size)
+			      in.corrupt("array address out of range");
+			vvp_vector4_t val = in.get_vec4();
+			if (val.size() != mem->vals_width)
+			      in.corrupt("array word width does not match");
+			mem->set_word(adr-1, 0, val);
+		  }
+		  break;
+		case CKPT_ARRAY_REAL:
+		  if (dynamic_cast<vvp_darray_real*>(mem->vals) == 0)
+			in.corrupt("array is not a real array");
+		  for (unsigned adr = 0 ; adr < size ; adr += 1)
+			mem->set_word(adr, in.get_real());
+		  break;
+		case CKPT_ARRAY_STRING:
+		  if (dynamic_cast<vvp_darray_string*>(mem->vals) == 0)
+			in.corrupt("array is not a string array");
+		  for (unsigned adr = 0 ; adr < size ; adr += 1)
+			mem->set_word(adr, in.get_str());
+		  break;
+		default:
+		  in.corrupt("unknown array record");
+	    }
+      }
+}
+
+/*
+ * Memories with at least this many words keep their words in pages
+ * that are allocated when they are first written. The VVP_SPARSE_WORDS
+ * environment variable changes the limit.
+ */
+static unsigned long sparse_array_words(void)
+{
+      static unsigned long limit = 0;
+      if (limit == 0) {
+	    limit = 1UL << 20;
+	    if (const char*env = getenv("VVP_SPARSE_WORDS")) {
+		  char*ep;
+		  unsigned long val = strtoul(env, &ep, 0);
+		  if (ep != env && *ep == 0 && val > 0)
+			limit = val;
+	    }
+      }
+      return limit;
+}
+
 void compile_var_array(char*label, char*name, int last, int first,
 		   int msb, int lsb, char signed_flag)
 {
@@ -858,6 +1043,19 @@ void compile_var_array(char*label, char*name, int last, int first,
       if (vpip_peek_current_scope()->is_automatic()) {
             arr->vals4 = new vvp_vector4array_aa(arr->vals_width,
 						 arr->get_size());
+      } else if (arr->get_size() >= sparse_array_words()) {
+            arr->vals4 = new vvp_vector4array_sparse(arr->vals_width,
+						     arr->get_size());
+	    unsigned npages = (arr->get_size() + vvp_vector4array_sparse::PAGE_WORDS-1)
+			      / vvp_vector4array_sparse::PAGE_WORDS;
+	    arr->word_pages = new struct __vpiArrayWord*[npages];
+	    for (unsigned idx = 0 ; idx < npages ; idx += 1)
+		  arr->word_pages[idx] = 0;
+	    count_var_arrays_sparse += 1;
+      } else if (arr->vals_width <= vvp_vector4array_packed::MAX_WIDTH) {
+            arr->vals4 = new vvp_vector4array_packed(arr->vals_width,
+						     arr->get_size());
+	    count_var_arrays_packed += 1;
       } else {
             arr->vals4 = new vvp_vector4array_sa(arr->vals_width,
 						 arr->get_size());
@@ -1512,6 +1710,7 @@ void compile_array_alias(char*label, char*name, char*src)
       obj->vals  = mem->vals;
       obj->vals_width = mem->vals_width;
       obj->vals_words = mem->vals_words;
+      obj->word_pages = mem->word_pages;
 
       obj->ports_ = 0;
       obj->vpi_callbacks = 0;
@@ -1519,6 +1718,7 @@ void compile_array_alias(char*label, char*name, char*src)
       assert(array_table);
       assert(!array_find(label));
       array_table->sym_set_value(label, obj);
+      array_list.push_back(obj);
 
       compile_vpi_symbol(label, obj);
       vpip_attach_to_current_scope(obj);
@@ -1616,7 +1816,14 @@ void compile_array_cleanup(void)
 void memory_delete(vpiHandle item)
 {
       struct __vpiArray*arr = (struct __vpiArray*) item;
-      if (arr->vals_words) delete [] (arr->vals_words-1);
+      if (arr->vals_words) delete [] (arr->vals_words-2);
+      if (arr->word_pages) {
+	    unsigned npages = (arr->get_size() + vvp_vector4array_sparse::PAGE_WORDS-1)
+		              / vvp_vector4array_sparse::PAGE_WORDS;
+	    for (unsigned idx = 0 ; idx < npages ; idx += 1)
+		  if (arr->word_pages[idx]) delete [] (arr->word_pages[idx]-2);
+	    delete [] arr->word_pages;
+      }
 
 //      if (arr->vals4) {}
 // Delete the individual words?
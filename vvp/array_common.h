@@ -60,7 +60,9 @@ struct __vpiArrayIndex : public __vpiHandle {
  * the memory) is calculated by subtracting word0 from the ArrayWord
  * pointer.
  *
- * To then get to the parent, use word0[-1].parent.
+ * To then get to the parent, use word0[-2].parent. The word0[-1].base
+ * is the index of word0 in the memory. That is 0 unless the words of
+ * a large (sparse) memory are made a page at a time.
  *
  * The vpiArrayWord is also used as a handle for the index (vpiIndex)
  * for the word. To make that work, return the pointer to the as_index
@@ -86,12 +88,20 @@ struct __vpiArrayWord {
       union {
 	    struct __vpiArrayBase*parent;
 	    struct __vpiArrayWord*word0;
+	    unsigned long base;
       };
 
-      inline unsigned get_index() const { return this - word0; }
-      inline struct __vpiArrayBase*get_parent() const { return (word0 - 1)->parent; }
+      inline unsigned get_index() const { return (word0 - 1)->base + (this - word0); }
+      inline struct __vpiArrayBase*get_parent() const { return (word0 - 2)->parent; }
 };
 
+/*
+ * Make the handles for count words of the parent, starting with word
+ * base, and return the pointer to the first word handle.
+ */
+extern struct __vpiArrayWord*array_make_words(struct __vpiArrayBase*parent,
+					      unsigned long base, unsigned count);
+
 struct __vpiArrayWord*array_var_word_from_handle(vpiHandle ref);
 struct __vpiArrayWord*array_var_index_from_handle(vpiHandle ref);
 
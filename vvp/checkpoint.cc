@@ -0,0 +1,888 @@
+/*
+ * Copyright (c) 2026 Stephen Williams (steve@icarus.com)
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+# include  "checkpoint.h"
+# include  "schedule.h"
+# include  "vpi_priv.h"
+# include  "vvp_net_sig.h"
+# include  "event.h"
+# include  "statistics.h"
+# include  "version_base.h"
+# include  <cstdio>
+# include  <cstdarg>
+# include  <cstdlib>
+# include  <cstring>
+# include  <cerrno>
+# include  <algorithm>
+# include  <set>
+# include  <cassert>
+# include  <unistd.h>
+
+/*
+ * The checkpoint file is a header followed by sections:
+ *
+ *    "VVPCKPT" <format> <vvp version> <nets> <opcodes> <scopes> <time>
+ *    <functor states> 0
+ *    <variable values, assigns and forces> 0
+ *    <memory words> 0
+ *    <future events> 0
+ *    <wait lists> 0
+ *    <threads> 0
+ *    <VPI module data> 0
+ *
+ * The numbers are unsigned variable length integers, 7 bits to a byte
+ * with the least significant bits first, as in token images. Nets,
+ * scopes and threads are written as their number plus one, so that 0
+ * is nil. Vectors are the width and then 4 bits to a byte. Each
+ * section is a list of records, each starting with a non-zero kind.
+ *
+ * The counts of nets, opcodes and scopes are a fingerprint of the
+ * design, checked when the file is loaded.
+ */
+static const char checkpoint_magic[] = "VVPCKPT";
+static const uint64_t checkpoint_format = 2;
+
+enum { CKPT_VEC4 = 1, CKPT_REAL, CKPT_STRING, CKPT_WAIT, CKPT_ASSIGN,
+       CKPT_FORCE, CKPT_FUNCTOR };
+
+bool checkpoint_restoring = false;
+bool checkpoint_save_pending = false;
+
+static std::string checkpoint_save_path;
+static checkpoint_in*checkpoint_loaded = 0;
+
+static int checkpoint_argc = 0;
+static char**checkpoint_argv = 0;
+
+void checkpoint_set_argv(int argc, char*argv[])
+{
+      checkpoint_argc = argc;
+      checkpoint_argv = argv;
+}
+
+/*
+ * The nets and scopes are numbered by their place in the lists that
+ * the compiler built. These lists are made the first time that they
+ * are needed, once the design is complete.
+ */
+static unsigned long checkpoint_design_nets = 0;
+static std::vector<vvp_net_t*> checkpoint_nets;
+static std::vector<__vpiScope*> checkpoint_scopes;
+static std::map<const vvp_net_t*,uint64_t> checkpoint_net_ids;
+static std::map<__vpiScope*,uint64_t> checkpoint_scope_ids;
+
+static void collect_scopes(__vpiScope*scope)
+{
+      checkpoint_scope_ids[scope] = checkpoint_scopes.size();
+      checkpoint_scopes.push_back(scope);
+      for (size_t idx = 0 ; idx < scope->intern.size() ; idx += 1) {
+	    __vpiScope*sub = dynamic_cast<__vpiScope*>(scope->intern[idx]);
+	    if (sub) collect_scopes(sub);
+      }
+}
+
+static void checkpoint_tables(void)
+{
+      if (! checkpoint_scopes.empty())
+	    return;
+
+      vvp_net_t::get_all_nets(checkpoint_nets);
+      if (checkpoint_nets.size() > checkpoint_design_nets)
+	    checkpoint_nets.resize(checkpoint_design_nets);
+      for (size_t idx = 0 ; idx < checkpoint_nets.size() ; idx += 1)
+	    checkpoint_net_ids[checkpoint_nets[idx]] = idx;
+
+      __vpiHandle**table;
+      unsigned ntable;
+      vpip_make_root_iterator(table, ntable);
+      for (unsigned idx = 0 ; idx < ntable ; idx += 1) {
+	    __vpiScope*scope = dynamic_cast<__vpiScope*>(table[idx]);
+	    if (scope) collect_scopes(scope);
+      }
+}
+
+/*
+ * Find a name for the net, for messages. Only the nets of signals
+ * and named events have names.
+ */
+static std::string checkpoint_net_name(const vvp_net_t*net)
+{
+      for (size_t sdx = 0 ; sdx < checkpoint_scopes.size() ; sdx += 1) {
+	    __vpiScope*scope = checkpoint_scopes[sdx];
+	    for (size_t idx = 0 ; idx < scope->intern.size() ; idx += 1) {
+		  vpiHandle item = scope->intern[idx];
+		  const vvp_net_t*node = 0;
+		  if (__vpiSignal*sig = dynamic_cast<__vpiSignal*>(item))
+			node = sig->node;
+		  else if (__vpiRealVar*rvar = dynamic_cast<__vpiRealVar*>(item))
+			node = rvar->net;
+		  else if (__vpiBaseVar*bvar = dynamic_cast<__vpiBaseVar*>(item))
+			node = bvar->get_net();
+		  else if (__vpiNamedEvent*nev = dynamic_cast<__vpiNamedEvent*>(item))
+			node = nev->funct;
+
+		  if (node == net)
+			return std::string("signal ") + item->vpi_get_str(vpiFullName);
+	    }
+      }
+      return "an unnamed net";
+}
+
+void checkpoint_design_done(void)
+{
+      checkpoint_design_nets = count_vvp_nets;
+}
+
+checkpoint_out::checkpoint_out()
+{
+      checkpoint_tables();
+}
+
+checkpoint_out::~checkpoint_out()
+{
+}
+
+void checkpoint_out::truncate(size_t size)
+{
+      assert(size <= buf_.size());
+      buf_.resize(size);
+}
+
+void checkpoint_out::put_uint(uint64_t val)
+{
+      while (val >= 0x80) {
+	    buf_ += (char) (0x80 | (val & 0x7f));
+	    val >>= 7;
+      }
+      buf_ += (char) val;
+}
+
+void checkpoint_out::put_real(double val)
+{
+      uint64_t bits;
+      memcpy(&bits, &val, sizeof bits);
+      put_uint(bits);
+}
+
+void checkpoint_out::put_str(const std::string&val)
+{
+      put_uint(val.size());
+      buf_ += val;
+}
+
+void checkpoint_out::put_vec4(const vvp_vector4_t&val)
+{
+      unsigned wid = val.size();
+      put_uint(wid);
+      for (unsigned idx = 0 ; idx < wid ; idx += 4) {
+	    unsigned char byte = 0;
+	    for (unsigned bit = 0 ; bit < 4 && idx+bit < wid ; bit += 1)
+		  byte |= (val.value(idx+bit) & 3) << (2*bit);
+	    buf_ += (char) byte;
+      }
+}
+
+void checkpoint_out::put_vec8(const vvp_vector8_t&val)
+{
+      unsigned wid = val.size();
+      put_uint(wid);
+      for (unsigned idx = 0 ; idx < wid ; idx += 1)
+	    buf_ += (char) val.value(idx).raw();
+}
+
+void checkpoint_out::put_vec2(const vvp_vector2_t&val)
+{
+      unsigned wid = val.size();
+      put_uint(wid);
+      for (unsigned idx = 0 ; idx < wid ; idx += 8) {
+	    unsigned char byte = 0;
+	    for (unsigned bit = 0 ; bit < 8 && idx+bit < wid ; bit += 1)
+		  byte |= (val.value(idx+bit) & 1) << bit;
+	    buf_ += (char) byte;
+      }
+}
+
+void checkpoint_out::put_net(const vvp_net_t*net)
+{
+      if (net == 0) {
+	    put_uint(0);
+	    return;
+      }
+
+      std::map<const vvp_net_t*,uint64_t>::const_iterator cur
+	    = checkpoint_net_ids.find(net);
+      if (cur == checkpoint_net_ids.end()) {
+	    refuse("a net was created during the simulation");
+	    put_uint(0);
+	    return;
+      }
+      put_uint(cur->second + 1);
+}
+
+void checkpoint_out::put_scope(__vpiScope*scope)
+{
+      std::map<__vpiScope*,uint64_t>::const_iterator cur
+	    = checkpoint_scope_ids.find(scope);
+      if (cur == checkpoint_scope_ids.end()) {
+	    refuse("a thread is in a scope outside the design hierarchy");
+	    put_uint(0);
+	    return;
+      }
+      put_uint(cur->second + 1);
+}
+
+uint64_t checkpoint_out::number_thread(vthread_t thr)
+{
+      std::map<vthread_t,uint64_t>::const_iterator cur = thread_ids_.find(thr);
+      if (cur != thread_ids_.end())
+	    return cur->second;
+
+      uint64_t id = threads_.size();
+      thread_ids_[thr] = id;
+      threads_.push_back(thr);
+      return id;
+}
+
+void checkpoint_out::put_thread(vthread_t thr)
+{
+      if (thr == 0) {
+	    put_uint(0);
+	    return;
+      }
+      put_uint(number_thread(thr) + 1);
+}
+
+void checkpoint_out::refuse(const char*fmt, ...)
+{
+      if (refused())
+	    return;
+
+      char text[512];
+      va_list ap;
+      va_start(ap, fmt);
+      vsnprintf(text, sizeof text, fmt, ap);
+      va_end(ap);
+      why_ = text;
+}
+
+checkpoint_in::checkpoint_in(const char*path, const std::string&bytes)
+: path_(path), buf_(bytes), pos_(0)
+{
+      checkpoint_tables();
+}
+
+checkpoint_in::~checkpoint_in()
+{
+}
+
+void checkpoint_in::corrupt(const char*what)
+{
+      fprintf(stderr, "%s: checkpoint does not match the design: %s.\n",
+	      path_, what);
+      exit(1);
+}
+
+uint64_t checkpoint_in::get_uint()
+{
+      uint64_t val = 0;
+      for (unsigned shift = 0 ; ; shift += 7) {
+	    if (pos_ >= buf_.size() || shift > 63)
+		  corrupt("the file is truncated");
+	    unsigned char byte = buf_[pos_++];
+	    val |= (uint64_t)(byte & 0x7f) << shift;
+	    if ((byte & 0x80) == 0)
+		  break;
+      }
+      return val;
+}
+
+double checkpoint_in::get_real()
+{
+      uint64_t bits = get_uint();
+      double val;
+      memcpy(&val, &bits, sizeof val);
+      return val;
+}
+
+std::string checkpoint_in::get_str()
+{
+      uint64_t len = get_uint();
+      if (len > buf_.size() - pos_)
+	    corrupt("the file is truncated");
+      std::string val = buf_.substr(pos_, len);
+      pos_ += len;
+      return val;
+}
+
+vvp_vector4_t checkpoint_in::get_vec4()
+{
+      uint64_t wid = get_uint();
+      if ((wid+3)/4 > buf_.size() - pos_)
+	    corrupt("the file is truncated");
+
+      vvp_vector4_t val (wid);
+      for (unsigned idx = 0 ; idx < wid ; idx += 4) {
+	    unsigned char byte = buf_[pos_++];
+	    for (unsigned bit = 0 ; bit < 4 && idx+bit < wid ; bit += 1)
+		  val.set_bit(idx+bit, (vvp_bit4_t) ((byte >> (2*bit)) & 3));
+      }
+      return val;
+}
+
+vvp_vector8_t checkpoint_in::get_vec8()
+{
+      uint64_t wid = get_uint();
+      if (wid > buf_.size() - pos_)
+	    corrupt("the file is truncated");
+
+      vvp_vector8_t val (wid);
+      for (unsigned idx = 0 ; idx < wid ; idx += 1)
+	    val.set_bit(idx, vvp_scalar_t((unsigned char) buf_[pos_++]));
+      return val;
+}
+
+vvp_vector2_t checkpoint_in::get_vec2()
+{
+      uint64_t wid = get_uint();
+      if ((wid+7)/8 > buf_.size() - pos_)
+	    corrupt("the file is truncated");
+      if (wid == 0)
+	    return vvp_vector2_t();
+
+      vvp_vector2_t val (vvp_vector2_t::FILL0, wid);
+      for (unsigned idx = 0 ; idx < wid ; idx += 8) {
+	    unsigned char byte = buf_[pos_++];
+	    for (unsigned bit = 0 ; bit < 8 && idx+bit < wid ; bit += 1)
+		  val.set_bit(idx+bit, (byte >> bit) & 1);
+      }
+      return val;
+}
+
+vvp_net_t* checkpoint_in::get_net()
+{
+      uint64_t id = get_uint();
+      if (id == 0)
+	    return 0;
+      if (id > checkpoint_nets.size())
+	    corrupt("net number out of range");
+      return checkpoint_nets[id-1];
+}
+
+__vpiScope* checkpoint_in::get_scope()
+{
+      uint64_t id = get_uint();
+      if (id == 0 || id > checkpoint_scopes.size())
+	    corrupt("scope number out of range");
+      return checkpoint_scopes[id-1];
+}
+
+vthread_t checkpoint_in::get_thread()
+{
+      uint64_t id = get_uint();
+      if (id == 0)
+	    return 0;
+      return thread(id-1);
+}
+
+vthread_t checkpoint_in::thread(uint64_t id)
+{
+	// The thread numbers are dense, so this is only a sanity limit.
+      if (id > buf_.size())
+	    corrupt("thread number out of range");
+      if (id >= threads_.size())
+	    threads_.resize(id+1, 0);
+      if (threads_[id] == 0)
+	    threads_[id] = vthread_checkpoint_new();
+      return threads_[id];
+}
+
+/*
+ * Save the state of the functors that have any. The record is taken
+ * back if the functor has nothing to save.
+ */
+static void save_functors(checkpoint_out&out)
+{
+      for (size_t idx = 0 ; idx < checkpoint_nets.size() ; idx += 1) {
+	    vvp_net_t*net = checkpoint_nets[idx];
+	    if (net->fun == 0)
+		  continue;
+
+	    size_t mark = out.bytes().size();
+	    out.put_uint(CKPT_FUNCTOR);
+	    out.put_net(net);
+	    if (! net->fun->checkpoint_save(out))
+		  out.truncate(mark);
+	    if (out.refused())
+		  return;
+      }
+}
+
+/*
+ * While the saved values propagate, the restored functors and the
+ * inputs of restored wide functors are cut off by giving their nets
+ * this functor, which ignores everything that it receives.
+ */
+class checkpoint_sink_fun : public vvp_net_fun_t {
+
+    public:
+      void recv_vec4(vvp_net_ptr_t, const vvp_vector4_t&, vvp_context_t) { }
+      void recv_vec8(vvp_net_ptr_t, const vvp_vector8_t&) { }
+      void recv_real(vvp_net_ptr_t, double, vvp_context_t) { }
+      void recv_long(vvp_net_ptr_t, long) { }
+      void recv_string(vvp_net_ptr_t, const std::string&, vvp_context_t) { }
+      void recv_object(vvp_net_ptr_t, vvp_object_t, vvp_context_t) { }
+      void recv_vec4_pv(vvp_net_ptr_t, const vvp_vector4_t&,
+			unsigned, unsigned, unsigned, vvp_context_t) { }
+      void recv_vec8_pv(vvp_net_ptr_t, const vvp_vector8_t&,
+			unsigned, unsigned, unsigned) { }
+      void recv_long_pv(vvp_net_ptr_t, long, unsigned, unsigned) { }
+      void force_flag(bool) { }
+};
+
+static std::vector<std::pair<vvp_net_t*,vvp_net_fun_t*> > checkpoint_cut_nets;
+
+static void cut_net(vvp_net_t*net, vvp_net_fun_t*sink)
+{
+      checkpoint_cut_nets.push_back(std::make_pair(net, net->fun));
+      net->fun = sink;
+}
+
+static void restore_functors(checkpoint_in&in)
+{
+	// The sink is never deleted, like the other functors.
+      static vvp_net_fun_t*sink = new checkpoint_sink_fun;
+
+      std::set<vvp_wide_fun_core*> cores;
+      while (uint64_t kind = in.get_uint()) {
+	    vvp_net_t*net = in.get_net();
+	    if (kind != CKPT_FUNCTOR || net == 0 || net->fun == 0)
+		  in.corrupt("unknown functor record");
+	    net->fun->checkpoint_load(in, net);
+	    if (vvp_wide_fun_core*core = dynamic_cast<vvp_wide_fun_core*>(net->fun))
+		  cores.insert(core);
+	    cut_net(net, sink);
+      }
+
+      if (cores.empty())
+	    return;
+
+      for (size_t idx = 0 ; idx < checkpoint_nets.size() ; idx += 1) {
+	    vvp_net_t*net = checkpoint_nets[idx];
+	    vvp_wide_fun_t*wide = dynamic_cast<vvp_wide_fun_t*>(net->fun);
+	    if (wide && cores.count(wide->core()))
+		  cut_net(net, sink);
+      }
+}
+
+static void save_values(checkpoint_out&out)
+{
+      for (size_t idx = 0 ; idx < checkpoint_nets.size() ; idx += 1) {
+	    vvp_net_t*net = checkpoint_nets[idx];
+	    vvp_net_fun_t*fun = net->fun;
+
+	    if (vvp_fun_signal4_sa*sig4 = dynamic_cast<vvp_fun_signal4_sa*>(fun)) {
+		  out.put_uint(CKPT_VEC4);
+		  out.put_net(net);
+		  out.put_vec4(sig4->vec4_unfiltered_value());
+
+	    } else if (vvp_fun_signal_real_sa*rsig = dynamic_cast<vvp_fun_signal_real_sa*>(fun)) {
+		  out.put_uint(CKPT_REAL);
+		  out.put_net(net);
+		  out.put_real(rsig->real_unfiltered_value());
+
+	    } else if (vvp_fun_signal_string_sa*ssig = dynamic_cast<vvp_fun_signal_string_sa*>(fun)) {
+		  out.put_uint(CKPT_STRING);
+		  out.put_net(net);
+		  out.put_str(ssig->get_string());
+
+	    } else if (vvp_fun_signal_object_sa*osig = dynamic_cast<vvp_fun_signal_object_sa*>(fun)) {
+		  if (! osig->get_object().test_nil())
+			out.refuse("%s holds a class object or dynamic array",
+				   checkpoint_net_name(net).c_str());
+	    }
+
+	    vvp_fun_signal_base*sig = dynamic_cast<vvp_fun_signal_base*>(fun);
+	    if (sig && sig->assign_active()) {
+		  out.put_uint(CKPT_ASSIGN);
+		  out.put_net(net);
+		  sig->checkpoint_save_assign(out);
+	    }
+
+	    if (net->fil && net->fil->force_active()) {
+		  out.put_uint(CKPT_FORCE);
+		  out.put_net(net);
+		  net->fil->checkpoint_save_force(out);
+	    }
+
+	    if (out.refused())
+		  return;
+      }
+}
+
+static void restore_values(checkpoint_in&in)
+{
+      while (uint64_t kind = in.get_uint()) {
+	    vvp_net_t*net = in.get_net();
+	    if (net == 0)
+		  in.corrupt("missing variable");
+	    vvp_net_ptr_t ptr (net, 0);
+
+	    switch (kind) {
+		case CKPT_VEC4: {
+		  vvp_vector4_t val = in.get_vec4();
+		  vvp_fun_signal4_sa*sig = dynamic_cast<vvp_fun_signal4_sa*>(net->fun);
+		  if (sig == 0 || sig->vec4_unfiltered_value().size() != val.size())
+			in.corrupt("variable type mismatch");
+		  vvp_send_vec4(ptr, val, 0);
+		  break;
+		}
+		case CKPT_REAL: {
+		  double val = in.get_real();
+		  if (dynamic_cast<vvp_fun_signal_real_sa*>(net->fun) == 0)
+			in.corrupt("variable type mismatch");
+		  vvp_send_real(ptr, val, 0);
+		  break;
+		}
+		case CKPT_STRING: {
+		  std::string val = in.get_str();
+		  if (dynamic_cast<vvp_fun_signal_string_sa*>(net->fun) == 0)
+			in.corrupt("variable type mismatch");
+		  vvp_send_string(ptr, val, 0);
+		  break;
+		}
+		case CKPT_ASSIGN: {
+		  vvp_fun_signal_base*sig = dynamic_cast<vvp_fun_signal_base*>(net->fun);
+		  if (sig == 0)
+			in.corrupt("assign to a net that is not a variable");
+		  sig->checkpoint_load_assign(in, net);
+		  break;
+		}
+		case CKPT_FORCE:
+		  if (net->fil == 0)
+			in.corrupt("force on a net that cannot be forced");
+		  net->fil->checkpoint_load_force(in, net);
+		  break;
+		default:
+		  in.corrupt("unknown variable record");
+	    }
+      }
+}
+
+/*
+ * The threads waiting on an event are saved in the order of the wait
+ * list, which is the order in which they will be woken up.
+ */
+static void save_waits(checkpoint_out&out)
+{
+      for (size_t idx = 0 ; idx < checkpoint_nets.size() ; idx += 1) {
+	    vvp_net_t*net = checkpoint_nets[idx];
+	    waitable_hooks_s*ev = dynamic_cast<waitable_hooks_s*>(net->fun);
+	    if (ev == 0)
+		  continue;
+
+	    if (ev->event_ctls) {
+		  out.refuse("an intra-assignment event control is pending");
+		  return;
+	    }
+
+	    vthread_t list = ev->waiting_threads();
+	    if (list == 0)
+		  continue;
+
+	    unsigned count = 0;
+	    for (vthread_t cur = list ; cur ; cur = vthread_wait_next(cur))
+		  count += 1;
+
+	    out.put_uint(CKPT_WAIT);
+	    out.put_net(net);
+	    out.put_uint(count);
+	    for (vthread_t cur = list ; cur ; cur = vthread_wait_next(cur))
+		  out.put_thread(cur);
+      }
+}
+
+static void restore_waits(checkpoint_in&in)
+{
+      while (uint64_t kind = in.get_uint()) {
+	    if (kind != CKPT_WAIT)
+		  in.corrupt("unknown wait record");
+
+	    vvp_net_t*net = in.get_net();
+	    waitable_hooks_s*ev = net? dynamic_cast<waitable_hooks_s*>(net->fun) : 0;
+	    if (ev == 0)
+		  in.corrupt("threads wait on a net that is not an event");
+
+	    std::vector<vthread_t> list (in.get_uint());
+	    for (size_t idx = 0 ; idx < list.size() ; idx += 1)
+		  list[idx] = in.get_thread();
+
+	      // Adding a thread puts it at the head of the list, so
+	      // add them in reverse.
+	    for (size_t idx = list.size() ; idx > 0 ; idx -= 1)
+		  vthread_wait_on(list[idx-1], ev);
+      }
+}
+
+static void save_threads(checkpoint_out&out)
+{
+	// Number the threads of the design, in scope order. The
+	// events and wait lists have numbered the threads that were
+	// already reaped, and saving a thread may number its parent.
+	// The final threads are created again by the compiler.
+      for (size_t idx = 0 ; idx < checkpoint_scopes.size() ; idx += 1) {
+	    __vpiScope*scope = checkpoint_scopes[idx];
+	    for (std::set<vthread_t>::const_iterator cur = scope->threads.begin()
+		       ; cur != scope->threads.end() ; ++ cur) {
+		  if (! schedule_final_thread(*cur))
+			out.number_thread(*cur);
+	    }
+      }
+
+      for (size_t idx = 0 ; idx < out.thread_count() ; idx += 1) {
+	    out.put_uint(1);
+	    vthread_checkpoint_save(out, out.thread(idx));
+	    if (out.refused())
+		  return;
+      }
+}
+
+static void restore_threads(checkpoint_in&in)
+{
+      for (uint64_t id = 0 ; in.get_uint() ; id += 1)
+	    vthread_checkpoint_load(in, in.thread(id));
+}
+
+/*
+ * Collect the state of the simulation into memory first, and only
+ * write the file if all of it could be saved.
+ */
+static void checkpoint_save(const char*path)
+{
+      checkpoint_out out;
+
+      if (const char*name = vpip_mcd_user_file())
+	    out.refuse("file \"%s\" is open", name);
+      if (const char*name = vpip_checkpoint_foreign_callback())
+	    out.refuse("a VPI callback of %s is active, and the module "
+		       "cannot save it", name);
+
+      out.put_str(checkpoint_magic);
+      out.put_uint(checkpoint_format);
+      out.put_str(VERSION);
+      out.put_uint(checkpoint_nets.size());
+      out.put_uint(count_opcodes);
+      out.put_uint(checkpoint_scopes.size());
+      out.put_uint(schedule_simtime());
+
+      if (! out.refused()) {
+	    save_functors(out);
+	    out.put_uint(0);
+      }
+      if (! out.refused()) {
+	    save_values(out);
+	    out.put_uint(0);
+      }
+      if (! out.refused()) {
+	    array_checkpoint_save(out);
+	    out.put_uint(0);
+      }
+      if (! out.refused()) {
+	    schedule_checkpoint_save(out);
+	    out.put_uint(0);
+      }
+      if (! out.refused()) {
+	    save_waits(out);
+	    out.put_uint(0);
+      }
+      if (! out.refused()) {
+	    save_threads(out);
+	    out.put_uint(0);
+      }
+	// The VPI modules are asked last, so that they are not told
+	// of a save that the rest of the state already refused.
+      bool vpi_saved = false;
+      if (! out.refused()) {
+	    vpi_saved = true;
+	    if (vpip_checkpoint_save(out))
+		  out.put_uint(0);
+      }
+
+      if (out.refused()) {
+	    fprintf(stderr, "$save: cannot save the simulation state at time "
+		    "%" TIME_FMT_U " to %s: %s.\n", schedule_simtime(), path,
+		    out.why().c_str());
+      } else if (FILE*fd = fopen(path, "wb")) {
+	    size_t rc = fwrite(out.bytes().data(), 1, out.bytes().size(), fd);
+	    if (fclose(fd) != 0 || rc != out.bytes().size())
+		  fprintf(stderr, "$save: %s: error writing the file.\n", path);
+      } else {
+	    fprintf(stderr, "$save: %s: %s\n", path, strerror(errno));
+      }
+
+      if (vpi_saved)
+	    vpip_checkpoint_end_save();
+}
+
+void checkpoint_request_save(const char*path)
+{
+      checkpoint_save_path = path;
+      checkpoint_save_pending = true;
+}
+
+void checkpoint_service(void)
+{
+      if (! checkpoint_save_pending)
+	    return;
+
+      checkpoint_save_pending = false;
+      checkpoint_save(checkpoint_save_path.c_str());
+}
+
+static bool checkpoint_read(const char*path, std::string&bytes)
+{
+      FILE*fd = fopen(path, "rb");
+      if (fd == 0) {
+	    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+	    return false;
+      }
+
+      char buf[8192];
+      size_t rc;
+      while ((rc = fread(buf, 1, sizeof buf, fd)) > 0)
+	    bytes.append(buf, rc);
+      fclose(fd);
+
+      std::string magic = checkpoint_magic;
+      if (bytes.size() < magic.size()+1
+	  || bytes.compare(1, magic.size(), magic) != 0) {
+	    fprintf(stderr, "%s: not a vvp checkpoint file.\n", path);
+	    return false;
+      }
+      return true;
+}
+
+bool checkpoint_load(const char*path)
+{
+      std::string bytes;
+      if (! checkpoint_read(path, bytes))
+	    return false;
+
+      checkpoint_loaded = new checkpoint_in(path, bytes);
+      checkpoint_in&in = *checkpoint_loaded;
+      in.get_str();
+      if (in.get_uint() != checkpoint_format || in.get_str() != VERSION) {
+	    fprintf(stderr, "%s: checkpoint was saved by a different "
+		    "version of vvp.\n", path);
+	    return false;
+      }
+
+      uint64_t nets = in.get_uint();
+      uint64_t opcodes = in.get_uint();
+      uint64_t scopes = in.get_uint();
+      if (nets != checkpoint_nets.size() || opcodes != count_opcodes
+	  || scopes != checkpoint_scopes.size()) {
+	    fprintf(stderr, "%s: checkpoint was saved from a different "
+		    "design.\n", path);
+	    return false;
+      }
+
+      return true;
+}
+
+vvp_time64_t checkpoint_restore_functors(void)
+{
+      assert(checkpoint_loaded);
+      checkpoint_in&in = *checkpoint_loaded;
+      vvp_time64_t time = in.get_uint();
+      restore_functors(in);
+      return time;
+}
+
+void checkpoint_restore_values(void)
+{
+      assert(checkpoint_loaded);
+      checkpoint_in&in = *checkpoint_loaded;
+      restore_values(in);
+      array_checkpoint_load(in);
+}
+
+void checkpoint_restore_threads(void)
+{
+      assert(checkpoint_loaded);
+      checkpoint_in&in = *checkpoint_loaded;
+
+	// The values have settled, so connect the functors again.
+      for (size_t idx = checkpoint_cut_nets.size() ; idx > 0 ; idx -= 1)
+	    checkpoint_cut_nets[idx-1].first->fun = checkpoint_cut_nets[idx-1].second;
+      checkpoint_cut_nets.clear();
+
+      schedule_checkpoint_load(in);
+      restore_waits(in);
+      restore_threads(in);
+      vpip_checkpoint_restart(in);
+
+      delete checkpoint_loaded;
+      checkpoint_loaded = 0;
+}
+
+/*
+ * $restart runs vvp again, with the same arguments and the -r flag,
+ * in place of this process. Check the file first, so that a bad file
+ * does not end the simulation. The VVP_RESTARTED environment variable
+ * tells the new process that it was started this way.
+ */
+void checkpoint_restart(const char*path)
+{
+      std::string bytes;
+      if (! checkpoint_read(path, bytes))
+	    return;
+
+      assert(checkpoint_argv);
+      std::vector<char*> args;
+      args.push_back(checkpoint_argv[0]);
+      args.push_back(const_cast<char*>("-r"));
+      args.push_back(const_cast<char*>(path));
+
+	// Pass on the other arguments, but leave out the -r flag of
+	// this run. The options end at the design file.
+      int idx = 1;
+      for ( ; idx < checkpoint_argc && checkpoint_argv[idx][0] == '-' ; idx += 1) {
+	    if (strcmp(checkpoint_argv[idx], "-r") == 0) {
+		  idx += 1;
+		  continue;
+	    }
+	    if (strncmp(checkpoint_argv[idx], "-r", 2) == 0)
+		  continue;
+	    args.push_back(checkpoint_argv[idx]);
+	      // The rest of these flags have an argument.
+	    if (checkpoint_argv[idx][1] && strchr("clMm", checkpoint_argv[idx][1])
+		&& checkpoint_argv[idx][2] == 0 && idx+1 < checkpoint_argc)
+		  args.push_back(checkpoint_argv[++idx]);
+      }
+      for ( ; idx < checkpoint_argc ; idx += 1)
+	    args.push_back(checkpoint_argv[idx]);
+      args.push_back(0);
+
+	// The new process continues the -l log file of this one.
+      putenv(const_cast<char*>("VVP_RESTARTED=1"));
+
+      fflush(0);
+      execvp(args[0], &args[0]);
+      fprintf(stderr, "$restart: %s: %s\n", args[0], strerror(errno));
+}
@@ -0,0 +1,201 @@
+#ifndef IVL_checkpoint_H
+#define IVL_checkpoint_H
+/*
+ * Copyright (c) 2026 Stephen Williams (steve@icarus.com)
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+# include  "schedule.h"
+# include  "vthread.h"
+# include  "vvp_net.h"
+# include  <map>
+# include  <string>
+# include  <vector>
+
+class __vpiScope;
+typedef struct __vpiArray* vvp_array_t;
+
+/*
+ * A checkpoint is a file that holds the state of a running
+ * simulation: the simulation time, the values of the variables and
+ * memories, the threads and the events scheduled for future time
+ * steps. The $save system task asks for a checkpoint, which is taken
+ * at the end of the current time step, and "vvp -r <file>" (or the
+ * $restart system task) loads the same design and continues the
+ * simulation from the saved state.
+ *
+ * The values of most nets are not saved. The restored variables are
+ * propagated through the netlist before any thread runs, and that
+ * recreates the net values. The functors that hold state of their
+ * own (flip-flops, latches, sequential UDPs, net and path delays)
+ * save it, and while the variables propagate they are cut off from
+ * their inputs so that the restore itself does not clock them. The
+ * forces and procedural continuous assignments are put back after
+ * the values.
+ *
+ * VPI modules save their own state through the cbStartOfSave and
+ * cbStartOfRestart callbacks and vpi_put_data/vpi_get_data. A module
+ * must register these callbacks when it is loaded, because a restart
+ * starts from a new process. A $save fails if a VPI callback belongs
+ * to a module that does not do this, or if a file is open.
+ *
+ * The objects are identified in the file by their position in the
+ * lists that the compiler builds, so a checkpoint can only be
+ * restored into the design (and VVP_NO_FOLD setting) that saved it.
+ */
+class checkpoint_out {
+
+    public:
+      checkpoint_out();
+      ~checkpoint_out();
+
+	// The bytes of the checkpoint so far. Truncating them takes
+	// back a record that turned out to be empty.
+      const std::string& bytes() const { return buf_; }
+      void truncate(size_t size);
+
+      void put_uint(uint64_t val);
+      void put_real(double val);
+      void put_str(const std::string&val);
+      void put_vec4(const vvp_vector4_t&val);
+      void put_vec8(const vvp_vector8_t&val);
+      void put_vec2(const vvp_vector2_t&val);
+
+	// Write a reference to the object. The threads are given
+	// numbers the first time they are written, and the thread
+	// writer later saves all the threads that were numbered.
+      void put_net(const vvp_net_t*net);
+      void put_scope(__vpiScope*scope);
+      void put_thread(vthread_t thr);
+      uint64_t number_thread(vthread_t thr);
+
+      size_t thread_count() const { return threads_.size(); }
+      vthread_t thread(size_t idx) const { return threads_[idx]; }
+
+	// Record that the state cannot be saved. Only the first
+	// reason is kept; the rest is probably a consequence.
+      void refuse(const char*fmt, ...) __attribute__((format (printf,2,3)));
+      bool refused() const { return ! why_.empty(); }
+      const std::string& why() const { return why_; }
+
+    private:
+      std::string buf_;
+      std::string why_;
+      std::vector<vthread_t> threads_;
+      std::map<vthread_t,uint64_t> thread_ids_;
+};
+
+class checkpoint_in {
+
+    public:
+      checkpoint_in(const char*path, const std::string&bytes);
+      ~checkpoint_in();
+
+      uint64_t get_uint();
+      double get_real();
+      std::string get_str();
+      vvp_vector4_t get_vec4();
+      vvp_vector8_t get_vec8();
+      vvp_vector2_t get_vec2();
+
+      vvp_net_t* get_net();
+      __vpiScope* get_scope();
+	// Threads are created the first time they are referenced,
+	// and the thread reader fills them in.
+      vthread_t get_thread();
+      vthread_t thread(uint64_t id);
+
+	// The file does not match the design, or is truncated. This
+	// does not return.
+      void corrupt(const char*what);
+
+    private:
+      const char*path_;
+      std::string buf_;
+      size_t pos_;
+      std::vector<vthread_t> threads_;
+};
+
+/*
+ * This is set by the -r flag before the design is compiled. The
+ * compiler does not start the initial threads of the design, because
+ * the threads come from the checkpoint instead.
+ */
+extern bool checkpoint_restoring;
+
+extern void checkpoint_set_argv(int argc, char*argv[]);
+
+/*
+ * The compiler calls this once the design is complete. The nets that
+ * are made after this (by %force/link, for example) are not part of
+ * the design that a checkpoint refers to.
+ */
+extern void checkpoint_design_done(void);
+
+/*
+ * $save and $restart call these. The save is done by the scheduler
+ * between time steps, the restart replaces the process right away.
+ */
+extern void checkpoint_request_save(const char*path);
+extern void checkpoint_restart(const char*path);
+
+/*
+ * The scheduler calls this at the end of each time step. It writes
+ * the requested checkpoint, if any.
+ */
+extern bool checkpoint_save_pending;
+extern void checkpoint_service(void);
+
+/*
+ * Read the checkpoint file for the -r flag, after the design is
+ * compiled. This returns false (with a message) if the file is not a
+ * checkpoint of this design.
+ */
+extern bool checkpoint_load(const char*path);
+
+/*
+ * The scheduler restores the loaded checkpoint in three steps. The
+ * functors with state are put back before the initialization events,
+ * and the return value is the time to continue from. The values are
+ * put back after the initialization events. The threads, the future
+ * events and the state of the VPI modules are put back once the
+ * values have settled.
+ */
+extern vvp_time64_t checkpoint_restore_functors(void);
+extern void checkpoint_restore_values(void);
+extern void checkpoint_restore_threads(void);
+
+/*
+ * The parts of the checkpoint that are private to their modules.
+ */
+extern void schedule_checkpoint_save(checkpoint_out&out);
+extern void schedule_checkpoint_load(checkpoint_in&in);
+extern bool schedule_final_thread(vthread_t thr);
+extern void vthread_checkpoint_save(checkpoint_out&out, vthread_t thr);
+extern void vthread_checkpoint_load(checkpoint_in&in, vthread_t thr);
+extern vthread_t vthread_checkpoint_new(void);
+extern void array_checkpoint_save(checkpoint_out&out);
+extern void array_checkpoint_load(checkpoint_in&in);
+extern void array_checkpoint_put(checkpoint_out&out, vvp_array_t mem);
+extern vvp_array_t array_checkpoint_get(checkpoint_in&in);
+extern vvp_gen_event_t delay_checkpoint_event(checkpoint_in&in);
+extern const char* vpip_checkpoint_foreign_callback(void);
+extern bool vpip_checkpoint_save(checkpoint_out&out);
+extern void vpip_checkpoint_end_save(void);
+extern void vpip_checkpoint_restart(checkpoint_in&in);
+
+#endif /* IVL_checkpoint_H */
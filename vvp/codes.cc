@@ -96,6 +96,48 @@ vvp_code_t codespace_null(void)
       return first_chunk + 0;
 }
 
+void codespace_scan(void (*fun)(vvp_code_t cp, unsigned avail))
+{
+      for (vvp_code_t chunk = first_chunk ; chunk != 0
+		 ; chunk = chunk[code_chunk_size-1].cptr) {
+	      /* Stop short of the chunk link, or the next free
+		 instruction if this is the current chunk. */
+	    unsigned end = code_chunk_size-1;
+	    if (chunk == current_chunk)
+		  end = current_within_chunk;
+
+	    for (unsigned idx = 0 ; idx < end ; idx += 1)
+		  fun(chunk+idx, end-idx);
+      }
+}
+
+unsigned long codespace_index(vvp_code_t cp)
+{
+      unsigned long base = 0;
+      for (vvp_code_t chunk = first_chunk ; chunk != 0
+		 ; chunk = chunk[code_chunk_size-1].cptr) {
+	    if (cp >= chunk && cp < chunk+code_chunk_size)
+		  return base + (cp - chunk);
+	    base += code_chunk_size;
+      }
+      assert(0);
+      return 0;
+}
+
+vvp_code_t codespace_at(unsigned long idx)
+{
+      for (vvp_code_t chunk = first_chunk ; chunk != 0
+		 ; chunk = chunk[code_chunk_size-1].cptr) {
+	    if (idx < code_chunk_size) {
+		  if (chunk == current_chunk && idx >= current_within_chunk)
+			return 0;
+		  return chunk + idx;
+	    }
+	    idx -= code_chunk_size;
+      }
+      return 0;
+}
+
 #ifdef CHECK_WITH_VALGRIND
 void codespace_delete(void)
 {
@@ -262,6 +262,35 @@ extern bool of_REAP_UFUNC(vthread_t thr, vvp_code_t code);
 
 extern bool of_CHUNK_LINK(vthread_t thr, vvp_code_t code);
 
+/*
+ * These operate on 2-state values of up to 64 bits on the vec2 stack.
+ */
+extern bool of_ADD_VEC2(vthread_t thr, vvp_code_t code);
+extern bool of_AND_VEC2(vthread_t thr, vvp_code_t code);
+extern bool of_CMP_VEC2_S(vthread_t thr, vvp_code_t code);
+extern bool of_CMP_VEC2_U(vthread_t thr, vvp_code_t code);
+extern bool of_INV_VEC2(vthread_t thr, vvp_code_t code);
+extern bool of_LOAD_VEC2(vthread_t thr, vvp_code_t code);
+extern bool of_MUL_VEC2(vthread_t thr, vvp_code_t code);
+extern bool of_OR_VEC2(vthread_t thr, vvp_code_t code);
+extern bool of_PUSHI_VEC2(vthread_t thr, vvp_code_t code);
+extern bool of_STORE_VEC2(vthread_t thr, vvp_code_t code);
+extern bool of_SUB_VEC2(vthread_t thr, vvp_code_t code);
+extern bool of_XOR_VEC2(vthread_t thr, vvp_code_t code);
+
+/*
+ * These are superinstructions. They are never named in the source
+ * file, but are put in place of the first opcode of some common
+ * instruction sequences by compile_fuse_opcodes().
+ */
+extern bool of_DUP_PUSHI_CMPU_JMP1(vthread_t thr, vvp_code_t code);
+extern bool of_LOAD_ASSIGN_VEC4(vthread_t thr, vvp_code_t code);
+extern bool of_LOAD_CMPIE(vthread_t thr, vvp_code_t code);
+extern bool of_LOAD_CMPIE_JMP0XZ(vthread_t thr, vvp_code_t code);
+extern bool of_LOAD_CMPINE(vthread_t thr, vvp_code_t code);
+extern bool of_LOAD_CMPINE_JMP0XZ(vthread_t thr, vvp_code_t code);
+extern bool of_PUSHI_ASSIGN_VEC4(vthread_t thr, vvp_code_t code);
+
 /*
  * This is the format of a machine code instruction.
  */
@@ -284,6 +313,19 @@ struct vvp_code_s {
 	    vvp_code_t   cptr2;
 	    class ufunc_core*ufunc_core_ptr;
       };
+
+	/* This is the operand resolved to the type that the opcode
+	   needs. compile_bind_operands() fills it in once the design
+	   is linked, so the opcode does not have to dynamic_cast the
+	   operand each time it runs. */
+      union {
+	    class vvp_signal_value*sig_value;
+	    class vvp_fun_signal_object*sig_object;
+	    class vvp_fun_signal_string*sig_string;
+	    struct waitable_hooks_s*waitable;
+	    class vpiScopeFunction*scope_func;
+	    const class class_type*class_defn;
+      };
 };
 
 /*
@@ -304,4 +346,20 @@ extern vvp_code_t codespace_allocate(void);
 extern vvp_code_t codespace_next(void);
 extern vvp_code_t codespace_null(void);
 
+/*
+ * Call the fun for each allocated instruction in the code space, in
+ * address order. The avail argument is the number of instructions,
+ * including this one, that are contiguous in memory starting at cp.
+ */
+extern void codespace_scan(void (*fun)(vvp_code_t cp, unsigned avail));
+
+/*
+ * Convert between instruction addresses and their position in the
+ * code space. The position of an instruction is the same each time
+ * the same design is loaded, so checkpoints save that instead of the
+ * address. codespace_at returns 0 if the position is out of range.
+ */
+extern unsigned long codespace_index(vvp_code_t cp);
+extern vvp_code_t codespace_at(unsigned long idx);
+
 #endif /* IVL_codes_H */
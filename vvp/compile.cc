@@ -23,6 +23,7 @@
 # include  "arith.h"
 # include  "compile.h"
 # include  "logic.h"
+# include  "part.h"
 # include  "resolv.h"
 # include  "udp.h"
 # include  "symbols.h"
@@ -32,8 +33,19 @@
 # include  "parse_misc.h"
 # include  "statistics.h"
 # include  "schedule.h"
+# include  "array.h"
+# include  "sfunc.h"
+# include  "ufunc.h"
+# include  "vvp_island.h"
+# include  "checkpoint.h"
+# include  "class_type.h"
+# include  "event.h"
+# include  "vvp_net_sig.h"
 # include  <iostream>
+# include  <algorithm>
 # include  <list>
+# include  <map>
+# include  <vector>
 # include  <cstdlib>
 # include  <cstring>
 # include  <cassert>
@@ -87,11 +99,13 @@ struct opcode_table_s {
 static const struct opcode_table_s opcode_table[] = {
       { "%abs/wr", of_ABS_WR, 0,  {OA_NONE,     OA_NONE,     OA_NONE} },
       { "%add",    of_ADD,    0,  {OA_NONE,     OA_NONE,     OA_NONE} },
+      { "%add/vec2",of_ADD_VEC2,0, {OA_NONE,     OA_NONE,     OA_NONE} },
       { "%add/wr", of_ADD_WR, 0,  {OA_NONE,     OA_NONE,     OA_NONE} },
       { "%addi",   of_ADDI,   3,  {OA_BIT1,     OA_BIT2,     OA_NUMBER} },
       { "%alloc",  of_ALLOC,  1,  {OA_VPI_PTR,  OA_NONE,     OA_NONE} },
       { "%and",    of_AND,    0,  {OA_NONE,     OA_NONE,     OA_NONE} },
       { "%and/r",  of_ANDR,   0,  {OA_NONE,     OA_NONE,     OA_NONE} },
+      { "%and/vec2",of_AND_VEC2,0, {OA_NONE,     OA_NONE,     OA_NONE} },
       { "%assign/ar",of_ASSIGN_AR,2,{OA_ARR_PTR,OA_BIT1,     OA_NONE} },
       { "%assign/ar/d",of_ASSIGN_ARD,2,{OA_ARR_PTR,OA_BIT1,  OA_NONE} },
       { "%assign/ar/e",of_ASSIGN_ARE,1,{OA_ARR_PTR,OA_NONE,  OA_NONE} },
@@ -123,6 +137,8 @@ static const struct opcode_table_s opcode_table[] = {
       { "%cmp/s",   of_CMPS,   0,  {OA_NONE,     OA_NONE,     OA_NONE} },
       { "%cmp/str", of_CMPSTR, 0,  {OA_NONE,     OA_NONE,     OA_NONE} },
       { "%cmp/u",   of_CMPU,   0,  {OA_NONE,     OA_NONE,     OA_NONE} },
+      { "%cmp/vec2/s",of_CMP_VEC2_S,1,{OA_NUMBER,OA_NONE,     OA_NONE} },
+      { "%cmp/vec2/u",of_CMP_VEC2_U,1,{OA_NUMBER,OA_NONE,     OA_NONE} },
       { "%cmp/we",  of_CMPWE,  0,  {OA_NONE,     OA_NONE,     OA_NONE} },
       { "%cmp/wne", of_CMPWNE, 0,  {OA_NONE,     OA_NONE,     OA_NONE} },
       { "%cmp/wr",  of_CMPWR,  0,  {OA_NONE,     OA_NONE,     OA_NONE} },
@@ -176,6 +192,7 @@ static const struct opcode_table_s opcode_table[] = {
       { "%fork",   of_FORK,   2,  {OA_CODE_PTR2,OA_VPI_PTR,  OA_NONE} },
       { "%free",   of_FREE,   1,  {OA_VPI_PTR,  OA_NONE,     OA_NONE} },
       { "%inv",    of_INV,    0,  {OA_NONE,     OA_NONE,     OA_NONE} },
+      { "%inv/vec2",of_INV_VEC2,0, {OA_NONE,     OA_NONE,     OA_NONE} },
       { "%ix/add", of_IX_ADD, 3,  {OA_NUMBER,   OA_BIT1,     OA_BIT2} },
       { "%ix/getv",of_IX_GETV,2,  {OA_BIT1,     OA_FUNC_PTR, OA_NONE} },
       { "%ix/getv/s",of_IX_GETV_S,2, {OA_BIT1,   OA_FUNC_PTR, OA_NONE} },
@@ -201,6 +218,7 @@ static const struct opcode_table_s opcode_table[] = {
       { "%load/real",  of_LOAD_REAL, 1,{OA_VPI_PTR, OA_NONE, OA_NONE} },
       { "%load/str",   of_LOAD_STR,  1,{OA_FUNC_PTR,OA_NONE, OA_NONE} },
       { "%load/stra",  of_LOAD_STRA, 2,{OA_ARR_PTR, OA_BIT1, OA_NONE} },
+      { "%load/vec2",  of_LOAD_VEC2, 1,{OA_FUNC_PTR,OA_NONE,  OA_NONE} },
       { "%load/vec4",  of_LOAD_VEC4, 1,{OA_FUNC_PTR,OA_NONE,  OA_NONE} },
       { "%load/vec4a", of_LOAD_VEC4A,2,{OA_ARR_PTR, OA_BIT1, OA_NONE} },
       { "%max/wr", of_MAX_WR, 0,  {OA_NONE,     OA_NONE,     OA_NONE} },
@@ -210,6 +228,7 @@ static const struct opcode_table_s opcode_table[] = {
       { "%mod/wr", of_MOD_WR, 0,  {OA_NONE,     OA_NONE,     OA_NONE} },
       { "%mov/wu", of_MOV_WU, 2,  {OA_BIT1,     OA_BIT2,     OA_NONE} },
       { "%mul",    of_MUL,    0,  {OA_NONE,     OA_NONE,     OA_NONE} },
+      { "%mul/vec2",of_MUL_VEC2,0, {OA_NONE,     OA_NONE,     OA_NONE} },
       { "%mul/wr", of_MUL_WR, 0,  {OA_NONE,     OA_NONE,     OA_NONE} },
       { "%muli",   of_MULI,   3,  {OA_BIT1,     OA_BIT2,     OA_NUMBER} },
       { "%nand",   of_NAND,   0,  {OA_NONE,     OA_NONE,     OA_NONE} },
@@ -222,6 +241,7 @@ static const struct opcode_table_s opcode_table[] = {
       { "%null",   of_NULL,   0,  {OA_NONE,     OA_NONE,     OA_NONE} },
       { "%or",     of_OR,     0,  {OA_NONE,     OA_NONE,     OA_NONE} },
       { "%or/r",   of_ORR,    0,  {OA_NONE,     OA_NONE,     OA_NONE} },
+      { "%or/vec2", of_OR_VEC2, 0, {OA_NONE,     OA_NONE,     OA_NONE} },
       { "%pad/s",  of_PAD_S,  1,  {OA_NUMBER,   OA_NONE,     OA_NONE} },
       { "%pad/u",  of_PAD_U,  1,  {OA_NUMBER,   OA_NONE,     OA_NONE} },
       { "%part/s", of_PART_S, 1,  {OA_NUMBER,   OA_NONE,     OA_NONE} },
@@ -241,6 +261,7 @@ static const struct opcode_table_s opcode_table[] = {
       { "%prop/v",  of_PROP_V,  1,  {OA_NUMBER,   OA_NONE,     OA_NONE} },
       { "%pushi/real",of_PUSHI_REAL,2,{OA_BIT1,   OA_BIT2,   OA_NONE} },
       { "%pushi/str", of_PUSHI_STR, 1,{OA_STRING, OA_NONE,   OA_NONE} },
+      { "%pushi/vec2",of_PUSHI_VEC2,2,{OA_BIT1,   OA_BIT2,   OA_NONE} },
       { "%pushi/vec4",of_PUSHI_VEC4,3,{OA_BIT1,   OA_BIT2,   OA_NUMBER} },
       { "%pushv/str", of_PUSHV_STR, 0,{OA_NONE,   OA_NONE,   OA_NONE} },
       { "%putc/str/vec4",of_PUTC_STR_VEC4,2,{OA_FUNC_PTR,OA_BIT1,OA_NONE} },
@@ -285,9 +306,11 @@ static const struct opcode_table_s opcode_table[] = {
       { "%store/reala",   of_STORE_REALA,   2, {OA_ARR_PTR, OA_BIT1, OA_NONE} },
       { "%store/str",     of_STORE_STR,     1, {OA_FUNC_PTR,OA_NONE, OA_NONE} },
       { "%store/stra",    of_STORE_STRA,    2, {OA_ARR_PTR, OA_BIT1, OA_NONE} },
+      { "%store/vec2",    of_STORE_VEC2,    2, {OA_FUNC_PTR,OA_BIT1, OA_NONE} },
       { "%store/vec4",    of_STORE_VEC4,    3, {OA_FUNC_PTR,OA_BIT1, OA_BIT2} },
       { "%store/vec4a",   of_STORE_VEC4A,   3, {OA_ARR_PTR, OA_BIT1, OA_BIT2} },
       { "%sub",    of_SUB,    0,  {OA_NONE,     OA_NONE,     OA_NONE} },
+      { "%sub/vec2",of_SUB_VEC2,0, {OA_NONE,     OA_NONE,     OA_NONE} },
       { "%sub/wr", of_SUB_WR, 0,  {OA_NONE,     OA_NONE,     OA_NONE} },
       { "%subi",   of_SUBI,   3,  {OA_BIT1,     OA_BIT2,     OA_NUMBER} },
       { "%substr",     of_SUBSTR,     2,{OA_BIT1,    OA_BIT2, OA_NONE} },
@@ -302,6 +325,7 @@ static const struct opcode_table_s opcode_table[] = {
       { "%xnor/r", of_XNORR,  0,  {OA_NONE,     OA_NONE,     OA_NONE} },
       { "%xor",    of_XOR,    0,  {OA_NONE,     OA_NONE,     OA_NONE} },
       { "%xor/r",  of_XORR,   0,  {OA_NONE,     OA_NONE,     OA_NONE} },
+      { "%xor/vec2",of_XOR_VEC2,0, {OA_NONE,     OA_NONE,     OA_NONE} },
       { 0, of_NOOP, 0, {OA_NONE, OA_NONE, OA_NONE} }
 };
 
@@ -315,6 +339,972 @@ static int opcode_compare(const void*k, const void*r)
       return strcmp(kp, rp->mnemonic);
 }
 
+/*
+ * This is the table of superinstructions. Each entry is a sequence of
+ * opcodes that tgt-vvp commonly generates, and the opcode that does
+ * the work of the entire sequence. If one sequence is a prefix of
+ * another, the longer sequence must come first.
+ */
+struct fuse_table_s {
+      vvp_code_fun fused;
+      unsigned count;
+      vvp_code_fun seq[4];
+};
+
+static const struct fuse_table_s fuse_table[] = {
+      { of_DUP_PUSHI_CMPU_JMP1, 4, {of_DUP_VEC4,  of_PUSHI_VEC4, of_CMPU, of_JMP1} },
+      { of_LOAD_CMPIE_JMP0XZ,   3, {of_LOAD_VEC4, of_CMPIE,  of_JMP0XZ, 0} },
+      { of_LOAD_CMPINE_JMP0XZ,  3, {of_LOAD_VEC4, of_CMPINE, of_JMP0XZ, 0} },
+      { of_LOAD_CMPIE,          2, {of_LOAD_VEC4, of_CMPIE,       0, 0} },
+      { of_LOAD_CMPINE,         2, {of_LOAD_VEC4, of_CMPINE,      0, 0} },
+      { of_LOAD_ASSIGN_VEC4,    2, {of_LOAD_VEC4, of_ASSIGN_VEC4, 0, 0} },
+      { of_PUSHI_ASSIGN_VEC4,   2, {of_PUSHI_VEC4,of_ASSIGN_VEC4, 0, 0} },
+      { 0, 0, {0, 0, 0, 0} }
+};
+
+static void fuse_opcode(vvp_code_t cp, unsigned avail)
+{
+      for (const struct fuse_table_s*cur = fuse_table ; cur->fused ; cur += 1) {
+	    if (cur->count > avail)
+		  continue;
+
+	    unsigned idx = 0;
+	    while (idx < cur->count && cp[idx].opcode == cur->seq[idx])
+		  idx += 1;
+	    if (idx < cur->count)
+		  continue;
+
+	    cp->opcode = cur->fused;
+	    count_opcodes_fused += 1;
+	    return;
+      }
+}
+
+/*
+ * Replace the first opcode of common instruction sequences with a
+ * superinstruction. Only the first opcode is changed, the remaining
+ * instructions are left alone so that jumps into the middle of a
+ * sequence still work. Set the VVP_NO_FUSE environment variable to
+ * skip this and run the plain opcodes, i.e. when debugging.
+ */
+static void compile_fuse_opcodes(void)
+{
+      if (getenv("VVP_NO_FUSE"))
+	    return;
+
+      codespace_scan(&fuse_opcode);
+}
+
+/*
+ * This is the table of the opcodes that use a typed operand. Each
+ * entry names the typed field of the instruction that the opcode
+ * reads, and compile_bind_operands() resolves that field from the
+ * untyped operand once the design is linked.
+ */
+enum operand_bind_e {
+      BIND_SIG_VALUE,
+      BIND_SIG_OBJECT,
+      BIND_SIG_STRING,
+      BIND_WAITABLE,
+      BIND_SCOPE_FUNC,
+      BIND_UFUNC_SCOPE,
+      BIND_CLASS_DEFN
+};
+
+struct bind_table_s {
+      vvp_code_fun opcode;
+      enum operand_bind_e bind;
+};
+
+static const struct bind_table_s bind_table[] = {
+      { of_ASSIGN_VEC4D,      BIND_SIG_VALUE },
+      { of_ASSIGN_VEC4E,      BIND_SIG_VALUE },
+      { of_ASSIGN_VEC4_OFF_D, BIND_SIG_VALUE },
+      { of_ASSIGN_VEC4_OFF_E, BIND_SIG_VALUE },
+      { of_FORCE_VEC4_OFF,    BIND_SIG_VALUE },
+      { of_IX_GETV,           BIND_SIG_VALUE },
+      { of_IX_GETV_S,         BIND_SIG_VALUE },
+      { of_LOAD_VEC2,         BIND_SIG_VALUE },
+      { of_LOAD_VEC4,         BIND_SIG_VALUE },
+      { of_STORE_VEC4,        BIND_SIG_VALUE },
+      { of_LOAD_DAR_R,        BIND_SIG_OBJECT },
+      { of_LOAD_DAR_STR,      BIND_SIG_OBJECT },
+      { of_LOAD_DAR_VEC4,     BIND_SIG_OBJECT },
+      { of_LOAD_OBJ,          BIND_SIG_OBJECT },
+      { of_QPOP_B_STR,        BIND_SIG_OBJECT },
+      { of_QPOP_B_V,          BIND_SIG_OBJECT },
+      { of_QPOP_F_STR,        BIND_SIG_OBJECT },
+      { of_QPOP_F_V,          BIND_SIG_OBJECT },
+      { of_STORE_DAR_R,       BIND_SIG_OBJECT },
+      { of_STORE_DAR_STR,     BIND_SIG_OBJECT },
+      { of_STORE_DAR_VEC4,    BIND_SIG_OBJECT },
+      { of_STORE_QB_STR,      BIND_SIG_OBJECT },
+      { of_STORE_QB_V,        BIND_SIG_OBJECT },
+      { of_STORE_QF_STR,      BIND_SIG_OBJECT },
+      { of_STORE_QF_V,        BIND_SIG_OBJECT },
+      { of_TEST_NUL,          BIND_SIG_OBJECT },
+      { of_LOAD_STR,          BIND_SIG_STRING },
+      { of_PUTC_STR_VEC4,     BIND_SIG_STRING },
+      { of_WAIT,              BIND_WAITABLE },
+      { of_CALLF_VEC4,        BIND_SCOPE_FUNC },
+      { of_EXEC_UFUNC_VEC4,   BIND_UFUNC_SCOPE },
+      { of_NEW_COBJ,          BIND_CLASS_DEFN },
+      { 0, BIND_SIG_VALUE }
+};
+
+/*
+ * These opcodes still dynamic_cast their operand each time they run.
+ * They are the procedural continuous assigns, which are rare enough
+ * that they are left alone. compile_bind_operands() counts them so
+ * that "vvp -v" can report how many remain.
+ */
+static const vvp_code_fun dynamic_table[] = {
+      of_CASSIGN_LINK,
+      of_CASSIGN_VEC4,
+      of_CASSIGN_VEC4_OFF,
+      of_CASSIGN_WR,
+      of_DEASSIGN,
+      of_DEASSIGN_WR,
+      0
+};
+
+static void bind_operand(vvp_code_t cp, unsigned)
+{
+      for (const vvp_code_fun*cur = dynamic_table ; *cur ; cur += 1) {
+	    if (cp->opcode == *cur) {
+		  count_opcodes_dynamic += 1;
+		  return;
+	    }
+      }
+
+      const struct bind_table_s*cur = bind_table;
+      while (cur->opcode && cur->opcode != cp->opcode)
+	    cur += 1;
+      if (cur->opcode == 0)
+	    return;
+
+	/* If the cast fails, the field is left nil, and the opcode
+	   reports the bad operand when it runs, as it always has. */
+      switch (cur->bind) {
+	  case BIND_SIG_VALUE:
+	    cp->sig_value = dynamic_cast<vvp_signal_value*>(cp->net->fil);
+	    break;
+	  case BIND_SIG_OBJECT:
+	    cp->sig_object = dynamic_cast<vvp_fun_signal_object*>(cp->net->fun);
+	    break;
+	  case BIND_SIG_STRING:
+	    cp->sig_string = dynamic_cast<vvp_fun_signal_string*>(cp->net->fun);
+	    break;
+	  case BIND_WAITABLE:
+	    cp->waitable = dynamic_cast<waitable_hooks_s*>(cp->net->fun);
+	    break;
+	  case BIND_SCOPE_FUNC:
+	    cp->scope_func = dynamic_cast<vpiScopeFunction*>(cp->scope);
+	    break;
+	  case BIND_UFUNC_SCOPE:
+	    cp->scope_func = dynamic_cast<vpiScopeFunction*>(cp->ufunc_core_ptr->func_scope());
+	    break;
+	  case BIND_CLASS_DEFN:
+	    cp->class_defn = dynamic_cast<const class_type*>(cp->handle);
+	    break;
+      }
+      count_opcodes_bound += 1;
+}
+
+/*
+ * Resolve the typed operands of the instructions. This must run
+ * after the netlist is final, and before compile_fuse_opcodes()
+ * replaces the opcodes that the bind table looks for.
+ */
+static void compile_bind_operands(void)
+{
+      codespace_scan(&bind_operand);
+}
+
+static std::map<vvp_code_fun,const struct opcode_table_s*>*cur_opcode_map = 0;
+static void (*cur_code_net_fun)(vvp_net_t*) = 0;
+
+static void scan_opcode_nets(vvp_code_t cp, unsigned)
+{
+      std::map<vvp_code_fun,const struct opcode_table_s*>::const_iterator op
+	    = cur_opcode_map->find(cp->opcode);
+      if (op == cur_opcode_map->end())
+	    return;
+
+      for (unsigned idx = 0 ; idx < op->second->argc ; idx += 1) {
+	    switch (op->second->argt[idx]) {
+		case OA_FUNC_PTR:
+		  if (cp->net) cur_code_net_fun(cp->net);
+		  break;
+		case OA_FUNC_PTR2:
+		  if (cp->net2) cur_code_net_fun(cp->net2);
+		  break;
+		default:
+		  break;
+	    }
+      }
+}
+
+/*
+ * Call the function for each net that an instruction refers to.
+ */
+static void codespace_scan_nets(void (*fun)(vvp_net_t*))
+{
+      std::map<vvp_code_fun,const struct opcode_table_s*> opcode_map;
+      for (unsigned idx = 0 ; idx < opcode_count ; idx += 1)
+	    opcode_map[opcode_table[idx].opcode] = opcode_table+idx;
+
+      cur_opcode_map = &opcode_map;
+      cur_code_net_fun = fun;
+      codespace_scan(&scan_opcode_nets);
+      cur_opcode_map = 0;
+      cur_code_net_fun = 0;
+}
+
+/*
+ * Constant folding of logic functors
+ *
+ * Synthesized netlists have many gates with inputs tied to
+ * constants. The input_connect function holds back the constant
+ * inputs of logic functors that can be folded (see vvp_fun_fold_), and
+ * once the netlist is linked the gates that have only constant inputs
+ * are evaluated here. The output of a folded gate is passed on to its
+ * fan-out as a constant in its place, so chains of constant logic fold
+ * away and only the final values are scheduled at time 0.
+ *
+ * Gates whose output goes nowhere are then unlinked from their
+ * inputs, and a buf that drives only another buf takes over the
+ * fan-out of that buf, as buf(buf(x)) is buf(x). Gates that the
+ * behavioral code refers to are left alone. Set the VVP_NO_FOLD
+ * environment variable to skip all of this.
+ */
+static bool fold_functors_flag = true;
+
+static const size_t FOLD_NONE = (size_t)-1;
+
+/*
+ * The held back constants. The constants for each gate are chained
+ * in order through the next member.
+ */
+struct fold_const_s {
+      fold_const_s(vvp_net_ptr_t p, const vvp_vector4_t&v)
+      : ptr(p), val(v), next(FOLD_NONE) { }
+
+      vvp_net_ptr_t ptr;
+      vvp_vector4_t val;
+      size_t next;
+};
+
+static std::vector<fold_const_s> fold_consts;
+
+/*
+ * A link into the input of a gate, and the net that it comes from.
+ */
+struct fold_source_s {
+      vvp_net_t*src;
+      vvp_net_ptr_t ptr;
+};
+
+struct fold_gate_s {
+      explicit fold_gate_s(vvp_net_t*n)
+      : net(n), drivers(0), pinned(false), done(false),
+	first_const(FOLD_NONE), last_const(FOLD_NONE), first_source(0)
+      { }
+
+      vvp_net_t*net;
+	// The number of links into the inputs of the gate.
+      unsigned drivers;
+	// True if the behavioral code refers to the gate.
+      bool pinned;
+	// True if the gate has been folded or removed.
+      bool done;
+	// The chain of constant inputs.
+      size_t first_const, last_const;
+	// The links into the inputs, in fold_sources.
+      size_t first_source;
+
+      bool operator < (const fold_gate_s&that) const { return net < that.net; }
+};
+
+static std::vector<fold_gate_s>*cur_fold_gates = 0;
+
+static fold_gate_s* fold_gate(vvp_net_t*net)
+{
+      std::vector<fold_gate_s>&gates = *cur_fold_gates;
+      std::vector<fold_gate_s>::iterator cur
+	    = std::lower_bound(gates.begin(), gates.end(), fold_gate_s(net));
+      if (cur == gates.end() || cur->net != net)
+	    return 0;
+      return &*cur;
+}
+
+static void fold_chain_const(fold_gate_s*gate, size_t idx)
+{
+      if (gate->last_const == FOLD_NONE)
+	    gate->first_const = idx;
+      else
+	    fold_consts[gate->last_const].next = idx;
+      gate->last_const = idx;
+}
+
+/*
+ * A constant that has been passed on, or whose gate is gone, is
+ * dropped by clearing its pointer.
+ */
+static void fold_drop_consts(fold_gate_s*gate)
+{
+      for (size_t idx = gate->first_const ; idx != FOLD_NONE
+		 ; idx = fold_consts[idx].next)
+	    fold_consts[idx].ptr = vvp_net_ptr_t();
+}
+
+static void fold_code_net(vvp_net_t*net)
+{
+      if (fold_gate_s*gate = fold_gate(net))
+	    gate->pinned = true;
+}
+
+enum fuse_kind_t { FUSE_NONE, FUSE_PART, FUSE_CONCAT, FUSE_EXTEND };
+
+static fuse_kind_t fuse_kind(vvp_net_fun_t*fun)
+{
+      if (dynamic_cast<vvp_fun_part_sa*>(fun))
+	    return FUSE_PART;
+      if (dynamic_cast<vvp_fun_concat*>(fun))
+	    return FUSE_CONCAT;
+      if (dynamic_cast<vvp_fun_extend_signed*>(fun))
+	    return FUSE_EXTEND;
+      return FUSE_NONE;
+}
+
+/*
+ * Hold back a constant input if it goes to a gate that may fold, or
+ * to a part select or concatenation that may be fused.
+ */
+static bool fold_constant_input(vvp_net_ptr_t ptr, const vvp_vector4_t&val)
+{
+      if (! fold_functors_flag)
+	    return false;
+      if (dynamic_cast<vvp_fun_fold_*>(ptr.ptr()->fun) == 0
+	  && fuse_kind(ptr.ptr()->fun) == FUSE_NONE)
+	    return false;
+
+      fold_consts.push_back(fold_const_s(ptr, val));
+      return true;
+}
+
+/*
+ * Fold a gate that has only constant inputs. A gate that is also a
+ * signal (i.e. has a filter) stays in place, and sends its output to
+ * its fan-out at time 0 through the filter. Any other gate passes
+ * its output on to its fan-out as constant inputs in its place.
+ */
+static void fold_gate_constant(fold_gate_s*gate, std::vector<fold_gate_s*>&work)
+{
+      vvp_net_t*net = gate->net;
+      vvp_fun_fold_*fun = dynamic_cast<vvp_fun_fold_*>(net->fun);
+
+	// A gate whose inputs never change never runs, so it has no
+	// output to pass on.
+      bool run_flag = false;
+      for (size_t idx = gate->first_const ; idx != FOLD_NONE
+		 ; idx = fold_consts[idx].next) {
+	    fold_const_s&cur = fold_consts[idx];
+	    if (fun->fold_input(cur.ptr.port(), cur.val))
+		  run_flag = true;
+	    cur.ptr = vvp_net_ptr_t();
+      }
+
+      vvp_vector4_t val;
+      if (run_flag)
+	    val = fun->fold_output();
+
+      gate->done = true;
+      count_functors_folded += 1;
+
+      if (net->fil) {
+	    if (run_flag)
+		  schedule_set_propagate(net, val);
+	    return;
+      }
+
+      while (! net->fanout().nil()) {
+	    vvp_net_ptr_t ptr = net->fanout();
+	    net->unlink(ptr);
+
+	    fold_gate_s*dst = fold_gate(ptr.ptr());
+	    if (run_flag && dst) {
+		  fold_consts.push_back(fold_const_s(ptr, val));
+		  fold_chain_const(dst, fold_consts.size()-1);
+	    } else if (run_flag && fuse_kind(ptr.ptr()->fun) != FUSE_NONE) {
+		  fold_consts.push_back(fold_const_s(ptr, val));
+	    } else if (run_flag) {
+		  schedule_set_vector(ptr, val);
+	    }
+
+	    if (dst) {
+		  dst->drivers -= 1;
+		  if (dst->drivers == 0 && ! dst->pinned)
+			work.push_back(dst);
+	    }
+      }
+}
+
+static void compile_fold_functors(void)
+{
+      if (! fold_functors_flag)
+	    return;
+
+      std::vector<fold_gate_s> gates;
+      std::vector<fold_source_s> sources;
+      {
+	    std::vector<vvp_net_t*> nets;
+	    vvp_net_t::get_all_nets(nets);
+
+	    for (size_t idx = 0 ; idx < nets.size() ; idx += 1) {
+		  if (dynamic_cast<vvp_fun_fold_*>(nets[idx]->fun))
+			gates.push_back(fold_gate_s(nets[idx]));
+	    }
+	    std::sort(gates.begin(), gates.end());
+	    cur_fold_gates = &gates;
+
+	      // Count the links into each gate, then collect them.
+	    for (size_t idx = 0 ; idx < nets.size() ; idx += 1) {
+		  for (vvp_net_ptr_t cur = nets[idx]->fanout() ; ! cur.nil()
+			     ; cur = cur.ptr()->port[cur.port()]) {
+			if (fold_gate_s*gate = fold_gate(cur.ptr()))
+			      gate->drivers += 1;
+		  }
+	    }
+
+	    size_t count = 0;
+	    for (size_t idx = 0 ; idx < gates.size() ; idx += 1) {
+		  gates[idx].first_source = count;
+		  count += gates[idx].drivers;
+		  gates[idx].drivers = 0;
+	    }
+
+	    sources.resize(count);
+	    for (size_t idx = 0 ; idx < nets.size() ; idx += 1) {
+		  for (vvp_net_ptr_t cur = nets[idx]->fanout() ; ! cur.nil()
+			     ; cur = cur.ptr()->port[cur.port()]) {
+			fold_gate_s*gate = fold_gate(cur.ptr());
+			if (gate == 0)
+			      continue;
+			fold_source_s&src = sources[gate->first_source + gate->drivers];
+			src.src = nets[idx];
+			src.ptr = cur;
+			gate->drivers += 1;
+		  }
+	    }
+      }
+
+      codespace_scan_nets(&fold_code_net);
+
+      for (size_t idx = 0 ; idx < fold_consts.size() ; idx += 1) {
+	    if (fold_gate_s*gate = fold_gate(fold_consts[idx].ptr.ptr()))
+		  fold_chain_const(gate, idx);
+      }
+
+	// Fold the gates that have only constant inputs. The output of
+	// a folded gate may in turn let the gates it drives fold.
+      std::vector<fold_gate_s*> work;
+      for (size_t idx = 0 ; idx < gates.size() ; idx += 1) {
+	    if (gates[idx].drivers == 0 && ! gates[idx].pinned)
+		  work.push_back(&gates[idx]);
+      }
+
+      while (! work.empty()) {
+	    fold_gate_s*gate = work.back();
+	    work.pop_back();
+	    fold_gate_constant(gate, work);
+      }
+
+	// Remove the gates that drive nothing. Gates that are also
+	// signals are visible through VPI, so they stay. The source
+	// links of a gate are not updated as gates fold, so walk them
+	// all and skip the links that folding already removed.
+      for (size_t idx = 0 ; idx < gates.size() ; idx += 1) {
+	    if (! gates[idx].done && ! gates[idx].pinned
+		&& gates[idx].net->fil == 0
+		&& gates[idx].net->fanout().nil())
+		  work.push_back(&gates[idx]);
+      }
+
+      while (! work.empty()) {
+	    fold_gate_s*gate = work.back();
+	    work.pop_back();
+
+	    gate->done = true;
+	    fold_drop_consts(gate);
+	    count_functors_pruned += 1;
+
+	    size_t gdx = gate - &gates[0];
+	    size_t end = gdx+1 < gates.size()
+		  ? gates[gdx+1].first_source : sources.size();
+	    for (size_t idx = gate->first_source ; idx < end ; idx += 1) {
+		  vvp_net_t*src = sources[idx].src;
+		  fold_gate_s*src_gate = fold_gate(src);
+		    // A folded gate has already let go of its fan-out,
+		    // unless it is also a signal.
+		  if (src_gate && src_gate->done && src->fil == 0)
+			continue;
+
+		  src->unlink(sources[idx].ptr);
+		  if (src_gate && ! src_gate->pinned && src->fil == 0
+		      && src->fanout().nil())
+			work.push_back(src_gate);
+	    }
+      }
+
+	// Collapse chains of buf gates.
+      for (size_t idx = 0 ; idx < gates.size() ; idx += 1) {
+	    fold_gate_s&gate = gates[idx];
+	    if (gate.done || dynamic_cast<vvp_fun_buf*>(gate.net->fun) == 0)
+		  continue;
+
+	    for (;;) {
+		  vvp_net_ptr_t ptr = gate.net->fanout();
+		  if (ptr.nil() || ptr.port() != 0
+		      || ! ptr.ptr()->port[0].nil())
+			break;
+
+		  fold_gate_s*next = fold_gate(ptr.ptr());
+		  if (next == 0 || next->done || next->pinned
+		      || next->net->fil || next->drivers != 1
+		      || dynamic_cast<vvp_fun_buf*>(next->net->fun) == 0)
+			break;
+
+		    // A buf ignores all but its first input.
+		  bool const_flag = false;
+		  for (size_t cdx = next->first_const ; cdx != FOLD_NONE
+			     ; cdx = fold_consts[cdx].next) {
+			if (fold_consts[cdx].ptr.port() == 0)
+			      const_flag = true;
+		  }
+		  if (const_flag)
+			break;
+
+		  gate.net->unlink(ptr);
+		  while (! next->net->fanout().nil()) {
+			vvp_net_ptr_t cur = next->net->fanout();
+			next->net->unlink(cur);
+			gate.net->link(cur);
+		  }
+
+		  next->done = true;
+		  fold_drop_consts(next);
+		  count_functors_pruned += 1;
+	    }
+      }
+
+      cur_fold_gates = 0;
+}
+
+/*
+ * Fusing trees of part selects
+ *
+ * tgt-vvp routes bits through many .part, .concat and .extend/s
+ * functors, and every hop is another recv_vec4 and another vector. A
+ * tree of these functors, in which all but the root drive only their
+ * parent and are not signals or used by the behavioral code, is
+ * replaced here with a vvp_fun_permute at the root that copies the
+ * bits of the tree inputs straight to their place in the output. The
+ * held back constant inputs of the tree become constant bits of the
+ * output. A tree may have no more than 4 distinct inputs. The
+ * VVP_NO_FOLD environment variable skips this too.
+ */
+struct fuse_node_s {
+      explicit fuse_node_s(vvp_net_t*n)
+      : net(n), kind(FUSE_NONE), pinned(false), interior(0)
+      { for (unsigned idx = 0 ; idx < 4 ; idx += 1) {
+		  src[idx] = 0;
+		  cons[idx] = FOLD_NONE;
+	    }
+      }
+
+      vvp_net_t*net;
+      fuse_kind_t kind;
+	// True if the behavioral code refers to the node.
+      bool pinned;
+	// 0 if not known yet, 1 while it is being worked out, 2 if the
+	// node may be fused into its parent, and 3 if not.
+      unsigned char interior;
+	// The net or held back constant that drives each input.
+      vvp_net_t*src[4];
+      size_t cons[4];
+
+      bool operator < (const fuse_node_s&that) const { return net < that.net; }
+};
+
+/*
+ * The source of a bit of a fused tree: bit "bit" of input "port". The
+ * FUSE_CONST port is the held back constant inputs of the tree, which
+ * become one more input, and the FUSE_FIXED port has the bit value
+ * itself as the bit.
+ */
+struct fuse_bit_s {
+      fuse_bit_s(unsigned p, unsigned b) : port(p), bit(b) { }
+      unsigned port;
+      unsigned bit;
+};
+
+static const unsigned FUSE_CONST = 4;
+static const unsigned FUSE_FIXED = 5;
+
+struct fuse_tree_s {
+      fuse_tree_s() : nleaf(0), sched_mask(0), const_sched(false) { }
+	// The distinct nets that drive the tree.
+      vvp_net_t*leaf[4];
+      unsigned nleaf;
+	// The links that the tree takes its inputs through.
+      std::vector<fold_source_s> links;
+	// The nodes other than the root, and the constants they use.
+      std::vector<fuse_node_s*> nodes;
+      std::vector<size_t> consts;
+	// The bits of the FUSE_CONST port.
+      std::vector<vvp_bit4_t> const_bits;
+	// The inputs that reach the root through a part select.
+      unsigned sched_mask;
+      bool const_sched;
+};
+
+static std::vector<fuse_node_s>*cur_fuse_nodes = 0;
+
+static fuse_node_s* fuse_node(vvp_net_t*net)
+{
+      std::vector<fuse_node_s>&nodes = *cur_fuse_nodes;
+      std::vector<fuse_node_s>::iterator cur
+	    = std::lower_bound(nodes.begin(), nodes.end(), fuse_node_s(net));
+      if (cur == nodes.end() || cur->net != net)
+	    return 0;
+      return &*cur;
+}
+
+static void fuse_code_net(vvp_net_t*net)
+{
+      if (fuse_node_s*node = fuse_node(net))
+	    node->pinned = true;
+}
+
+static bool fuse_interior(fuse_node_s*node)
+{
+      if (node->interior == 1)
+	    return false;
+      if (node->interior != 0)
+	    return node->interior == 2;
+
+      node->interior = 3;
+
+      vvp_net_ptr_t out = node->net->fanout();
+      if (node->pinned || node->net->fil || out.nil()
+	  || ! out.ptr()->port[out.port()].nil())
+	    return false;
+
+      fuse_node_s*parent = fuse_node(out.ptr());
+      if (parent == 0 || parent == node)
+	    return false;
+      if (parent->kind != FUSE_CONCAT && out.port() != 0)
+	    return false;
+
+	// A sign extension must know the width of its input, so it
+	// can only be fused with the tree below it.
+      if (node->kind == FUSE_EXTEND && node->cons[0] == FOLD_NONE) {
+	    node->interior = 1;
+	    fuse_node_s*child = node->src[0]? fuse_node(node->src[0]) : 0;
+	    bool flag = child && fuse_interior(child);
+	    node->interior = 3;
+	    if (! flag)
+		  return false;
+      }
+
+      node->interior = 2;
+      return true;
+}
+
+static void fuse_const_bits(fuse_tree_s&tree, size_t idx,
+			    std::vector<fuse_bit_s>&bits)
+{
+      tree.consts.push_back(idx);
+
+      const vvp_vector4_t&val = fold_consts[idx].val;
+      for (unsigned bdx = 0 ; bdx < val.size() ; bdx += 1) {
+	    bits.push_back(fuse_bit_s(FUSE_CONST, tree.const_bits.size()));
+	    tree.const_bits.push_back(val.value(bdx));
+      }
+}
+
+/*
+ * Get the bits of the output of the node, in terms of the inputs of
+ * the tree. Return false if the tree cannot be fused.
+ */
+static bool fuse_build(fuse_tree_s&tree, fuse_node_s*node,
+		       std::vector<fuse_bit_s>&bits, bool sched)
+{
+      if (node->kind == FUSE_PART)
+	    sched = true;
+
+      unsigned nport = node->kind == FUSE_CONCAT? 4 : 1;
+      for (unsigned port = 0 ; port < nport ; port += 1) {
+	    unsigned wid = 0;
+	    if (node->kind == FUSE_CONCAT) {
+		  wid = dynamic_cast<vvp_fun_concat*>(node->net->fun)->width(port);
+		  if (wid == 0)
+			continue;
+	    }
+
+	      // Get the bits of the input, if they are known. A net
+	      // that is not fused supplies bits [0, wid) of a new
+	      // input of the tree.
+	    std::vector<fuse_bit_s> in;
+	    bool in_flag = true;
+	    fuse_node_s*child = node->src[port]? fuse_node(node->src[port]) : 0;
+	    if (child && fuse_interior(child)) {
+		  tree.nodes.push_back(child);
+		  if (! fuse_build(tree, child, in, sched))
+			return false;
+	    } else if (node->src[port]) {
+		  unsigned leaf = 0;
+		  while (leaf < tree.nleaf && tree.leaf[leaf] != node->src[port])
+			leaf += 1;
+		  if (leaf == 4)
+			return false;
+		  if (leaf == tree.nleaf)
+			tree.leaf[tree.nleaf++] = node->src[port];
+		  if (sched)
+			tree.sched_mask |= 1U << leaf;
+
+		  fold_source_s link;
+		  link.src = node->src[port];
+		  link.ptr = vvp_net_ptr_t(node->net, port);
+		  tree.links.push_back(link);
+
+		  if (node->kind == FUSE_EXTEND)
+			return false;
+		  unsigned base = 0;
+		  if (node->kind == FUSE_PART) {
+			vvp_fun_part*fun = dynamic_cast<vvp_fun_part*>(node->net->fun);
+			base = fun->base();
+			wid = fun->width();
+		  }
+		  for (unsigned idx = 0 ; idx < wid ; idx += 1)
+			bits.push_back(fuse_bit_s(leaf, base+idx));
+		  continue;
+	    } else if (node->cons[port] != FOLD_NONE) {
+		  fuse_const_bits(tree, node->cons[port], in);
+		  if (sched)
+			tree.const_sched = true;
+	    } else {
+		    // An input that is never driven leaves the output
+		    // of a part select or extension unset, which its
+		    // parent sees as Z.
+		  in_flag = false;
+	    }
+
+	    switch (node->kind) {
+		case FUSE_PART: {
+		      vvp_fun_part*fun = dynamic_cast<vvp_fun_part*>(node->net->fun);
+		      for (unsigned idx = 0 ; idx < fun->width() ; idx += 1) {
+			    unsigned bdx = fun->base() + idx;
+			    if (! in_flag)
+				  bits.push_back(fuse_bit_s(FUSE_FIXED, BIT4_Z));
+			    else if (bdx < in.size())
+				  bits.push_back(in[bdx]);
+			    else
+				  bits.push_back(fuse_bit_s(FUSE_FIXED, BIT4_X));
+		      }
+		      break;
+		}
+		case FUSE_CONCAT:
+		  if (! in_flag) {
+			for (unsigned idx = 0 ; idx < wid ; idx += 1)
+			      bits.push_back(fuse_bit_s(FUSE_FIXED, BIT4_Z));
+		  } else if (in.size() == wid) {
+			bits.insert(bits.end(), in.begin(), in.end());
+		  } else {
+			return false;
+		  }
+		  break;
+		case FUSE_EXTEND: {
+		      if (! in_flag)
+			    return false;
+		      unsigned ewid = dynamic_cast<vvp_fun_extend_signed*>
+			    (node->net->fun)->width();
+		      fuse_bit_s pad (FUSE_FIXED, BIT4_0);
+		      if (! in.empty())
+			    pad = in.back();
+		      bits.insert(bits.end(), in.begin(), in.end());
+		      while (bits.size() < ewid)
+			    bits.push_back(pad);
+		      break;
+		}
+		default:
+		  assert(0);
+	    }
+      }
+
+      return true;
+}
+
+/*
+ * Replace the tree of nodes under the root with a vvp_fun_permute.
+ * If that cannot be done, try the subtrees.
+ */
+static void fuse_tree(fuse_node_s*root)
+{
+      fuse_tree_s tree;
+      std::vector<fuse_bit_s> bits;
+      bool ok = ! root->pinned && fuse_build(tree, root, bits, false);
+      if (! tree.const_bits.empty() && tree.nleaf == 4)
+	    ok = false;
+
+      if (! ok || tree.nodes.empty()) {
+	    for (unsigned port = 0 ; port < 4 ; port += 1) {
+		  fuse_node_s*child = root->src[port]? fuse_node(root->src[port]) : 0;
+		  if (child && fuse_interior(child))
+			fuse_tree(child);
+	    }
+	    return;
+      }
+
+	// Turn the bits into runs of copied bits. The constants come
+	// in through the input after the last net.
+      vvp_vector4_t init (bits.size(), BIT4_Z);
+      std::vector<vvp_fun_permute::run_s> map;
+      for (unsigned idx = 0 ; idx < bits.size() ; idx += 1) {
+	    fuse_bit_s cur = bits[idx];
+	    if (cur.port == FUSE_CONST)
+		  cur.port = tree.nleaf;
+	    if (cur.port == FUSE_FIXED) {
+		  init.set_bit(idx, (vvp_bit4_t)cur.bit);
+		  continue;
+	    }
+
+	    if (! map.empty()) {
+		  vvp_fun_permute::run_s&run = map.back();
+		  if (run.port == cur.port && run.dst+run.wid == idx) {
+			if (! run.repeat && run.src+run.wid == cur.bit) {
+			      run.wid += 1;
+			      continue;
+			}
+			if ((run.repeat || run.wid == 1) && run.src == cur.bit) {
+			      run.repeat = true;
+			      run.wid += 1;
+			      continue;
+			}
+		  }
+	    }
+
+	    vvp_fun_permute::run_s run;
+	    run.port = cur.port;
+	    run.dst = idx;
+	    run.src = cur.bit;
+	    run.wid = 1;
+	    run.repeat = false;
+	    map.push_back(run);
+      }
+
+      for (size_t idx = 0 ; idx < tree.links.size() ; idx += 1)
+	    tree.links[idx].src->unlink(tree.links[idx].ptr);
+      for (size_t idx = 0 ; idx < tree.nodes.size() ; idx += 1)
+	    tree.nodes[idx]->net->unlink(tree.nodes[idx]->net->fanout());
+      for (size_t idx = 0 ; idx < tree.consts.size() ; idx += 1)
+	    fold_consts[tree.consts[idx]].ptr = vvp_net_ptr_t();
+
+	// The functors of the tree are no longer used. They are in the
+	// permanent heap, which cannot give memory back, so only run
+	// their destructors to free the vectors they hold.
+      for (size_t idx = 0 ; idx < tree.nodes.size() ; idx += 1) {
+	    tree.nodes[idx]->net->fun->~vvp_net_fun_t();
+	    tree.nodes[idx]->net->fun = 0;
+      }
+      root->net->fun->~vvp_net_fun_t();
+
+      if (tree.const_sched)
+	    tree.sched_mask |= 1U << tree.nleaf;
+      vvp_fun_permute*fun = new vvp_fun_permute(init, map, tree.sched_mask);
+      root->net->fun = fun;
+      for (unsigned idx = 0 ; idx < tree.nleaf ; idx += 1)
+	    tree.leaf[idx]->link(vvp_net_ptr_t(root->net, idx));
+
+      if (! tree.const_bits.empty()) {
+	    vvp_vector4_t consts (tree.const_bits.size());
+	    for (unsigned idx = 0 ; idx < tree.const_bits.size() ; idx += 1)
+		  consts.set_bit(idx, tree.const_bits[idx]);
+	    vvp_net_ptr_t ptr (root->net, tree.nleaf);
+	    fold_consts.push_back(fold_const_s(ptr, consts));
+      }
+
+      count_functors_merged += tree.nodes.size();
+}
+
+static void compile_fuse_parts(void)
+{
+      if (! fold_functors_flag)
+	    return;
+
+      std::vector<fuse_node_s> nodes;
+      std::vector<vvp_net_t*> nets;
+      vvp_net_t::get_all_nets(nets);
+
+      for (size_t idx = 0 ; idx < nets.size() ; idx += 1) {
+	    fuse_kind_t kind = fuse_kind(nets[idx]->fun);
+	    if (kind == FUSE_NONE)
+		  continue;
+	    nodes.push_back(fuse_node_s(nets[idx]));
+	    nodes.back().kind = kind;
+      }
+      if (nodes.empty())
+	    return;
+
+      std::sort(nodes.begin(), nodes.end());
+      cur_fuse_nodes = &nodes;
+
+      for (size_t idx = 0 ; idx < nets.size() ; idx += 1) {
+	    for (vvp_net_ptr_t cur = nets[idx]->fanout() ; ! cur.nil()
+		       ; cur = cur.ptr()->port[cur.port()]) {
+		  if (fuse_node_s*node = fuse_node(cur.ptr()))
+			node->src[cur.port()] = nets[idx];
+	    }
+      }
+
+      for (size_t idx = 0 ; idx < fold_consts.size() ; idx += 1) {
+	    vvp_net_ptr_t ptr = fold_consts[idx].ptr;
+	    if (ptr.nil())
+		  continue;
+	    if (fuse_node_s*node = fuse_node(ptr.ptr()))
+		  node->cons[ptr.port()] = idx;
+      }
+
+      codespace_scan_nets(&fuse_code_net);
+
+	// The roots are the nodes that are not part of a larger tree.
+      for (size_t idx = 0 ; idx < nodes.size() ; idx += 1) {
+	    if (! fuse_interior(&nodes[idx]))
+		  fuse_tree(&nodes[idx]);
+      }
+
+      cur_fuse_nodes = 0;
+}
+
+/*
+ * The constants that were held back for folding and fusing, and
+ * were not used up by them, go to their functors at time 0. They
+ * would have been scheduled as they were parsed, ahead of the threads,
+ * so push them (in order) in front of the threads.
+ */
+static void compile_schedule_held_constants(void)
+{
+      for (size_t idx = fold_consts.size() ; idx > 0 ; idx -= 1) {
+	    const fold_const_s&cur = fold_consts[idx-1];
+	    if (! cur.ptr.nil())
+		  schedule_set_vector(cur.ptr, cur.val, true);
+      }
+
+      std::vector<fold_const_s>().swap(fold_consts);
+      fold_functors_flag = false;
+}
+
 /*
  * Keep a symbol table of addresses within code space. Labels on
  * executable opcodes are mapped to their address here.
@@ -746,7 +1736,7 @@ void compile_compiletf(struct __vpiSysTaskCall*obj)
  * the final stuff. Clean up deferred linking here.
  */
 
-void compile_cleanup(void)
+void compile_link(void)
 {
       int lnerrs = -1;
       int nerrs = 0;
@@ -781,7 +1771,10 @@ void compile_cleanup(void)
       } while (nerrs && !last);
 
       compile_errors += nerrs;
+}
 
+void compile_cleanup(void)
+{
       if (verbose_flag) {
 	    fprintf(stderr, " ... Removing symbol tables\n");
 	    fflush(stderr);
@@ -806,6 +1799,13 @@ void compile_cleanup(void)
       compile_island_cleanup();
       compile_array_cleanup();
 
+      compile_fold_functors();
+      compile_fuse_parts();
+      compile_schedule_held_constants();
+
+      compile_bind_operands();
+      compile_fuse_opcodes();
+
       if (verbose_flag) {
 	    fprintf(stderr, " ... Compiletf functions\n");
 	    fflush(stderr);
@@ -844,6 +1844,8 @@ void compile_init(void)
 
       sym_codespace = new_symbol_table();
       codespace_init();
+
+      fold_functors_flag = getenv("VVP_NO_FOLD") == 0;
 }
 
 void compile_load_vpi_module(char*name)
@@ -942,8 +1944,11 @@ void input_connect(vvp_net_t*fdx, unsigned port, char*label)
 	      // like any other signal value. But letting the
 	      // scheduler distribute the constant value has the
 	      // additional advantage that the constant is not
-	      // propagated until the network is fully linked.
-	    schedule_set_vector(ifdx, tmp);
+	      // propagated until the network is fully linked. The
+	      // constant inputs of gates are held back until the
+	      // gates have had a chance to fold.
+	    if (! fold_constant_input(ifdx, tmp))
+		  schedule_set_vector(ifdx, tmp);
 
 	    free(label);
 	    return;
@@ -953,7 +1958,8 @@ void input_connect(vvp_net_t*fdx, unsigned port, char*label)
       if (c8string_test(label)) {
 
 	    vvp_vector8_t tmp = c8string_to_vector8(label);
-	    schedule_set_vector(ifdx, tmp);
+	    if (! fold_constant_input(ifdx, reduce4(tmp)))
+		  schedule_set_vector(ifdx, tmp);
 
 	    free(label);
 	    return;
@@ -1968,6 +2974,15 @@ void compile_thread(char*start_sym, char*flag)
       if (flag && (strcmp(flag,"$push") == 0))
 	    push_flag = true;
 
+	// The threads of a restored checkpoint take the place of the
+	// threads that start the design.
+      if (checkpoint_restoring && !(flag && (strcmp(flag,"$init") == 0
+					     || strcmp(flag,"$final") == 0))) {
+	    free(start_sym);
+	    free(flag);
+	    return;
+      }
+
       vthread_t thr = vthread_new(pc, vpip_peek_current_scope());
 
       if (flag && (strcmp(flag,"$init") == 0))
@@ -46,6 +46,12 @@ extern vector<const char*> file_names;
 
 extern void compile_init(void);
 
+/*
+ * After the design is parsed, compile_link resolves the references
+ * between the objects that the parser created, then compile_cleanup
+ * releases the symbol tables and finishes up the netlist.
+ */
+extern void compile_link(void);
 extern void compile_cleanup(void);
 
 extern bool verbose_flag;
@@ -325,7 +331,7 @@ class resolv_list_s {
 
     private:
       friend void resolv_submit(class resolv_list_s*cur);
-      friend void compile_cleanup(void);
+      friend void compile_link(void);
 
       char*label_;
       class resolv_list_s*next;
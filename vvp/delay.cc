@@ -19,6 +19,7 @@
 
 #include "delay.h"
 #include "schedule.h"
+#include "checkpoint.h"
 #include "vpi_priv.h"
 #include "config.h"
 #ifdef CHECK_WITH_VALGRIND
@@ -148,6 +149,24 @@ void vvp_delay_t::set_decay(vvp_time64_t val)
 	    calculate_min_delay_();
 }
 
+void vvp_delay_t::checkpoint_save(checkpoint_out&out) const
+{
+      out.put_uint(rise_);
+      out.put_uint(fall_);
+      out.put_uint(decay_);
+      out.put_uint(min_delay_);
+      out.put_uint(ignore_decay_);
+}
+
+void vvp_delay_t::checkpoint_load(checkpoint_in&in)
+{
+      rise_ = in.get_uint();
+      fall_ = in.get_uint();
+      decay_ = in.get_uint();
+      min_delay_ = in.get_uint();
+      ignore_decay_ = in.get_uint() != 0;
+}
+
 vvp_fun_delay::vvp_fun_delay(vvp_net_t*n, unsigned width, const vvp_delay_t&d)
 : net_(n), delay_(d)
 {
@@ -506,10 +525,108 @@ void vvp_fun_delay::run_run_real_(struct vvp_fun_delay::event_*cur)
       net_->send_real(cur_real_, 0);
 }
 
+/*
+ * The pending values are saved with the time they are due. The
+ * generic events that run them are saved by the scheduler, which
+ * finds this functor through checkpoint_net().
+ */
+bool vvp_fun_delay::checkpoint_save(checkpoint_out&out)
+{
+      out.put_uint(type_);
+      out.put_uint(initial_);
+      delay_.checkpoint_save(out);
+      out.put_vec4(cur_vec4_);
+      out.put_vec8(cur_vec8_);
+      out.put_real(cur_real_);
+
+      uint64_t count = 0;
+      if (list_) {
+	    struct event_*cur = list_;
+	    do {
+		  cur = cur->next;
+		  count += 1;
+	    } while (cur != list_);
+      }
+      out.put_uint(count);
+
+      if (list_) {
+	    struct event_*cur = list_;
+	    do {
+		  cur = cur->next;
+		  out.put_uint(cur->sim_time);
+		  if (cur->run_run_ptr == &vvp_fun_delay::run_run_vec4_) {
+			out.put_uint(VEC4_DELAY);
+			out.put_vec4(cur->ptr_vec4);
+		  } else if (cur->run_run_ptr == &vvp_fun_delay::run_run_vec8_) {
+			out.put_uint(VEC8_DELAY);
+			out.put_vec8(cur->ptr_vec8);
+		  } else {
+			out.put_uint(REAL_DELAY);
+			out.put_real(cur->ptr_real);
+		  }
+	    } while (cur != list_);
+      }
+      return true;
+}
+
+void vvp_fun_delay::checkpoint_load(checkpoint_in&in, vvp_net_t*net)
+{
+      assert(net == net_);
+      type_ = (delay_type_t) in.get_uint();
+      initial_ = in.get_uint() != 0;
+      delay_.checkpoint_load(in);
+      cur_vec4_ = in.get_vec4();
+      cur_vec8_ = in.get_vec8();
+      cur_real_ = in.get_real();
+
+      while (struct event_*cur = dequeue_())
+	    delete cur;
+
+      for (uint64_t count = in.get_uint() ; count > 0 ; count -= 1) {
+	    struct event_*cur = new struct event_(in.get_uint());
+	    switch (in.get_uint()) {
+		case VEC4_DELAY:
+		  cur->run_run_ptr = &vvp_fun_delay::run_run_vec4_;
+		  cur->ptr_vec4 = in.get_vec4();
+		  break;
+		case VEC8_DELAY:
+		  cur->run_run_ptr = &vvp_fun_delay::run_run_vec8_;
+		  cur->ptr_vec8 = in.get_vec8();
+		  break;
+		case REAL_DELAY:
+		  cur->run_run_ptr = &vvp_fun_delay::run_run_real_;
+		  cur->ptr_real = in.get_real();
+		  break;
+		default:
+		  delete cur;
+		  in.corrupt("unknown net delay value");
+	    }
+	    enqueue_(cur);
+      }
+
+      switch (type_) {
+	  case VEC8_DELAY:
+	    schedule_init_propagate(net_, cur_vec8_);
+	    break;
+	  case REAL_DELAY:
+	    schedule_init_propagate(net_, cur_real_);
+	    break;
+	  default:
+	    schedule_init_propagate(net_, cur_vec4_);
+	    break;
+      }
+}
+
+vvp_net_t* vvp_fun_delay::checkpoint_net(checkpoint_out&)
+{
+      return net_;
+}
+
 vvp_fun_modpath::vvp_fun_modpath(vvp_net_t*net, unsigned width)
 : net_(net), src_list_(0), ifnone_list_(0)
 {
       cur_vec4_ = vvp_vector4_t(width, BIT4_X);
+      out_vec4_ = cur_vec4_;
       schedule_init_propagate(net_, cur_vec4_);
 }
 
@@ -672,7 +789,28 @@ void vvp_fun_modpath::recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
 
 void vvp_fun_modpath::run_run()
 {
-      net_->send_vec4(cur_vec4_, 0);
+      out_vec4_ = cur_vec4_;
+      net_->send_vec4(out_vec4_, 0);
+}
+
+bool vvp_fun_modpath::checkpoint_save(checkpoint_out&out)
+{
+      out.put_vec4(cur_vec4_);
+      out.put_vec4(out_vec4_);
+      return true;
+}
+
+void vvp_fun_modpath::checkpoint_load(checkpoint_in&in, vvp_net_t*net)
+{
+      assert(net == net_);
+      cur_vec4_ = in.get_vec4();
+      out_vec4_ = in.get_vec4();
+      schedule_init_propagate(net_, out_vec4_);
+}
+
+vvp_net_t* vvp_fun_modpath::checkpoint_net(checkpoint_out&)
+{
+      return net_;
 }
 
 vvp_fun_modpath_src::vvp_fun_modpath_src(vvp_time64_t del[12])
@@ -723,6 +861,26 @@ bool vvp_fun_modpath_src::test_vec4(const vvp_vector4_t&)
       return true;
 }
 
+/*
+ * The delays are saved because vpi_put_delays may have changed them.
+ */
+bool vvp_fun_modpath_src::checkpoint_save(checkpoint_out&out)
+{
+      for (unsigned idx = 0 ;  idx < 12 ;  idx += 1)
+	    out.put_uint(delay_[idx]);
+      out.put_uint(wake_time_);
+      out.put_uint(condition_flag_);
+      return true;
+}
+
+void vvp_fun_modpath_src::checkpoint_load(checkpoint_in&in, vvp_net_t*)
+{
+      for (unsigned idx = 0 ;  idx < 12 ;  idx += 1)
+	    delay_[idx] = in.get_uint();
+      wake_time_ = in.get_uint();
+      condition_flag_ = in.get_uint() != 0;
+}
+
 vvp_fun_modpath_edge::vvp_fun_modpath_edge(vvp_time64_t del[12],
 					   bool pos, bool neg)
 : vvp_fun_modpath_src(del)
@@ -743,6 +901,36 @@ bool vvp_fun_modpath_edge::test_vec4(const vvp_vector4_t&bit)
       return false;
 }
 
+bool vvp_fun_modpath_edge::checkpoint_save(checkpoint_out&out)
+{
+      vvp_fun_modpath_src::checkpoint_save(out);
+      out.put_uint(old_value_);
+      return true;
+}
+
+void vvp_fun_modpath_edge::checkpoint_load(checkpoint_in&in, vvp_net_t*net)
+{
+      vvp_fun_modpath_src::checkpoint_load(in, net);
+      old_value_ = (vvp_bit4_t) (in.get_uint() & 3);
+}
+
+/*
+ * A scheduled event of a net or path delay is saved as the net of
+ * the functor, and the functor gives the event back.
+ */
+vvp_gen_event_t delay_checkpoint_event(checkpoint_in&in)
+{
+      vvp_net_t*net = in.get_net();
+      if (net) {
+	    if (vvp_fun_delay*fun = dynamic_cast<vvp_fun_delay*>(net->fun))
+		  return fun->checkpoint_event();
+	    if (vvp_fun_modpath*fun = dynamic_cast<vvp_fun_modpath*>(net->fun))
+		  return fun->checkpoint_event();
+      }
+      in.corrupt("scheduled event of a net that is not a delay");
+      return 0;
+}
+
 
 /*
  * All the below routines that begin with
@@ -51,6 +51,10 @@ class vvp_delay_t {
       void set_decay(vvp_time64_t val);
       void set_ignore_decay();
 
+	// Variable delays change at run time, so checkpoints save them.
+      void checkpoint_save(checkpoint_out&out) const;
+      void checkpoint_load(checkpoint_in&in);
+
     private:
       vvp_time64_t rise_, fall_, decay_;
       vvp_time64_t min_delay_;
@@ -105,8 +109,15 @@ class vvp_fun_delay  : public vvp_net_fun_t, private vvp_gen_event_s {
       void recv_vec8_pv(vvp_net_ptr_t ptr, const vvp_vector8_t&bit,
 			unsigned base, unsigned wid, unsigned vwid);
 
+      bool checkpoint_save(checkpoint_out&out);
+      void checkpoint_load(checkpoint_in&in, vvp_net_t*net);
+	// The scheduled events of the functor are saved by its net,
+	// and this gives the event back when they are loaded.
+      vvp_gen_event_t checkpoint_event() { return this; }
+
     private:
       virtual void run_run();
+      vvp_net_t* checkpoint_net(checkpoint_out&out);
 
 
       void run_run_vec4_(struct vvp_fun_delay::event_*cur);
@@ -176,13 +187,20 @@ class vvp_fun_modpath  : public vvp_net_fun_t, private vvp_gen_event_s {
       void recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
                      vvp_context_t);
 
+      bool checkpoint_save(checkpoint_out&out);
+      void checkpoint_load(checkpoint_in&in, vvp_net_t*net);
+      vvp_gen_event_t checkpoint_event() { return this; }
+
     private:
       virtual void run_run();
+      vvp_net_t* checkpoint_net(checkpoint_out&out);
 
     private:
       vvp_net_t*net_;
 
+	// The value scheduled last, and the value sent last.
       vvp_vector4_t cur_vec4_;
+      vvp_vector4_t out_vec4_;
 
       vvp_fun_modpath_src*src_list_;
       vvp_fun_modpath_src*ifnone_list_;
@@ -209,6 +227,9 @@ class vvp_fun_modpath_src  : public vvp_net_fun_t {
       void get_delay12(vvp_time64_t out[12]) const;
       void put_delay12(const vvp_time64_t in[12]);
 
+      bool checkpoint_save(checkpoint_out&out);
+      void checkpoint_load(checkpoint_in&in, vvp_net_t*net);
+
     private:
 	// FIXME: Needs to be a 12-value array
       vvp_time64_t delay_[12];
@@ -230,6 +251,9 @@ class vvp_fun_modpath_edge  : public vvp_fun_modpath_src {
 
       bool test_vec4(const vvp_vector4_t&bit);
 
+      bool checkpoint_save(checkpoint_out&out);
+      void checkpoint_load(checkpoint_in&in, vvp_net_t*net);
+
     private:
       vvp_bit4_t old_value_;
       bool posedge_;
@@ -48,6 +48,9 @@ class vvp_dff : public vvp_net_fun_t {
 			unsigned base, unsigned wid, unsigned vwid,
                         vvp_context_t ctx);
 
+      bool checkpoint_save(checkpoint_out&out);
+      void checkpoint_load(checkpoint_in&in, vvp_net_t*net);
+
     private:
       virtual void recv_async(vvp_net_ptr_t port);
 
@@ -56,7 +59,12 @@ class vvp_dff : public vvp_net_fun_t {
       vvp_bit4_t ena_        : 8;
       vvp_bit4_t asc_        : 8;
 
+	// The last output, which a checkpoint needs to send again.
+      vvp_vector4_t q_;
+
     protected:
+      void propagate_(vvp_net_t*net, const vvp_vector4_t&val);
+
       vvp_vector4_t d_;
 };
 
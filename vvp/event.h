@@ -125,6 +125,10 @@ struct waitable_hooks_s {
       virtual ~waitable_hooks_s() {}
 
       virtual vthread_t add_waiting_thread(vthread_t thread) = 0;
+	// The list of threads waiting on a statically allocated
+	// event, for saving checkpoints. The threads waiting on
+	// automatic events are always in an automatic context.
+      virtual vthread_t waiting_threads() const { return 0; }
 
       evctl*event_ctls;
       evctl**last;
@@ -180,6 +184,7 @@ class vvp_fun_edge_sa : public vvp_fun_edge {
       virtual ~vvp_fun_edge_sa();
 
       vthread_t add_waiting_thread(vthread_t thread);
+      vthread_t waiting_threads() const { return threads_; }
 
       void recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
                      vvp_context_t context);
@@ -253,6 +258,7 @@ class vvp_fun_anyedge_sa : public vvp_fun_anyedge {
       virtual ~vvp_fun_anyedge_sa();
 
       vthread_t add_waiting_thread(vthread_t thread);
+      vthread_t waiting_threads() const { return threads_; }
 
       void recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
                      vvp_context_t context);
@@ -316,6 +322,7 @@ class vvp_fun_event_or_sa : public vvp_fun_event_or {
       ~vvp_fun_event_or_sa();
 
       vthread_t add_waiting_thread(vthread_t thread);
+      vthread_t waiting_threads() const { return threads_; }
 
       void recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
                      vvp_context_t context);
@@ -374,6 +381,7 @@ class vvp_named_event_sa : public vvp_named_event {
       ~vvp_named_event_sa();
 
       vthread_t add_waiting_thread(vthread_t thread);
+      vthread_t waiting_threads() const { return threads_; }
 
       void recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
                      vvp_context_t);
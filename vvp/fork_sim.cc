@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2026 Stephen Williams (steve@icarus.com)
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+# include  "config.h"
+# include  "vpi_priv.h"
+# include  "schedule.h"
+# include  <cstdio>
+# include  <cstdlib>
+# include  <cstring>
+# include  <cerrno>
+# include  <string>
+# include  <vector>
+#if !defined(__MINGW32__)
+# include  <unistd.h>
+# include  <fcntl.h>
+# include  <sys/wait.h>
+#endif
+
+/*
+ * The $fork_sim("file") system task runs the rest of the simulation
+ * once for each line of the file, each in a child process that the
+ * operating system forks from the current one. The children share the
+ * memory of the loaded design until they write it, so the design is
+ * loaded (and reset, if the task is called after the reset) only once.
+ *
+ * Each line of the file lists extra arguments, usually plusargs, for
+ * one variant. They are placed ahead of the arguments of this run, so
+ * they take precedence in $test$plusargs and $value$plusargs. Blank
+ * lines and lines that start with '#' are skipped.
+ *
+ * The output of child N goes to <stem>.N.log, where <stem> is the name
+ * of the file without its extension, and the files that the child
+ * opens get N inserted before their extension. The process that calls
+ * $fork_sim only runs the children, as many at a time as there are
+ * processors, and then reports their exit status and finishes its
+ * own simulation.
+ */
+
+static unsigned fork_child_index = 0;
+
+/*
+ * Insert the child index into the file name, in front of the
+ * extension if there is one.
+ */
+static std::string fork_file_name(const char*name, unsigned idx)
+{
+      std::string path = name;
+      char tag[32];
+      snprintf(tag, sizeof tag, ".%u", idx);
+
+      size_t dot = path.rfind('.');
+      size_t sep = path.find_last_of("/\\");
+      if (dot == std::string::npos || dot == 0
+	  || (sep != std::string::npos && dot <= sep+1))
+	    return path + tag;
+
+      return path.substr(0, dot) + tag + path.substr(dot);
+}
+
+extern "C" char* vpip_fork_file_name(const char*name)
+{
+      if (fork_child_index == 0)
+	    return strdup(name);
+
+      return strdup(fork_file_name(name, fork_child_index).c_str());
+}
+
+static bool read_variants(const char*path, std::vector<std::vector<std::string> >&list)
+{
+      FILE*fd = fopen(path, "r");
+      if (fd == 0) {
+	    fprintf(stderr, "$fork_sim: %s: %s\n", path, strerror(errno));
+	    return false;
+      }
+
+      char line[4096];
+      while (fgets(line, sizeof line, fd)) {
+	    std::vector<std::string> args;
+	    for (char*tok = strtok(line, " \t\r\n") ; tok
+		       ; tok = strtok(0, " \t\r\n")) {
+		  if (args.empty() && tok[0] == '#')
+			break;
+		  args.push_back(tok);
+	    }
+	    if (! args.empty())
+		  list.push_back(args);
+      }
+
+      fclose(fd);
+      return true;
+}
+
+#if defined(__MINGW32__)
+extern "C" void vpip_fork_sim(const char*)
+{
+      fprintf(stderr, "$fork_sim: not supported on this platform.\n");
+}
+#else
+
+/*
+ * This runs in the child. Give it its own output and its plusargs,
+ * and return to continue the simulation.
+ */
+static void fork_child_setup(const char*path, unsigned idx,
+			     const std::vector<std::string>&args)
+{
+      fork_child_index = idx;
+
+      std::string stem = path;
+      size_t dot = stem.rfind('.');
+      size_t sep = stem.find_last_of("/\\");
+      if (dot != std::string::npos && (sep == std::string::npos || dot > sep+1))
+	    stem.erase(dot);
+      std::string log = fork_file_name((stem + ".log").c_str(), idx);
+
+      int fd = open(log.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0666);
+      if (fd < 0) {
+	    fprintf(stderr, "$fork_sim: %s: %s\n", log.c_str(), strerror(errno));
+	    _exit(1);
+      }
+      dup2(fd, 1);
+      dup2(fd, 2);
+      close(fd);
+
+	// The -l log file belongs to the parent.
+      vpip_mcd_drop_log();
+
+	// The argument vector is never freed, like the one that main
+	// passes in.
+      s_vpi_vlog_info info;
+      vpi_get_vlog_info(&info);
+      char**argv = new char*[info.argc + args.size() + 1];
+      int argc = 0;
+      argv[argc++] = info.argv[0];
+      for (size_t adx = 0 ; adx < args.size() ; adx += 1)
+	    argv[argc++] = strdup(args[adx].c_str());
+      for (int adx = 1 ; adx < info.argc ; adx += 1)
+	    argv[argc++] = info.argv[adx];
+      argv[argc] = 0;
+      vpip_set_vlog_args(argc, argv);
+}
+
+extern "C" void vpip_fork_sim(const char*path)
+{
+      if (fork_child_index != 0) {
+	    fprintf(stderr, "$fork_sim: already running variant %u.\n",
+		    fork_child_index);
+	    return;
+      }
+      if (const char*name = vpip_mcd_user_file()) {
+	    fprintf(stderr, "$fork_sim: file \"%s\" is open; the variants "
+		    "cannot share it.\n", name);
+	    return;
+      }
+	// The callbacks of $monitor and the dumpers would run in every
+	// variant, with the output and dump files of the parent.
+      if (vpip_count_runtime_callbacks() > 0) {
+	    fprintf(stderr, "$fork_sim: VPI callbacks (e.g. $monitor or "
+		    "$dumpvars) are active; call $fork_sim before them.\n");
+	    return;
+      }
+
+      std::vector<std::vector<std::string> > variants;
+      if (! read_variants(path, variants))
+	    return;
+      if (variants.empty()) {
+	    fprintf(stderr, "$fork_sim: %s: no variants.\n", path);
+	    return;
+      }
+
+      long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+      if (jobs < 1) jobs = 1;
+
+      std::vector<pid_t> pids (variants.size(), 0);
+      std::vector<int> status (variants.size(), 0);
+      size_t next = 0, running = 0, failed = 0;
+
+      fflush(0);
+      while (next < variants.size() || running > 0) {
+	    if (next < variants.size() && running < (size_t)jobs) {
+		  pid_t pid = fork();
+		  if (pid == 0) {
+			fork_child_setup(path, next+1, variants[next]);
+			return;
+		  }
+		  if (pid < 0) {
+			fprintf(stderr, "$fork_sim: fork: %s\n", strerror(errno));
+			status[next] = -1;
+			failed += 1;
+		  } else {
+			pids[next] = pid;
+			running += 1;
+		  }
+		  next += 1;
+		  continue;
+	    }
+
+	    int rc;
+	    pid_t pid = wait(&rc);
+	    if (pid < 0) {
+		  if (errno == EINTR) continue;
+		  break;
+	    }
+	    for (size_t idx = 0 ; idx < pids.size() ; idx += 1) {
+		  if (pids[idx] != pid) continue;
+		  status[idx] = rc;
+		  if (! WIFEXITED(rc) || WEXITSTATUS(rc) != 0)
+			failed += 1;
+		  running -= 1;
+	    }
+      }
+
+      for (size_t idx = 0 ; idx < variants.size() ; idx += 1) {
+	    std::string args;
+	    for (size_t adx = 0 ; adx < variants[idx].size() ; adx += 1)
+		  args += (adx? " " : "") + variants[idx][adx];
+
+	    int rc = status[idx];
+	    if (pids[idx] == 0)
+		  printf("$fork_sim: variant %u (%s): not started\n",
+			 (unsigned)idx+1, args.c_str());
+	    else if (WIFEXITED(rc))
+		  printf("$fork_sim: variant %u (%s): exit %d\n",
+			 (unsigned)idx+1, args.c_str(), WEXITSTATUS(rc));
+	    else
+		  printf("$fork_sim: variant %u (%s): killed by signal %d\n",
+			 (unsigned)idx+1, args.c_str(), WTERMSIG(rc));
+      }
+      printf("$fork_sim: %u of %u variants passed.\n",
+	     (unsigned)(variants.size()-failed), (unsigned)variants.size());
+      fflush(stdout);
+
+	// The parent has no simulation of its own to run. Finish it as
+	// $finish would, so that the final blocks and the end of
+	// simulation callbacks run, and the log file is closed.
+      vpip_set_return_value(failed? 1 : 0);
+      schedule_finish(0);
+}
+#endif
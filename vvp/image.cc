@@ -0,0 +1,418 @@
+/*
+ * Copyright (c) 2026 Stephen Williams (steve@icarus.com)
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+# include  "parse_misc.h"
+# include  "compile.h"
+# include  "parse.h"
+# include  "version_base.h"
+# include  "version_tag.h"
+# include  <cstdio>
+# include  <cstdlib>
+# include  <cstring>
+# include  <map>
+# include  <string>
+# include  <vector>
+# include  <fcntl.h>
+# include  <sys/stat.h>
+#if defined(__MINGW32__) || defined(__CYGWIN__)
+# include  <io.h>
+#else
+# include  <sys/mman.h>
+# include  <unistd.h>
+#endif
+# include  "ivl_alloc.h"
+
+/*
+ * A token image is the stream of tokens that the lexor produced for a
+ * design file, saved in a compact binary form. Loading an image feeds
+ * the saved tokens to the parser, so the text of the design does not
+ * need to be scanned again. The image holds no pointers, so it can be
+ * read anywhere in memory.
+ *
+ * Only the scanning is skipped. The parser still runs every rule, the
+ * symbol tables are rebuilt and the resolv_list references are linked
+ * on every load, just as for a text file. The image is not a snapshot
+ * of the linked design.
+ *
+ * The file is a header followed by a record for each token:
+ *
+ *    "VVPIMAGE" <format> <vvp version> <T_VECTOR> <source path>
+ *    <token> <line delta> [<value>]
+ *    ...
+ *    0 0
+ *
+ * The numbers are unsigned variable length integers, 7 bits to a byte
+ * with the least significant bits first. Symbols are mostly used more
+ * than once, so the strings of the token values are pooled: a string
+ * is written as an even number, twice the length, followed by the
+ * bytes the first time it is used, and as an odd number, twice the
+ * index of the earlier string plus one, after that. The strings of the
+ * header are always written in full.
+ *
+ * The value of a token depends on its type: T_NUMBER has a number,
+ * T_VECTOR has a width and a string, and the T_LABEL, T_STRING,
+ * T_INSTR and T_SYMBOL tokens have a string. The record stream ends
+ * with the end of file token.
+ *
+ * The token codes are generated by the parser, so the vvp version and
+ * the code of T_VECTOR are checked to make sure that an image is only
+ * loaded by the vvp that saved it.
+ *
+ * An image is mapped into memory when it is loaded, so the pages are
+ * only read as the parser gets to them, and the token strings are
+ * copied straight out of the map. Systems without mmap read the whole
+ * file into a buffer instead.
+ */
+
+static const char image_magic[8] = { 'V','V','P','I','M','A','G','E' };
+static const unsigned image_format = 1;
+static const char image_version[] = VERSION " " VERSION_TAG;
+
+const char*image_save_path = 0;
+
+static FILE*save_fd = 0;
+static unsigned save_line = 1;
+static std::map<std::string,uint64_t> save_pool;
+
+static char*load_buf = 0;
+static size_t load_size = 0;
+static const unsigned char*load_ptr = 0;
+static const unsigned char*load_end = 0;
+static unsigned load_line = 1;
+static std::vector<std::pair<const unsigned char*,size_t> > load_pool;
+static bool load_error = false;
+static std::string load_source;
+
+static void save_number(uint64_t val)
+{
+      do {
+	    unsigned char byte = val & 0x7f;
+	    val >>= 7;
+	    if (val) byte |= 0x80;
+	    putc(byte, save_fd);
+      } while (val);
+}
+
+static void save_string(const char*text)
+{
+      size_t len = strlen(text);
+      save_number(len);
+      fwrite(text, 1, len, save_fd);
+}
+
+static void save_pooled_string(const char*text)
+{
+      std::map<std::string,uint64_t>::iterator cur = save_pool.find(text);
+      if (cur != save_pool.end()) {
+	    save_number(cur->second*2 + 1);
+	    return;
+      }
+
+      uint64_t idx = save_pool.size();
+      save_pool[text] = idx;
+      size_t len = strlen(text);
+      save_number(len*2);
+      fwrite(text, 1, len, save_fd);
+}
+
+static bool load_number(uint64_t&val)
+{
+      val = 0;
+      for (unsigned shift = 0 ; shift < 64 && load_ptr < load_end ; shift += 7) {
+	    unsigned char byte = *load_ptr++;
+	    val |= (uint64_t)(byte & 0x7f) << shift;
+	    if ((byte & 0x80) == 0)
+		  return true;
+      }
+      return false;
+}
+
+/*
+ * The parser releases T_STRING text with delete[] and all the other
+ * text with free(), so the copy is allocated to match.
+ */
+static char* copy_string(const unsigned char*ptr, size_t len, bool new_flag)
+{
+      char*text = new_flag? new char[len+1] : (char*)malloc(len+1);
+      memcpy(text, ptr, len);
+      text[len] = 0;
+      return text;
+}
+
+static char* load_string(bool new_flag)
+{
+      uint64_t len;
+      if (! load_number(len) || len > (uint64_t)(load_end - load_ptr))
+	    return 0;
+
+      char*text = copy_string(load_ptr, len, new_flag);
+      load_ptr += len;
+      return text;
+}
+
+static char* load_pooled_string(bool new_flag)
+{
+      uint64_t code;
+      if (! load_number(code))
+	    return 0;
+
+      if (code & 1) {
+	    if ((code >> 1) >= load_pool.size())
+		  return 0;
+	    const std::pair<const unsigned char*,size_t>&cur = load_pool[code >> 1];
+	    return copy_string(cur.first, cur.second, new_flag);
+      }
+
+      uint64_t len = code >> 1;
+      if (len > (uint64_t)(load_end - load_ptr))
+	    return 0;
+
+      load_pool.push_back(std::make_pair(load_ptr, (size_t)len));
+      char*text = copy_string(load_ptr, len, new_flag);
+      load_ptr += len;
+      return text;
+}
+
+bool image_save_open(const char*path, const char*source)
+{
+      save_fd = fopen(path, "wb");
+      if (save_fd == 0) {
+	    fprintf(stderr, "%s: Unable to open image file for writing.\n", path);
+	    return false;
+      }
+
+      fwrite(image_magic, 1, sizeof image_magic, save_fd);
+      save_number(image_format);
+      save_string(image_version);
+      save_number(T_VECTOR);
+      save_string(source);
+      save_line = 1;
+      return true;
+}
+
+/*
+ * Map (or read) the image file into load_buf. The caller has already
+ * checked the magic, so any failure here is an error.
+ */
+static bool map_image(int fd, size_t size)
+{
+#if defined(__MINGW32__) || defined(__CYGWIN__)
+      load_buf = (char*)malloc(size);
+      lseek(fd, 0, SEEK_SET);
+      size_t cnt = 0;
+      while (cnt < size) {
+	    int rc = read(fd, load_buf+cnt, size-cnt);
+	    if (rc <= 0) {
+		  free(load_buf);
+		  load_buf = 0;
+		  return false;
+	    }
+	    cnt += rc;
+      }
+#else
+      void*map = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map == MAP_FAILED)
+	    return false;
+      load_buf = (char*)map;
+#endif
+      load_size = size;
+      return true;
+}
+
+static void unmap_image(void)
+{
+#if defined(__MINGW32__) || defined(__CYGWIN__)
+      free(load_buf);
+#else
+      munmap(load_buf, load_size);
+#endif
+      load_buf = 0;
+      load_size = 0;
+}
+
+int image_load_open(const char*path)
+{
+#if defined(__MINGW32__) || defined(__CYGWIN__)
+      int fd = open(path, O_RDONLY|O_BINARY);
+#else
+      int fd = open(path, O_RDONLY);
+#endif
+      if (fd < 0)
+	    return 0;
+
+      char magic[sizeof image_magic];
+      struct stat sb;
+      if (read(fd, magic, sizeof magic) != (int)sizeof magic
+	  || memcmp(magic, image_magic, sizeof magic) != 0
+	  || fstat(fd, &sb) != 0) {
+	    close(fd);
+	    return 0;
+      }
+
+      if (! map_image(fd, sb.st_size)) {
+	    fprintf(stderr, "%s: Unable to read image file.\n", path);
+	    close(fd);
+	    return -1;
+      }
+      close(fd);
+
+      load_ptr = (const unsigned char*)load_buf + sizeof image_magic;
+      load_end = (const unsigned char*)load_buf + load_size;
+
+      uint64_t format, token_check;
+      char*version = 0;
+      char*source = 0;
+      bool ok = load_number(format) && format == image_format
+	    && (version = load_string(false)) != 0
+	    && strcmp(version, image_version) == 0
+	    && load_number(token_check) && token_check == T_VECTOR
+	    && (source = load_string(false)) != 0;
+
+      if (! ok) {
+	    fprintf(stderr, "%s: Image file was not saved by this version "
+		    "of vvp (%s).\n", path, image_version);
+	    free(version);
+	    free(source);
+	    unmap_image();
+	    return -1;
+      }
+
+	/* Report errors against the design file that the image was
+	   made from. */
+      load_source = source;
+      yypath = load_source.c_str();
+      free(version);
+      free(source);
+
+      load_line = 1;
+      load_error = false;
+      return 1;
+}
+
+/*
+ * Replay the next token from the loaded image.
+ */
+static int image_load_lex(void)
+{
+      uint64_t token, delta;
+      if (! load_number(token) || ! load_number(delta))
+	    goto corrupt;
+
+      load_line += delta;
+      yyline = load_line;
+
+      switch (token) {
+	  case T_NUMBER:
+	    if (! load_number(yylval.numb))
+		  goto corrupt;
+	    break;
+	  case T_VECTOR: {
+		uint64_t wid;
+		if (! load_number(wid))
+		      goto corrupt;
+		yylval.vect.idx = wid;
+		yylval.vect.text = load_pooled_string(false);
+		if (yylval.vect.text == 0)
+		      goto corrupt;
+		break;
+	  }
+	  case T_STRING:
+	  case T_LABEL:
+	  case T_INSTR:
+	  case T_SYMBOL:
+	    yylval.text = load_pooled_string(token == T_STRING);
+	    if (yylval.text == 0)
+		  goto corrupt;
+	    break;
+	  default:
+	    break;
+      }
+
+      return token;
+
+ corrupt:
+      fprintf(stderr, "%s: Image file is truncated or corrupt.\n", yypath);
+      load_error = true;
+      load_ptr = load_end;
+      return 0;
+}
+
+int image_lex(void)
+{
+      if (load_buf)
+	    return image_load_lex();
+
+      int token = yylex();
+      if (save_fd == 0)
+	    return token;
+
+      save_number(token);
+      save_number(yyline - save_line);
+      save_line = yyline;
+
+      switch (token) {
+	  case T_NUMBER:
+	    save_number(yylval.numb);
+	    break;
+	  case T_VECTOR:
+	    save_number(yylval.vect.idx);
+	    save_pooled_string(yylval.vect.text);
+	    break;
+	  case T_STRING:
+	  case T_LABEL:
+	  case T_INSTR:
+	  case T_SYMBOL:
+	    save_pooled_string(yylval.text);
+	    break;
+	  default:
+	    break;
+      }
+
+      return token;
+}
+
+bool image_close(bool parse_ok)
+{
+      bool ok = true;
+
+      if (save_fd) {
+	    if (ferror(save_fd) || ! parse_ok) {
+		  fprintf(stderr, "%s: Image file not saved.\n",
+			  image_save_path);
+		  fclose(save_fd);
+		  remove(image_save_path);
+		  ok = parse_ok;
+	    } else {
+		  fclose(save_fd);
+	    }
+	    save_fd = 0;
+	    save_pool.clear();
+      }
+
+      if (load_buf) {
+	    if (load_error)
+		  ok = false;
+	    unmap_image();
+	    load_ptr = 0;
+	    load_end = 0;
+	    load_pool.clear();
+      }
+
+      return ok;
+}
@@ -31,6 +31,11 @@ typedef void* ivl_dll_t;
 typedef shl_t ivl_dll_t;
 #endif
 
+/*
+ * The ivl_dlmodule function returns the file name of the module that
+ * holds the address, or nil if that is not known.
+ */
+
 #if defined(__MINGW32__)
 inline ivl_dll_t ivl_dlopen(const char *name, bool)
 {
@@ -49,6 +54,20 @@ inline void *ivl_dlsym(ivl_dll_t dll, const char *nm)
 inline void ivl_dlclose(ivl_dll_t dll)
 { (void)FreeLibrary((HINSTANCE)dll);}
 
+inline const char *ivl_dlmodule(const void*addr)
+{
+      static char name[4096];
+      HMODULE mod;
+      if (! GetModuleHandleEx(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS
+			      |GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+			      (LPCTSTR)addr, &mod))
+	    return 0;
+      unsigned long length = GetModuleFileName(mod, name, sizeof(name));
+      if ((length == 0) || (length >= sizeof(name)))
+	    return 0;
+      return name;
+}
+
 inline const char *dlerror(void)
 {
   static char msg[256];
@@ -81,6 +100,14 @@ inline void* ivl_dlsym(ivl_dll_t dll, const char*nm)
 inline void ivl_dlclose(ivl_dll_t dll)
 { dlclose(dll); }
 
+inline const char* ivl_dlmodule(const void*addr)
+{
+      Dl_info info;
+      if (dladdr(const_cast<void*>(addr), &info) == 0)
+	    return 0;
+      return info.dli_fname;
+}
+
 #elif defined(HAVE_DL_H)
 inline ivl_dll_t ivl_dlopen(const char*name)
 { return shl_load(name, BIND_IMMEDIATE, 0); }
@@ -97,6 +124,9 @@ inline void ivl_dlclose(ivl_dll_t dll)
 
 inline const char*dlerror(void)
 { return strerror( errno ); }
+
+inline const char*ivl_dlmodule(const void*)
+{ return 0; }
 #endif
 
 #endif /* IVL_ivl_dlfcn_H */
@@ -20,6 +20,7 @@
 # include  "compile.h"
 # include  "schedule.h"
 # include  "latch.h"
+# include  "checkpoint.h"
 # include  <climits>
 # include  <cstdio>
 # include  <cassert>
@@ -31,7 +32,7 @@
    value received on port 3 will propagate an initial value of 'bx. */
 
 vvp_latch::vvp_latch(unsigned width)
-: en_(BIT4_X), d_(width, BIT4_X)
+: en_(BIT4_X), d_(width, BIT4_X), q_(width, BIT4_X)
 {
 }
 
@@ -48,16 +49,20 @@ void vvp_latch::recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
 
 	  case 0: // D
 	    d_ = bit;
-	    if (en_ == BIT4_1)
-		  schedule_propagate_vector(port.ptr(), 0, d_);
+	    if (en_ == BIT4_1) {
+		  q_ = d_;
+		  schedule_propagate_vector(port.ptr(), 0, q_);
+	    }
 	    break;
 
 	  case 1: // EN
 	    assert(bit.size() == 1);
 	    tmp = en_;
 	    en_ = bit.value(0);
-	    if (en_ == BIT4_1 && tmp != BIT4_1)
-		  schedule_propagate_vector(port.ptr(), 0, d_);
+	    if (en_ == BIT4_1 && tmp != BIT4_1) {
+		  q_ = d_;
+		  schedule_propagate_vector(port.ptr(), 0, q_);
+	    }
 	    break;
 
 	  case 2:
@@ -65,11 +70,30 @@ void vvp_latch::recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
 	    break;
 
 	  case 3:
-	    port.ptr()->send_vec4(vvp_vector4_t(d_.size(), BIT4_X), 0);
+	    q_ = vvp_vector4_t(d_.size(), BIT4_X);
+	    port.ptr()->send_vec4(q_, 0);
 	    break;
       }
 }
 
+bool vvp_latch::checkpoint_save(checkpoint_out&out)
+{
+      out.put_uint(en_);
+      out.put_vec4(d_);
+      out.put_vec4(q_);
+      return true;
+}
+
+void vvp_latch::checkpoint_load(checkpoint_in&in, vvp_net_t*net)
+{
+      en_ = (vvp_bit4_t) (in.get_uint() & 3);
+      d_ = in.get_vec4();
+      q_ = in.get_vec4();
+      if (q_.size() != d_.size())
+	    in.corrupt("latch width mismatch");
+      schedule_init_propagate(net, q_);
+}
+
 void vvp_latch::recv_vec4_pv(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
 			     unsigned base, unsigned wid, unsigned vwid,
                              vvp_context_t ctx)
@@ -41,9 +41,14 @@ class vvp_latch : public vvp_net_fun_t {
 			unsigned base, unsigned wid, unsigned vwid,
                         vvp_context_t ctx);
 
+      bool checkpoint_save(checkpoint_out&out);
+      void checkpoint_load(checkpoint_in&in, vvp_net_t*net);
+
     private:
       vvp_bit4_t en_;
       vvp_vector4_t d_;
+	// The last output, which a checkpoint needs to send again.
+      vvp_vector4_t q_;
 };
 
 #endif /* IVL_latch_H */
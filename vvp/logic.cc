@@ -74,6 +74,23 @@ void vvp_fun_boolean_::recv_vec4_pv(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
       }
 }
 
+bool vvp_fun_boolean_::fold_input(unsigned port, const vvp_vector4_t&bit)
+{
+      if (input_[port] .eeq( bit ))
+	    return false;
+
+      input_[port] = bit;
+      return true;
+}
+
+void vvp_fun_boolean_::run_run()
+{
+      vvp_net_t*ptr = net_;
+      net_ = 0;
+
+      ptr->send_vec4(fold_output(), 0);
+}
+
 vvp_fun_and::vvp_fun_and(unsigned wid, bool invert)
 : vvp_fun_boolean_(wid), invert_(invert)
 {
@@ -84,11 +101,8 @@ vvp_fun_and::~vvp_fun_and()
 {
 }
 
-void vvp_fun_and::run_run()
+vvp_vector4_t vvp_fun_and::fold_output() const
 {
-      vvp_net_t*ptr = net_;
-      net_ = 0;
-
       vvp_vector4_t result (input_[0]);
 
       for (unsigned idx = 0 ;  idx < result.size() ;  idx += 1) {
@@ -107,7 +121,7 @@ void vvp_fun_and::run_run()
 	    result.set_bit(idx, bitbit);
       }
 
-      ptr->send_vec4(result, 0);
+      return result;
 }
 
 vvp_fun_buf::vvp_fun_buf(unsigned wid)
@@ -163,14 +177,31 @@ void vvp_fun_buf::recv_vec4_pv(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
       }
 }
 
+bool vvp_fun_buf::fold_input(unsigned port, const vvp_vector4_t&bit)
+{
+      if (port != 0)
+	    return false;
+
+      if (input_ .eeq( bit ))
+	    return false;
+
+      input_ = bit;
+      return true;
+}
+
+vvp_vector4_t vvp_fun_buf::fold_output() const
+{
+      vvp_vector4_t tmp (input_);
+      tmp.change_z2x();
+      return tmp;
+}
+
 void vvp_fun_buf::run_run()
 {
       vvp_net_t*ptr = net_;
       net_ = 0;
 
-      vvp_vector4_t tmp (input_);
-      tmp.change_z2x();
-      ptr->send_vec4(tmp, 0);
+      ptr->send_vec4(fold_output(), 0);
 }
 
 vvp_fun_bufz::vvp_fun_bufz()
@@ -489,13 +520,29 @@ void vvp_fun_not::recv_vec4_pv(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
       }
 }
 
+bool vvp_fun_not::fold_input(unsigned port, const vvp_vector4_t&bit)
+{
+      if (port != 0)
+	    return false;
+
+      if (input_ .eeq( bit ))
+	    return false;
+
+      input_ = bit;
+      return true;
+}
+
+vvp_vector4_t vvp_fun_not::fold_output() const
+{
+      return vvp_vector4_t(input_, true /* invert */);
+}
+
 void vvp_fun_not::run_run()
 {
       vvp_net_t*ptr = net_;
       net_ = 0;
 
-      vvp_vector4_t result (input_, true /* invert */);
-      ptr->send_vec4(result, 0);
+      ptr->send_vec4(fold_output(), 0);
 }
 
 vvp_fun_or::vvp_fun_or(unsigned wid, bool invert)
@@ -508,11 +555,8 @@ vvp_fun_or::~vvp_fun_or()
 {
 }
 
-void vvp_fun_or::run_run()
+vvp_vector4_t vvp_fun_or::fold_output() const
 {
-      vvp_net_t*ptr = net_;
-      net_ = 0;
-
       vvp_vector4_t result (input_[0]);
 
       for (unsigned idx = 0 ;  idx < result.size() ;  idx += 1) {
@@ -531,7 +575,7 @@ void vvp_fun_or::run_run()
 	    result.set_bit(idx, bitbit);
       }
 
-      ptr->send_vec4(result, 0);
+      return result;
 }
 
 vvp_fun_xor::vvp_fun_xor(unsigned wid, bool invert)
@@ -544,11 +588,8 @@ vvp_fun_xor::~vvp_fun_xor()
 {
 }
 
-void vvp_fun_xor::run_run()
+vvp_vector4_t vvp_fun_xor::fold_output() const
 {
-      vvp_net_t*ptr = net_;
-      net_ = 0;
-
       vvp_vector4_t result (input_[0]);
 
       for (unsigned idx = 0 ;  idx < result.size() ;  idx += 1) {
@@ -567,7 +608,7 @@ void vvp_fun_xor::run_run()
 	    result.set_bit(idx, bitbit);
       }
 
-      ptr->send_vec4(result, 0);
+      return result;
 }
 
 /*
@@ -23,10 +23,28 @@
 # include  "schedule.h"
 # include  <cstddef>
 
+/*
+ * Logic functors that are a pure function of their vector inputs can
+ * be evaluated when the design is loaded if all the inputs are
+ * constant. The fold_input method sets an input without scheduling
+ * the functor, and returns true if the input changed, meaning the
+ * functor would have run. The fold_output method returns the output
+ * for the current inputs.
+ */
+class vvp_fun_fold_ {
+
+    public:
+      virtual ~vvp_fun_fold_() { }
+
+      virtual bool fold_input(unsigned port, const vvp_vector4_t&bit) =0;
+      virtual vvp_vector4_t fold_output() const =0;
+};
+
 /*
  * vvp_fun_boolean_ is just a common hook for holding operands.
  */
-class vvp_fun_boolean_ : public vvp_net_fun_t, protected vvp_gen_event_s {
+class vvp_fun_boolean_ : public vvp_net_fun_t, public vvp_fun_fold_,
+			 protected vvp_gen_event_s {
 
     public:
       explicit vvp_fun_boolean_(unsigned wid);
@@ -38,6 +56,11 @@ class vvp_fun_boolean_ : public vvp_net_fun_t, protected vvp_gen_event_s {
 			unsigned base, unsigned wid, unsigned vwid,
                         vvp_context_t);
 
+      bool fold_input(unsigned port, const vvp_vector4_t&bit);
+
+    protected:
+      void run_run();
+
     protected:
       vvp_vector4_t input_[4];
       vvp_net_t*net_;
@@ -49,8 +72,9 @@ class vvp_fun_and  : public vvp_fun_boolean_ {
       explicit vvp_fun_and(unsigned wid, bool invert);
       ~vvp_fun_and();
 
+      vvp_vector4_t fold_output() const;
+
     private:
-      void run_run();
       bool invert_;
 };
 
@@ -60,7 +84,8 @@ class vvp_fun_and  : public vvp_fun_boolean_ {
  * The retransmitted vector has all Z values changed to X, just like
  * the buf(Q,D) gate in Verilog.
  */
-class vvp_fun_buf: public vvp_net_fun_t, private vvp_gen_event_s {
+class vvp_fun_buf: public vvp_net_fun_t, public vvp_fun_fold_,
+		    private vvp_gen_event_s {
 
     public:
       explicit vvp_fun_buf(unsigned wid);
@@ -72,6 +97,9 @@ class vvp_fun_buf: public vvp_net_fun_t, private vvp_gen_event_s {
 			unsigned base, unsigned wid, unsigned vwid,
                         vvp_context_t);
 
+      bool fold_input(unsigned port, const vvp_vector4_t&bit);
+      vvp_vector4_t fold_output() const;
+
     private:
       void run_run();
 
@@ -170,7 +198,8 @@ class vvp_fun_muxr : public vvp_net_fun_t, private vvp_gen_event_s {
       sel_type select_;
 };
 
-class vvp_fun_not: public vvp_net_fun_t, private vvp_gen_event_s {
+class vvp_fun_not: public vvp_net_fun_t, public vvp_fun_fold_,
+		    private vvp_gen_event_s {
 
     public:
       explicit vvp_fun_not(unsigned wid);
@@ -182,6 +211,9 @@ class vvp_fun_not: public vvp_net_fun_t, private vvp_gen_event_s {
 			unsigned base, unsigned wid, unsigned vwid,
                         vvp_context_t);
 
+      bool fold_input(unsigned port, const vvp_vector4_t&bit);
+      vvp_vector4_t fold_output() const;
+
     private:
       void run_run();
 
@@ -196,8 +228,9 @@ class vvp_fun_or  : public vvp_fun_boolean_ {
       explicit vvp_fun_or(unsigned wid, bool invert);
       ~vvp_fun_or();
 
+      vvp_vector4_t fold_output() const;
+
     private:
-      void run_run();
       bool invert_;
 };
 
@@ -207,8 +240,9 @@ class vvp_fun_xor  : public vvp_fun_boolean_ {
       explicit vvp_fun_xor(unsigned wid, bool invert);
       ~vvp_fun_xor();
 
+      vvp_vector4_t fold_output() const;
+
     private:
-      void run_run();
       bool invert_;
 };
 
@@ -27,6 +27,7 @@
 # include  "statistics.h"
 # include  "vvp_cleanup.h"
 # include  "vvp_object.h"
+# include  "checkpoint.h"
 # include  <cstdio>
 # include  <cstdlib>
 # include  <cstring>
@@ -96,17 +97,22 @@ static void my_getrusage(struct rusage *a)
 #     endif
 }
 
-static void print_rusage(struct rusage *a, struct rusage *b)
+static double rusage_delta(struct rusage *a, struct rusage *b)
 {
-      double delta = a->ru_utime.tv_sec
-	    +        a->ru_utime.tv_usec/1E6
-	    +        a->ru_stime.tv_sec
-	    +        a->ru_stime.tv_usec/1E6
-	    -        b->ru_utime.tv_sec
-	    -        b->ru_utime.tv_usec/1E6
-	    -        b->ru_stime.tv_sec
-	    -        b->ru_stime.tv_usec/1E6
+      return a->ru_utime.tv_sec
+	    +  a->ru_utime.tv_usec/1E6
+	    +  a->ru_stime.tv_sec
+	    +  a->ru_stime.tv_usec/1E6
+	    -  b->ru_utime.tv_sec
+	    -  b->ru_utime.tv_usec/1E6
+	    -  b->ru_stime.tv_sec
+	    -  b->ru_stime.tv_usec/1E6
 	    ;
+}
+
+static void print_rusage(struct rusage *a, struct rusage *b)
+{
+      double delta = rusage_delta(a, b);
 
       vpi_mcd_printf(1,
 	      " ... %G seconds,"
@@ -122,6 +128,7 @@ static void print_rusage(struct rusage *a, struct rusage *b)
 // Provide dummies
 struct rusage { int x; };
 inline static void my_getrusage(struct rusage *) { }
+inline static double rusage_delta(struct rusage *, struct rusage *) { return 0.0; }
 inline static void print_rusage(struct rusage *, struct rusage *){};
 
 #endif // ! defined(HAVE_SYS_RESOURCE_H)
@@ -226,6 +233,7 @@ static void final_cleanup()
       signal_pool_delete();
       vvp_net_pool_delete();
       ufunc_pool_delete();
+      vthread_pool_delete();
 #endif
 	/*
 	 * Unload the VPI modules. This is essential for MinGW, to ensure
@@ -256,7 +264,9 @@ int main(int argc, char*argv[])
       unsigned flag_errors = 0;
       const char*design_path = 0;
       struct rusage cycles[3];
+      struct rusage load_cycles[3];
       const char *logfile_name = 0x0;
+      const char *restore_path = 0;
       FILE *logfile = 0x0;
       extern void vpi_set_vlog_info(int, char**);
       extern bool stop_is_finish;
@@ -315,11 +325,16 @@ int main(int argc, char*argv[])
         /* For non-interactive runs we do not want to run the interactive
          * debugger, so make $stop just execute a $finish. */
       stop_is_finish = false;
-      while ((opt = getopt(argc, argv, "+hil:M:m:nNsvV")) != EOF) switch (opt) {
+      checkpoint_set_argv(argc, argv);
+      while ((opt = getopt(argc, argv, "+c:hil:M:m:nNr:svV")) != EOF) switch (opt) {
+	  case 'c':
+	    image_save_path = optarg;
+	    break;
          case 'h':
            fprintf(stderr,
                    "Usage: vvp [options] input-file [+plusargs...]\n"
                    "Options:\n"
+                   " -c file        Save a token image of the input file.\n"
                    " -h             Print this help message.\n"
                    " -i             Interactive mode (unbuffered stdio).\n"
                    " -l file        Logfile, '-' for <stderr>\n"
@@ -328,6 +343,7 @@ int main(int argc, char*argv[])
                    " -m module      Load vpi module.\n"
 		   " -n             Non-interactive ($stop = $finish).\n"
                    " -N             Same as -n, but exit code is 1 instead of 0\n"
+		   " -r file        Restore a checkpoint saved by $save.\n"
 		   " -s             $stop right away.\n"
                    " -v             Verbose progress messages.\n"
                    " -V             Print the version information.\n" );
@@ -356,6 +372,10 @@ int main(int argc, char*argv[])
             stop_is_finish = true;
             stop_is_finish_exit_code = 1;
             break;
+	  case 'r':
+	    restore_path = optarg;
+	    checkpoint_restoring = true;
+	    break;
 	  case 's':
 	    schedule_stop(0);
 	    break;
@@ -412,11 +432,17 @@ int main(int argc, char*argv[])
 	   anything. It is done early because it is plausible that the
 	   compile might affect it, and it is cheap to do. */
 
+	/* A process that $restart started appends to the log file, which
+	   has the output from before the restart. */
+      const char*restarted = getenv("VVP_RESTARTED");
+      bool append_log = restarted && *restarted;
+      putenv(const_cast<char*>("VVP_RESTARTED="));
+
       if (logfile_name) {
 	    if (!strcmp(logfile_name, "-"))
 		  logfile = stderr;
 	    else {
-		  logfile = fopen(logfile_name, "w");
+		  logfile = fopen(logfile_name, append_log? "a" : "w");
 		  if (!logfile) {
 		        perror(logfile_name);
 		        exit(1);
@@ -443,6 +469,7 @@ int main(int argc, char*argv[])
 	    vpip_load_module(module_tab[idx]);
 
       int ret_cd = compile_design(design_path);
+      if (verbose_flag) my_getrusage(load_cycles+0);
       destroy_lexor();
       print_vpi_call_errors();
       if (ret_cd) return ret_cd;
@@ -457,7 +484,10 @@ int main(int argc, char*argv[])
 	    vpi_mcd_printf(1, "Compile cleanup...\n");
       }
 
+      compile_link();
+      if (verbose_flag) my_getrusage(load_cycles+1);
       compile_cleanup();
+      if (verbose_flag) my_getrusage(load_cycles+2);
 
       if (compile_errors > 0) {
 	    vpi_mcd_printf(1, "%s: Program not runnable, %u errors.\n",
@@ -466,29 +496,57 @@ int main(int argc, char*argv[])
 	    return compile_errors;
       }
 
+      checkpoint_design_done();
+      if (restore_path && ! checkpoint_load(restore_path)) {
+	    final_cleanup();
+	    return 1;
+      }
+
       if (verbose_flag) {
-	    vpi_mcd_printf(1, " ... %8lu functors (net_fun pool=%zu bytes)\n",
-			   count_functors, vvp_net_fun_t::heap_total());
+	    vpi_mcd_printf(1, " ... %8lu functors\n", count_functors);
 	    vpi_mcd_printf(1, "           %8lu logic\n",  count_functors_logic);
+	    vpi_mcd_printf(1, "           %8lu folded\n", count_functors_folded);
+	    vpi_mcd_printf(1, "           %8lu pruned\n", count_functors_pruned);
+	    vpi_mcd_printf(1, "           %8lu merged\n", count_functors_merged);
 	    vpi_mcd_printf(1, "           %8lu bufif\n",  count_functors_bufif);
 	    vpi_mcd_printf(1, "           %8lu resolv\n",count_functors_resolv);
 	    vpi_mcd_printf(1, "           %8lu signals\n", count_functors_sig);
-	    vpi_mcd_printf(1, " ... %8lu filters (net_fil pool=%zu bytes)\n",
-			   count_filters, vvp_net_fil_t::heap_total());
+	    vpi_mcd_printf(1, " ... %8lu filters\n", count_filters);
 	    vpi_mcd_printf(1, " ... %8lu opcodes (%zu bytes)\n",
 	                   count_opcodes, size_opcodes);
+	    vpi_mcd_printf(1, "           %8lu fused\n", count_opcodes_fused);
+	    vpi_mcd_printf(1, "           %8lu bound\n", count_opcodes_bound);
+	    vpi_mcd_printf(1, "           %8lu dynamic\n", count_opcodes_dynamic);
 	    vpi_mcd_printf(1, " ... %8lu nets\n",     count_vpi_nets);
 	    vpi_mcd_printf(1, " ... %8lu vvp_nets (%zu bytes)\n",
 			   count_vvp_nets, size_vvp_nets);
+	    vvp_net_t::layout_s fanout_layout, fun_layout;
+	    vvp_net_t::layout_stats(fanout_layout, fun_layout);
+	    vpi_mcd_printf(1, " ... net heap %zu bytes used of %zu\n",
+			   vvp_net_heap.heap_used(), vvp_net_heap.heap_total());
+	    vpi_mcd_printf(1, "           %8lu fanout links, median distance"
+			   " %zu bytes, %lu within a page\n",
+			   fanout_layout.count, fanout_layout.median,
+			   fanout_layout.near);
+	    vpi_mcd_printf(1, "           %8lu functors, median distance"
+			   " %zu bytes, %lu within a page\n",
+			   fun_layout.count, fun_layout.median,
+			   fun_layout.near);
 	    vpi_mcd_printf(1, " ... %8lu arrays (%lu words)\n",
 			   count_net_arrays, count_net_array_words);
 	    vpi_mcd_printf(1, " ... %8lu memories\n",
 			   count_var_arrays+count_real_arrays);
-	    vpi_mcd_printf(1, "           %8lu logic (%lu words)\n",
-			   count_var_arrays, count_var_array_words);
+	    vpi_mcd_printf(1, "           %8lu logic (%lu words, %lu sparse,"
+			   " %lu packed)\n",
+			   count_var_arrays, count_var_array_words,
+			   count_var_arrays_sparse, count_var_arrays_packed);
 	    vpi_mcd_printf(1, "           %8lu real (%lu words)\n",
 			   count_real_arrays, count_real_array_words);
 	    vpi_mcd_printf(1, " ... %8lu scopes\n",   count_vpi_scopes);
+	    vpi_mcd_printf(1, " ... %G seconds parse, %G link, %G cleanup\n",
+			   rusage_delta(load_cycles+0, cycles+0),
+			   rusage_delta(load_cycles+1, load_cycles+0),
+			   rusage_delta(load_cycles+2, load_cycles+1));
       }
 
       if (verbose_flag) {
@@ -507,22 +565,39 @@ int main(int argc, char*argv[])
 	    vpi_mcd_printf(1, "Event counts:\n");
 	    vpi_mcd_printf(1, "    %8lu time steps (pool=%lu)\n",
 			   count_time_events, count_time_pool());
-	    vpi_mcd_printf(1, "    %8lu thread schedule events\n",
-		    count_thread_events);
+	    vpi_mcd_printf(1, "             ...wheel hits=%lu, overflows=%lu,"
+			   " promotions=%lu\n", count_wheel_hits,
+			   count_wheel_overflows, count_wheel_promotions);
+	    vpi_mcd_printf(1, "    %8lu thread schedule events (peak=%lu)\n",
+			   count_thread_events, count_thread_peak());
+	    vpi_mcd_printf(1, "    %8lu opcodes run (fused=%lu, unfused=%lu)\n",
+			   count_opcodes_run, count_opcodes_fused_run,
+			   count_opcodes_run - count_opcodes_fused_run);
+	    vpi_mcd_printf(1, "    %8lu threads created\n", count_threads);
+	    vpi_mcd_printf(1, "             ...peak live=%lu, reused=%lu\n",
+			   count_threads_peak, count_threads_reused);
 	    vpi_mcd_printf(1, "    %8lu assign events\n",
 		    count_assign_events);
-	    vpi_mcd_printf(1, "             ...assign(vec4) pool=%lu\n",
-			   count_assign4_pool());
-	    vpi_mcd_printf(1, "             ...assign(vec8) pool=%lu\n",
-			   count_assign8_pool());
-	    vpi_mcd_printf(1, "             ...assign(real) pool=%lu\n",
-			   count_assign_real_pool());
-	    vpi_mcd_printf(1, "             ...assign(word) pool=%lu\n",
-			   count_assign_aword_pool());
-	    vpi_mcd_printf(1, "             ...assign(word/r) pool=%lu\n",
-			   count_assign_arword_pool());
-	    vpi_mcd_printf(1, "    %8lu other events (pool=%lu)\n",
-			   count_gen_events, count_gen_pool());
+	    vpi_mcd_printf(1, "             ...assign(vec4) peak=%lu\n",
+			   count_assign4_peak());
+	    vpi_mcd_printf(1, "             ...assign(vec8) peak=%lu\n",
+			   count_assign8_peak());
+	    vpi_mcd_printf(1, "             ...assign(real) peak=%lu\n",
+			   count_assign_real_peak());
+	    vpi_mcd_printf(1, "             ...assign(word) peak=%lu\n",
+			   count_assign_aword_peak());
+	    vpi_mcd_printf(1, "             ...assign(word/r) peak=%lu\n",
+			   count_assign_arword_peak());
+	    vpi_mcd_printf(1, "             ...force(vec4) peak=%lu\n",
+			   count_force4_peak());
+	    vpi_mcd_printf(1, "             ...propagate(vec4) peak=%lu\n",
+			   count_propagate4_peak());
+	    vpi_mcd_printf(1, "             ...propagate(real) peak=%lu\n",
+			   count_propagate_real_peak());
+	    vpi_mcd_printf(1, "    %8lu other events (peak=%lu)\n",
+			   count_gen_events, count_gen_peak());
+	    vpi_mcd_printf(1, "    %8zu bytes of event pool chunks\n",
+			   size_event_pool());
       }
 
       final_cleanup();
@@ -33,6 +33,12 @@
  */
 extern FILE*yyin;
 
+/*
+ * The tokens come through the image module, which can save or replay
+ * the token stream of the lexor.
+ */
+# define yylex image_lex
+
 vector <const char*> file_names;
 
 /*
@@ -1228,13 +1234,36 @@ int compile_design(const char*path)
 {
       yypath = path;
       yyline = 1;
-      yyin = fopen(path, "r");
-      if (yyin == 0) {
-	    fprintf(stderr, "%s: Unable to open input file.\n", path);
+
+	/* The input may be a token image saved by an earlier run. */
+      int image = image_load_open(path);
+      if (image < 0)
 	    return -1;
+
+      if (image > 0 && image_save_path) {
+	    fprintf(stderr, "%s: Input is already an image file, "
+		    "-c %s not saved.\n", path, image_save_path);
+	    image_close(false);
+	    return -1;
+      }
+
+      if (image == 0) {
+	    yyin = fopen(path, "r");
+	    if (yyin == 0) {
+		  fprintf(stderr, "%s: Unable to open input file.\n", path);
+		  return -1;
+	    }
+
+	    if (image_save_path && ! image_save_open(image_save_path, path)) {
+		  fclose(yyin);
+		  return -1;
+	    }
       }
 
       int rc = yyparse();
-      fclose(yyin);
+      if (image == 0)
+	    fclose(yyin);
+      if (! image_close(rc == 0) && rc == 0)
+	    rc = -1;
       return rc;
 }
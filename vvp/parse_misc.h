@@ -46,6 +46,21 @@ extern void yyerror(const char*msg);
 
 extern void destroy_lexor();
 
+/*
+ * The parser reads its tokens through image_lex(). This normally
+ * passes on the tokens of the lexor, saving them to a token image if
+ * image_save_open() was called. If image_load_open() found that the
+ * input is a token image, the saved tokens are replayed instead.
+ * image_load_open() returns 1 if the file is an image, 0 if it is not
+ * and -1 if it is an image that cannot be loaded. image_close() ends
+ * the save or load, and returns false if that failed.
+ */
+extern const char*image_save_path;
+extern int image_lex(void);
+extern bool image_save_open(const char*path, const char*source);
+extern int  image_load_open(const char*path);
+extern bool image_close(bool parse_ok);
+
 /*
  * This is the path of the current source file.
  */
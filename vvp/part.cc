@@ -20,6 +20,7 @@
 # define __STDC_LIMIT_MACROS
 # include  "compile.h"
 # include  "part.h"
+# include  <algorithm>
 # include  <cstdlib>
 # include  <climits>
 # include  <stdint.h>
@@ -238,6 +239,119 @@ void vvp_fun_part_pv::recv_vec8(vvp_net_ptr_t port, const vvp_vector8_t&bit)
       port.ptr()->send_vec8_pv(bit, base_, wid_, vwid_);
 }
 
+static bool compare_run_port(const vvp_fun_permute::run_s&a,
+			     const vvp_fun_permute::run_s&b)
+{
+      return a.port < b.port;
+}
+
+vvp_fun_permute::vvp_fun_permute(const vvp_vector4_t&init,
+				 const std::vector<run_s>&map, unsigned sched_mask)
+: map_(map), val_(init), sched_mask_(sched_mask), sent_flag_(false)
+{
+      net_ = 0;
+
+      std::stable_sort(map_.begin(), map_.end(), compare_run_port);
+      unsigned idx = 0;
+      for (unsigned port = 0 ; port < 5 ; port += 1) {
+	    while (idx < map_.size() && map_[idx].port < port)
+		  idx += 1;
+	    first_[port] = idx;
+      }
+}
+
+vvp_fun_permute::~vvp_fun_permute()
+{
+}
+
+/*
+ * Set the output bits that come from bits [base, base+bit.size()) of
+ * an input that is vwid bits wide. The output bits that come from
+ * past the end of the input are set to BIT4_X, as vvp_fun_part_sa
+ * does, so a part select that reaches past a narrow input or past a
+ * part value gets X there and not the initial Z. Return true if any
+ * output bits changed.
+ */
+bool vvp_fun_permute::set_bits_(unsigned port, const vvp_vector4_t&bit,
+				unsigned base, unsigned vwid)
+{
+      unsigned end = base + bit.size();
+      bool changed = false;
+      for (unsigned idx = first_[port] ; idx < first_[port+1] ; idx += 1) {
+	    const run_s&run = map_[idx];
+
+	    if (run.repeat) {
+		  vvp_bit4_t pad;
+		  if (run.src >= vwid)
+			pad = BIT4_X;
+		  else if (run.src >= base && run.src < end)
+			pad = bit.value(run.src-base);
+		  else
+			continue;
+		  for (unsigned pdx = 0 ; pdx < run.wid ; pdx += 1) {
+			if (val_.value(run.dst+pdx) == pad)
+			      continue;
+			val_.set_bit(run.dst+pdx, pad);
+			changed = true;
+		  }
+		  continue;
+	    }
+
+	    unsigned lo = run.src > base? run.src : base;
+	    unsigned hi = run.src+run.wid < end? run.src+run.wid : end;
+	    if (lo < hi && val_.set_vec(run.dst + lo-run.src, bit, lo-base, hi-lo))
+		  changed = true;
+
+	    for (unsigned sdx = vwid > run.src? vwid : run.src
+		       ; sdx < run.src+run.wid ; sdx += 1) {
+		  if (val_.value(run.dst + sdx-run.src) == BIT4_X)
+			continue;
+		  val_.set_bit(run.dst + sdx-run.src, BIT4_X);
+		  changed = true;
+	    }
+      }
+
+      return changed;
+}
+
+void vvp_fun_permute::recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
+				vvp_context_t)
+{
+      bool changed = set_bits_(port.port(), bit, 0, bit.size());
+      send_(port, changed);
+}
+
+void vvp_fun_permute::recv_vec4_pv(vvp_net_ptr_t port, const vvp_vector4_t&bit,
+				   unsigned base, unsigned wid, unsigned vwid,
+				   vvp_context_t)
+{
+      assert(bit.size() == wid);
+
+      bool changed = set_bits_(port.port(), bit, base, vwid);
+      send_(port, changed);
+}
+
+void vvp_fun_permute::send_(vvp_net_ptr_t port, bool changed)
+{
+      if ((sched_mask_ & (1U << port.port())) == 0) {
+	    port.ptr()->send_vec4(val_, 0);
+	    return;
+      }
+
+      if ((changed || ! sent_flag_) && net_ == 0) {
+	    net_ = port.ptr();
+	    schedule_functor(this);
+      }
+}
+
+void vvp_fun_permute::run_run()
+{
+      vvp_net_t*ptr = net_;
+      net_ = 0;
+      sent_flag_ = true;
+      ptr->send_vec4(val_, 0);
+}
+
 vvp_fun_part_var::vvp_fun_part_var(unsigned w, bool is_signed)
 : wid_(w), is_signed_(is_signed)
 {
@@ -21,6 +21,7 @@
 
 # include  "schedule.h"
 # include  "config.h"
+# include  <vector>
 
 /* vvp_fun_part
  * This node takes a part select of the input vector. Input 0 is the
@@ -34,6 +35,9 @@ class vvp_fun_part  : public vvp_net_fun_t {
       vvp_fun_part(unsigned base, unsigned wid);
       ~vvp_fun_part();
 
+      unsigned base() const { return base_; }
+      unsigned width() const { return wid_; }
+
     protected:
       unsigned base_;
       unsigned wid_;
@@ -121,6 +125,63 @@ class vvp_fun_part_pv  : public vvp_net_fun_t {
       unsigned vwid_;
 };
 
+/* vvp_fun_permute
+ * This node replaces a tree of part selects, concatenations and sign
+ * extensions that compile_cleanup fused together. Each bit of the
+ * output is a copy of a bit of one of the (up to 4) inputs, or is a
+ * fixed bit of the initial value. The map is a list of runs of output
+ * bits that are either copied from consecutive bits of an input, or
+ * are all copies of one bit of an input. The constant inputs of the
+ * tree are gathered into one of the inputs.
+ *
+ * If an input went through a part select in the tree, a change of
+ * that input is scheduled like the output of vvp_fun_part_sa, and only
+ * if it changed the output. The other inputs are sent on right away
+ * like those of vvp_fun_concat. The sched_mask has a bit for each
+ * input that is scheduled.
+ */
+class vvp_fun_permute  : public vvp_net_fun_t, public vvp_gen_event_s {
+
+    public:
+      struct run_s {
+	    unsigned port;
+	    unsigned dst;
+	    unsigned src;
+	    unsigned wid;
+	    bool repeat;
+      };
+
+      vvp_fun_permute(const vvp_vector4_t&init,
+		      const std::vector<run_s>&map, unsigned sched_mask);
+      ~vvp_fun_permute();
+
+    public:
+      void recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
+                     vvp_context_t);
+
+      void recv_vec4_pv(vvp_net_ptr_t port, const vvp_vector4_t&bit,
+			unsigned base, unsigned wid, unsigned vwid,
+                        vvp_context_t);
+
+    private:
+      bool set_bits_(unsigned port, const vvp_vector4_t&bit,
+		     unsigned base, unsigned vwid);
+      void send_(vvp_net_ptr_t port, bool changed);
+      void run_run();
+
+    private:
+	// The runs, sorted by port. The runs of port p are
+	// map_[first_[p]] up to map_[first_[p+1]].
+      std::vector<run_s> map_;
+      unsigned first_[5];
+      vvp_vector4_t val_;
+      unsigned sched_mask_;
+	// A scheduled output is sent the first time even if it did
+	// not change, as vvp_fun_part_sa does.
+      bool sent_flag_;
+      vvp_net_t*net_;
+};
+
 /*
  * This part select is more flexible in that it takes the vector to
  * part in port 0, and the base of the part in port 1. The width of
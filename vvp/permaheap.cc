@@ -25,6 +25,7 @@ permaheap::permaheap()
       chunk_ptr_ = initial_chunk_.bytes;
       chunk_remaining_ = sizeof(initial_chunk_);
       heap_total_ = chunk_remaining_;
+      heap_used_ = 0;
 }
 
 permaheap::~permaheap()
@@ -46,6 +47,7 @@ void* permaheap::alloc(size_t size)
       void*res = chunk_ptr_;
       chunk_ptr_ += size;
       chunk_remaining_ -= size;
+      heap_used_ += size;
 
       return res;
 }
@@ -35,6 +35,7 @@ class permaheap {
       void* alloc(size_t size);
 
       size_t heap_total() const { return heap_total_; }
+      size_t heap_used() const { return heap_used_; }
 
     private:
       enum { INITIAL_CHUNK_SIZE = 512*1024, CHUNK_SIZE=256*1024 };
@@ -47,6 +48,7 @@ class permaheap {
       char*chunk_ptr_;
       size_t chunk_remaining_;
       size_t heap_total_;
+      size_t heap_used_;
 };
 
 #endif /* IVL_permaheap_H */
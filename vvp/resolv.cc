@@ -37,6 +37,12 @@
  * array, with the input values stored at the start of the array, then
  * the next level of branch values, and so on, down to the final array
  * array element which stores the current output value.
+ *
+ * Buses often have many drivers with only one of them driving at a
+ * time, so the resolvers also keep a flag for each node that is
+ * entirely HiZ. Those nodes can not change the resolved value, so
+ * they are skipped, and a branch with only one driving input just
+ * takes the value of that input.
  */
 
 
@@ -114,11 +120,15 @@ resolv_tri::resolv_tri(unsigned nports, vvp_net_t*net, vvp_scalar_t hiz_value)
             nnodes += 1;
 
       val_ = new vvp_vector8_t [nnodes];
+      hiz_ = new bool [nnodes];
+      for (unsigned idx = 0 ;  idx < nnodes ;  idx += 1)
+	    hiz_[idx] = true;
 }
 
 resolv_tri::~resolv_tri()
 {
       delete[] val_;
+      delete[] hiz_;
 }
 
 void resolv_tri::recv_vec4_(unsigned port, const vvp_vector4_t&bit)
@@ -134,6 +144,7 @@ void resolv_tri::recv_vec8_(unsigned port, const vvp_vector8_t&bit)
 	    return;
 
       val_[port] = bit;
+      hiz_[port] = bit.is_hiz();
 
         // Starting at the leaf level, work down the tree, resolving
         // the changed values. base is the first node in the current
@@ -150,18 +161,26 @@ void resolv_tri::recv_vec8_(unsigned port, const vvp_vector8_t&bit)
             unsigned op = next_base + (port / 4);
             unsigned ll = min(ip + 4, next_base);
 
-            vvp_vector8_t out = val_[ip];
+              // Resolving a HiZ value with another value gives the
+              // other value, so only resolve the values that drive.
+            vvp_vector8_t*out = &val_[ip];
+            bool out_hiz = hiz_[ip];
+            vvp_vector8_t tmp;
             for (ip = ip + 1; ip < ll; ip += 1) {
                   if (val_[ip].size() == 0)
                         continue;
-                  if (out.size() == 0)
-                        out = val_[ip];
-                  else
-                        out = resolve(out, val_[ip]);
+                  if (out->size() == 0 || (out_hiz && !hiz_[ip])) {
+                        out = &val_[ip];
+                        out_hiz = hiz_[ip];
+                  } else if (! hiz_[ip]) {
+                        tmp = resolve(*out, val_[ip]);
+                        out = &tmp;
+                  }
             }
-            if (val_[op].eeq(out))
+            if (val_[op].eeq(*out))
                   return;
-            val_[op] = out;
+            val_[op] = *out;
+            hiz_[op] = out_hiz;
 
             base = next_base;
             span = (span + 3) / 4;
@@ -169,10 +188,13 @@ void resolv_tri::recv_vec8_(unsigned port, const vvp_vector8_t&bit)
       }
 
       if (! hiz_value_.is_hiz()) {
-	    for (unsigned idx = 0 ;  idx < val_[base].size() ;  idx += 1) {
-		  val_[base].set_bit(idx, resolve(val_[base].value(idx),
-						  hiz_value_));
+	    unsigned wid = val_[base].size();
+	    if (pull_.size() != wid) {
+		  pull_ = vvp_vector8_t(wid);
+		  for (unsigned idx = 0 ;  idx < wid ;  idx += 1)
+			pull_.set_bit(idx, hiz_value_);
 	    }
+	    val_[base] = resolve(val_[base], pull_);
       }
 
       net_->send_vec8(val_[base]);
@@ -206,11 +228,15 @@ resolv_wired_logic::resolv_wired_logic(unsigned nports, vvp_net_t*net)
             nnodes += 1;
 
       val_ = new vvp_vector4_t [nnodes];
+      hiz_ = new bool [nnodes];
+      for (unsigned idx = 0 ;  idx < nnodes ;  idx += 1)
+	    hiz_[idx] = true;
 }
 
 resolv_wired_logic::~resolv_wired_logic()
 {
       delete[] val_;
+      delete[] hiz_;
 }
 
 void resolv_wired_logic::recv_vec4_(unsigned port, const vvp_vector4_t&bit)
@@ -221,6 +247,7 @@ void resolv_wired_logic::recv_vec4_(unsigned port, const vvp_vector4_t&bit)
 	    return;
 
       val_[port] = bit;
+      hiz_[port] = bit.is_hiz();
 
         // Starting at the leaf level, work down the tree, resolving
         // the changed values. base is the first node in the current
@@ -237,18 +264,26 @@ void resolv_wired_logic::recv_vec4_(unsigned port, const vvp_vector4_t&bit)
             unsigned op = next_base + (port / 4);
             unsigned ll = min(ip + 4, next_base);
 
-            vvp_vector4_t out = val_[ip];
+              // The wired logic of a Z value with another value gives
+              // the other value, so only combine the values that drive.
+            vvp_vector4_t*out = &val_[ip];
+            bool out_hiz = hiz_[ip];
+            vvp_vector4_t tmp;
             for (ip = ip + 1; ip < ll; ip += 1) {
                   if (val_[ip].size() == 0)
                         continue;
-                  if (out.size() == 0)
-                        out = val_[ip];
-                  else
-                        out = wired_logic_math_(out, val_[ip]);
+                  if (out->size() == 0 || (out_hiz && !hiz_[ip])) {
+                        out = &val_[ip];
+                        out_hiz = hiz_[ip];
+                  } else if (! hiz_[ip]) {
+                        tmp = wired_logic_math_(*out, val_[ip]);
+                        out = &tmp;
+                  }
             }
-            if (val_[op].eeq(out))
+            if (val_[op].eeq(*out))
                   return;
-            val_[op] = out;
+            val_[op] = *out;
+            hiz_[op] = out_hiz;
 
             base = next_base;
             span = (span + 3) / 4;
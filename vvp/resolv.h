@@ -126,8 +126,12 @@ class resolv_tri : public resolv_core {
     private:
         // The puller value to be used when a bit is not driven.
       vvp_scalar_t hiz_value_;
+        // A vector of the puller value, the width of the output.
+      vvp_vector8_t pull_;
         // The array of input values.
       vvp_vector8_t*val_;
+        // Flags marking the values that are entirely HiZ.
+      bool*hiz_;
 };
 
 /*
@@ -157,6 +161,8 @@ class resolv_wired_logic : public resolv_core {
     private:
         // The array of input values.
       vvp_vector4_t*val_;
+        // Flags marking the values that are entirely Z.
+      bool*hiz_;
 };
 
 class resolv_triand : public resolv_wired_logic {
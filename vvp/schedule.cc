@@ -24,12 +24,16 @@
 # include  "vvp_net_sig.h"
 # include  "slab.h"
 # include  "compile.h"
+# include  "checkpoint.h"
 # include  <new>
 # include  <typeinfo>
 # include  <csignal>
 # include  <cstdlib>
 # include  <cassert>
 # include  <iostream>
+# include  <algorithm>
+# include  <vector>
+# include  <utility>
 #ifdef CHECK_WITH_VALGRIND
 # include  "vvp_cleanup.h"
 # include  "ivl_alloc.h"
@@ -40,6 +44,12 @@ unsigned long count_gen_events = 0;
 unsigned long count_thread_events = 0;
   // Count the time events (A time cell created)
 unsigned long count_time_events = 0;
+  // Count the time steps placed directly in the timing wheel, the
+  // time steps that overflowed to the far heap, and the far time
+  // steps later promoted into the wheel.
+unsigned long count_wheel_hits = 0;
+unsigned long count_wheel_overflows = 0;
+unsigned long count_wheel_promotions = 0;
 
 
 
@@ -49,6 +59,8 @@ unsigned long count_time_events = 0;
  *
  * The event_time_s objects are one per time step. Each time step in
  * turn contains a list of event_s objects that are the actual events.
+ * The event_time_s objects for future time steps are kept in a timing
+ * wheel (see below) indexed by their absolute simulation time.
  *
  * The event_s objects are base classes for the more specific sort of
  * event.
@@ -61,6 +73,10 @@ struct event_s {
 	// Write something about the event to stderr
       virtual void single_step_display(void);
 
+	// Write the event to a checkpoint. Most events cannot be
+	// saved, so the default refuses.
+      virtual void checkpoint_save(checkpoint_out&out);
+
 	// Fallback new/delete
       static void*operator new (size_t size) { return ::new char[size]; }
       static void operator delete(void*ptr)  { ::delete[]( (char*)ptr ); }
@@ -71,6 +87,18 @@ void event_s::single_step_display(void)
       std::cerr << "event_s: Step into event " << typeid(*this).name() << std::endl;
 }
 
+void event_s::checkpoint_save(checkpoint_out&out)
+{
+      out.refuse("an event that cannot be saved is scheduled");
+}
+
+/*
+ * These are the kinds of events that checkpoint_save writes.
+ */
+enum { CKPT_EV_THREAD = 1, CKPT_EV_ASSIGN4, CKPT_EV_ASSIGN_REAL,
+       CKPT_EV_ARRAY_WORD, CKPT_EV_ARRAY_R_WORD, CKPT_EV_FUNCTOR,
+       CKPT_EV_FORCE4 };
+
 struct event_time_s {
       event_time_s() {
 	    count_time_events += 1;
@@ -81,9 +109,9 @@ struct event_time_s {
 	    rwsync = 0;
 	    rosync = 0;
 	    del_thr = 0;
-	    next = NULL;
       }
-      vvp_time64_t delay;
+	// The absolute simulation time of this time step.
+      vvp_time64_t time;
 
       struct event_s*start;
       struct event_s*active;
@@ -93,7 +121,9 @@ struct event_time_s {
       struct event_s*rosync;
       struct event_s*del_thr;
 
-      struct event_time_s*next;
+	// Append the events of the later time step cell to the queues
+	// of this cell. Both cells are for the same time step.
+      void merge(struct event_time_s*that);
 
       static void* operator new (size_t);
       static void operator delete(void*obj, size_t s);
@@ -108,6 +138,80 @@ void vvp_gen_event_s::single_step_display(void)
       cerr << "vvp_gen_event_s: Step into event " << typeid(*this).name() << endl;
 }
 
+vvp_net_t* vvp_gen_event_s::checkpoint_net(checkpoint_out&out)
+{
+      out.refuse("a VPI callback or value change is scheduled");
+      return 0;
+}
+
+/*
+ * All the event types are allocated from a few slabs, one for each
+ * size class, instead of a slab for each type. Event types of similar
+ * size share their free cells, so a simulation that moves from one
+ * kind of event to another reuses the cells it already has. Each type
+ * counts its live events and keeps the high water mark of that count
+ * for the statistics.
+ *
+ * The classes fit the event sizes of a 64-bit build, where event_s is
+ * 16 bytes and a vvp_vector4_t is 24 bytes with the bits of vectors of
+ * up to 64 bits held in the object. The thread, real and generic
+ * events are 24 to 32 bytes, the vec8, real word and vec4 propagate
+ * events are 40 to 48 bytes, and the vec4 assign, force and array
+ * word events are 56 to 64 bytes.
+ */
+struct event_stats_s {
+      unsigned long live;
+      unsigned long peak;
+};
+
+static const size_t EVENT_SMALL_SIZE  = 32;
+static const size_t EVENT_MEDIUM_SIZE = 48;
+static const size_t EVENT_LARGE_SIZE  = 64;
+
+static slab_t<EVENT_SMALL_SIZE, 131072/EVENT_SMALL_SIZE> event_small_heap;
+static slab_t<EVENT_MEDIUM_SIZE, 65536/EVENT_MEDIUM_SIZE> event_medium_heap;
+static slab_t<EVENT_LARGE_SIZE, 524288/EVENT_LARGE_SIZE> event_large_heap;
+
+static inline void* event_alloc(size_t size, event_stats_s&stats)
+{
+      stats.live += 1;
+      if (stats.live > stats.peak)
+	    stats.peak = stats.live;
+
+      if (size <= EVENT_SMALL_SIZE)
+	    return event_small_heap.alloc_slab();
+      if (size <= EVENT_MEDIUM_SIZE)
+	    return event_medium_heap.alloc_slab();
+      if (size <= EVENT_LARGE_SIZE)
+	    return event_large_heap.alloc_slab();
+      return ::new char[size];
+}
+
+static inline void event_free(void*ptr, size_t size, event_stats_s&stats)
+{
+      stats.live -= 1;
+
+      if (size <= EVENT_SMALL_SIZE)
+	    event_small_heap.free_slab(ptr);
+      else if (size <= EVENT_MEDIUM_SIZE)
+	    event_medium_heap.free_slab(ptr);
+      else if (size <= EVENT_LARGE_SIZE)
+	    event_large_heap.free_slab(ptr);
+      else
+	    ::delete[]( (char*)ptr );
+}
+
+/*
+ * The values passed to the schedule functions by value are copies
+ * that the caller is done with, so the events take over their storage
+ * instead of copying wide values again.
+ */
+#if __cplusplus >= 201103L
+# define EVENT_ADOPT(val) std::move(val)
+#else
+# define EVENT_ADOPT(val) (val)
+#endif
+
 /*
  * Derived event types
  */
@@ -115,6 +219,7 @@ struct vthread_event_s : public event_s {
       vthread_t thr;
       void run_run(void);
       void single_step_display(void);
+      void checkpoint_save(checkpoint_out&out);
 
       static void* operator new(size_t);
       static void operator delete(void*);
@@ -134,24 +239,36 @@ void vthread_event_s::single_step_display(void)
 	   << endl;
 }
 
-static const size_t VTHR_CHUNK_COUNT = 8192 / sizeof(struct vthread_event_s);
-static slab_t<sizeof(vthread_event_s),VTHR_CHUNK_COUNT> vthread_event_heap;
+  // The event may run a list of threads. They are saved as separate
+  // events, which run them in the same order.
+void vthread_event_s::checkpoint_save(checkpoint_out&out)
+{
+      for (vthread_t cur = thr ; cur ; cur = vthread_wait_next(cur)) {
+	    out.put_uint(CKPT_EV_THREAD);
+	    out.put_thread(cur);
+      }
+}
+
+static event_stats_s thread_stats;
 
 inline void* vthread_event_s::operator new(size_t size)
 {
       assert(size == sizeof(vthread_event_s));
-      return vthread_event_heap.alloc_slab();
+      return event_alloc(size, thread_stats);
 }
 
 void vthread_event_s::operator delete(void*dptr)
 {
-      vthread_event_heap.free_slab(dptr);
+      event_free(dptr, sizeof(vthread_event_s), thread_stats);
 }
 
 struct del_thr_event_s : public event_s {
       vthread_t thr;
       void run_run(void);
       void single_step_display(void);
+
+      static void* operator new(size_t);
+      static void operator delete(void*);
 };
 
 void del_thr_event_s::run_run(void)
@@ -166,12 +283,29 @@ void del_thr_event_s::single_step_display(void)
 	   << " scope=" << scope->vpi_get_str(vpiFullName) << endl;
 }
 
+inline void* del_thr_event_s::operator new(size_t size)
+{
+      assert(size == sizeof(del_thr_event_s));
+      return event_alloc(size, thread_stats);
+}
+
+void del_thr_event_s::operator delete(void*dptr)
+{
+      event_free(dptr, sizeof(del_thr_event_s), thread_stats);
+}
+
 struct assign_vector4_event_s  : public event_s {
 	/* The default constructor. */
       explicit assign_vector4_event_s(const vvp_vector4_t&that) : val(that) {
 	    base = 0;
 	    vwid = 0;
       }
+#if __cplusplus >= 201103L
+      explicit assign_vector4_event_s(vvp_vector4_t&&that) : val(std::move(that)) {
+	    base = 0;
+	    vwid = 0;
+      }
+#endif
 
 	/* Where to do the assign. */
       vvp_net_ptr_t ptr;
@@ -183,6 +317,7 @@ struct assign_vector4_event_s  : public event_s {
       unsigned vwid;
       void run_run(void);
       void single_step_display(void);
+      void checkpoint_save(checkpoint_out&out);
 
       static void* operator new(size_t);
       static void operator delete(void*);
@@ -203,21 +338,32 @@ void assign_vector4_event_s::single_step_display(void)
 	   << ", vwid=" << vwid << ", base=" << base << endl;
 }
 
-static const size_t ASSIGN4_CHUNK_COUNT = 524288 / sizeof(struct assign_vector4_event_s);
-static slab_t<sizeof(assign_vector4_event_s),ASSIGN4_CHUNK_COUNT> assign4_heap;
+void assign_vector4_event_s::checkpoint_save(checkpoint_out&out)
+{
+      out.put_uint(CKPT_EV_ASSIGN4);
+      out.put_net(ptr.ptr());
+      out.put_uint(ptr.port());
+      out.put_vec4(val);
+      out.put_uint(base);
+      out.put_uint(vwid);
+}
+
+static event_stats_s assign4_stats;
 
 inline void* assign_vector4_event_s::operator new(size_t size)
 {
       assert(size == sizeof(assign_vector4_event_s));
-      return assign4_heap.alloc_slab();
+      return event_alloc(size, assign4_stats);
 }
 
 void assign_vector4_event_s::operator delete(void*dptr)
 {
-      assign4_heap.free_slab(dptr);
+      event_free(dptr, sizeof(assign_vector4_event_s), assign4_stats);
 }
 
-unsigned long count_assign4_pool(void) { return assign4_heap.pool; }
+unsigned long count_thread_peak(void) { return thread_stats.peak; }
+
+unsigned long count_assign4_peak(void) { return assign4_stats.peak; }
 
 struct assign_vector8_event_s  : public event_s {
       vvp_net_ptr_t ptr;
@@ -240,27 +386,27 @@ void assign_vector8_event_s::single_step_display(void)
       cerr << "assign_vector8_event: Propagate val=" << val << endl;
 }
 
-static const size_t ASSIGN8_CHUNK_COUNT = 8192 / sizeof(struct assign_vector8_event_s);
-static slab_t<sizeof(assign_vector8_event_s),ASSIGN8_CHUNK_COUNT> assign8_heap;
+static event_stats_s assign8_stats;
 
 inline void* assign_vector8_event_s::operator new(size_t size)
 {
       assert(size == sizeof(assign_vector8_event_s));
-      return assign8_heap.alloc_slab();
+      return event_alloc(size, assign8_stats);
 }
 
 void assign_vector8_event_s::operator delete(void*dptr)
 {
-      assign8_heap.free_slab(dptr);
+      event_free(dptr, sizeof(assign_vector8_event_s), assign8_stats);
 }
 
-unsigned long count_assign8_pool() { return assign8_heap.pool; }
+unsigned long count_assign8_peak() { return assign8_stats.peak; }
 
 struct assign_real_event_s  : public event_s {
       vvp_net_ptr_t ptr;
       double val;
       void run_run(void);
       void single_step_display(void);
+      void checkpoint_save(checkpoint_out&out);
 
       static void* operator new(size_t);
       static void operator delete(void*);
@@ -277,21 +423,28 @@ void assign_real_event_s::single_step_display(void)
       cerr << "assign_real_event: Propagate val=" << val << endl;
 }
 
-static const size_t ASSIGNR_CHUNK_COUNT = 8192 / sizeof(struct assign_real_event_s);
-static slab_t<sizeof(assign_real_event_s),ASSIGNR_CHUNK_COUNT> assignr_heap;
+void assign_real_event_s::checkpoint_save(checkpoint_out&out)
+{
+      out.put_uint(CKPT_EV_ASSIGN_REAL);
+      out.put_net(ptr.ptr());
+      out.put_uint(ptr.port());
+      out.put_real(val);
+}
+
+static event_stats_s assignr_stats;
 
 inline void* assign_real_event_s::operator new (size_t size)
 {
       assert(size == sizeof(assign_real_event_s));
-      return assignr_heap.alloc_slab();
+      return event_alloc(size, assignr_stats);
 }
 
 void assign_real_event_s::operator delete(void*dptr)
 {
-      assignr_heap.free_slab(dptr);
+      event_free(dptr, sizeof(assign_real_event_s), assignr_stats);
 }
 
-unsigned long count_assign_real_pool(void) { return assignr_heap.pool; }
+unsigned long count_assign_real_peak(void) { return assignr_stats.peak; }
 
 struct assign_array_word_s  : public event_s {
       vvp_array_t mem;
@@ -299,6 +452,7 @@ struct assign_array_word_s  : public event_s {
       vvp_vector4_t val;
       unsigned off;
       void run_run(void);
+      void checkpoint_save(checkpoint_out&out);
 
       static void* operator new(size_t);
       static void operator delete(void*);
@@ -310,21 +464,29 @@ void assign_array_word_s::run_run(void)
       mem->set_word(adr, off, val);
 }
 
-static const size_t ARRAY_W_CHUNK_COUNT = 8192 / sizeof(struct assign_array_word_s);
-static slab_t<sizeof(assign_array_word_s),ARRAY_W_CHUNK_COUNT> array_w_heap;
+void assign_array_word_s::checkpoint_save(checkpoint_out&out)
+{
+      out.put_uint(CKPT_EV_ARRAY_WORD);
+      array_checkpoint_put(out, mem);
+      out.put_uint(adr);
+      out.put_vec4(val);
+      out.put_uint(off);
+}
+
+static event_stats_s array_w_stats;
 
 inline void* assign_array_word_s::operator new (size_t size)
 {
       assert(size == sizeof(assign_array_word_s));
-      return array_w_heap.alloc_slab();
+      return event_alloc(size, array_w_stats);
 }
 
 void assign_array_word_s::operator delete(void*ptr)
 {
-      array_w_heap.free_slab(ptr);
+      event_free(ptr, sizeof(assign_array_word_s), array_w_stats);
 }
 
-unsigned long count_assign_aword_pool(void) { return array_w_heap.pool; }
+unsigned long count_assign_aword_peak(void) { return array_w_stats.peak; }
 
 struct force_vector4_event_s  : public event_s {
 	/* The default constructor. */
@@ -344,6 +506,7 @@ struct force_vector4_event_s  : public event_s {
 
       void run_run(void);
       void single_step_display(void);
+      void checkpoint_save(checkpoint_out&out);
 
       static void* operator new(size_t);
       static void operator delete(void*);
@@ -382,21 +545,29 @@ void force_vector4_event_s::single_step_display(void)
 	   << ", vwid=" << vwid << ", base=" << base << endl;
 }
 
-static const size_t FORCE4_CHUNK_COUNT = 8192 / sizeof(struct force_vector4_event_s);
-static slab_t<sizeof(force_vector4_event_s),FORCE4_CHUNK_COUNT> force4_heap;
+void force_vector4_event_s::checkpoint_save(checkpoint_out&out)
+{
+      out.put_uint(CKPT_EV_FORCE4);
+      out.put_net(net);
+      out.put_vec4(val);
+      out.put_uint(base);
+      out.put_uint(vwid);
+}
+
+static event_stats_s force4_stats;
 
 inline void* force_vector4_event_s::operator new(size_t size)
 {
       assert(size == sizeof(force_vector4_event_s));
-      return force4_heap.alloc_slab();
+      return event_alloc(size, force4_stats);
 }
 
 void force_vector4_event_s::operator delete(void*dptr)
 {
-      force4_heap.free_slab(dptr);
+      event_free(dptr, sizeof(force_vector4_event_s), force4_stats);
 }
 
-unsigned long count_force4_pool(void) { return force4_heap.pool; }
+unsigned long count_force4_peak(void) { return force4_stats.peak; }
 
 /*
  * This class supports the propagation of vec4 outputs from a
@@ -412,6 +583,11 @@ struct propagate_vector4_event_s : public event_s {
       : val(that,adr,wid) {
 	    net = NULL;
       }
+#if __cplusplus >= 201103L
+      explicit propagate_vector4_event_s(vvp_vector4_t&&that) : val(std::move(that)) {
+	    net = NULL;
+      }
+#endif
 
 	/* Propagate the output of this net. */
       vvp_net_t*net;
@@ -420,6 +596,9 @@ struct propagate_vector4_event_s : public event_s {
 	/* Action */
       void run_run(void);
       void single_step_display(void);
+
+      static void* operator new(size_t);
+      static void operator delete(void*);
 };
 
 void propagate_vector4_event_s::run_run(void)
@@ -432,6 +611,46 @@ void propagate_vector4_event_s::single_step_display(void)
       cerr << "propagate_vector4_event: Propagate val=" << val << endl;
 }
 
+static event_stats_s propagate4_stats;
+
+inline void* propagate_vector4_event_s::operator new(size_t size)
+{
+      assert(size == sizeof(propagate_vector4_event_s));
+      return event_alloc(size, propagate4_stats);
+}
+
+void propagate_vector4_event_s::operator delete(void*dptr)
+{
+      event_free(dptr, sizeof(propagate_vector4_event_s), propagate4_stats);
+}
+
+unsigned long count_propagate4_peak(void) { return propagate4_stats.peak; }
+
+/*
+ * This class supports the propagation of vec8 outputs from a
+ * vvp_net_t object. Only the restore of a checkpoint uses it, so it
+ * does not need its own allocator.
+ */
+struct propagate_vector8_event_s : public event_s {
+	/* Propagate the output of this net. */
+      vvp_net_t*net;
+	/* value to propagate */
+      vvp_vector8_t val;
+	/* Action */
+      void run_run(void);
+      void single_step_display(void);
+};
+
+void propagate_vector8_event_s::run_run(void)
+{
+      net->send_vec8(val);
+}
+
+void propagate_vector8_event_s::single_step_display(void)
+{
+      cerr << "propagate_vector8_event: Propagate val=" << val << endl;
+}
+
 /*
  * This class supports the propagation of real outputs from a
  * vvp_net_t object.
@@ -444,6 +663,9 @@ struct propagate_real_event_s : public event_s {
 	/* Action */
       void run_run(void);
       void single_step_display(void);
+
+      static void* operator new(size_t);
+      static void operator delete(void*);
 };
 
 void propagate_real_event_s::run_run(void)
@@ -456,11 +678,27 @@ void propagate_real_event_s::single_step_display(void)
       cerr << "propagate_real_event: Propagate val=" << val << endl;
 }
 
+static event_stats_s propagate_real_stats;
+
+inline void* propagate_real_event_s::operator new(size_t size)
+{
+      assert(size == sizeof(propagate_real_event_s));
+      return event_alloc(size, propagate_real_stats);
+}
+
+void propagate_real_event_s::operator delete(void*dptr)
+{
+      event_free(dptr, sizeof(propagate_real_event_s), propagate_real_stats);
+}
+
+unsigned long count_propagate_real_peak(void) { return propagate_real_stats.peak; }
+
 struct assign_array_r_word_s  : public event_s {
       vvp_array_t mem;
       unsigned adr;
       double val;
       void run_run(void);
+      void checkpoint_save(checkpoint_out&out);
 
       static void* operator new(size_t);
       static void operator delete(void*);
@@ -471,27 +709,35 @@ void assign_array_r_word_s::run_run(void)
       count_assign_events += 1;
       mem->set_word(adr, val);
 }
-static const size_t ARRAY_R_W_CHUNK_COUNT = 8192 / sizeof(struct assign_array_r_word_s);
-static slab_t<sizeof(assign_array_r_word_s),ARRAY_R_W_CHUNK_COUNT> array_r_w_heap;
+void assign_array_r_word_s::checkpoint_save(checkpoint_out&out)
+{
+      out.put_uint(CKPT_EV_ARRAY_R_WORD);
+      array_checkpoint_put(out, mem);
+      out.put_uint(adr);
+      out.put_real(val);
+}
+
+static event_stats_s array_r_w_stats;
 
 inline void* assign_array_r_word_s::operator new(size_t size)
 {
       assert(size == sizeof(assign_array_r_word_s));
-      return array_r_w_heap.alloc_slab();
+      return event_alloc(size, array_r_w_stats);
 }
 
 void assign_array_r_word_s::operator delete(void*ptr)
 {
-      array_r_w_heap.free_slab(ptr);
+      event_free(ptr, sizeof(assign_array_r_word_s), array_r_w_stats);
 }
 
-unsigned long count_assign_arword_pool(void) { return array_r_w_heap.pool; }
+unsigned long count_assign_arword_peak(void) { return array_r_w_stats.peak; }
 
 struct generic_event_s : public event_s {
       vvp_gen_event_t obj;
       bool delete_obj_when_done;
       void run_run(void);
       void single_step_display(void);
+      void checkpoint_save(checkpoint_out&out);
 
       static void* operator new(size_t);
       static void operator delete(void*);
@@ -512,21 +758,39 @@ void generic_event_s::single_step_display(void)
       obj->single_step_display();
 }
 
-static const size_t GENERIC_CHUNK_COUNT = 131072 / sizeof(struct generic_event_s);
-static slab_t<sizeof(generic_event_s),GENERIC_CHUNK_COUNT> generic_event_heap;
+/*
+ * A generic event is saved as the net of the functor that it runs.
+ * A cancelled event does nothing, so it is left out, and so are the
+ * events that the object leaves out.
+ */
+void generic_event_s::checkpoint_save(checkpoint_out&out)
+{
+      if (obj == 0)
+	    return;
+
+      vvp_net_t*net = obj->checkpoint_net(out);
+      if (net == 0)
+	    return;
+
+      assert(! delete_obj_when_done);
+      out.put_uint(CKPT_EV_FUNCTOR);
+      out.put_net(net);
+}
+
+static event_stats_s generic_stats;
 
 inline void* generic_event_s::operator new(size_t size)
 {
       assert(size == sizeof(generic_event_s));
-      return generic_event_heap.alloc_slab();
+      return event_alloc(size, generic_stats);
 }
 
 void generic_event_s::operator delete(void*ptr)
 {
-      generic_event_heap.free_slab(ptr);
+      event_free(ptr, sizeof(generic_event_s), generic_stats);
 }
 
-unsigned long count_gen_pool(void) { return generic_event_heap.pool; }
+unsigned long count_gen_peak(void) { return generic_stats.peak; }
 
 /*
 ** These event_time_s will be required a lot, at high frequency.
@@ -551,12 +815,246 @@ inline void event_time_s::operator delete(void*ptr, size_t)
 
 unsigned long count_time_pool(void) { return event_time_heap.pool; }
 
+size_t size_event_pool(void)
+{
+      return event_small_heap.chunk_bytes()
+	   + event_medium_heap.chunk_bytes()
+	   + event_large_heap.chunk_bytes()
+	   + event_time_heap.chunk_bytes();
+}
+
 /*
- * This is the head of the list of pending events. This includes all
- * the events that have not been executed yet, and reaches into the
- * future.
+ * Give the chunks of the event slabs that have no live events back to
+ * the C++ heap. The slabs grow to fit the busiest point of the
+ * simulation and otherwise never shrink.
  */
-static struct event_time_s* sched_list = 0;
+static size_t schedule_trim_pools(void)
+{
+      size_t trimmed = 0;
+      trimmed += event_small_heap.trim();
+      trimmed += event_medium_heap.trim();
+      trimmed += event_large_heap.trim();
+      trimmed += event_time_heap.trim();
+      return trimmed;
+}
+
+/*
+ * Append the circular event list src to the end of the circular event
+ * list dst. The lists are represented by their last cell.
+ */
+static inline void merge_event_queue_(struct event_s*&dst, struct event_s*src)
+{
+      if (src == 0)
+	    return;
+
+      if (dst != 0) {
+	    struct event_s*first = dst->next;
+	    dst->next = src->next;
+	    src->next = first;
+      }
+      dst = src;
+}
+
+void event_time_s::merge(struct event_time_s*that)
+{
+      assert(time == that->time);
+      merge_event_queue_(start,    that->start);
+      merge_event_queue_(active,   that->active);
+      merge_event_queue_(inactive, that->inactive);
+      merge_event_queue_(nbassign, that->nbassign);
+      merge_event_queue_(rwsync,   that->rwsync);
+      merge_event_queue_(rosync,   that->rosync);
+      merge_event_queue_(del_thr,  that->del_thr);
+}
+
+/*
+ * This is the time step that is currently being executed. It is the
+ * cell for schedule_time, and is nil between time steps. Events with
+ * a zero delay go here.
+ */
+static struct event_time_s* sched_now = 0;
+
+static vvp_time64_t schedule_time;
+
+/*
+ * The future time steps are kept in a timing wheel. The wheel is a
+ * ring of SCHED_WHEEL_SIZE slots that covers the time steps in the
+ * range (schedule_time, schedule_time+SCHED_WHEEL_SIZE), each time
+ * step in that range having exactly one slot. A bit map of the
+ * occupied slots lets the scheduler find the next time step without
+ * touching the empty slots.
+ *
+ * Time steps that are too far in the future for the wheel go into the
+ * sched_far heap, ordered by time and then by the order in which they
+ * were created. As the simulation time advances, the far time steps
+ * that come into range of the wheel are promoted into their slot,
+ * merging with any other far cells for the same time.
+ */
+static const unsigned SCHED_WHEEL_BITS = 12;
+static const vvp_time64_t SCHED_WHEEL_SIZE = 1 << SCHED_WHEEL_BITS;
+static const unsigned SCHED_WHEEL_MASK = SCHED_WHEEL_SIZE - 1;
+static const unsigned SCHED_MAP_BITS = 8 * sizeof(unsigned long);
+static const unsigned SCHED_MAP_WORDS = SCHED_WHEEL_SIZE / SCHED_MAP_BITS;
+
+static struct event_time_s* sched_wheel[SCHED_WHEEL_SIZE];
+static unsigned long sched_wheel_map[SCHED_MAP_WORDS];
+static unsigned long sched_wheel_count = 0;
+
+struct sched_far_s {
+      vvp_time64_t time;
+      unsigned long seq;
+      struct event_time_s*cell;
+};
+
+  // The std heap functions make a max-heap, so this orders the cells
+  // so that the earliest (and first created) time step is at the top.
+static inline bool operator < (const sched_far_s&a, const sched_far_s&b)
+{
+      if (a.time != b.time)
+	    return a.time > b.time;
+      return a.seq > b.seq;
+}
+
+static std::vector<sched_far_s> sched_far;
+static unsigned long sched_far_seq = 0;
+static struct event_time_s* sched_far_last = 0;
+
+static inline unsigned sched_wheel_first_bit_(unsigned long word)
+{
+#if defined(__GNUC__)
+      return __builtin_ctzl(word);
+#else
+      unsigned idx = 0;
+      while ((word & 1UL) == 0) {
+	    word >>= 1;
+	    idx += 1;
+      }
+      return idx;
+#endif
+}
+
+static void sched_wheel_insert_(struct event_time_s*cell)
+{
+      unsigned slot = cell->time & SCHED_WHEEL_MASK;
+      if (struct event_time_s*cur = sched_wheel[slot]) {
+	    cur->merge(cell);
+	    delete cell;
+	    return;
+      }
+
+      sched_wheel[slot] = cell;
+      sched_wheel_map[slot / SCHED_MAP_BITS] |= 1UL << (slot % SCHED_MAP_BITS);
+      sched_wheel_count += 1;
+}
+
+/*
+ * Find the cell for the future time step at the given absolute
+ * time, creating it if necessary.
+ */
+static struct event_time_s* sched_future_cell_(vvp_time64_t time)
+{
+      assert(time > schedule_time);
+
+      if (time - schedule_time < SCHED_WHEEL_SIZE) {
+	    unsigned slot = time & SCHED_WHEEL_MASK;
+	    if (struct event_time_s*cur = sched_wheel[slot]) {
+		  assert(cur->time == time);
+		  return cur;
+	    }
+
+	    count_wheel_hits += 1;
+	    struct event_time_s*cell = new struct event_time_s;
+	    cell->time = time;
+	    sched_wheel_insert_(cell);
+	    return cell;
+      }
+
+	/* Far events get their own cell. If the most recently created
+	   far cell is for the same time, which is common when many
+	   events are scheduled with the same large delay, then reuse
+	   it. It is safe to add events to it because no later cell
+	   for that time can exist yet. */
+      if (sched_far_last && sched_far_last->time == time)
+	    return sched_far_last;
+
+      count_wheel_overflows += 1;
+      struct event_time_s*cell = new struct event_time_s;
+      cell->time = time;
+
+      sched_far_s item;
+      item.time = time;
+      item.seq = sched_far_seq++;
+      item.cell = cell;
+      sched_far.push_back(item);
+      push_heap(sched_far.begin(), sched_far.end());
+      sched_far_last = cell;
+      return cell;
+}
+
+/*
+ * Move the far cells that are now in range of the wheel into the
+ * wheel. This is called after the schedule_time advances.
+ */
+static void sched_promote_far_(void)
+{
+      while (! sched_far.empty()) {
+	    const sched_far_s&top = sched_far.front();
+	    if (top.time - schedule_time >= SCHED_WHEEL_SIZE)
+		  break;
+
+	    count_wheel_promotions += 1;
+	    struct event_time_s*cell = top.cell;
+	    if (cell == sched_far_last)
+		  sched_far_last = 0;
+	    pop_heap(sched_far.begin(), sched_far.end());
+	    sched_far.pop_back();
+	    sched_wheel_insert_(cell);
+      }
+}
+
+/*
+ * Advance the schedule_time to the next time step that has events,
+ * and return the cell for that time step, removed from the wheel. If
+ * there are no future events, return nil.
+ */
+static struct event_time_s* sched_advance_(void)
+{
+      vvp_time64_t next_time;
+
+      if (sched_wheel_count > 0) {
+	      /* Scan the bit map of the wheel starting just after
+		 the current time. The wheel wraps, so the scan may
+		 need to visit the first word twice. */
+	    unsigned slot = (schedule_time + 1) & SCHED_WHEEL_MASK;
+	    unsigned word = slot / SCHED_MAP_BITS;
+	    unsigned long bits = sched_wheel_map[word] & (~0UL << (slot % SCHED_MAP_BITS));
+	    for (unsigned idx = 0 ; bits == 0 ; idx += 1) {
+		  assert(idx < SCHED_MAP_WORDS);
+		  word = (word + 1) % SCHED_MAP_WORDS;
+		  bits = sched_wheel_map[word];
+	    }
+	    slot = word * SCHED_MAP_BITS + sched_wheel_first_bit_(bits);
+	    next_time = sched_wheel[slot]->time;
+
+      } else if (! sched_far.empty()) {
+	    next_time = sched_far.front().time;
+
+      } else {
+	    return 0;
+      }
+
+      assert(next_time > schedule_time);
+      schedule_time = next_time;
+      sched_promote_far_();
+
+      unsigned slot = next_time & SCHED_WHEEL_MASK;
+      struct event_time_s*cell = sched_wheel[slot];
+      assert(cell && cell->time == next_time);
+      sched_wheel[slot] = 0;
+      sched_wheel_map[slot / SCHED_MAP_BITS] &= ~(1UL << (slot % SCHED_MAP_BITS));
+      sched_wheel_count -= 1;
+      return cell;
+}
 
 /*
  * This is a list of initialization events. The setup puts
@@ -670,56 +1168,20 @@ static void schedule_event_(struct event_s*cur, vvp_time64_t delay,
 			    event_queue_t select_queue)
 {
       cur->next = cur;
-      struct event_time_s*ctim = sched_list;
-
-      if (sched_list == 0) {
-	      /* Is the event_time list completely empty? Create the
-		 first event_time object. */
-	    ctim = new struct event_time_s;
-	    ctim->delay = delay;
-	    ctim->next  = 0;
-	    sched_list = ctim;
-
-      } else if (sched_list->delay > delay) {
-
-	      /* Am I looking for an event before the first event_time?
-		 If so, create a new event_time to go in front. */
-	    struct event_time_s*tmp = new struct event_time_s;
-	    tmp->delay = delay;
-	    tmp->next = ctim;
-	    ctim->delay -= delay;
-	    ctim = tmp;
-	    sched_list = ctim;
-
-      } else {
-	    struct event_time_s*prev = 0;
-
-	    while (ctim->next && (ctim->delay < delay)) {
-		  delay -= ctim->delay;
-		  prev = ctim;
-		  ctim = ctim->next;
+      struct event_time_s*ctim;
+
+      if (delay == 0) {
+	      /* Zero delay events go into the current time step,
+		 which may need to be created if we are between time
+		 steps. */
+	    if (sched_now == 0) {
+		  sched_now = new struct event_time_s;
+		  sched_now->time = schedule_time;
 	    }
+	    ctim = sched_now;
 
-	    if (ctim->delay > delay) {
-		  struct event_time_s*tmp = new struct event_time_s;
-		  tmp->delay = delay;
-		  tmp->next  = prev->next;
-		  prev->next = tmp;
-
-		  tmp->next->delay -= delay;
-		  ctim = tmp;
-
-	    } else if (ctim->delay == delay) {
-
-	    } else {
-		  assert(ctim->next == 0);
-		  struct event_time_s*tmp = new struct event_time_s;
-		  tmp->delay = delay - ctim->delay;
-		  tmp->next = 0;
-		  ctim->next = tmp;
-
-		  ctim = tmp;
-	    }
+      } else {
+	    ctim = sched_future_cell_(schedule_time + delay);
       }
 
 	/* By this point, ctim is the event_time structure that is to
@@ -771,12 +1233,12 @@ static void schedule_event_(struct event_s*cur, vvp_time64_t delay,
 
 static void schedule_event_push_(struct event_s*cur)
 {
-      if ((sched_list == 0) || (sched_list->delay > 0)) {
+      if (sched_now == 0) {
 	    schedule_event_(cur, 0, SEQ_ACTIVE);
 	    return;
       }
 
-      struct event_time_s*ctim = sched_list;
+      struct event_time_s*ctim = sched_now;
 
       if (ctim->active == 0) {
 	    cur->next = cur;
@@ -888,7 +1350,7 @@ void schedule_assign_array_word(vvp_array_t mem,
       cur->mem = mem;
       cur->adr = word_addr;
       cur->off = off;
-      cur->val = val;
+      cur->val = EVENT_ADOPT(val);
       schedule_event_(cur, delay, SEQ_NBASSIGN);
 }
 
@@ -904,20 +1366,24 @@ void schedule_assign_array_word(vvp_array_t mem,
       schedule_event_(cur, delay, SEQ_NBASSIGN);
 }
 
-void schedule_set_vector(vvp_net_ptr_t ptr, const vvp_vector4_t&bit)
+void schedule_set_vector(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
+			 bool push_flag)
 {
       struct assign_vector4_event_s*cur = new struct assign_vector4_event_s(bit);
       cur->ptr = ptr;
       cur->base = 0;
       cur->vwid = 0;
-      schedule_event_(cur, 0, SEQ_ACTIVE);
+      if (push_flag)
+	    schedule_event_push_(cur);
+      else
+	    schedule_event_(cur, 0, SEQ_ACTIVE);
 }
 
 void schedule_set_vector(vvp_net_ptr_t ptr, vvp_vector8_t bit)
 {
       struct assign_vector8_event_s*cur = new struct assign_vector8_event_s;
       cur->ptr = ptr;
-      cur->val = bit;
+      cur->val = EVENT_ADOPT(bit);
       schedule_event_(cur, 0, SEQ_ACTIVE);
 }
 
@@ -929,9 +1395,17 @@ void schedule_set_vector(vvp_net_ptr_t ptr, double bit)
       schedule_event_(cur, 0, SEQ_ACTIVE);
 }
 
+void schedule_set_propagate(vvp_net_t*net, const vvp_vector4_t&bit)
+{
+      struct propagate_vector4_event_s*cur = new struct propagate_vector4_event_s(bit);
+      cur->net = net;
+      schedule_event_(cur, 0, SEQ_ACTIVE);
+}
+
 void schedule_init_vector(vvp_net_ptr_t ptr, vvp_vector4_t bit)
 {
-      struct assign_vector4_event_s*cur = new struct assign_vector4_event_s(bit);
+      struct assign_vector4_event_s*cur
+	    = new struct assign_vector4_event_s(EVENT_ADOPT(bit));
       cur->ptr = ptr;
       cur->base = 0;
       cur->vwid = 0;
@@ -942,7 +1416,7 @@ void schedule_init_vector(vvp_net_ptr_t ptr, vvp_vector8_t bit)
 {
       struct assign_vector8_event_s*cur = new struct assign_vector8_event_s;
       cur->ptr = ptr;
-      cur->val = bit;
+      cur->val = EVENT_ADOPT(bit);
       schedule_init_event(cur);
 }
 
@@ -956,8 +1430,17 @@ void schedule_init_vector(vvp_net_ptr_t ptr, double bit)
 
 void schedule_init_propagate(vvp_net_t*net, vvp_vector4_t bit)
 {
-      struct propagate_vector4_event_s*cur = new struct propagate_vector4_event_s(bit);
+      struct propagate_vector4_event_s*cur
+	    = new struct propagate_vector4_event_s(EVENT_ADOPT(bit));
+      cur->net = net;
+      schedule_init_event(cur);
+}
+
+void schedule_init_propagate(vvp_net_t*net, vvp_vector8_t bit)
+{
+      struct propagate_vector8_event_s*cur = new struct propagate_vector8_event_s;
       cur->net = net;
+      cur->val = EVENT_ADOPT(bit);
       schedule_init_event(cur);
 }
 
@@ -1016,7 +1499,6 @@ void schedule_at_start_of_simtime(vvp_gen_event_t obj, vvp_time64_t delay)
       schedule_event_(cur, delay, SEQ_START);
 }
 
-static vvp_time64_t schedule_time;
 vvp_time64_t schedule_simtime(void)
 { return schedule_time; }
 
@@ -1073,6 +1555,175 @@ static void run_rosync(struct event_time_s*ctim)
       }
 }
 
+bool schedule_final_thread(vthread_t thr)
+{
+      if (schedule_final_list == 0)
+	    return false;
+
+      struct event_s*cur = schedule_final_list;
+      do {
+	    cur = cur->next;
+	    vthread_event_s*tev = dynamic_cast<vthread_event_s*>(cur);
+	    if (tev && tev->thr == thr)
+		  return true;
+      } while (cur != schedule_final_list);
+      return false;
+}
+
+/*
+ * The checkpoint holds the future time steps in time order. Each
+ * queue of a time step is a list of events, ended with a 0. The
+ * inactive queue is only used in the current time step, and the
+ * current time step is over when a checkpoint is taken.
+ */
+static const event_queue_t checkpoint_queues[] = {
+      SEQ_START, SEQ_ACTIVE, SEQ_NBASSIGN, SEQ_RWSYNC, SEQ_ROSYNC, DEL_THREAD
+};
+static const unsigned checkpoint_queue_count
+      = sizeof checkpoint_queues / sizeof checkpoint_queues[0];
+
+static struct event_s* checkpoint_queue_(struct event_time_s*cell,
+					 event_queue_t queue)
+{
+      switch (queue) {
+	  case SEQ_START:    return cell->start;
+	  case SEQ_ACTIVE:   return cell->active;
+	  case SEQ_INACTIVE: return cell->inactive;
+	  case SEQ_NBASSIGN: return cell->nbassign;
+	  case SEQ_RWSYNC:   return cell->rwsync;
+	  case SEQ_ROSYNC:   return cell->rosync;
+	  case DEL_THREAD:   return cell->del_thr;
+      }
+      return 0;
+}
+
+void schedule_checkpoint_save(checkpoint_out&out)
+{
+      assert(sched_now == 0);
+
+	// The wheel cells are the only cells for their time, so they
+	// sort ahead of far cells by the sequence number alone.
+      std::vector<sched_far_s> cells (sched_far);
+      for (unsigned slot = 0 ; slot < SCHED_WHEEL_SIZE ; slot += 1) {
+	    if (sched_wheel[slot] == 0)
+		  continue;
+	    sched_far_s item;
+	    item.time = sched_wheel[slot]->time;
+	    item.seq = 0;
+	    item.cell = sched_wheel[slot];
+	    cells.push_back(item);
+      }
+	// The heap order puts the earliest cell last.
+      sort(cells.begin(), cells.end());
+      reverse(cells.begin(), cells.end());
+
+      for (size_t idx = 0 ; idx < cells.size() ; idx += 1) {
+	    struct event_time_s*cell = cells[idx].cell;
+	    assert(cell->inactive == 0);
+	    out.put_uint(1);
+	    out.put_uint(cell->time);
+	    for (unsigned qdx = 0 ; qdx < checkpoint_queue_count ; qdx += 1) {
+		  struct event_s*last = checkpoint_queue_(cell, checkpoint_queues[qdx]);
+		  if (last) {
+			struct event_s*cur = last;
+			do {
+			      cur = cur->next;
+			      cur->checkpoint_save(out);
+			} while (cur != last);
+		  }
+		  out.put_uint(0);
+		  if (out.refused())
+			return;
+	    }
+      }
+}
+
+static struct event_s* checkpoint_load_event_(checkpoint_in&in, uint64_t kind)
+{
+      switch (kind) {
+	  case CKPT_EV_THREAD: {
+		struct vthread_event_s*cur = new vthread_event_s;
+		cur->thr = in.get_thread();
+		if (cur->thr == 0)
+		      in.corrupt("scheduled thread is missing");
+		vthread_mark_scheduled(cur->thr);
+		return cur;
+	  }
+	  case CKPT_EV_ASSIGN4: {
+		vvp_net_t*net = in.get_net();
+		unsigned port = in.get_uint();
+		struct assign_vector4_event_s*cur
+		      = new assign_vector4_event_s(in.get_vec4());
+		cur->ptr = vvp_net_ptr_t(net, port & 3);
+		cur->base = in.get_uint();
+		cur->vwid = in.get_uint();
+		return cur;
+	  }
+	  case CKPT_EV_ASSIGN_REAL: {
+		vvp_net_t*net = in.get_net();
+		unsigned port = in.get_uint();
+		struct assign_real_event_s*cur = new assign_real_event_s;
+		cur->ptr = vvp_net_ptr_t(net, port & 3);
+		cur->val = in.get_real();
+		return cur;
+	  }
+	  case CKPT_EV_ARRAY_WORD: {
+		vvp_array_t mem = array_checkpoint_get(in);
+		unsigned adr = in.get_uint();
+		struct assign_array_word_s*cur = new assign_array_word_s;
+		cur->mem = mem;
+		cur->adr = adr;
+		cur->val = in.get_vec4();
+		cur->off = in.get_uint();
+		return cur;
+	  }
+	  case CKPT_EV_ARRAY_R_WORD: {
+		struct assign_array_r_word_s*cur = new assign_array_r_word_s;
+		cur->mem = array_checkpoint_get(in);
+		cur->adr = in.get_uint();
+		cur->val = in.get_real();
+		return cur;
+	  }
+	  case CKPT_EV_FUNCTOR: {
+		struct generic_event_s*cur = new generic_event_s;
+		cur->obj = delay_checkpoint_event(in);
+		cur->delete_obj_when_done = false;
+		return cur;
+	  }
+	  case CKPT_EV_FORCE4: {
+		vvp_net_t*net = in.get_net();
+		struct force_vector4_event_s*cur
+		      = new force_vector4_event_s(in.get_vec4());
+		cur->net = net;
+		cur->base = in.get_uint();
+		cur->vwid = in.get_uint();
+		if (net == 0 || cur->base > cur->vwid)
+		      in.corrupt("scheduled force does not fit the net");
+		return cur;
+	  }
+	  default:
+	    in.corrupt("unknown event record");
+	    return 0;
+      }
+}
+
+void schedule_checkpoint_load(checkpoint_in&in)
+{
+      while (in.get_uint()) {
+	    vvp_time64_t time = in.get_uint();
+	    if (time <= schedule_time)
+		  in.corrupt("event time is not in the future");
+
+	    for (unsigned qdx = 0 ; qdx < checkpoint_queue_count ; qdx += 1) {
+		  while (uint64_t kind = in.get_uint()) {
+			struct event_s*cur = checkpoint_load_event_(in, kind);
+			schedule_event_(cur, time - schedule_time,
+					checkpoint_queues[qdx]);
+		  }
+	    }
+      }
+}
+
 void schedule_simulate(void)
 {
       bool run_finals;
@@ -1091,6 +1742,14 @@ void schedule_simulate(void)
 	    vpi_mcd_printf(1, " ...propagate initialization events\n");
       }
 
+	// When restoring a checkpoint, put back the state of the
+	// functors first, so that the initialization events of the
+	// functors propagate the saved outputs after their defaults.
+      if (checkpoint_restoring) {
+	    schedule_time = checkpoint_restore_functors();
+	    if (sched_now) sched_now->time = schedule_time;
+      }
+
 	// Execute initialization events.
       while (schedule_init_list) {
 	    struct event_s*cur = schedule_init_list->next;
@@ -1103,6 +1762,40 @@ void schedule_simulate(void)
 	    delete cur;
       }
 
+	// When restoring a checkpoint, put back the saved values and
+	// let them propagate through the nets. The events that the
+	// propagation causes in the current time step settle before
+	// the threads are put back, so that threads waiting on edges
+	// are not woken by the restore itself.
+      if (checkpoint_restoring) {
+	    checkpoint_restore_values();
+	    while (schedule_init_list) {
+		  struct event_s*cur = schedule_init_list->next;
+		  if (cur->next == cur) {
+			schedule_init_list = 0;
+		  } else {
+			schedule_init_list->next = cur->next;
+		  }
+		  cur->run_run();
+		  delete cur;
+	    }
+	    while (struct event_time_s*ctim = sched_now) {
+		  struct event_s**q = ctim->active? &ctim->active
+			: ctim->inactive? &ctim->inactive
+			: ctim->nbassign? &ctim->nbassign : 0;
+		  if (q == 0)
+			break;
+		  struct event_s*cur = (*q)->next;
+		  if (cur->next == cur)
+			*q = 0;
+		  else
+			(*q)->next = cur->next;
+		  cur->run_run();
+		  delete cur;
+	    }
+	    checkpoint_restore_threads();
+      }
+
       if (verbose_flag) {
 	    vpi_mcd_printf(1, " ...execute StartOfSim callbacks\n");
       }
@@ -1122,7 +1815,8 @@ void schedule_simulate(void)
       // process events and when done run the final blocks.
       run_finals = schedule_runnable;
 
-      if (schedule_runnable) while (sched_list) {
+      if (schedule_runnable) while (sched_now || sched_wheel_count
+				     || ! sched_far.empty()) {
 
 	    if (schedule_stopped_flag) {
 		  schedule_stopped_flag = false;
@@ -1133,21 +1827,22 @@ void schedule_simulate(void)
 	    }
 
 	      /* ctim is the current time step. */
-	    struct event_time_s* ctim = sched_list;
+	    struct event_time_s* ctim = sched_now;
 
 	      /* If the time is advancing, then first run the
 		 postponed sync events. Run them all. */
-	    if (ctim->delay > 0) {
+	    if (ctim == 0) {
 
 		  if (!schedule_runnable) break;
-		  schedule_time += ctim->delay;
+		  ctim = sched_advance_();
+		  assert(ctim);
+		  sched_now = ctim;
 		    /* When the design is being traced (we are emitting
 		     * file/line information) also print any time changes. */
 		  if (show_file_line) {
 			cerr << "Advancing to simulation time: "
 			     << schedule_time << endl;
 		  }
-		  ctim->delay = 0;
 
 		  vpiNextSimTime();
 		    // Process the cbAtStartOfSimTime callbacks.
@@ -1184,8 +1879,10 @@ void schedule_simulate(void)
 				   deletes threads as needed. */
 			      if (ctim->active == 0) {
 				    run_rosync(ctim);
-				    sched_list = ctim->next;
+				    sched_now = 0;
 				    delete ctim;
+				    if (checkpoint_save_pending)
+					  checkpoint_service();
 				    continue;
 			      }
 			}
@@ -1213,6 +1910,15 @@ void schedule_simulate(void)
 	    delete (cur);
       }
 
+	// If asked to, release the idle event memory before the final
+	// blocks and the end of simulation callbacks run.
+      if (getenv("VVP_TRIM_POOLS")) {
+	    size_t trimmed = schedule_trim_pools();
+	    if (verbose_flag)
+		  vpi_mcd_printf(1, " ...trimmed %zu bytes of idle event pools\n",
+				 trimmed);
+      }
+
 	// Execute final events.
       schedule_runnable = run_finals;
       while (schedule_runnable && schedule_final_list) {
@@ -1242,13 +1948,9 @@ void schedule_simulate(void)
 #ifdef CHECK_WITH_VALGRIND
 void schedule_delete(void)
 {
-      vthread_event_heap.delete_pool();
-      assign4_heap.delete_pool();
-      assign8_heap.delete_pool();
-      assignr_heap.delete_pool();
-      array_w_heap.delete_pool();
-      array_r_w_heap.delete_pool();
-      generic_event_heap.delete_pool();
+      event_small_heap.delete_pool();
+      event_medium_heap.delete_pool();
+      event_large_heap.delete_pool();
       event_time_heap.delete_pool();
 }
 #endif
@@ -82,12 +82,23 @@ extern void schedule_propagate_vector(vvp_net_t*ptr,
  * This is very similar to schedule_assign_vector, but generates an
  * event in the active queue. It is used at link time to assign a
  * constant value (i.e. C4<...>) to the input of a functor. This
- * creates an event in the active queue.
+ * creates an event in the active queue. If the push_flag is true, the
+ * event goes in front of the events that are already there, such as
+ * the threads that start at time 0.
  */
-extern void schedule_set_vector(vvp_net_ptr_t ptr, const vvp_vector4_t&val);
+extern void schedule_set_vector(vvp_net_ptr_t ptr, const vvp_vector4_t&val,
+				bool push_flag =false);
 extern void schedule_set_vector(vvp_net_ptr_t ptr, vvp_vector8_t val);
 extern void schedule_set_vector(vvp_net_ptr_t ptr, double val);
 
+/*
+ * The schedule_set_propagate function is similar to the above but
+ * propagates a value from a net output (i.e. without passing through
+ * the net functor). It is used at link time to send the output of a
+ * functor whose inputs are all constant.
+ */
+extern void schedule_set_propagate(vvp_net_t*net, const vvp_vector4_t&val);
+
 /*
  * Create a T0 event for always_comb/latch processes. This is the first
  * event in the first inactive region.
@@ -113,6 +124,7 @@ extern void schedule_init_vector(vvp_net_ptr_t ptr, double val);
  * through the net functor).
  */
 extern void schedule_init_propagate(vvp_net_t*net, vvp_vector4_t val);
+extern void schedule_init_propagate(vvp_net_t*net, vvp_vector8_t val);
 extern void schedule_init_propagate(vvp_net_t*net, double val);
 
 /*
@@ -157,6 +169,10 @@ struct vvp_gen_event_s
       virtual ~vvp_gen_event_s() =0;
       virtual void run_run() =0;
       virtual void single_step_display(void);
+	// A checkpoint saves a scheduled generic event as the net of
+	// the functor that the event runs. Return nil to leave the
+	// event out of the checkpoint. The default refuses the save.
+      virtual vvp_net_t* checkpoint_net(checkpoint_out&out);
 };
 
 /*
@@ -166,9 +182,9 @@ struct vvp_gen_event_s
 extern void schedule_simulate(void);
 
 /*
- * Get the current absolute simulation time. This is not used
- * internally by the scheduler (which uses time differences instead)
- * but is used for printouts and stuff.
+ * Get the current absolute simulation time. The scheduler keeps its
+ * future time steps by absolute time, and this is also used for
+ * printouts and stuff.
  */
 extern vvp_time64_t schedule_simtime(void);
 
@@ -22,6 +22,8 @@
 
 
 # include  "config.h"
+# include  <vector>
+# include  <algorithm>
 
 template <size_t SLAB_SIZE, size_t CHUNK_COUNT> class slab_t {
 
@@ -35,6 +37,13 @@ template <size_t SLAB_SIZE, size_t CHUNK_COUNT> class slab_t {
 
       void* alloc_slab();
       void  free_slab(void*);
+
+	// Release the allocated chunks that have no cells in use back
+	// to the C++ heap. Return the number of bytes released.
+      size_t trim();
+	// The number of bytes in the allocated chunks.
+      size_t chunk_bytes() const
+      { return chunks_.size() * CHUNK_COUNT * sizeof(item_cell_u); }
 #ifdef CHECK_WITH_VALGRIND
 	// If we have allocated memory then we need to delete it to make
 	// valgrind happy.
@@ -46,11 +55,8 @@ template <size_t SLAB_SIZE, size_t CHUNK_COUNT> class slab_t {
     private:
       item_cell_u*heap_;
       item_cell_u initial_chunk_[CHUNK_COUNT];
-#ifdef CHECK_WITH_VALGRIND
-	// Each slab needs a pointer to the allocated space.
-      item_cell_u**slab_pool;
-      unsigned slab_pool_count;
-#endif
+	// The chunks allocated after the initial chunk.
+      std::vector<item_cell_u*> chunks_;
 };
 
 template <size_t SLAB_SIZE, size_t CHUNK_COUNT>
@@ -62,11 +68,6 @@ slab_t<SLAB_SIZE,CHUNK_COUNT>::slab_t()
 	    initial_chunk_[idx].next = initial_chunk_+idx+1;
 
       initial_chunk_[CHUNK_COUNT-1].next = 0;
-#ifdef CHECK_WITH_VALGRIND
-	// Initially we have no allocated space.
-      slab_pool = NULL;
-      slab_pool_count = 0;
-#endif
 }
 
 template <size_t SLAB_SIZE, size_t CHUNK_COUNT>
@@ -74,12 +75,7 @@ inline void* slab_t<SLAB_SIZE,CHUNK_COUNT>::alloc_slab()
 {
       if (heap_ == 0) {
 	    item_cell_u*chunk = new item_cell_u[CHUNK_COUNT];
-#ifdef CHECK_WITH_VALGRIND
-	    slab_pool_count += 1;
-	    slab_pool = (item_cell_u **) realloc(slab_pool,
-	                slab_pool_count*sizeof(item_cell_u **));
-	    slab_pool[slab_pool_count-1] = chunk;
-#endif
+	    chunks_.push_back(chunk);
 	    for (unsigned idx = 0 ; idx < CHUNK_COUNT ; idx += 1) {
 		  chunk[idx].next = heap_;
 		  heap_ = chunk+idx;
@@ -100,16 +96,68 @@ inline void slab_t<SLAB_SIZE,CHUNK_COUNT>::free_slab(void*ptr)
       heap_ = cur;
 }
 
+/*
+ * A chunk is idle if all its cells are on the free list. Count the
+ * free cells of each chunk, then rebuild the free list without the
+ * cells of the idle chunks and delete those chunks. The initial chunk
+ * is part of the slab object and is always kept.
+ */
+template <size_t SLAB_SIZE, size_t CHUNK_COUNT>
+size_t slab_t<SLAB_SIZE,CHUNK_COUNT>::trim()
+{
+      if (chunks_.empty())
+	    return 0;
+
+      std::sort(chunks_.begin(), chunks_.end());
+      std::vector<size_t> free_count (chunks_.size(), 0);
+      std::vector<size_t> cell_chunk;
+
+      for (item_cell_u*cur = heap_ ; cur ; cur = cur->next) {
+	    size_t idx = std::upper_bound(chunks_.begin(), chunks_.end(), cur)
+		  - chunks_.begin();
+	    if (idx > 0 && cur < chunks_[idx-1]+CHUNK_COUNT) {
+		  free_count[idx-1] += 1;
+		  cell_chunk.push_back(idx-1);
+	    } else {
+		  cell_chunk.push_back(chunks_.size());
+	    }
+      }
+
+      item_cell_u**tail = &heap_;
+      size_t cnt = 0;
+      for (item_cell_u*cur = heap_ ; cur ; cur = cur->next, cnt += 1) {
+	    size_t idx = cell_chunk[cnt];
+	    if (idx < chunks_.size() && free_count[idx] == CHUNK_COUNT)
+		  continue;
+	    *tail = cur;
+	    tail = &cur->next;
+      }
+      *tail = 0;
+
+      size_t released = 0;
+      size_t keep = 0;
+      for (size_t idx = 0 ; idx < chunks_.size() ; idx += 1) {
+	    if (free_count[idx] == CHUNK_COUNT) {
+		  delete[] chunks_[idx];
+		  pool -= CHUNK_COUNT;
+		  released += CHUNK_COUNT * sizeof(item_cell_u);
+	    } else {
+		  chunks_[keep++] = chunks_[idx];
+	    }
+      }
+      chunks_.resize(keep);
+
+      return released;
+}
+
 #ifdef CHECK_WITH_VALGRIND
 template <size_t SLAB_SIZE, size_t CHUNK_COUNT>
 inline void slab_t<SLAB_SIZE,CHUNK_COUNT>::delete_pool(void)
 {
-      for (unsigned idx = 0; idx < slab_pool_count; idx += 1) {
-	    delete [] slab_pool[idx];
+      for (unsigned idx = 0; idx < chunks_.size(); idx += 1) {
+	    delete [] chunks_[idx];
       }
-      free(slab_pool);
-      slab_pool = NULL;
-      slab_pool_count = 0;
+      std::vector<item_cell_u*>().swap(chunks_);
 }
 #endif
 
@@ -23,12 +23,32 @@
  * This is a count of the instruction opcodes that were created.
  */
 unsigned long count_opcodes = 0;
+/*
+ * This is a count of the opcodes that were replaced with a
+ * superinstruction.
+ */
+unsigned long count_opcodes_fused = 0;
+/*
+ * These are counts of the opcodes whose operand was resolved to its
+ * type when the design was linked, and of those that still look up
+ * the type of their operand each time they run.
+ */
+unsigned long count_opcodes_bound = 0;
+unsigned long count_opcodes_dynamic = 0;
 
 unsigned long count_functors = 0;
 unsigned long count_functors_logic = 0;
 unsigned long count_functors_bufif = 0;
 unsigned long count_functors_resolv= 0;
 unsigned long count_functors_sig   = 0;
+/*
+ * These are counts of the logic functors that were evaluated at load
+ * time because their inputs are constant, and of those that were
+ * removed because they drive nothing or only repeat a buf.
+ */
+unsigned long count_functors_folded = 0;
+unsigned long count_functors_pruned = 0;
+unsigned long count_functors_merged = 0;
 
 unsigned long count_filters = 0;
 unsigned long count_vpi_nets = 0;
@@ -27,11 +27,19 @@
 #endif
 
 extern unsigned long count_opcodes;
+extern unsigned long count_opcodes_fused;
+extern unsigned long count_opcodes_bound;
+extern unsigned long count_opcodes_dynamic;
+extern unsigned long count_opcodes_run;
+extern unsigned long count_opcodes_fused_run;
 extern unsigned long count_functors;
 extern unsigned long count_functors_logic;
 extern unsigned long count_functors_bufif;
 extern unsigned long count_functors_resolv;
 extern unsigned long count_functors_sig;
+extern unsigned long count_functors_folded;
+extern unsigned long count_functors_pruned;
+extern unsigned long count_functors_merged;
 extern unsigned long count_filters;
 extern unsigned long count_vvp_nets;
 extern unsigned long count_vpi_nets;
@@ -41,22 +49,39 @@ extern unsigned long count_net_arrays;
 extern unsigned long count_net_array_words;
 extern unsigned long count_var_arrays;
 extern unsigned long count_var_array_words;
+extern unsigned long count_var_arrays_sparse;
+extern unsigned long count_var_arrays_packed;
 extern unsigned long count_real_arrays;
 extern unsigned long count_real_array_words;
 
 
+extern unsigned long count_threads;
+extern unsigned long count_threads_live;
+extern unsigned long count_threads_peak;
+extern unsigned long count_threads_reused;
+extern unsigned long count_thread_peak(void);
+
 extern unsigned long count_time_events;
 extern unsigned long count_time_pool(void);
+extern unsigned long count_wheel_hits;
+extern unsigned long count_wheel_overflows;
+extern unsigned long count_wheel_promotions;
 
 extern unsigned long count_assign_events;
-extern unsigned long count_assign4_pool(void);
-extern unsigned long count_assign8_pool(void);
-extern unsigned long count_assign_real_pool(void);
-extern unsigned long count_assign_aword_pool(void);
-extern unsigned long count_assign_arword_pool(void);
+extern unsigned long count_assign4_peak(void);
+extern unsigned long count_assign8_peak(void);
+extern unsigned long count_assign_real_peak(void);
+extern unsigned long count_assign_aword_peak(void);
+extern unsigned long count_assign_arword_peak(void);
+extern unsigned long count_force4_peak(void);
+extern unsigned long count_propagate4_peak(void);
+extern unsigned long count_propagate_real_peak(void);
 
 extern unsigned long count_gen_events;
-extern unsigned long count_gen_pool(void);
+extern unsigned long count_gen_peak(void);
+
+  // The bytes of event memory allocated beyond the initial slabs.
+extern size_t size_event_pool(void);
 
 extern size_t size_opcodes;
 extern size_t size_vvp_nets;
@@ -22,6 +22,7 @@
 
 #include "udp.h"
 #include "schedule.h"
+#include "checkpoint.h"
 #include "symbols.h"
 #include "compile.h"
 #include "config.h"
@@ -74,6 +75,50 @@ struct vvp_udp_s *udp_find(const char *label)
       return (struct vvp_udp_s *)v.ptr;
 }
 
+/*
+ * The largest dense table, in entries, that is made for a UDP. This
+ * allows a combinational UDP with up to 8 inputs and a sequential UDP
+ * with up to 5 inputs.
+ */
+static const unsigned long udp_dense_limit = 1UL << 17;
+
+/*
+ * Return the number of entries in a dense table that has scale
+ * entries for each of the 2**bits states, or 0 if that is more than
+ * the limit.
+ */
+static unsigned long dense_size(unsigned bits, unsigned long scale)
+{
+      unsigned long size = scale;
+      for (unsigned idx = 0 ;  idx < bits ;  idx += 1) {
+	    size *= 2;
+	    if (size > udp_dense_limit)
+		  return 0;
+      }
+      return size;
+}
+
+static inline unsigned long dense_index(const udp_levels_table&cur,
+					unsigned ports)
+{
+      return cur.mask1 | (cur.maskx << ports);
+}
+
+/*
+ * Make the levels table for the dense index of a state. The index has
+ * a bit position that is both 1 and x if the state is impossible, and
+ * this returns false.
+ */
+static bool dense_state(udp_levels_table&cur, unsigned long idx,
+			unsigned ports)
+{
+      unsigned long port_mask = ~(-1UL << ports);
+      cur.mask1 = idx & port_mask;
+      cur.maskx = (idx >> ports) & port_mask;
+      cur.mask0 = port_mask & ~(cur.mask1 | cur.maskx);
+      return (cur.mask1 & cur.maskx) == 0;
+}
+
 ostream& operator <<(ostream&o, const struct udp_levels_table&table)
 {
       o << "[" << hex << table.mask0
@@ -125,12 +170,14 @@ vvp_udp_comb_s::vvp_udp_comb_s(char*label, char*name__, unsigned ports)
       levels1_ = 0;
       nlevels0_ = 0;
       nlevels1_ = 0;
+      dense_ = 0;
 }
 
 vvp_udp_comb_s::~vvp_udp_comb_s()
 {
       delete[] levels0_;
       delete[] levels1_;
+      delete[] dense_;
 }
 
 /*
@@ -188,9 +235,33 @@ vvp_bit4_t vvp_udp_comb_s::calculate_output(const udp_levels_table&cur,
 					    const udp_levels_table&,
 					    vvp_bit4_t)
 {
+      if (dense_)
+	    return (vvp_bit4_t) dense_[dense_index(cur, port_count())];
+
       return test_levels(cur);
 }
 
+/*
+ * The dense table of a combinational UDP has an entry for each state
+ * of the inputs.
+ */
+void vvp_udp_comb_s::compile_dense_()
+{
+      unsigned ports = port_count();
+      unsigned long size = dense_size(2*ports, 1);
+      if (size == 0)
+	    return;
+
+      dense_ = new unsigned char[size];
+      for (unsigned long idx = 0 ;  idx < size ;  idx += 1) {
+	    udp_levels_table cur;
+	    if (dense_state(cur, idx, ports))
+		  dense_[idx] = test_levels(cur);
+	    else
+		  dense_[idx] = BIT4_X;
+      }
+}
+
 static void or_based_on_char(udp_levels_table&cur, char flag,
 			     unsigned long mask_bit)
 {
@@ -290,6 +361,8 @@ void vvp_udp_comb_s::compile_table(char**tab)
 
       assert(nrows0 == nlevels0_);
       assert(nrows1 == nlevels1_);
+
+      compile_dense_();
 }
 
 vvp_udp_seq_s::vvp_udp_seq_s(char*label, char*name__,
@@ -313,6 +386,8 @@ vvp_udp_seq_s::vvp_udp_seq_s(char*label, char*name__,
       nedges0_ = 0;
       nedges1_ = 0;
       nedgesL_ = 0;
+
+      dense_ = 0;
 }
 
 vvp_udp_seq_s::~vvp_udp_seq_s()
@@ -324,6 +399,7 @@ vvp_udp_seq_s::~vvp_udp_seq_s()
       delete[] edges0_;
       delete[] edges1_;
       delete[] edgesL_;
+      delete[] dense_;
 }
 
 void edge_based_on_char(struct udp_edges_table&cur, char chr, unsigned pos)
@@ -670,6 +746,7 @@ void vvp_udp_seq_s::compile_table(char**tab)
       assert(idx_edg1 == nedges1_);
       assert(idx_edgL == nedgesL_);
 
+      compile_dense_();
 }
 
 bool operator == (const udp_levels_table&a, const udp_levels_table&b)
@@ -683,6 +760,20 @@ bool operator == (const udp_levels_table&a, const udp_levels_table&b)
       return true;
 }
 
+/*
+ * The inputs of a UDP change one at a time, so the next output of a
+ * sequential UDP is a function of the current inputs, the current
+ * output, the input that changed and the previous value of that
+ * input. The dense table has an entry for each. The input states are
+ * the low 2*N bits of the index, then come 2 bits of the current
+ * output, 2 bits of the previous input value and the input number.
+ */
+static inline unsigned long dense_code(unsigned long mask1,
+				       unsigned long maskx, unsigned pos)
+{
+      return ((mask1 >> pos) & 1) | (((maskx >> pos) & 1) << 1);
+}
+
 vvp_bit4_t vvp_udp_seq_s::calculate_output(const udp_levels_table&cur,
 					   const udp_levels_table&prev,
 					   vvp_bit4_t cur_out)
@@ -690,6 +781,91 @@ vvp_bit4_t vvp_udp_seq_s::calculate_output(const udp_levels_table&cur,
       if (cur == prev)
 	    return cur_out;
 
+      if (dense_) {
+	    unsigned ports = port_count();
+	    unsigned long edge_mask = (cur.mask0 ^ prev.mask0)
+		  | (cur.mask1 ^ prev.mask1) | (cur.maskx ^ prev.maskx);
+	    unsigned edge_position = 0;
+	    while ((edge_mask&1) == 0) {
+		  edge_mask >>= 1;
+		  edge_position += 1;
+	    }
+
+	    unsigned long key = edge_position*4
+		  + dense_code(prev.mask1, prev.maskx, edge_position);
+	    switch (cur_out) {
+		case BIT4_0:
+		  key = key*4 + 0;
+		  break;
+		case BIT4_1:
+		  key = key*4 + 1;
+		  break;
+		default:
+		  key = key*4 + 2;
+		  break;
+	    }
+	    return (vvp_bit4_t) dense_[(key << 2*ports) | dense_index(cur, ports)];
+      }
+
+      return search_output_(cur, prev, cur_out);
+}
+
+void vvp_udp_seq_s::compile_dense_()
+{
+      unsigned ports = port_count();
+      unsigned long states = dense_size(2*ports, 1);
+      unsigned long size = dense_size(2*ports, 16*ports);
+      if (size == 0)
+	    return;
+
+      static const vvp_bit4_t out_bits[3] = { BIT4_0, BIT4_1, BIT4_X };
+
+      dense_ = new unsigned char[size];
+      memset(dense_, BIT4_X, size);
+      for (unsigned pos = 0 ;  pos < ports ;  pos += 1) {
+	    unsigned long pos_mask = 1UL << pos;
+	    for (unsigned from = 0 ;  from < 3 ;  from += 1) {
+		  for (unsigned out = 0 ;  out < 3 ;  out += 1) {
+			unsigned long key = (pos*4 + from)*4 + out;
+			unsigned char*row = dense_ + key*states;
+			for (unsigned long idx = 0 ;  idx < states ;  idx += 1) {
+			      udp_levels_table cur, prev;
+			      if (! dense_state(cur, idx, ports))
+				    continue;
+
+			      prev = cur;
+			      prev.mask0 &= ~pos_mask;
+			      prev.mask1 &= ~pos_mask;
+			      prev.maskx &= ~pos_mask;
+			      switch (from) {
+				  case 0:
+				    prev.mask0 |= pos_mask;
+				    break;
+				  case 1:
+				    prev.mask1 |= pos_mask;
+				    break;
+				  default:
+				    prev.maskx |= pos_mask;
+				    break;
+			      }
+
+			      row[idx] = search_output_(cur, prev, out_bits[out]);
+			}
+		  }
+	    }
+      }
+}
+
+/*
+ * Calculate the next output by searching the rows of the device.
+ */
+vvp_bit4_t vvp_udp_seq_s::search_output_(const udp_levels_table&cur,
+					 const udp_levels_table&prev,
+					 vvp_bit4_t cur_out)
+{
+      if (cur == prev)
+	    return cur_out;
+
       udp_levels_table cur_tmp = cur;
 
       unsigned long mask_out = 1UL << port_count();
@@ -962,6 +1138,32 @@ void vvp_udp_fun_core::recv_vec4_from_inputs(unsigned port)
       schedule_functor(this);
 }
 
+bool vvp_udp_fun_core::checkpoint_save(checkpoint_out&out)
+{
+      if (! sequential())
+	    return false;
+
+      out.put_uint(cur_out_);
+      out.put_uint(current_.mask0);
+      out.put_uint(current_.mask1);
+      out.put_uint(current_.maskx);
+      return true;
+}
+
+void vvp_udp_fun_core::checkpoint_load(checkpoint_in&in, vvp_net_t*net)
+{
+      if (! sequential())
+	    in.corrupt("state for a combinational UDP");
+
+      cur_out_ = (vvp_bit4_t) (in.get_uint() & 3);
+      current_.mask0 = in.get_uint();
+      current_.mask1 = in.get_uint();
+      current_.maskx = in.get_uint();
+
+      vvp_vector4_t tmp (1);
+      tmp.set_bit(0, cur_out_);
+      schedule_init_propagate(net, tmp);
+}
 
 /*
  * This function is called by the parser in response to a .udp
@@ -104,6 +104,16 @@ struct vvp_udp_s {
  * Only 0, 1 and x characters are allowed in the output position.
  */
 
+/*
+ * Searching the rows for every input change is slow for devices with
+ * many rows, so when the tables are compiled the rows are also
+ * evaluated for every possible input state and the results saved in a
+ * dense table. The dense table is indexed by the mask1 and maskx bits
+ * of the current state, so a bit position that is neither 1 nor x is
+ * a 0. The table has 4**N entries for an N input device, so it is
+ * only made for small devices. Larger devices search the rows.
+ */
+
 struct udp_levels_table {
       unsigned long mask0;
       unsigned long mask1;
@@ -127,10 +137,16 @@ class vvp_udp_comb_s : public vvp_udp_s {
 				  vvp_bit4_t cur_out);
 
     private:
+      void compile_dense_();
+
 	// Level sensitive rows of the device.
       struct udp_levels_table*levels0_;
       struct udp_levels_table*levels1_;
       unsigned nlevels0_, nlevels1_;
+
+	// Output for every input state, or nil if the device has too
+	// many inputs for a dense table.
+      unsigned char*dense_;
 };
 
 /*
@@ -208,6 +224,15 @@ class vvp_udp_seq_s : public vvp_udp_s {
       struct udp_edges_table*edgesL_;
       unsigned nedges0_, nedges1_, nedgesL_;
 
+      vvp_bit4_t search_output_(const udp_levels_table&cur,
+				const udp_levels_table&prev,
+				vvp_bit4_t cur_out);
+      void compile_dense_();
+
+	// Next output for every input state, current output and
+	// single input edge, or nil if the device has too many inputs
+	// for a dense table.
+      unsigned char*dense_;
 };
 
 /*
@@ -230,6 +255,13 @@ class vvp_udp_fun_core  : public vvp_wide_fun_core, private vvp_gen_event_s {
 
       void recv_vec4_from_inputs(unsigned);
 
+      bool sequential() const { return def_->is_sequential(); }
+
+	// A sequential UDP saves its output and inputs. The output of
+	// a combinational UDP follows from the inputs.
+      bool checkpoint_save(checkpoint_out&out);
+      void checkpoint_load(checkpoint_in&in, vvp_net_t*net);
+
     private:
       void run_run();
 
@@ -30,11 +30,18 @@
 # include  "schedule.h"
 # include  "event.h"
 # include  "vvp_net_sig.h"
+# include  "checkpoint.h"
 # include  "config.h"
+# include  "ivl_dlfcn.h"
 #ifdef CHECK_WITH_VALGRIND
 #include  "vvp_cleanup.h"
 #endif
 # include  <cstdio>
+# include  <cstring>
+# include  <map>
+# include  <set>
+# include  <string>
+# include  <vector>
 # include  <cassert>
 # include  <cstdlib>
 /*
@@ -61,11 +68,16 @@ struct sync_cb  : public vvp_gen_event_s {
       ~sync_cb () { }
 
       virtual void run_run();
+      vvp_net_t* checkpoint_net(checkpoint_out&out);
 };
 
+  // This becomes true once the StartOfSimulation callbacks are done.
+static bool callbacks_at_runtime = false;
+
 inline __vpiCallback::__vpiCallback()
 {
       next = 0;
+      runtime = callbacks_at_runtime;
 }
 
 __vpiCallback::~__vpiCallback()
@@ -76,8 +88,12 @@ int __vpiCallback::get_type_code(void) const
 { return vpiCallback; }
 
 
+  // All the value change callbacks that have not been reaped.
+static std::set<value_callback*> value_callbacks;
+
 value_callback::value_callback(p_cb_data data)
 {
+      value_callbacks.insert(this);
       cb_data = *data;
       if (data->time) {
 	    cb_time = *(data->time);
@@ -93,6 +109,11 @@ value_callback::value_callback(p_cb_data data)
       cb_data.value = &cb_value;
 }
 
+value_callback::~value_callback()
+{
+      value_callbacks.erase(this);
+}
+
 /*
  * Normally, any assign to a value triggers a value change callback,
  * so return a constant true here. This is a stub.
@@ -325,6 +346,27 @@ void sync_cb::run_run()
       delete cur;
 }
 
+static bool module_saves_state(const void*addr);
+
+/*
+ * A scheduled callback of a module that saves its state is left out
+ * of a checkpoint, because the module registers it again when it is
+ * restarted. Other callbacks cannot be saved.
+ */
+vvp_net_t* sync_cb::checkpoint_net(checkpoint_out&out)
+{
+      if (handle == 0 || handle->cb_data.cb_rtn == 0)
+	    return 0;
+
+      const void*addr = reinterpret_cast<const void*>(handle->cb_data.cb_rtn);
+      if (! module_saves_state(addr)) {
+	    const char*name = ivl_dlmodule(addr);
+	    out.refuse("a VPI callback of %s is scheduled",
+		       name? name : "an unknown module");
+      }
+      return 0;
+}
+
 static sync_callback* make_sync(p_cb_data data, bool readonly_flag)
 {
       sync_callback*obj = new sync_callback(data);
@@ -410,6 +452,22 @@ static simulator_callback*EndOfCompile = 0;
 static simulator_callback*StartOfSimulation = 0;
 static simulator_callback*EndOfSimulation = 0;
 
+/*
+ * The save and restart callbacks are kept in the order that they are
+ * registered, and they are not used up. The position (plus one) of a
+ * cbStartOfSave or cbStartOfRestart callback in its list is its
+ * vpiSaveRestartID. The modules are loaded in the same order when a
+ * checkpoint is restored, so each module gets its own data back.
+ */
+static std::vector<simulator_callback*> StartOfSave;
+static std::vector<simulator_callback*> EndOfSave;
+static std::vector<simulator_callback*> StartOfRestart;
+static std::vector<simulator_callback*> EndOfRestart;
+
+static PLI_INT32 save_restart_id = 0;
+static std::map<PLI_INT32,std::string> save_restart_data;
+static std::map<PLI_INT32,size_t> restart_data_pos;
+
 #ifdef CHECK_WITH_VALGRIND
 /* This is really only needed if the simulator aborts before starting the
  * main event loop. For that reason we can skip the next sim time queue. */
@@ -478,6 +536,7 @@ void vpiStartOfSim(void) {
       }
 
       vpi_mode_flag = VPI_MODE_NONE;
+      callbacks_at_runtime = true;
 }
 
 void vpiPostsim(void) {
@@ -527,8 +586,21 @@ static simulator_callback* make_prepost(p_cb_data data)
 {
       simulator_callback*obj = new simulator_callback(data);
 
-      /* Insert at head of list */
+      /* Insert at head of list. The save and restart callbacks keep
+         the order of registration (see StartOfSave). */
       switch (data->reason) {
+	  case cbStartOfSave:
+	    StartOfSave.push_back(obj);
+	    break;
+	  case cbEndOfSave:
+	    EndOfSave.push_back(obj);
+	    break;
+	  case cbStartOfRestart:
+	    StartOfRestart.push_back(obj);
+	    break;
+	  case cbEndOfRestart:
+	    EndOfRestart.push_back(obj);
+	    break;
 	  case cbEndOfCompile:
 	    obj->next = EndOfCompile;
 	    EndOfCompile = obj;
@@ -580,6 +652,10 @@ vpiHandle vpi_register_cb(p_cb_data data)
 	  case cbStartOfSimulation:
 	  case cbEndOfSimulation:
 	  case cbNextSimTime:
+	  case cbStartOfSave:
+	  case cbEndOfSave:
+	  case cbStartOfRestart:
+	  case cbEndOfRestart:
 	    obj = make_prepost(data);
 	    break;
 
@@ -607,6 +683,187 @@ PLI_INT32 vpi_remove_cb(vpiHandle ref)
       return 1;
 }
 
+unsigned vpip_count_runtime_callbacks(void)
+{
+      unsigned count = 0;
+      for (std::set<value_callback*>::const_iterator cur = value_callbacks.begin()
+		 ; cur != value_callbacks.end() ; ++ cur) {
+	    if ((*cur)->cb_data.cb_rtn)
+		  count += 1;
+      }
+      for (__vpiCallback*cur = NextSimTime ; cur ; cur = cur->next) {
+	    if (cur->cb_data.cb_rtn)
+		  count += 1;
+      }
+      return count;
+}
+
+/*
+ * A module saves its state if it has a cbStartOfSave callback. Its
+ * callbacks are known by the module that holds the callback routine.
+ */
+static bool module_saves_state(const void*addr)
+{
+      const char*name = ivl_dlmodule(addr);
+      if (name == 0)
+	    return false;
+
+      for (size_t idx = 0 ; idx < StartOfSave.size() ; idx += 1) {
+	    const char*save = ivl_dlmodule(reinterpret_cast<const void*>
+					   (StartOfSave[idx]->cb_data.cb_rtn));
+	    if (save && strcmp(save, name) == 0)
+		  return true;
+      }
+      return false;
+}
+
+static const char* foreign_module(const __vpiCallback*cur)
+{
+      if (! cur->runtime || cur->cb_data.cb_rtn == 0)
+	    return 0;
+
+      const void*addr = reinterpret_cast<const void*>(cur->cb_data.cb_rtn);
+      if (module_saves_state(addr))
+	    return 0;
+
+      const char*name = ivl_dlmodule(addr);
+      return name? name : "an unknown module";
+}
+
+const char* vpip_checkpoint_foreign_callback(void)
+{
+      for (std::set<value_callback*>::const_iterator cur = value_callbacks.begin()
+		 ; cur != value_callbacks.end() ; ++ cur) {
+	    if (const char*name = foreign_module(*cur))
+		  return name;
+      }
+      for (__vpiCallback*cur = NextSimTime ; cur ; cur = cur->next) {
+	    if (const char*name = foreign_module(cur))
+		  return name;
+      }
+      for (__vpiCallback*cur = EndOfSimulation ; cur ; cur = cur->next) {
+	    if (const char*name = foreign_module(cur))
+		  return name;
+      }
+      return 0;
+}
+
+PLI_INT32 vpip_save_restart_id(void)
+{
+      return save_restart_id;
+}
+
+static PLI_INT32 run_save_restart(std::vector<simulator_callback*>&list,
+				  size_t idx)
+{
+      simulator_callback*cur = list[idx];
+      if (cur->cb_data.cb_rtn == 0)
+	    return 0;
+
+      save_restart_id = idx + 1;
+      PLI_INT32 rc = (cur->cb_data.cb_rtn)(&cur->cb_data);
+      save_restart_id = 0;
+      return rc;
+}
+
+/*
+ * The data of the modules are saved as the id and the bytes that the
+ * module wrote with vpi_put_data. A module refuses the save by
+ * returning non-zero from its cbStartOfSave callback.
+ */
+bool vpip_checkpoint_save(checkpoint_out&out)
+{
+      assert(vpi_mode_flag == VPI_MODE_NONE);
+      vpi_mode_flag = VPI_MODE_RWSYNC;
+
+      save_restart_data.clear();
+      for (size_t idx = 0 ; idx < StartOfSave.size() ; idx += 1) {
+	    if (run_save_restart(StartOfSave, idx) != 0) {
+		  const char*name = ivl_dlmodule(reinterpret_cast<const void*>
+						 (StartOfSave[idx]->cb_data.cb_rtn));
+		  out.refuse("the VPI module %s cannot save its state",
+			     name? name : "(unknown)");
+		  break;
+	    }
+      }
+
+      vpi_mode_flag = VPI_MODE_NONE;
+      if (out.refused()) {
+	    save_restart_data.clear();
+	    return false;
+      }
+
+      for (std::map<PLI_INT32,std::string>::const_iterator cur = save_restart_data.begin()
+		 ; cur != save_restart_data.end() ; ++ cur) {
+	    out.put_uint(cur->first);
+	    out.put_str(cur->second);
+      }
+      save_restart_data.clear();
+      return true;
+}
+
+void vpip_checkpoint_end_save(void)
+{
+      assert(vpi_mode_flag == VPI_MODE_NONE);
+      vpi_mode_flag = VPI_MODE_RWSYNC;
+      for (size_t idx = 0 ; idx < EndOfSave.size() ; idx += 1)
+	    run_save_restart(EndOfSave, idx);
+      vpi_mode_flag = VPI_MODE_NONE;
+}
+
+void vpip_checkpoint_restart(checkpoint_in&in)
+{
+      save_restart_data.clear();
+      restart_data_pos.clear();
+      while (uint64_t id = in.get_uint()) {
+	    if (id > StartOfRestart.size())
+		  in.corrupt("data of a VPI module that is not loaded");
+	    save_restart_data[id] = in.get_str();
+      }
+
+      assert(vpi_mode_flag == VPI_MODE_NONE);
+      vpi_mode_flag = VPI_MODE_RWSYNC;
+      for (size_t idx = 0 ; idx < StartOfRestart.size() ; idx += 1)
+	    run_save_restart(StartOfRestart, idx);
+      for (size_t idx = 0 ; idx < EndOfRestart.size() ; idx += 1)
+	    run_save_restart(EndOfRestart, idx);
+      vpi_mode_flag = VPI_MODE_NONE;
+
+      save_restart_data.clear();
+      restart_data_pos.clear();
+}
+
+/*
+ * A module may only write its own data, and only while it is saved.
+ */
+PLI_INT32 vpi_put_data(PLI_INT32 id, PLI_BYTE8*dataLoc, PLI_INT32 numOfBytes)
+{
+      if (id == 0 || id != save_restart_id || numOfBytes < 0)
+	    return 0;
+
+      save_restart_data[id].append(dataLoc, numOfBytes);
+      return numOfBytes;
+}
+
+/*
+ * Each read continues where the last read of the same id ended.
+ */
+PLI_INT32 vpi_get_data(PLI_INT32 id, PLI_BYTE8*dataLoc, PLI_INT32 numOfBytes)
+{
+      std::map<PLI_INT32,std::string>::const_iterator cur
+	    = save_restart_data.find(id);
+      if (cur == save_restart_data.end() || numOfBytes < 0)
+	    return 0;
+
+      size_t&pos = restart_data_pos[id];
+      size_t count = cur->second.size() - pos;
+      if (count > (size_t)numOfBytes)
+	    count = numOfBytes;
+      memcpy(dataLoc, cur->second.data() + pos, count);
+      pos += count;
+      return count;
+}
+
 void callback_execute(struct __vpiCallback*cur)
 {
       const vpi_mode_t save_mode = vpi_mode_flag;
@@ -350,7 +350,7 @@ vpiHandle vpip_make_queue_var(const char*name, vvp_net_t*net)
 void darray_delete(vpiHandle item)
 {
       __vpiDarrayVar*obj = dynamic_cast<__vpiDarrayVar*>(item);
-      if (obj->vals_words) delete [] (obj->vals_words-1);
+      if (obj->vals_words) delete [] (obj->vals_words-2);
       delete obj;
 }
 
@@ -80,6 +80,32 @@ void vpip_mcd_init(FILE *log)
       logfile = log;
 }
 
+/*
+ * A $fork_sim child stops copying its output to the log file, which
+ * belongs to the process that started the children.
+ */
+void vpip_mcd_drop_log(void)
+{
+      logfile = 0;
+}
+
+/*
+ * Return the name of a file that the design has opened, or nil if
+ * only the preopened files are open.
+ */
+const char* vpip_mcd_user_file(void)
+{
+      for (unsigned idx = 1 ; idx < 31 ; idx += 1) {
+	    if (mcd_table[idx].fp)
+		  return mcd_table[idx].filename;
+      }
+      for (unsigned idx = 3 ; idx < fd_table_len ; idx += 1) {
+	    if (fd_table[idx].fp)
+		  return fd_table[idx].filename;
+      }
+      return 0;
+}
+
 #ifdef CHECK_WITH_VALGRIND
 void vpi_mcd_delete(void)
 {
@@ -161,6 +187,7 @@ extern "C" PLI_UINT32 vpi_mcd_open(char *name)
 	return 0;  /* too many open mcd's */
 
 got_entry:
+	name = vpip_fork_file_name(name);
 #if defined(__GNUC__)
 	mcd_table[i].fp = fopen(name, "w");
 #else
@@ -169,9 +196,11 @@ got_entry:
 	else
 		mcd_table[i].fp = fopen("nul", "w");
 #endif
-	if(mcd_table[i].fp == NULL)
+	if(mcd_table[i].fp == NULL) {
+		free(name);
 		return 0;
-	mcd_table[i].filename = strdup(name);
+	}
+	mcd_table[i].filename = name;
 
 	if (vpi_trace) {
 	      fprintf(vpi_trace, "vpi_mcd_open(%s) --> 0x%08x\n",
@@ -305,16 +334,20 @@ extern "C" PLI_INT32 vpi_fopen(const char*name, const char*mode)
       }
 
 got_entry:
+      char*path = vpip_fork_file_name(name);
 #ifndef _MSC_VER
-	  fd_table[i].fp = fopen(name, mode);
+	  fd_table[i].fp = fopen(path, mode);
 #else // Changed for MSVC++ so vpi/pr723.v will pass.
-	  if(strcmp(name, "/dev/null") != 0)
-		fd_table[i].fp = fopen(name, mode);
+	  if(strcmp(path, "/dev/null") != 0)
+		fd_table[i].fp = fopen(path, mode);
 	  else
 		fd_table[i].fp = fopen("nul", mode);
 #endif
-      if (fd_table[i].fp == NULL) return 0;
-      fd_table[i].filename = strdup(name);
+      if (fd_table[i].fp == NULL) {
+	    free(path);
+	    return 0;
+      }
+      fd_table[i].filename = path;
       return ((1U<<31)|i);
 }
 
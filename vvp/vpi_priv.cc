@@ -20,6 +20,7 @@
 # include  "version_base.h"
 # include  "vpi_priv.h"
 # include  "schedule.h"
+# include  "checkpoint.h"
 #ifdef CHECK_WITH_VALGRIND
 # include  "vvp_cleanup.h"
 #endif
@@ -276,6 +277,9 @@ static int vpip_get_global(int property)
 	  case vpiTimePrecision:
 	    return vpip_get_time_precision();
 
+	  case vpiSaveRestartID:
+	    return vpip_save_restart_id();
+
 	  default:
 	    fprintf(stderr, "vpi error: bad global property: %d\n", property);
 	    assert(0);
@@ -568,6 +572,15 @@ PLI_INT32 vpi_get_vlog_info(p_vpi_vlog_info vlog_info_p)
     }
 }
 
+/*
+ * A $fork_sim child runs with the arguments of its variant.
+ */
+void vpip_set_vlog_args(int argc, char**argv)
+{
+    vpi_vlog_info.argc = argc;
+    vpi_vlog_info.argv = argv;
+}
+
 void vpi_set_vlog_info(int argc, char** argv)
 {
     static char icarus_product[] = "Icarus Verilog";
@@ -732,6 +745,11 @@ void vpip_vec4_get_value(const vvp_vector4_t&word_val, unsigned width,
 			need_result_buf(hwid * sizeof(s_vpi_vecval), RBUF_VAL);
 		vp->value.vector = op;
 
+		if (word_val.size() == width) {
+		      word_val.get_vpi_vecval(op);
+		      break;
+		}
+
 		op->aval = op->bval = 0;
 		for (unsigned idx = 0 ;  idx < width ;  idx += 1) {
 		      switch (word_val.value(idx)) {
@@ -1633,3 +1651,13 @@ extern "C" void vpip_count_drivers(vpiHandle ref, unsigned idx,
       assert(rfp);
       rfp->node->count_drivers(idx, counts);
 }
+
+extern "C" void vpip_save_checkpoint(const char*path)
+{
+      checkpoint_request_save(path);
+}
+
+extern "C" void vpip_restart_checkpoint(const char*path)
+{
+      checkpoint_restart(path);
+}
@@ -180,6 +180,10 @@ struct __vpiCallback : public __vpiHandle {
 
 	// Used for listing callbacks.
       struct __vpiCallback*next;
+	// True if registered once the simulation has started. A
+	// restart starts a new process, where only the modules bring
+	// back such callbacks.
+      bool runtime;
 
 	// user supplied callback data
       struct t_cb_data cb_data;
@@ -188,6 +192,7 @@ struct __vpiCallback : public __vpiHandle {
 class value_callback : public __vpiCallback {
     public:
       explicit value_callback(p_cb_data data);
+      ~value_callback();
 	// Return true if the callback really is ready to be called
       virtual bool test_value_callback_ready(void);
 
@@ -199,6 +204,31 @@ class value_callback : public __vpiCallback {
 
 extern void callback_execute(struct __vpiCallback*cur);
 
+/*
+ * Count the VPI callbacks that a checkpoint would lose: the value
+ * change and next time step callbacks that are still enabled.
+ */
+extern unsigned vpip_count_runtime_callbacks(void);
+
+/*
+ * The vpiSaveRestartID of the running cbStartOfSave or
+ * cbStartOfRestart callback, or 0.
+ */
+extern PLI_INT32 vpip_save_restart_id(void);
+
+/*
+ * Return the name of a file that the design has open, or nil.
+ */
+extern const char* vpip_mcd_user_file(void);
+
+/*
+ * A $fork_sim child gives the -l log file back to the parent, and
+ * replaces the arguments that vpi_get_vlog_info returns with those of
+ * its variant.
+ */
+extern void vpip_mcd_drop_log(void);
+extern void vpip_set_vlog_args(int argc, char**argv);
+
 struct __vpiSystemTime : public __vpiHandle {
       __vpiSystemTime();
       int get_type_code(void) const;
@@ -675,6 +705,9 @@ struct __vpiArray : public __vpiArrayBase, public __vpiHandle {
 	// If this is a var array, then these are used instead of nets.
       vvp_vector4array_t*vals4;
       vvp_darray        *vals;
+	// If the vals4 words are sparse, the word handles are made a
+	// page at a time instead of all at once in vals_words.
+      struct __vpiArrayWord**word_pages;
 
       vvp_fun_arrayport*ports_;
       struct __vpiCallback *vpi_callbacks;
@@ -682,6 +715,8 @@ struct __vpiArray : public __vpiArrayBase, public __vpiHandle {
       bool swap_addr;
 
 private:
+      vpiHandle word_handle(unsigned idx);
+
       unsigned array_count;
       __vpiScope*scope;
 
@@ -496,9 +496,23 @@ static void format_vpiVectorVal(vvp_signal_value*sig, int base, unsigned wid,
                          need_result_buf(hwid * sizeof(s_vpi_vecval), RBUF_VAL);
       vp->value.vector = op;
 
+	/* If all the bits are within the signal, copy them a word at
+	   a time from the vector value. Read the stored vector in
+	   place if the signal has one. */
+      if (base >= 0 && end <= (signed)sig->value_size()) {
+	    if (const vvp_vector4_t*bits = sig->vec4_value_ptr()) {
+		  bits->get_vpi_vecval(op, base, wid);
+		  return;
+	    }
+	    vvp_vector4_t tmp;
+	    sig->vec4_value(tmp);
+	    tmp.get_vpi_vecval(op, base, wid);
+	    return;
+      }
+
       op->aval = op->bval = 0;
       for (long idx = base ;  idx < end ;  idx += 1) {
-	    if (base >= 0 && base < (signed)sig->value_size()) {
+	    if (idx >= 0 && idx < (signed)sig->value_size()) {
 		switch (sig->value(idx)) {
 		case BIT4_0:
 		  op->aval &= ~(1 << obit);
@@ -34,6 +34,7 @@
 # include  <cstdlib>
 # include  <cstring>
 # include  <cassert>
+# include  <vector>
 # include  "ivl_alloc.h"
 
 using namespace std;
@@ -780,6 +781,12 @@ static void cleanup_vpi_call_args(unsigned argc, vpiHandle*argv)
  * describes the call, and return it. The %vpi_call instruction will
  * store this handle for when it is executed.
  */
+/*
+ * The calls are numbered in the order that they are compiled, so that
+ * a checkpoint can name a call (see vpip_systf_call_id).
+ */
+static std::vector<__vpiSysTaskCall*> vpi_calls;
+
 vpiHandle vpip_build_vpi_call(const char*name, int val_code, unsigned return_width,
 			      vvp_net_t*fnet,
 			      bool func_as_task_err, bool func_as_task_warn,
@@ -880,6 +887,7 @@ vpiHandle vpip_build_vpi_call(const char*name, int val_code, unsigned return_wid
 
       compile_compiletf(obj);
 
+      vpi_calls.push_back(obj);
       return obj;
 }
 
@@ -1024,3 +1032,19 @@ void* vpi_get_userdata(vpiHandle ref)
 
       return rfp->userdata;
 }
+
+PLI_INT32 vpip_systf_call_id(vpiHandle ref)
+{
+      for (size_t idx = 0 ; idx < vpi_calls.size() ; idx += 1) {
+	    if (vpi_calls[idx] == ref)
+		  return idx + 1;
+      }
+      return 0;
+}
+
+vpiHandle vpip_systf_call_by_id(PLI_INT32 id)
+{
+      if (id <= 0 || (size_t)id > vpi_calls.size())
+	    return 0;
+      return vpi_calls[id-1];
+}
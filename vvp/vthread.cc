@@ -28,6 +28,8 @@
 # include  "vvp_cobject.h"
 # include  "vvp_darray.h"
 # include  "class_type.h"
+# include  "statistics.h"
+# include  "checkpoint.h"
 #ifdef CHECK_WITH_VALGRIND
 # include  "vvp_cleanup.h"
 #endif
@@ -101,9 +103,36 @@ struct vthread_s {
 
 	/* This is the program counter. */
       vvp_code_t pc;
-	/* These hold the private thread bits. */
-      enum { FLAGS_COUNT = 256, WORDS_COUNT = 16 };
-      vvp_bit4_t flags[FLAGS_COUNT];
+	/* These hold the private thread bits. The code generator
+	   allocates flags from the bottom up, so nearly all threads
+	   only ever touch the first few. Those are kept inline, and
+	   the rest are allocated the first time an instruction
+	   addresses one of them. */
+      enum { FLAGS_COUNT = 256, FLAGS_INLINE = 32, WORDS_COUNT = 16 };
+      class flag_array_t {
+	  public:
+	    inline flag_array_t() : extra_(0) { }
+	    inline ~flag_array_t() { delete[] extra_; }
+
+	    inline vvp_bit4_t& operator[] (unsigned idx)
+	    {
+		  if (idx < FLAGS_INLINE)
+			return inline_[idx];
+		  return extra_flag_(idx);
+	    }
+	    inline bool has_extra() const { return extra_ != 0; }
+
+	  private:
+	    vvp_bit4_t& extra_flag_(unsigned idx);
+
+	    vvp_bit4_t inline_[FLAGS_INLINE];
+	    vvp_bit4_t*extra_;
+
+	  private: // not implemented
+	    flag_array_t(const flag_array_t&);
+	    flag_array_t& operator= (const flag_array_t&);
+      };
+      flag_array_t flags;
 
 	/* These are the word registers. */
       union {
@@ -124,7 +153,10 @@ struct vthread_s {
       inline vvp_vector4_t pop_vec4(void)
       {
 	    assert(! stack_vec4_.empty());
-	    vvp_vector4_t val = stack_vec4_.back();
+	      // Swap the value off the stack so that the bits of wide
+	      // values are not copied.
+	    vvp_vector4_t val;
+	    val.swap(stack_vec4_.back());
 	    stack_vec4_.pop_back();
 	    return val;
       }
@@ -132,6 +164,12 @@ struct vthread_s {
       {
 	    stack_vec4_.push_back(val);
       }
+#if __cplusplus >= 201103L
+      inline void push_vec4(vvp_vector4_t&&val)
+      {
+	    stack_vec4_.push_back(std::move(val));
+      }
+#endif
       inline const vvp_vector4_t& peek_vec4(unsigned depth)
       {
 	    unsigned size = stack_vec4_.size();
@@ -159,6 +197,31 @@ struct vthread_s {
 	    }
       }
 
+	/* 2-state values of up to 64 bits are operated on by the
+	   vec2 instructions as native words. They never have X or Z
+	   bits, so they need no bbits and no XZ checks. The values
+	   are not masked to their width; the instructions that care
+	   about the width (stores and compares) take it as an
+	   operand. */
+    private:
+      vector<uint64_t> stack_vec2_;
+    public:
+      inline uint64_t pop_vec2(void)
+      {
+	    assert(! stack_vec2_.empty());
+	    uint64_t val = stack_vec2_.back();
+	    stack_vec2_.pop_back();
+	    return val;
+      }
+      inline void push_vec2(uint64_t val)
+      {
+	    stack_vec2_.push_back(val);
+      }
+      inline uint64_t& peek_vec2(void)
+      {
+	    assert(! stack_vec2_.empty());
+	    return stack_vec2_.back();
+      }
 
     private:
       vector<double> stack_real_;
@@ -301,15 +364,21 @@ struct vthread_s {
       {
 	    if (i_was_disabled) {
 		  stack_vec4_.clear();
+		  stack_vec2_.clear();
 		  stack_real_.clear();
 		  stack_str_.clear();
 		  pop_object(stack_obj_size_);
 	    }
 	    assert(stack_vec4_.empty());
+	    assert(stack_vec2_.empty());
 	    assert(stack_real_.empty());
 	    assert(stack_str_.empty());
 	    assert(stack_obj_size_ == 0);
       }
+
+	/* Write the thread to a checkpoint, or fill it in from one. */
+      void checkpoint_save(checkpoint_out&out);
+      void checkpoint_load(checkpoint_in&in);
 };
 
 inline vthread_s::vthread_s()
@@ -317,18 +386,33 @@ inline vthread_s::vthread_s()
       stack_obj_size_ = 0;
 }
 
+vvp_bit4_t& vthread_s::flag_array_t::extra_flag_(unsigned idx)
+{
+      assert(idx < FLAGS_COUNT);
+      if (extra_ == 0) {
+	    extra_ = new vvp_bit4_t[FLAGS_COUNT-FLAGS_INLINE];
+	    for (unsigned tmp = 0 ; tmp < FLAGS_COUNT-FLAGS_INLINE ; tmp += 1)
+		  extra_[tmp] = BIT4_X;
+      }
+      return extra_[idx-FLAGS_INLINE];
+}
+
 void vthread_s::debug_dump(ostream&fd, const char*label)
 {
       fd << "**** " << label << endl;
       fd << "**** ThreadId: " << this << ", parent id: " << parent << endl;
 
       fd << "**** Flags: ";
-      for (int idx = 0 ; idx < FLAGS_COUNT ; idx += 1)
+      int flag_count = flags.has_extra()? FLAGS_COUNT : FLAGS_INLINE;
+      for (int idx = 0 ; idx < flag_count ; idx += 1)
 	    fd << flags[idx];
       fd << endl;
       fd << "**** vec4 stack..." << endl;
       for (size_t idx = stack_vec4_.size() ; idx > 0 ; idx -= 1)
 	    fd << "    " << (stack_vec4_.size()-idx) << ": " << stack_vec4_[idx-1] << endl;
+      fd << "**** vec2 stack..." << endl;
+      for (size_t idx = stack_vec2_.size() ; idx > 0 ; idx -= 1)
+	    fd << "    " << (stack_vec2_.size()-idx) << ": " << stack_vec2_[idx-1] << endl;
       fd << "**** str stack (" << stack_str_.size() << ")..." << endl;
       fd << "**** obj stack (" << stack_obj_size_ << ")..." << endl;
       fd << "**** args_vec4 array (" << args_vec4.size() << ")..." << endl;
@@ -347,6 +431,16 @@ __vpiScope* vthread_scope(struct vthread_s*thr)
 
 struct vthread_s*running_thread = 0;
 
+/*
+ * These are the dynamic opcode counts. The interpreter loop counts
+ * the opcodes that it runs in a local variable and adds that to the
+ * total when the thread stops, so the innermost loop does no memory
+ * update. The superinstructions count themselves. That costs one
+ * increment for the two to four opcodes that each one replaces.
+ */
+unsigned long count_opcodes_run = 0;
+unsigned long count_opcodes_fused_run = 0;
+
 
 void vthread_push_vec4(struct vthread_s*thr, const vvp_vector4_t&val)
 {
@@ -398,14 +492,15 @@ const vvp_vector4_t& vthread_get_vec4_stack(struct vthread_s*thr, unsigned depth
  */
 /*
  * This is a function to get a vvp_queue handle from the variable
- * referenced by "net". If the queue is nil, then allocated it and
- * assign the value to the net. Note that this function is
- * parameterized by the queue type so that we can create the right
- * derived type of queue object.
+ * that is the operand of the instruction. If the queue is nil, then
+ * allocated it and assign the value to the net. Note that this
+ * function is parameterized by the queue type so that we can create
+ * the right derived type of queue object.
  */
-template <class VVP_QUEUE> static vvp_queue*get_queue_object(vthread_t thr, vvp_net_t*net)
+template <class VVP_QUEUE> static vvp_queue*get_queue_object(vthread_t thr, vvp_code_t cp)
 {
-      vvp_fun_signal_object*obj = dynamic_cast<vvp_fun_signal_object*> (net->fun);
+      vvp_net_t*net = cp->net;
+      vvp_fun_signal_object*obj = cp->sig_object;
       assert(obj);
 
       vvp_queue*dqueue = obj->get_object().peek<vvp_queue>();
@@ -438,25 +533,6 @@ template vvp_vector4_t coerce_to_width(const vvp_vector4_t&that,
                                        unsigned width);
 
 
-static void multiply_array_imm(unsigned long*res, unsigned long*val,
-			       unsigned words, unsigned long imm)
-{
-      for (unsigned idx = 0 ; idx < words ; idx += 1)
-	    res[idx] = 0;
-
-      for (unsigned mul_idx = 0 ; mul_idx < words ; mul_idx += 1) {
-	    unsigned long sum;
-	    unsigned long tmp = multiply_with_carry(val[mul_idx], imm, sum);
-
-	    unsigned long carry = 0;
-	    res[mul_idx] = add_with_carry(res[mul_idx], tmp, carry);
-	    for (unsigned add_idx = mul_idx+1 ; add_idx < words ; add_idx += 1) {
-		  res[add_idx] = add_with_carry(res[add_idx], sum, carry);
-		  sum = 0;
-	    }
-      }
-}
-
 /*
  * Allocate a context for use by a child thread. By preference, use
  * the last freed context. If none available, create a new one. Add
@@ -527,12 +603,38 @@ void contexts_delete(struct __vpiScope*scope)
 }
 #endif
 
+/*
+ * Threads that end are not deleted, but kept on this free list
+ * (linked through the wait_next member) so that forking a new thread
+ * does not need to allocate, and so that the new thread reuses the
+ * stack capacity of the old one.
+ */
+static vthread_t thread_pool = 0;
+
+unsigned long count_threads = 0;
+unsigned long count_threads_live = 0;
+unsigned long count_threads_peak = 0;
+unsigned long count_threads_reused = 0;
+
 /*
  * Create a new thread with the given start address.
  */
-vthread_t vthread_new(vvp_code_t pc, __vpiScope*scope)
+static vthread_t vthread_alloc_(vvp_code_t pc, __vpiScope*scope)
 {
-      vthread_t thr = new struct vthread_s;
+      vthread_t thr;
+      if (thread_pool) {
+	    thr = thread_pool;
+	    thread_pool = thr->wait_next;
+	    count_threads_reused += 1;
+      } else {
+	    thr = new struct vthread_s;
+      }
+
+      count_threads += 1;
+      count_threads_live += 1;
+      if (count_threads_live > count_threads_peak)
+	    count_threads_peak = count_threads_live;
+
       thr->pc     = pc;
 	//thr->bits4  = vvp_vector4_t(32);
       thr->parent = 0;
@@ -560,10 +662,174 @@ vthread_t vthread_new(vvp_code_t pc, __vpiScope*scope)
       for (int idx = 4 ; idx < 8 ; idx += 1)
 	    thr->flags[idx] = BIT4_X;
 
+      return thr;
+}
+
+vthread_t vthread_new(vvp_code_t pc, __vpiScope*scope)
+{
+      vthread_t thr = vthread_alloc_(pc, scope);
       scope->threads .insert(thr);
       return thr;
 }
 
+/*
+ * A thread restored from a checkpoint starts out empty, and the
+ * checkpoint reader fills in the rest of it, including the scope.
+ */
+vthread_t vthread_checkpoint_new(void)
+{
+      return vthread_alloc_(codespace_null(), 0);
+}
+
+void vthread_s::checkpoint_save(checkpoint_out&out)
+{
+      if (wt_context || rd_context) {
+	    out.refuse("a thread is running in an automatic scope");
+	    return;
+      }
+      if (stack_obj_size_ > 0) {
+	    out.refuse("a thread holds class or dynamic array objects");
+	    return;
+      }
+      if (event) {
+	    out.refuse("an intra-assignment event control is pending");
+	    return;
+      }
+
+      out.put_uint(codespace_index(pc));
+      out.put_scope(parent_scope);
+      out.put_uint(parent_scope->threads.count(this));
+
+      unsigned nflags = flags.has_extra()? FLAGS_COUNT : FLAGS_INLINE;
+      out.put_uint(nflags);
+      for (unsigned idx = 0 ; idx < nflags ; idx += 1)
+	    out.put_uint(flags[idx] & 3);
+      for (unsigned idx = 0 ; idx < WORDS_COUNT ; idx += 1)
+	    out.put_uint(words[idx].w_uint);
+
+      out.put_uint(args_real.size());
+      for (size_t idx = 0 ; idx < args_real.size() ; idx += 1)
+	    out.put_uint(args_real[idx]);
+      out.put_uint(args_str.size());
+      for (size_t idx = 0 ; idx < args_str.size() ; idx += 1)
+	    out.put_uint(args_str[idx]);
+      out.put_uint(args_vec4.size());
+      for (size_t idx = 0 ; idx < args_vec4.size() ; idx += 1)
+	    out.put_uint(args_vec4[idx]);
+
+      out.put_uint(stack_vec4_.size());
+      for (size_t idx = 0 ; idx < stack_vec4_.size() ; idx += 1)
+	    out.put_vec4(stack_vec4_[idx]);
+      out.put_uint(stack_vec2_.size());
+      for (size_t idx = 0 ; idx < stack_vec2_.size() ; idx += 1)
+	    out.put_uint(stack_vec2_[idx]);
+      out.put_uint(stack_real_.size());
+      for (size_t idx = 0 ; idx < stack_real_.size() ; idx += 1)
+	    out.put_real(stack_real_[idx]);
+      out.put_uint(stack_str_.size());
+      for (size_t idx = 0 ; idx < stack_str_.size() ; idx += 1)
+	    out.put_str(stack_str_[idx]);
+
+	// The scheduler and the event wait lists restore the
+	// is_scheduled and waiting_for_event bits themselves.
+      out.put_uint(i_am_joining << 0 | i_am_detached << 1
+		   | i_am_waiting << 2 | i_am_in_function << 3
+		   | i_have_ended << 4 | i_was_disabled << 5
+		   | delay_delete << 6);
+
+      out.put_thread(parent);
+      set<vthread_t>*sets[3] = { &children, &detached_children,
+				 &task_func_children };
+      for (unsigned sdx = 0 ; sdx < 3 ; sdx += 1) {
+	    out.put_uint(sets[sdx]->size());
+	    for (set<vthread_t>::iterator cur = sets[sdx]->begin()
+		       ; cur != sets[sdx]->end() ; ++ cur)
+		  out.put_thread(*cur);
+      }
+      out.put_uint(ecount);
+}
+
+void vthread_s::checkpoint_load(checkpoint_in&in)
+{
+      pc = codespace_at(in.get_uint());
+      if (pc == 0)
+	    in.corrupt("thread address out of range");
+      parent_scope = in.get_scope();
+      if (in.get_uint())
+	    parent_scope->threads.insert(this);
+
+      unsigned nflags = in.get_uint();
+      if (nflags > FLAGS_COUNT)
+	    in.corrupt("too many thread flags");
+      for (unsigned idx = 0 ; idx < nflags ; idx += 1)
+	    flags[idx] = (vvp_bit4_t) (in.get_uint() & 3);
+      for (unsigned idx = 0 ; idx < WORDS_COUNT ; idx += 1)
+	    words[idx].w_uint = in.get_uint();
+
+      args_real.resize(in.get_uint());
+      for (size_t idx = 0 ; idx < args_real.size() ; idx += 1)
+	    args_real[idx] = in.get_uint();
+      args_str.resize(in.get_uint());
+      for (size_t idx = 0 ; idx < args_str.size() ; idx += 1)
+	    args_str[idx] = in.get_uint();
+      args_vec4.resize(in.get_uint());
+      for (size_t idx = 0 ; idx < args_vec4.size() ; idx += 1)
+	    args_vec4[idx] = in.get_uint();
+
+      stack_vec4_.resize(in.get_uint());
+      for (size_t idx = 0 ; idx < stack_vec4_.size() ; idx += 1)
+	    stack_vec4_[idx] = in.get_vec4();
+      stack_vec2_.resize(in.get_uint());
+      for (size_t idx = 0 ; idx < stack_vec2_.size() ; idx += 1)
+	    stack_vec2_[idx] = in.get_uint();
+      stack_real_.resize(in.get_uint());
+      for (size_t idx = 0 ; idx < stack_real_.size() ; idx += 1)
+	    stack_real_[idx] = in.get_real();
+      stack_str_.resize(in.get_uint());
+      for (size_t idx = 0 ; idx < stack_str_.size() ; idx += 1)
+	    stack_str_[idx] = in.get_str();
+
+      uint64_t bits = in.get_uint();
+      i_am_joining     = (bits >> 0) & 1;
+      i_am_detached    = (bits >> 1) & 1;
+      i_am_waiting     = (bits >> 2) & 1;
+      i_am_in_function = (bits >> 3) & 1;
+      i_have_ended     = (bits >> 4) & 1;
+      i_was_disabled   = (bits >> 5) & 1;
+      delay_delete     = (bits >> 6) & 1;
+
+      parent = in.get_thread();
+      set<vthread_t>*sets[3] = { &children, &detached_children,
+				 &task_func_children };
+      for (unsigned sdx = 0 ; sdx < 3 ; sdx += 1) {
+	    for (uint64_t cnt = in.get_uint() ; cnt > 0 ; cnt -= 1)
+		  sets[sdx]->insert(in.get_thread());
+      }
+      ecount = in.get_uint();
+}
+
+void vthread_checkpoint_save(checkpoint_out&out, vthread_t thr)
+{
+      thr->checkpoint_save(out);
+}
+
+void vthread_checkpoint_load(checkpoint_in&in, vthread_t thr)
+{
+      thr->checkpoint_load(in);
+}
+
+vthread_t vthread_wait_next(vthread_t thr)
+{
+      return thr->wait_next;
+}
+
+void vthread_wait_on(vthread_t thr, waitable_hooks_s*ep)
+{
+      assert(! thr->waiting_for_event);
+      thr->waiting_for_event = 1;
+      thr->wait_next = ep->add_waiting_thread(thr);
+}
+
 #ifdef CHECK_WITH_VALGRIND
 #if 0
 /*
@@ -662,9 +928,33 @@ static void vthread_reap(vthread_t thr)
 void vthread_delete(vthread_t thr)
 {
       thr->cleanup();
-      delete thr;
+
+	// The stacks are already empty. Clear the remaining
+	// containers, but keep their capacity for the next thread.
+      thr->args_real.clear();
+      thr->args_str.clear();
+      thr->args_vec4.clear();
+      thr->detached_children.clear();
+      thr->task_func_children.clear();
+
+      assert(count_threads_live > 0);
+      count_threads_live -= 1;
+
+      thr->wait_next = thread_pool;
+      thread_pool = thr;
 }
 
+#ifdef CHECK_WITH_VALGRIND
+void vthread_pool_delete(void)
+{
+      while (thread_pool) {
+	    vthread_t tmp = thread_pool->wait_next;
+	    delete thread_pool;
+	    thread_pool = tmp;
+      }
+}
+#endif
+
 void vthread_mark_scheduled(vthread_t thr)
 {
       while (thr != 0) {
@@ -696,9 +986,11 @@ void vthread_run(vthread_t thr)
 
             running_thread = thr;
 
+	    unsigned long run = 0;
 	    for (;;) {
 		  vvp_code_t cp = thr->pc;
 		  thr->pc += 1;
+		  run += 1;
 
 		    /* Run the opcode implementation. If the execution of
 		       the opcode returns false, then the thread is meant to
@@ -707,6 +999,7 @@ void vthread_run(vthread_t thr)
 		  if (rc == false)
 			break;
 	    }
+	    count_opcodes_run += run;
 
 	    thr = tmp;
       }
@@ -1090,7 +1383,7 @@ bool of_ASSIGN_VEC4_OFF_D(vthread_t thr, vvp_code_t cp)
       if (thr->flags[4] == BIT4_1)
 	    return true;
 
-      vvp_signal_value*sig = dynamic_cast<vvp_signal_value*> (cp->net->fil);
+      vvp_signal_value*sig = cp->sig_value;
       assert(sig);
 
       if (off >= (long)sig->value_size())
@@ -1132,7 +1425,7 @@ bool of_ASSIGN_VEC4_OFF_E(vthread_t thr, vvp_code_t cp)
       if (thr->flags[4] == BIT4_1)
 	    return true;
 
-      vvp_signal_value*sig = dynamic_cast<vvp_signal_value*> (cp->net->fil);
+      vvp_signal_value*sig = cp->sig_value;
       assert(sig);
 
       if (off >= (long)sig->value_size())
@@ -1173,7 +1466,7 @@ bool of_ASSIGN_VEC4D(vthread_t thr, vvp_code_t cp)
 
       vvp_vector4_t value = thr->pop_vec4();
 
-      vvp_signal_value*sig = dynamic_cast<vvp_signal_value*> (cp->net->fil);
+      vvp_signal_value*sig = cp->sig_value;
       assert(sig);
 
       schedule_assign_vector(ptr, 0, sig->value_size(), value, del);
@@ -1189,7 +1482,7 @@ bool of_ASSIGN_VEC4E(vthread_t thr, vvp_code_t cp)
       vvp_net_ptr_t ptr (cp->net, 0);
       vvp_vector4_t value = thr->pop_vec4();
 
-      vvp_signal_value*sig = dynamic_cast<vvp_signal_value*> (cp->net->fil);
+      vvp_signal_value*sig = cp->sig_value;
       assert(sig);
 
       if (thr->ecount == 0) {
@@ -1375,7 +1668,7 @@ bool of_CALLF_VEC4(vthread_t thr, vvp_code_t cp)
 {
       vthread_t child = vthread_new(cp->cptr2, cp->scope);
 
-      vpiScopeFunction*scope_func = dynamic_cast<vpiScopeFunction*>(cp->scope);
+      vpiScopeFunction*scope_func = cp->scope_func;
       assert(scope_func);
 
 	// This is the return value. Push a place-holder value. The function
@@ -2463,205 +2756,18 @@ bool of_DISABLE_FORK(vthread_t thr, vvp_code_t)
       return true;
 }
 
-/*
- * This function divides a 2-word number {high, a} by a 1-word
- * number. Assume that high < b.
- */
-static unsigned long divide2words(unsigned long a, unsigned long b,
-				  unsigned long high)
-{
-      unsigned long result = 0;
-      while (high > 0) {
-	    unsigned long tmp_result = ULONG_MAX / b;
-	    unsigned long remain = ULONG_MAX % b;
-
-	    remain += 1;
-	    if (remain >= b) {
-		  remain -= b;
-		  tmp_result += 1;
-	    }
-
-	      // Now 0x1_0...0 = b*tmp_result + remain
-	      // high*0x1_0...0 = high*(b*tmp_result + remain)
-	      // high*0x1_0...0 = high*b*tmp_result + high*remain
-
-	      // We know that high*0x1_0...0 >= high*b*tmp_result, and
-	      // we know that high*0x1_0...0 > high*remain. Use
-	      // high*remain as the remainder for another iteration,
-	      // and add tmp_result*high into the current estimate of
-	      // the result.
-	    result += tmp_result * high;
-
-	      // The new iteration starts with high*remain + a.
-	    remain = multiply_with_carry(high, remain, high);
-	    a += remain;
-            if(a < remain)
-              high += 1;
-
-	      // Now result*b + {high,a} == the input {high,a}. It is
-	      // possible that the new high >= 1. If so, it will
-	      // certainly be less than high from the previous
-	      // iteration. Do another iteration and it will shrink,
-	      // eventually to 0.
-      }
-
-	// high is now 0, so a is the remaining remainder, so we can
-	// finish off the integer divide with a simple a/b.
-
-      return result + a/b;
-}
-
-static unsigned long* divide_bits(unsigned long*ap, unsigned long*bp, unsigned wid)
-{
-	// Do all our work a cpu-word at a time. The "words" variable
-	// is the number of words of the wid.
-      unsigned words = (wid+CPU_WORD_BITS-1) / CPU_WORD_BITS;
-
-      unsigned btop = words-1;
-      while (btop > 0 && bp[btop] == 0)
-	    btop -= 1;
-
-	// Detect divide by 0, and exit.
-      if (btop==0 && bp[0]==0)
-	    return 0;
-
-	// The result array will eventually accumulate the result. The
-	// diff array is a difference that we use in the intermediate.
-      unsigned long*diff  = new unsigned long[words];
-      unsigned long*result= new unsigned long[words];
-      for (unsigned idx = 0 ; idx < words ; idx += 1)
-	    result[idx] = 0;
-
-      for (unsigned cur = words-btop ; cur > 0 ; cur -= 1) {
-	    unsigned cur_ptr = cur-1;
-	    unsigned long cur_res;
-	    if (ap[cur_ptr+btop] >= bp[btop]) {
-		  unsigned long high = 0;
-		  if (cur_ptr+btop+1 < words)
-			high = ap[cur_ptr+btop+1];
-		  cur_res = divide2words(ap[cur_ptr+btop], bp[btop], high);
-
-	    } else if (cur_ptr+btop+1 >= words) {
-		  continue;
-
-	    } else if (ap[cur_ptr+btop+1] == 0) {
-		  continue;
-
-	    } else {
-		  cur_res = divide2words(ap[cur_ptr+btop], bp[btop],
-					 ap[cur_ptr+btop+1]);
-	    }
-
-	      // cur_res is a guesstimate of the result this far. It
-	      // may be 1 too big. (But it will also be >0) Try it,
-	      // and if the difference comes out negative, then adjust.
-
-	      // diff = (bp * cur_res)  << cur_ptr;
-	    multiply_array_imm(diff+cur_ptr, bp, words-cur_ptr, cur_res);
-	      // ap -= diff
-	    unsigned long carry = 1;
-	    for (unsigned idx = cur_ptr ; idx < words ; idx += 1)
-		  ap[idx] = add_with_carry(ap[idx], ~diff[idx], carry);
-
-	      // ap has the diff subtracted out of it. If cur_res was
-	      // too large, then ap will turn negative. (We easily
-	      // tell that ap turned negative by looking at
-	      // carry&1. If it is 0, then it is *negative*.) In that
-	      // case, we know that cur_res was too large by 1. Correct by
-	      // adding 1b back in and reducing cur_res.
-	    if ((carry&1) == 0) {
-		    // Keep adding b back in until the remainder
-		    // becomes positive again.
-		  do {
-			cur_res -= 1;
-			carry = 0;
-			for (unsigned idx = cur_ptr ; idx < words ; idx += 1)
-			      ap[idx] = add_with_carry(ap[idx], bp[idx-cur_ptr], carry);
-		  } while (carry == 0);
-	    }
-
-	    result[cur_ptr] = cur_res;
-      }
-
-	// Now ap contains the remainder and result contains the
-	// desired result. We should find that:
-	//  input-a = bp * result + ap;
-
-      delete[]diff;
-      return result;
-}
-
 /*
  * %div
  */
 bool of_DIV(vthread_t thr, vvp_code_t)
 {
       vvp_vector4_t valb = thr->pop_vec4();
-      vvp_vector4_t vala = thr->pop_vec4();
-
-      assert(vala.size()== valb.size());
-      unsigned wid = vala.size();
-
-      unsigned long*ap = vala.subarray(0, wid);
-      if (ap == 0) {
-	    vvp_vector4_t tmp(wid, BIT4_X);
-	    thr->push_vec4(tmp);
-	    return true;
-      }
-
-      unsigned long*bp = valb.subarray(0, wid);
-      if (bp == 0) {
-	    delete[]ap;
-	    vvp_vector4_t tmp(wid, BIT4_X);
-	    thr->push_vec4(tmp);
-	    return true;
-      }
-
-	// If the value fits in a single CPU word, then do it the easy way.
-      if (wid <= CPU_WORD_BITS) {
-	    if (bp[0] == 0) {
-		  vvp_vector4_t tmp(wid, BIT4_X);
-		  thr->push_vec4(tmp);
-	    } else {
-		  ap[0] /= bp[0];
-		  vala.setarray(0, wid, ap);
-		  thr->push_vec4(vala);
-	    }
-	    delete[]ap;
-	    delete[]bp;
-	    return true;
-      }
-
-      unsigned long*result = divide_bits(ap, bp, wid);
-      if (result == 0) {
-	    delete[]ap;
-	    delete[]bp;
-	    vvp_vector4_t tmp(wid, BIT4_X);
-	    thr->push_vec4(tmp);
-	    return true;
-      }
-
-	// Now ap contains the remainder and result contains the
-	// desired result. We should find that:
-	//  input-a = bp * result + ap;
-
-      vala.setarray(0, wid, result);
-      thr->push_vec4(vala);
-      delete[]ap;
-      delete[]bp;
-      delete[]result;
+      vvp_vector4_t&vala = thr->peek_vec4();
 
+      vala.div(valb, false);
       return true;
 }
 
-
-static void negate_words(unsigned long*val, unsigned words)
-{
-      unsigned long carry = 1;
-      for (unsigned idx = 0 ; idx < words ; idx += 1)
-	    val[idx] = add_with_carry(0, ~val[idx], carry);
-}
-
 /*
  * %div/s
  */
@@ -2670,86 +2776,7 @@ bool of_DIV_S(vthread_t thr, vvp_code_t)
       vvp_vector4_t valb = thr->pop_vec4();
       vvp_vector4_t&vala = thr->peek_vec4();
 
-      assert(vala.size()== valb.size());
-      unsigned wid = vala.size();
-      unsigned words = (wid + CPU_WORD_BITS - 1) / CPU_WORD_BITS;
-
-	// Get the values, left in right, in binary form. If there is
-	// a problem with either (caused by an X or Z bit) then we
-	// know right away that the entire result is X.
-      unsigned long*ap = vala.subarray(0, wid);
-      if (ap == 0) {
-	    vvp_vector4_t tmp(wid, BIT4_X);
-	    vala = tmp;
-	    return true;
-      }
-
-      unsigned long*bp = valb.subarray(0, wid);
-      if (bp == 0) {
-	    delete[]ap;
-	    vvp_vector4_t tmp(wid, BIT4_X);
-	    vala = tmp;
-	    return true;
-      }
-
-	// Sign extend the bits in the array to fill out the array.
-      unsigned long sign_mask = 0;
-      if (unsigned long sign_bits = (words*CPU_WORD_BITS) - wid) {
-	    sign_mask = -1UL << (CPU_WORD_BITS-sign_bits);
-	    if (ap[words-1] & (sign_mask>>1))
-		  ap[words-1] |= sign_mask;
-	    if (bp[words-1] & (sign_mask>>1))
-		  bp[words-1] |= sign_mask;
-      }
-
-	// If the value fits in a single word, then use the native divide.
-      if (wid <= CPU_WORD_BITS) {
-	    if (bp[0] == 0) {
-		  vvp_vector4_t tmp(wid, BIT4_X);
-		  vala = tmp;
-	    } else {
-		  long tmpa = (long) ap[0];
-		  long tmpb = (long) bp[0];
-		  long res = tmpa / tmpb;
-		  ap[0] = ((unsigned long)res) & ~sign_mask;
-		  vala.setarray(0, wid, ap);
-	    }
-	    delete[]ap;
-	    delete[]bp;
-	    return true;
-      }
-
-	// We need to the actual division to positive integers. Make
-	// them positive here, and remember the negations.
-      bool negate_flag = false;
-      if ( ((long) ap[words-1]) < 0 ) {
-	    negate_flag = true;
-	    negate_words(ap, words);
-      }
-      if ( ((long) bp[words-1]) < 0 ) {
-	    negate_flag ^= true;
-	    negate_words(bp, words);
-      }
-
-      unsigned long*result = divide_bits(ap, bp, wid);
-      if (result == 0) {
-	    delete[]ap;
-	    delete[]bp;
-	    vvp_vector4_t tmp(wid, BIT4_X);
-	    vala = tmp;
-	    return true;
-      }
-
-      if (negate_flag) {
-	    negate_words(result, words);
-      }
-
-      result[words-1] &= ~sign_mask;
-
-      vala.setarray(0, wid, result);
-      delete[]ap;
-      delete[]bp;
-      delete[]result;
+      vala.div(valb, true);
       return true;
 }
 
@@ -3052,7 +3079,7 @@ bool of_FORCE_VEC4_OFF(vthread_t thr, vvp_code_t cp)
 	// vvp_net_t::force_vec4 propagates all the bits of the
 	// forced vector value, regardless of the mask. This
 	// ensures the unforced bits retain their current value.
-      vvp_signal_value*sig = dynamic_cast<vvp_signal_value*>(net->fil);
+      vvp_signal_value*sig = cp->sig_value;
       assert(sig);
       sig->vec4_value(tmp);
 
@@ -3227,7 +3254,7 @@ bool of_IX_GETV(vthread_t thr, vvp_code_t cp)
       unsigned index = cp->bit_idx[0];
       vvp_net_t*net = cp->net;
 
-      vvp_signal_value*sig = dynamic_cast<vvp_signal_value*>(net->fil);
+      vvp_signal_value*sig = cp->sig_value;
       if (sig == 0) {
 	    assert(net->fil);
 	    cerr << "%%ix/getv error: Net arg not a vector signal? "
@@ -3256,7 +3283,7 @@ bool of_IX_GETV_S(vthread_t thr, vvp_code_t cp)
       unsigned index = cp->bit_idx[0];
       vvp_net_t*net = cp->net;
 
-      vvp_signal_value*sig = dynamic_cast<vvp_signal_value*>(net->fil);
+      vvp_signal_value*sig = cp->sig_value;
       if (sig == 0) {
 	    assert(net->fil);
 	    cerr << "%%ix/getv/s error: Net arg not a vector signal? "
@@ -3585,7 +3612,7 @@ bool of_LOAD_DAR_R(vthread_t thr, vvp_code_t cp)
       vvp_net_t*net = cp->net;
 
       assert(net);
-      vvp_fun_signal_object*obj = dynamic_cast<vvp_fun_signal_object*> (net->fun);
+      vvp_fun_signal_object*obj = cp->sig_object;
       assert(obj);
 
       vvp_darray*darray = obj->get_object().peek<vvp_darray>();
@@ -3604,7 +3631,7 @@ bool of_LOAD_DAR_STR(vthread_t thr, vvp_code_t cp)
       vvp_net_t*net = cp->net;
 
       assert(net);
-      vvp_fun_signal_object*obj = dynamic_cast<vvp_fun_signal_object*> (net->fun);
+      vvp_fun_signal_object*obj = cp->sig_object;
       assert(obj);
 
       vvp_darray*darray = obj->get_object().peek<vvp_darray>();
@@ -3623,7 +3650,7 @@ bool of_LOAD_DAR_VEC4(vthread_t thr, vvp_code_t cp)
       vvp_net_t*net = cp->net;
 
       assert(net);
-      vvp_fun_signal_object*obj = dynamic_cast<vvp_fun_signal_object*> (net->fun);
+      vvp_fun_signal_object*obj = cp->sig_object;
       assert(obj);
 
       vvp_darray*darray = obj->get_object().peek<vvp_darray>();
@@ -3641,8 +3668,7 @@ bool of_LOAD_DAR_VEC4(vthread_t thr, vvp_code_t cp)
  */
 bool of_LOAD_OBJ(vthread_t thr, vvp_code_t cp)
 {
-      vvp_net_t*net = cp->net;
-      vvp_fun_signal_object*fun = dynamic_cast<vvp_fun_signal_object*> (net->fun);
+      vvp_fun_signal_object*fun = cp->sig_object;
       assert(fun);
 
       vvp_object_t val = fun->get_object();
@@ -3695,10 +3721,7 @@ bool of_LOAD_REAL(vthread_t thr, vvp_code_t cp)
  */
 bool of_LOAD_STR(vthread_t thr, vvp_code_t cp)
 {
-      vvp_net_t*net = cp->net;
-
-
-      vvp_fun_signal_string*fun = dynamic_cast<vvp_fun_signal_string*> (net->fun);
+      vvp_fun_signal_string*fun = cp->sig_string;
       assert(fun);
 
       const string&val = fun->get_string();
@@ -3725,30 +3748,39 @@ bool of_LOAD_STRA(vthread_t thr, vvp_code_t cp)
 
 
 /*
- * %load/vec4 <net>
+ * Get the vec4 value of the signal operand of the instruction into
+ * val. This is the guts of %load/vec4, and is also used by the
+ * superinstructions and %load/vec2.
  */
-bool of_LOAD_VEC4(vthread_t thr, vvp_code_t cp)
+static void load_vec4_value(vvp_code_t cp, vvp_vector4_t&val)
 {
-	// Push a placeholder onto the stack in order to reserve the
-	// stack space. Use a reference for the stack top as a target
-	// for the load.
-      thr->push_vec4(vvp_vector4_t());
-      vvp_vector4_t&sig_value = thr->peek_vec4();
-
-      vvp_net_t*net = cp->net;
-
 	// For the %load to work, the functor must actually be a
 	// signal functor. Only signals save their vector value.
-      vvp_signal_value*sig = dynamic_cast<vvp_signal_value*> (net->fil);
+      vvp_signal_value*sig = cp->sig_value;
       if (sig == 0) {
+	    vvp_net_t*net = cp->net;
 	    cerr << "%load/v error: Net arg not a signal? "
 		 << (net->fil ? typeid(*net->fil).name() : typeid(*net->fun).name()) << endl;
 	    assert(sig);
       }
 
+      sig->vec4_value(val);
+}
+
+/*
+ * %load/vec4 <net>
+ */
+bool of_LOAD_VEC4(vthread_t thr, vvp_code_t cp)
+{
+	// Push a placeholder onto the stack in order to reserve the
+	// stack space. Use a reference for the stack top as a target
+	// for the load.
+      thr->push_vec4(vvp_vector4_t());
+      vvp_vector4_t&sig_value = thr->peek_vec4();
+
 	// Extract the value from the signal and directly into the
 	// target stack position.
-      sig->vec4_value(sig_value);
+      load_vec4_value(cp, sig_value);
 
       return true;
 }
@@ -3776,122 +3808,6 @@ bool of_LOAD_VEC4A(vthread_t thr, vvp_code_t cp)
       return true;
 }
 
-static void do_verylong_mod(vvp_vector4_t&vala, const vvp_vector4_t&valb,
-			    bool left_is_neg, bool right_is_neg)
-{
-      bool out_is_neg = left_is_neg;
-      const int len=vala.size();
-      unsigned char *a, *z, *t;
-      a = new unsigned char[len+1];
-      z = new unsigned char[len+1];
-      t = new unsigned char[len+1];
-
-      unsigned char carry;
-      unsigned char temp;
-
-      int mxa = -1, mxz = -1;
-      int i;
-      int current, copylen;
-
-      unsigned lb_carry = left_is_neg? 1 : 0;
-      unsigned rb_carry = right_is_neg? 1 : 0;
-      for (int idx = 0 ;  idx < len ;  idx += 1) {
-	    unsigned lb = vala.value(idx);
-	    unsigned rb = valb.value(idx);
-
-	    if ((lb | rb) & 2) {
-		  delete []t;
-		  delete []z;
-		  delete []a;
-		  vvp_vector4_t tmp(len, BIT4_X);
-		  vala = tmp;
-		  return;
-	    }
-
-	    if (left_is_neg) {
-		  lb = (1-lb) + lb_carry;
-		  lb_carry = (lb & ~1)? 1 : 0;
-		  lb &= 1;
-	    }
-	    if (right_is_neg) {
-		  rb = (1-rb) + rb_carry;
-		  rb_carry = (rb & ~1)? 1 : 0;
-		  rb &= 1;
-	    }
-
-	    z[idx]=lb;
-	    a[idx]=1-rb;	// for 2s complement add..
-      }
-
-      z[len]=0;
-      a[len]=1;
-
-      for(i=len-1;i>=0;i--) {
-	    if(! a[i]) {
-		  mxa=i;
-		  break;
-	    }
-      }
-
-      for(i=len-1;i>=0;i--) {
-	    if(z[i]) {
-		  mxz=i;
-		  break;
-	    }
-      }
-
-      if((mxa>mxz)||(mxa==-1)) {
-	    if(mxa==-1) {
-		  delete []t;
-		  delete []z;
-		  delete []a;
-		  vvp_vector4_t tmpx (len, BIT4_X);
-		  vala = tmpx;
-		  return;
-	    }
-
-	    goto tally;
-      }
-
-      copylen = mxa + 2;
-      current = mxz - mxa;
-
-      while(current > -1) {
-	    carry = 1;
-	    for(i=0;i<copylen;i++) {
-		  temp = z[i+current] + a[i] + carry;
-		  t[i] = (temp&1);
-		  carry = (temp>>1);
-	    }
-
-	    if(carry) {
-		  for(i=0;i<copylen;i++) {
-			z[i+current] = t[i];
-		  }
-	    }
-
-	    current--;
-      }
-
- tally:
-
-      vvp_vector4_t tmp (len, BIT4_X);
-      carry = out_is_neg? 1 : 0;
-      for (int idx = 0 ;  idx < len ;  idx += 1) {
-	    unsigned ob = z[idx];
-	    if (out_is_neg) {
-		  ob = (1-ob) + carry;
-		  carry = (ob & ~1)? 1 : 0;
-		  ob = ob & 1;
-	    }
-	    tmp.set_bit(idx, ob?BIT4_1:BIT4_0);
-      }
-      vala = tmp;
-      delete []t;
-      delete []z;
-      delete []a;
-}
-
 bool of_MAX_WR(vthread_t thr, vvp_code_t)
 {
       double r = thr->pop_real();
@@ -3927,42 +3843,7 @@ bool of_MOD(vthread_t thr, vvp_code_t)
       vvp_vector4_t valb = thr->pop_vec4();
       vvp_vector4_t&vala = thr->peek_vec4();
 
-      assert(vala.size()==valb.size());
-      unsigned wid = vala.size();
-
-      if(wid <= 8*sizeof(unsigned long long)) {
-	    unsigned long long lv = 0, rv = 0;
-
-	    for (unsigned idx = 0 ;  idx < wid ;  idx += 1) {
-		  unsigned long long lb = vala.value(idx);
-		  unsigned long long rb = valb.value(idx);
-
-		  if ((lb | rb) & 2)
-			goto x_out;
-
-		  lv |= (unsigned long long) lb << idx;
-		  rv |= (unsigned long long) rb << idx;
-	    }
-
-	    if (rv == 0)
-		  goto x_out;
-
-	    lv %= rv;
-
-	    for (unsigned idx = 0 ;  idx < wid ;  idx += 1) {
-		  vala.set_bit(idx, (lv&1)?BIT4_1 : BIT4_0);
-		  lv >>= 1;
-	    }
-
-	    return true;
-
-      } else {
-	    do_verylong_mod(vala, valb, false, false);
-	    return true;
-      }
-
- x_out:
-      vala = vvp_vector4_t(wid, BIT4_X);
+      vala.mod(valb, false);
       return true;
 }
 
@@ -3974,58 +3855,7 @@ bool of_MOD_S(vthread_t thr, vvp_code_t)
       vvp_vector4_t valb = thr->pop_vec4();
       vvp_vector4_t&vala = thr->peek_vec4();
 
-      assert(vala.size()==valb.size());
-      unsigned wid = vala.size();
-
-	/* Handle the case that we can fit the bits into a long-long
-	   variable. We cause use native % to do the work. */
-      if(wid <= 8*sizeof(long long)) {
-	    long long lv = 0, rv = 0;
-
-	    for (unsigned idx = 0 ;  idx < wid ;  idx += 1) {
-		  long long lb = vala.value(idx);
-		  long long rb = valb.value(idx);
-
-		  if ((lb | rb) & 2)
-			goto x_out;
-
-		  lv |= (long long) lb << idx;
-		  rv |= (long long) rb << idx;
-	    }
-
-	    if (rv == 0)
-		  goto x_out;
-
-	      /* Sign extend the signed operands when needed. */
-	    if (wid < 8*sizeof(long long)) {
-		  if (lv & (1LL << (wid-1)))
-			lv |= -1ULL << wid;
-		  if (rv & (1LL << (wid-1)))
-			rv |= -1ULL << wid;
-	    }
-
-	    lv %= rv;
-
-	    for (unsigned idx = 0 ;  idx < wid ;  idx += 1) {
-		  vala.set_bit(idx, (lv&1)? BIT4_1 : BIT4_0);
-		  lv >>= 1;
-	    }
-
-	      // vala is the top of the stack, edited in place, so we
-	      // do not need to push the result.
-
-	    return true;
-
-      } else {
-
-	    bool left_is_neg  = vala.value(vala.size()-1) == BIT4_1;
-	    bool right_is_neg = valb.value(valb.size()-1) == BIT4_1;
-	    do_verylong_mod(vala, valb, left_is_neg, right_is_neg);
-	    return true;
-      }
-
- x_out:
-      vala = vvp_vector4_t(wid, BIT4_X);
+      vala.mod(valb, true);
       return true;
 }
 
@@ -4275,7 +4105,7 @@ bool of_NAND(vthread_t thr, vvp_code_t)
  */
 bool of_NEW_COBJ(vthread_t thr, vvp_code_t cp)
 {
-      const class_type*defn = dynamic_cast<const class_type*> (cp->handle);
+      const class_type*defn = cp->class_defn;
       assert(defn);
 
       vvp_object_t tmp (new vvp_cobject(defn));
@@ -4899,8 +4729,7 @@ bool of_PUTC_STR_VEC4(vthread_t thr, vvp_code_t cp)
 
 	/* Get the existing value of the string. If we find that the
 	   index is too big for the string, then give up. */
-      vvp_net_t*net = cp->net;
-      vvp_fun_signal_string*fun = dynamic_cast<vvp_fun_signal_string*> (net->fun);
+      vvp_fun_signal_string*fun = cp->sig_string;
       assert(fun);
 
       string tmp = fun->get_string();
@@ -4926,9 +4755,7 @@ bool of_PUTC_STR_VEC4(vthread_t thr, vvp_code_t cp)
 
 bool of_QPOP_B_STR(vthread_t thr, vvp_code_t cp)
 {
-      vvp_net_t*net = cp->net;
-
-      vvp_queue*dqueue = get_queue_object<vvp_queue_string>(thr, net);
+      vvp_queue*dqueue = get_queue_object<vvp_queue_string>(thr, cp);
       assert(dqueue);
 
       size_t size = dqueue->get_size();
@@ -4947,9 +4774,7 @@ bool of_QPOP_B_STR(vthread_t thr, vvp_code_t cp)
  */
 bool of_QPOP_B_V(vthread_t thr, vvp_code_t cp)
 {
-      vvp_net_t*net = cp->net;
-
-      vvp_queue*dqueue = get_queue_object<vvp_queue_vec4>(thr, net);
+      vvp_queue*dqueue = get_queue_object<vvp_queue_vec4>(thr, cp);
       assert(dqueue);
 
       size_t size = dqueue->get_size();
@@ -4965,9 +4790,7 @@ bool of_QPOP_B_V(vthread_t thr, vvp_code_t cp)
 
 bool of_QPOP_F_STR(vthread_t thr, vvp_code_t cp)
 {
-      vvp_net_t*net = cp->net;
-
-      vvp_queue*dqueue = get_queue_object<vvp_queue_string>(thr, net);
+      vvp_queue*dqueue = get_queue_object<vvp_queue_string>(thr, cp);
       assert(dqueue);
 
       string value;
@@ -4983,9 +4806,7 @@ bool of_QPOP_F_STR(vthread_t thr, vvp_code_t cp)
  */
 bool of_QPOP_F_V(vthread_t thr, vvp_code_t cp)
 {
-      vvp_net_t*net = cp->net;
-
-      vvp_queue*dqueue = get_queue_object<vvp_queue_vec4>(thr, net);
+      vvp_queue*dqueue = get_queue_object<vvp_queue_vec4>(thr, cp);
       assert(dqueue);
 
       size_t size = dqueue->get_size();
@@ -5469,8 +5290,7 @@ bool of_STORE_DAR_R(vthread_t thr, vvp_code_t cp)
 	// Pop the real value to be store...
       double value = thr->pop_real();
 
-      vvp_net_t*net = cp->net;
-      vvp_fun_signal_object*obj = dynamic_cast<vvp_fun_signal_object*> (net->fun);
+      vvp_fun_signal_object*obj = cp->sig_object;
       assert(obj);
 
       vvp_darray*darray = obj->get_object().peek<vvp_darray>();
@@ -5492,8 +5312,7 @@ bool of_STORE_DAR_STR(vthread_t thr, vvp_code_t cp)
 	// Pop the string to be stored...
       string value = thr->pop_str();
 
-      vvp_net_t*net = cp->net;
-      vvp_fun_signal_object*obj = dynamic_cast<vvp_fun_signal_object*> (net->fun);
+      vvp_fun_signal_object*obj = cp->sig_object;
       assert(obj);
 
       vvp_darray*darray = obj->get_object().peek<vvp_darray>();
@@ -5511,8 +5330,7 @@ bool of_STORE_DAR_VEC4(vthread_t thr, vvp_code_t cp)
 	// Pop the real value to be store...
       vvp_vector4_t value = thr->pop_vec4();
 
-      vvp_net_t*net = cp->net;
-      vvp_fun_signal_object*obj = dynamic_cast<vvp_fun_signal_object*> (net->fun);
+      vvp_fun_signal_object*obj = cp->sig_object;
       assert(obj);
 
       vvp_darray*darray = obj->get_object().peek<vvp_darray>();
@@ -5664,8 +5482,7 @@ bool of_STORE_QB_STR(vthread_t thr, vvp_code_t cp)
 	// Pop the string to be stored...
       string value = thr->pop_str();
 
-      vvp_net_t*net = cp->net;
-      vvp_queue*dqueue = get_queue_object<vvp_queue_string>(thr, net);
+      vvp_queue*dqueue = get_queue_object<vvp_queue_string>(thr, cp);
 
       assert(dqueue);
       dqueue->push_back(value);
@@ -5680,12 +5497,11 @@ bool of_STORE_QB_V(vthread_t thr, vvp_code_t cp)
 	// Pop the vec4 value to be stored...
       vvp_vector4_t value = thr->pop_vec4();
 
-      vvp_net_t*net = cp->net;
       unsigned wid = cp->bit_idx[0];
 
       assert(value.size() == wid);
 
-      vvp_queue*dqueue = get_queue_object<vvp_queue_vec4>(thr, net);
+      vvp_queue*dqueue = get_queue_object<vvp_queue_vec4>(thr, cp);
 
       assert(dqueue);
       dqueue->push_back(value);
@@ -5705,9 +5521,15 @@ bool of_STORE_QF_R(vthread_t, vvp_code_t)
 /*
  * %store/qf/str <var-label>
  */
-bool of_STORE_QF_STR(vthread_t, vvp_code_t)
+bool of_STORE_QF_STR(vthread_t thr, vvp_code_t cp)
 {
-      fprintf(stderr, "XXXX %%store/qf/str NOT IMPLEMENTED\n");
+	// Pop the string to be stored...
+      string value = thr->pop_str();
+
+      vvp_queue*dqueue = get_queue_object<vvp_queue_string>(thr, cp);
+
+      assert(dqueue);
+      dqueue->push_front(value);
       return true;
 }
 
@@ -5719,10 +5541,9 @@ bool of_STORE_QF_V(vthread_t thr, vvp_code_t cp)
 	// Pop the vec4 value to be stored...
       vvp_vector4_t value = thr->pop_vec4();
 
-      vvp_net_t*net = cp->net;
       unsigned wid = cp->bit_idx[0];
 
-      vvp_queue*dqueue = get_queue_object<vvp_queue_vec4>(thr, net);
+      vvp_queue*dqueue = get_queue_object<vvp_queue_vec4>(thr, cp);
 
       assert(value.size() == wid);
       assert(dqueue);
@@ -5800,7 +5621,7 @@ bool of_STORE_STRA(vthread_t thr, vvp_code_t cp)
 bool of_STORE_VEC4(vthread_t thr, vvp_code_t cp)
 {
       vvp_net_ptr_t ptr(cp->net, 0);
-      vvp_signal_value*sig = dynamic_cast<vvp_signal_value*> (cp->net->fil);
+      vvp_signal_value*sig = cp->sig_value;
       unsigned off_index = cp->bit_idx[0];
       int wid = cp->bit_idx[1];
 
@@ -6012,7 +5833,7 @@ bool of_TEST_NUL(vthread_t thr, vvp_code_t cp)
       vvp_net_t*net = cp->net;
 
       assert(net);
-      vvp_fun_signal_object*obj = dynamic_cast<vvp_fun_signal_object*> (net->fun);
+      vvp_fun_signal_object*obj = cp->sig_object;
       assert(obj);
 
       if (obj->get_object().test_nil())
@@ -6106,7 +5927,7 @@ bool of_WAIT(vthread_t thr, vvp_code_t cp)
       thr->waiting_for_event = 1;
 
 	/* Add this thread to the list in the event. */
-      waitable_hooks_s*ep = dynamic_cast<waitable_hooks_s*> (cp->net->fun);
+      waitable_hooks_s*ep = cp->waitable;
       assert(ep);
       thr->wait_next = ep->add_waiting_thread(thr);
 
@@ -6269,7 +6090,7 @@ bool of_EXEC_UFUNC_VEC4(vthread_t thr, vvp_code_t cp)
       __vpiScope*child_scope = cp->ufunc_core_ptr->func_scope();
       assert(child_scope);
 
-      vpiScopeFunction*scope_func = dynamic_cast<vpiScopeFunction*>(child_scope);
+      vpiScopeFunction*scope_func = cp->scope_func;
       assert(scope_func);
 
 	/* Create a temporary thread and run it immediately. */
@@ -6302,3 +6123,366 @@ bool of_REAP_UFUNC(vthread_t thr, vvp_code_t cp)
 
       return true;
 }
+
+/*
+ * 2-state instructions
+ *
+ * The code generator uses these for expressions whose operands are
+ * all 2-state variables (bit, byte, int, longint, ...) or constants
+ * no wider than 64 bits. The values are kept on the vec2 stack as
+ * native words, so there are no bbits to carry and no X or Z bits to
+ * check for. The bits above the width of a value are not kept clear;
+ * only the compares and the stores look at the width. The variables
+ * themselves still hold vec4 values, so the loads and stores convert.
+ */
+
+/*
+ * Sign extend the low wid bits of val to 64 bits.
+ */
+static inline int64_t vec2_signed(uint64_t val, unsigned wid)
+{
+      if (wid >= 64)
+	    return (int64_t)val;
+
+      uint64_t sign = (uint64_t)1 << (wid-1);
+      val &= (sign << 1) - 1;
+      return (int64_t)(val ^ sign) - (int64_t)sign;
+}
+
+static inline uint64_t vec2_unsigned(uint64_t val, unsigned wid)
+{
+      if (wid >= 64)
+	    return val;
+
+      return val & (((uint64_t)1 << wid) - 1);
+}
+
+/*
+ * %add/vec2
+ */
+bool of_ADD_VEC2(vthread_t thr, vvp_code_t)
+{
+      uint64_t rval = thr->pop_vec2();
+      thr->peek_vec2() += rval;
+      return true;
+}
+
+/*
+ * %and/vec2
+ */
+bool of_AND_VEC2(vthread_t thr, vvp_code_t)
+{
+      uint64_t rval = thr->pop_vec2();
+      thr->peek_vec2() &= rval;
+      return true;
+}
+
+static inline void do_CMP_VEC2(vthread_t thr, bool eq, bool lt)
+{
+      thr->flags[4] = eq? BIT4_1 : BIT4_0;
+      thr->flags[5] = lt? BIT4_1 : BIT4_0;
+      thr->flags[6] = thr->flags[4];
+}
+
+/*
+ * %cmp/vec2/s <wid>
+ */
+bool of_CMP_VEC2_S(vthread_t thr, vvp_code_t cp)
+{
+      int64_t rval = vec2_signed(thr->pop_vec2(), cp->number);
+      int64_t lval = vec2_signed(thr->pop_vec2(), cp->number);
+      do_CMP_VEC2(thr, lval == rval, lval < rval);
+      return true;
+}
+
+/*
+ * %cmp/vec2/u <wid>
+ */
+bool of_CMP_VEC2_U(vthread_t thr, vvp_code_t cp)
+{
+      uint64_t rval = vec2_unsigned(thr->pop_vec2(), cp->number);
+      uint64_t lval = vec2_unsigned(thr->pop_vec2(), cp->number);
+      do_CMP_VEC2(thr, lval == rval, lval < rval);
+      return true;
+}
+
+/*
+ * %inv/vec2
+ */
+bool of_INV_VEC2(vthread_t thr, vvp_code_t)
+{
+      uint64_t&val = thr->peek_vec2();
+      val = ~val;
+      return true;
+}
+
+/*
+ * %load/vec2 <net>
+ *
+ * A 2-state variable has no X or Z bits, but treat them as 0 if the
+ * net is written with them anyway, as a 2-state variable would.
+ */
+bool of_LOAD_VEC2(vthread_t thr, vvp_code_t cp)
+{
+      vvp_vector4_t sig_value;
+      load_vec4_value(cp, sig_value);
+
+      unsigned long word;
+      if (sig_value.get_word2(word)) {
+	    thr->push_vec2(word);
+	    return true;
+      }
+
+      unsigned wid = sig_value.size() < 64? sig_value.size() : 64;
+      uint64_t val = 0;
+      for (unsigned idx = 0 ; idx < wid ; idx += 1) {
+	    if (sig_value.value(idx) == BIT4_1)
+		  val |= (uint64_t)1 << idx;
+      }
+      thr->push_vec2(val);
+      return true;
+}
+
+/*
+ * %mul/vec2
+ */
+bool of_MUL_VEC2(vthread_t thr, vvp_code_t)
+{
+      uint64_t rval = thr->pop_vec2();
+      thr->peek_vec2() *= rval;
+      return true;
+}
+
+/*
+ * %or/vec2
+ */
+bool of_OR_VEC2(vthread_t thr, vvp_code_t)
+{
+      uint64_t rval = thr->pop_vec2();
+      thr->peek_vec2() |= rval;
+      return true;
+}
+
+/*
+ * %pushi/vec2 <low>, <high>
+ */
+bool of_PUSHI_VEC2(vthread_t thr, vvp_code_t cp)
+{
+      thr->push_vec2((uint64_t)cp->bit_idx[1] << 32 | cp->bit_idx[0]);
+      return true;
+}
+
+/*
+ * %store/vec2 <net>, <wid>
+ *
+ * The code generator only uses this to write the whole variable, so
+ * <wid> is the width of the variable.
+ */
+bool of_STORE_VEC2(vthread_t thr, vvp_code_t cp)
+{
+      vvp_net_ptr_t ptr(cp->net, 0);
+      unsigned wid = cp->bit_idx[0];
+      uint64_t val = thr->pop_vec2();
+
+      unsigned long words[2];
+      words[0] = (unsigned long)val;
+      words[1] = (sizeof(unsigned long) < sizeof(uint64_t))
+	    ? (unsigned long)(val >> 32) : 0;
+
+      vvp_vector4_t tmp (wid, BIT4_0);
+      tmp.setarray(0, wid, words);
+      vvp_send_vec4(ptr, tmp, thr->wt_context);
+      return true;
+}
+
+/*
+ * %sub/vec2
+ */
+bool of_SUB_VEC2(vthread_t thr, vvp_code_t)
+{
+      uint64_t rval = thr->pop_vec2();
+      thr->peek_vec2() -= rval;
+      return true;
+}
+
+/*
+ * %xor/vec2
+ */
+bool of_XOR_VEC2(vthread_t thr, vvp_code_t)
+{
+      uint64_t rval = thr->pop_vec2();
+      thr->peek_vec2() ^= rval;
+      return true;
+}
+
+/*
+ * Superinstructions
+ *
+ * At the end of compile, compile_fuse_opcodes() replaces the opcode
+ * of the first instruction of some common instruction sequences with
+ * one of these. The rest of the sequence is left in place, so a jump
+ * into the middle of a sequence still works, and the implementations
+ * here take their operands from the original instructions. Each does
+ * the work of the entire sequence without going through the vec4
+ * stack, and steps the pc past the sequence.
+ */
+
+/*
+ * Get the value of a %pushi/vec4 or %cmpi immediate operand as a
+ * single word. This returns false if the value does not fit in a
+ * word or has X or Z bits.
+ */
+static inline bool get_immediate_word(vvp_code_t cp, unsigned long&val)
+{
+      unsigned wid = cp->number;
+      if (cp->bit_idx[1] != 0 || wid == 0 || wid > CPU_WORD_BITS)
+	    return false;
+
+      val = cp->bit_idx[0];
+      if (wid < CPU_WORD_BITS)
+	    val &= -1UL >> (CPU_WORD_BITS - wid);
+      return true;
+}
+
+/*
+ * Compare lval with the immediate operand of the %cmpi/e at icp, and
+ * set flags 4 and 6 just as %cmpi/e does.
+ */
+static void do_CMPIE_value(vthread_t thr, const vvp_vector4_t&lval, vvp_code_t icp)
+{
+      unsigned long lword, rword;
+      if (lval.size() == icp->number && lval.get_word2(lword)
+	  && get_immediate_word(icp, rword)) {
+	    thr->flags[4] = thr->flags[6] = (lword == rword)? BIT4_1 : BIT4_0;
+	    return;
+      }
+
+      vvp_vector4_t rval (icp->number, BIT4_0);
+      get_immediate_rval (icp, rval);
+      do_CMPE(thr, lval, rval);
+}
+
+/*
+ * %load/vec4 <net>
+ * %cmpi/e <vala>, <valb>, <wid>
+ */
+bool of_LOAD_CMPIE(vthread_t thr, vvp_code_t cp)
+{
+      count_opcodes_fused_run += 1;
+      thr->pc = cp + 2;
+
+      vvp_vector4_t lval;
+      load_vec4_value(cp, lval);
+      do_CMPIE_value(thr, lval, cp+1);
+      return true;
+}
+
+/*
+ * %load/vec4 <net>
+ * %cmpi/ne <vala>, <valb>, <wid>
+ */
+bool of_LOAD_CMPINE(vthread_t thr, vvp_code_t cp)
+{
+      count_opcodes_fused_run += 1;
+      thr->pc = cp + 2;
+
+      vvp_vector4_t lval;
+      load_vec4_value(cp, lval);
+      do_CMPIE_value(thr, lval, cp+1);
+      thr->flags[4] = ~thr->flags[4];
+      thr->flags[6] = ~thr->flags[6];
+      return true;
+}
+
+/*
+ * %load/vec4 <net>
+ * %cmpi/e <vala>, <valb>, <wid>
+ * %jmp/0xz <pc>, <flag>
+ */
+bool of_LOAD_CMPIE_JMP0XZ(vthread_t thr, vvp_code_t cp)
+{
+      of_LOAD_CMPIE(thr, cp);
+      thr->pc = cp + 3;
+      return of_JMP0XZ(thr, cp+2);
+}
+
+/*
+ * %load/vec4 <net>
+ * %cmpi/ne <vala>, <valb>, <wid>
+ * %jmp/0xz <pc>, <flag>
+ */
+bool of_LOAD_CMPINE_JMP0XZ(vthread_t thr, vvp_code_t cp)
+{
+      of_LOAD_CMPINE(thr, cp);
+      thr->pc = cp + 3;
+      return of_JMP0XZ(thr, cp+2);
+}
+
+/*
+ * This is one entry of the branch table of a case statement:
+ *
+ * %dup/vec4
+ * %pushi/vec4 <vala>, <valb>, <wid>
+ * %cmp/u
+ * %jmp/1 <pc>, <flag>
+ *
+ * The case expression stays on the stack, and is compared directly
+ * with the immediate value.
+ */
+bool of_DUP_PUSHI_CMPU_JMP1(vthread_t thr, vvp_code_t cp)
+{
+      count_opcodes_fused_run += 1;
+      thr->pc = cp + 4;
+
+      const vvp_vector4_t&lval = thr->peek_vec4();
+      vvp_code_t icp = cp + 1;
+
+      unsigned long lword, rword;
+      if (lval.size() == icp->number && lval.get_word2(lword)
+	  && get_immediate_word(icp, rword)) {
+	    vvp_bit4_t eq = (lword == rword)? BIT4_1 : BIT4_0;
+	    thr->flags[4] = eq;
+	    thr->flags[5] = (lword < rword)? BIT4_1 : BIT4_0;
+	    thr->flags[6] = eq;
+      } else {
+	    vvp_vector4_t rval (icp->number, BIT4_0);
+	    get_immediate_rval (icp, rval);
+	    do_CMPU(thr, lval, rval);
+      }
+
+      return of_JMP1(thr, cp+3);
+}
+
+/*
+ * %load/vec4 <net>
+ * %assign/vec4 <var-label>, <delay>
+ */
+bool of_LOAD_ASSIGN_VEC4(vthread_t thr, vvp_code_t cp)
+{
+      count_opcodes_fused_run += 1;
+      thr->pc = cp + 2;
+
+      vvp_vector4_t val;
+      load_vec4_value(cp, val);
+
+      vvp_net_ptr_t ptr (cp[1].net, 0);
+      schedule_assign_vector(ptr, 0, 0, val, cp[1].bit_idx[0]);
+      return true;
+}
+
+/*
+ * %pushi/vec4 <vala>, <valb>, <wid>
+ * %assign/vec4 <var-label>, <delay>
+ */
+bool of_PUSHI_ASSIGN_VEC4(vthread_t thr, vvp_code_t cp)
+{
+      count_opcodes_fused_run += 1;
+      thr->pc = cp + 2;
+
+      vvp_vector4_t val (cp->number, BIT4_0);
+      get_immediate_rval (cp, val);
+
+      vvp_net_ptr_t ptr (cp[1].net, 0);
+      schedule_assign_vector(ptr, 0, 0, val, cp[1].bit_idx[0]);
+      return true;
+}
@@ -75,6 +75,14 @@ extern void vthread_schedule_list(vthread_t thr);
 
 extern __vpiScope*vthread_scope(vthread_t thr);
 
+/*
+ * Walk the list of threads waiting on an event, or add a thread to
+ * such a list, as the %wait instruction does. The checkpoints use
+ * these to save and restore the wait lists.
+ */
+extern vthread_t vthread_wait_next(vthread_t thr);
+extern void vthread_wait_on(vthread_t thr, struct waitable_hooks_s*ep);
+
 /*
  * This function returns a handle to the writable context of the currently
  * running thread. Normally the writable context is the context allocated
@@ -41,6 +41,7 @@ extern void vpi_handle_delete(void);
 extern void vpi_stack_delete(void);
 extern void vvp_net_pool_delete(void);
 extern void ufunc_pool_delete(void);
+extern void vthread_pool_delete(void);
 
 extern void A_delete(class __vpiHandle *item);
 extern void APV_delete(class __vpiHandle *item);
@@ -364,18 +364,17 @@ void vvp_queue_string::push_back(const string&val)
       array_.push_back(val);
 }
 
+void vvp_queue_string::push_front(const string&val)
+{
+      array_.push_front(val);
+}
+
 void vvp_queue_string::set_word(unsigned adr, const string&value)
 {
       if (adr >= array_.size())
 	    return;
 
-      list<string>::iterator cur = array_.begin();
-      while (adr > 0) {
-	    ++ cur;
-	    adr -= 1;
-      }
-
-      *cur = value;
+      array_[adr] = value;
 }
 
 void vvp_queue_string::get_word(unsigned adr, string&value)
@@ -385,13 +384,7 @@ void vvp_queue_string::get_word(unsigned adr, string&value)
 	    return;
       }
 
-      list<string>::const_iterator cur = array_.begin();
-      while (adr > 0) {
-	    ++ cur;
-	    adr -= 1;
-      }
-
-      value = *cur;
+      value = array_[adr];
 }
 
 void vvp_queue_string::pop_back(void)
@@ -404,61 +397,119 @@ void vvp_queue_string::pop_front(void)
       array_.pop_front();
 }
 
+vvp_queue_vec4::vvp_queue_vec4()
+: packed_(true), packed_wid_(0)
+{
+}
+
 vvp_queue_vec4::~vvp_queue_vec4()
 {
 }
 
+bool vvp_queue_vec4::pack_(const vvp_vector4_t&value, unsigned long&word)
+{
+      if (! packed_)
+	    return false;
+      if (packed_wid_ != 0 && packed_wid_ != value.size())
+	    return false;
+      if (! value.get_word2(word))
+	    return false;
+
+      packed_wid_ = value.size();
+      return true;
+}
+
+/*
+ * Switch the queue from packed 2-state words to vec4 items. This
+ * happens at most once in the life of the queue.
+ */
+void vvp_queue_vec4::unpack_(void)
+{
+      if (! packed_)
+	    return;
+
+      packed_ = false;
+      while (bits_.size() > 0) {
+	    vvp_vector4_t tmp (packed_wid_, BIT4_0);
+	    tmp.setarray(0, packed_wid_, &bits_[0]);
+	    array_.push_back(tmp);
+	    bits_.pop_front();
+      }
+}
+
 size_t vvp_queue_vec4::get_size() const
 {
-      return array_.size();
+      return packed_? bits_.size() : array_.size();
 }
 
 void vvp_queue_vec4::set_word(unsigned adr, const vvp_vector4_t&value)
 {
-      if (adr >= array_.size())
+      if (adr >= get_size())
 	    return;
 
-      list<vvp_vector4_t>::iterator cur = array_.begin();
-      while (adr > 0) {
-	    ++ cur;
-	    adr -= 1;
+      unsigned long word;
+      if (pack_(value, word)) {
+	    bits_[adr] = word;
+	    return;
       }
 
-      *cur = value;
+      unpack_();
+      array_[adr] = value;
 }
 
 void vvp_queue_vec4::get_word(unsigned adr, vvp_vector4_t&value)
 {
-      if (adr >= array_.size()) {
+      if (adr >= get_size()) {
 	    value = vvp_vector4_t();
 	    return;
       }
 
-      list<vvp_vector4_t>::const_iterator cur = array_.begin();
-      while (adr > 0) {
-	    ++ cur;
-	    adr -= 1;
+      if (packed_) {
+	    vvp_vector4_t tmp (packed_wid_, BIT4_0);
+	    tmp.setarray(0, packed_wid_, &bits_[adr]);
+	    value.swap(tmp);
+	    return;
       }
 
-      value = *cur;
+      value = array_[adr];
 }
 
 void vvp_queue_vec4::push_back(const vvp_vector4_t&val)
 {
+      unsigned long word;
+      if (pack_(val, word)) {
+	    bits_.push_back(word);
+	    return;
+      }
+
+      unpack_();
       array_.push_back(val);
 }
 
 void vvp_queue_vec4::push_front(const vvp_vector4_t&val)
 {
+      unsigned long word;
+      if (pack_(val, word)) {
+	    bits_.push_front(word);
+	    return;
+      }
+
+      unpack_();
       array_.push_front(val);
 }
 
 void vvp_queue_vec4::pop_back(void)
 {
-      array_.pop_back();
+      if (packed_)
+	    bits_.pop_back();
+      else
+	    array_.pop_back();
 }
 
 void vvp_queue_vec4::pop_front(void)
 {
-      array_.pop_front();
+      if (packed_)
+	    bits_.pop_front();
+      else
+	    array_.pop_front();
 }
@@ -21,7 +21,6 @@
 
 # include  "vvp_object.h"
 # include  "vvp_net.h"
-# include  <list>
 # include  <string>
 # include  <vector>
 
@@ -142,6 +141,99 @@ class vvp_darray_object : public vvp_darray {
       std::vector<vvp_object_t> array_;
 };
 
+/*
+ * The queue classes keep their items in a vvp_ring_buf. This is a
+ * contiguous ring buffer whose capacity is always a power of 2, so
+ * the logical index of an item is mapped to its slot with a mask,
+ * and the buffer grows by doubling. That makes push and pop at
+ * either end, and indexed access, all constant time.
+ */
+template <class TYPE> inline void vvp_ring_move(TYPE&dst, TYPE&src)
+{ dst = src; }
+inline void vvp_ring_move(vvp_vector4_t&dst, vvp_vector4_t&src)
+{ dst.swap(src); }
+inline void vvp_ring_move(std::string&dst, std::string&src)
+{ dst.swap(src); }
+
+template <class TYPE> class vvp_ring_buf {
+
+    public:
+      inline vvp_ring_buf() : buf_(0), cap_(0), head_(0), size_(0) { }
+      inline ~vvp_ring_buf() { delete[] buf_; }
+
+      inline size_t size() const { return size_; }
+
+      inline TYPE& operator[] (size_t idx)
+      { return buf_[(head_+idx) & (cap_-1)]; }
+      inline const TYPE& operator[] (size_t idx) const
+      { return buf_[(head_+idx) & (cap_-1)]; }
+
+      void push_back(const TYPE&val);
+      void push_front(const TYPE&val);
+	// The popped slot is reset to a default value so that any
+	// storage the item holds is released right away.
+      void pop_back(void);
+      void pop_front(void);
+
+    private:
+      void grow_(void);
+
+    private:
+      TYPE*buf_;
+      size_t cap_;
+      size_t head_;
+      size_t size_;
+
+    private: // not implemented
+      vvp_ring_buf(const vvp_ring_buf&);
+      vvp_ring_buf& operator= (const vvp_ring_buf&);
+};
+
+template <class TYPE> void vvp_ring_buf<TYPE>::grow_(void)
+{
+      size_t new_cap = cap_? 2*cap_ : 8;
+      TYPE*tmp = new TYPE[new_cap];
+      for (size_t idx = 0 ; idx < size_ ; idx += 1)
+	    vvp_ring_move(tmp[idx], (*this)[idx]);
+
+      delete[] buf_;
+      buf_ = tmp;
+      cap_ = new_cap;
+      head_ = 0;
+}
+
+template <class TYPE> inline void vvp_ring_buf<TYPE>::push_back(const TYPE&val)
+{
+      if (size_ == cap_)
+	    grow_();
+      buf_[(head_+size_) & (cap_-1)] = val;
+      size_ += 1;
+}
+
+template <class TYPE> inline void vvp_ring_buf<TYPE>::push_front(const TYPE&val)
+{
+      if (size_ == cap_)
+	    grow_();
+      head_ = (head_-1) & (cap_-1);
+      buf_[head_] = val;
+      size_ += 1;
+}
+
+template <class TYPE> inline void vvp_ring_buf<TYPE>::pop_back(void)
+{
+      assert(size_ > 0);
+      size_ -= 1;
+      buf_[(head_+size_) & (cap_-1)] = TYPE();
+}
+
+template <class TYPE> inline void vvp_ring_buf<TYPE>::pop_front(void)
+{
+      assert(size_ > 0);
+      buf_[head_] = TYPE();
+      head_ = (head_+1) & (cap_-1);
+      size_ -= 1;
+}
+
 class vvp_queue : public vvp_darray {
 
     public:
@@ -161,9 +253,17 @@ class vvp_queue : public vvp_darray {
       virtual void pop_front(void)=0;
 };
 
+/*
+ * The .var/queue does not carry the element type, so the vec4 queue
+ * starts out keeping its items packed as 2-state words. This is the
+ * representation that bit/int/byte... queues keep for their whole
+ * life. The first item that is wider than a word, has a different
+ * width, or has X or Z bits switches the queue to full vec4 items.
+ */
 class vvp_queue_vec4 : public vvp_queue {
 
     public:
+      vvp_queue_vec4();
       ~vvp_queue_vec4();
 
       size_t get_size(void) const;
@@ -175,7 +275,16 @@ class vvp_queue_vec4 : public vvp_queue {
       void pop_front(void);
 
     private:
-      std::list<vvp_vector4_t> array_;
+	// Return true and the packed word if value can be stored in
+	// the packed array.
+      bool pack_(const vvp_vector4_t&value, unsigned long&word);
+      void unpack_(void);
+
+    private:
+      bool packed_;
+      unsigned packed_wid_;
+      vvp_ring_buf<unsigned long> bits_;
+      vvp_ring_buf<vvp_vector4_t> array_;
 };
 
 
@@ -188,12 +297,12 @@ class vvp_queue_string : public vvp_queue {
       void set_word(unsigned adr, const std::string&value);
       void get_word(unsigned adr, std::string&value);
       void push_back(const std::string&value);
-	//void push_front(const std::string&value);
+      void push_front(const std::string&value);
       void pop_back(void);
       void pop_front(void);
 
     private:
-      std::list<std::string> array_;
+      vvp_ring_buf<std::string> array_;
 };
 
 #endif /* IVL_vvp_darray_H */
@@ -25,6 +25,7 @@
 # include  "resolv.h"
 # include  "schedule.h"
 # include  "statistics.h"
+# include  "checkpoint.h"
 # include  <cstdio>
 # include  <cstring>
 # include  <cstdlib>
@@ -33,6 +34,7 @@
 # include  <climits>
 # include  <cmath>
 # include  <cassert>
+# include  <algorithm>
 #ifdef CHECK_WITH_VALGRIND
 # include  <valgrind/memcheck.h>
 # include  <map>
@@ -46,51 +48,111 @@
 # define CPU_WORD_BITS (8*sizeof(unsigned long))
 # define TOP_BIT (1UL << (CPU_WORD_BITS-1))
 
-permaheap vvp_net_fun_t::heap_;
-permaheap vvp_net_fil_t::heap_;
+permaheap vvp_net_heap;
 
-// Allocate around 1Megabyte/chunk.
+#ifdef CHECK_WITH_VALGRIND
+// Allocate around 1Megabyte/chunk. The nets get their own chunks when
+// checking with valgrind so that they can be put into memory pools.
 static const size_t VVP_NET_CHUNK = 1024*1024/sizeof(vvp_net_t);
 static vvp_net_t*vvp_net_alloc_table = NULL;
-#ifdef CHECK_WITH_VALGRIND
 static vvp_net_t **vvp_net_pool = NULL;
 static unsigned vvp_net_pool_count = 0;
-#endif
 static size_t vvp_net_alloc_remaining = 0;
-// For statistics, count the vvp_nets allocated and the bytes of alloc
-// chunks allocated.
+#endif
+// Keep a list of all the nets so that they can be enumerated. They
+// are mixed in with the functors and filters in the vvp_net_heap.
+static vector<vvp_net_t*> vvp_net_list;
+// For statistics, count the vvp_nets allocated and the bytes they use.
 unsigned long count_vvp_nets = 0;
 size_t size_vvp_nets = 0;
 
 void* vvp_net_t::operator new (size_t size)
 {
       assert(size == sizeof(vvp_net_t));
+#ifdef CHECK_WITH_VALGRIND
       if (vvp_net_alloc_remaining == 0) {
 	    vvp_net_alloc_table = ::new vvp_net_t[VVP_NET_CHUNK];
 	    vvp_net_alloc_remaining = VVP_NET_CHUNK;
-	    size_vvp_nets += size*VVP_NET_CHUNK;
-#ifdef CHECK_WITH_VALGRIND
 	    VALGRIND_MAKE_MEM_NOACCESS(vvp_net_alloc_table, size*VVP_NET_CHUNK);
 	    VALGRIND_CREATE_MEMPOOL(vvp_net_alloc_table, 0, 0);
 	    vvp_net_pool_count += 1;
 	    vvp_net_pool = (vvp_net_t **) realloc(vvp_net_pool,
 	                   vvp_net_pool_count*sizeof(vvp_net_t **));
 	    vvp_net_pool[vvp_net_pool_count-1] = vvp_net_alloc_table;
-#endif
       }
 
       vvp_net_t*return_this = vvp_net_alloc_table;
-#ifdef CHECK_WITH_VALGRIND
       VALGRIND_MEMPOOL_ALLOC(vvp_net_pool[vvp_net_pool_count-1],
                              return_this, size);
       return_this->pool = vvp_net_pool[vvp_net_pool_count-1];
-#endif
       vvp_net_alloc_table += 1;
       vvp_net_alloc_remaining -= 1;
+#else
+      vvp_net_t*return_this = (vvp_net_t*) vvp_net_heap.alloc(size);
+#endif
+      vvp_net_list.push_back(return_this);
       count_vvp_nets += 1;
+      size_vvp_nets += size;
       return return_this;
 }
 
+void vvp_net_t::get_all_nets(vector<vvp_net_t*>&nets)
+{
+      nets.insert(nets.end(), vvp_net_list.begin(), vvp_net_list.end());
+}
+
+/*
+ * Measure how well the nets are laid out for propagation. A send
+ * walks from a net to each of its fanout nets and calls the functor
+ * of each, so report the median distance in bytes from a net to its
+ * fanout nets and to its own functor, and the fraction of each that
+ * are within a page. The median is used because the few links that
+ * cross between heap chunks are very far.
+ */
+static size_t layout_distance(const void*a, const void*b)
+{
+      const char*pa = reinterpret_cast<const char*>(a);
+      const char*pb = reinterpret_cast<const char*>(b);
+      return pa > pb ? pa - pb : pb - pa;
+}
+
+static void layout_summary(vector<size_t>&dist, vvp_net_t::layout_s&res)
+{
+      res.count = dist.size();
+      res.median = 0;
+      res.near = 0;
+      if (dist.empty())
+	    return;
+
+      for (size_t idx = 0 ; idx < dist.size() ; idx += 1)
+	    if (dist[idx] < 4096) res.near += 1;
+
+      vector<size_t>::iterator mid = dist.begin() + dist.size()/2;
+      nth_element(dist.begin(), mid, dist.end());
+      res.median = *mid;
+}
+
+void vvp_net_t::layout_stats(layout_s&fanout, layout_s&funs)
+{
+      vector<size_t> fanout_dist, fun_dist;
+
+      for (size_t idx = 0 ; idx < vvp_net_list.size() ; idx += 1) {
+	    vvp_net_t*net = vvp_net_list[idx];
+
+	    if (net->fun)
+		  fun_dist.push_back(layout_distance(net, net->fun));
+
+	    vvp_net_ptr_t cur = net->out_;
+	    while (vvp_net_t*dst = cur.ptr()) {
+		  fanout_dist.push_back(layout_distance(net, dst));
+		  cur = dst->port[cur.port()];
+	    }
+      }
+
+      layout_summary(fanout_dist, fanout);
+      layout_summary(fun_dist, funs);
+}
+
 #ifdef CHECK_WITH_VALGRIND
 static map<vvp_net_t*, bool> vvp_net_map;
 static map<sfunc_core*, bool> sfunc_map;
@@ -179,6 +241,7 @@ void vvp_net_pool_delete()
       free(vvp_net_pool);
       vvp_net_pool = NULL;
       vvp_net_pool_count = 0;
+      vector<vvp_net_t*>().swap(vvp_net_list);
 }
 #endif
 
@@ -399,6 +462,36 @@ void vvp_net_fil_t::force_unlink(void)
       force_link_->port[2] = vvp_net_ptr_t(0,0);
 }
 
+void vvp_net_fil_t::checkpoint_save_force(checkpoint_out&out) const
+{
+      out.refuse("a net of a type that cannot save its force is forced");
+}
+
+void vvp_net_fil_t::checkpoint_load_force(checkpoint_in&in, vvp_net_t*)
+{
+      in.corrupt("force on a net that cannot be forced");
+}
+
+void vvp_net_fil_t::checkpoint_save_mask_(checkpoint_out&out) const
+{
+      out.put_vec2(force_mask_);
+      out.put_net(force_link_? force_link_->port[2].ptr() : 0);
+      out.put_uint(force_propagate_? 1 : 0);
+}
+
+vvp_vector2_t vvp_net_fil_t::checkpoint_load_mask_(checkpoint_in&in,
+						   unsigned wid,
+						   vvp_net_t*&src,
+						   bool&propagate)
+{
+      vvp_vector2_t mask = in.get_vec2();
+      src = in.get_net();
+      propagate = in.get_uint() != 0;
+      if (mask.size() != wid)
+	    in.corrupt("force mask does not fit the net");
+      return mask;
+}
+
 /* *** BIT operations *** */
 vvp_bit4_t add_with_carry(vvp_bit4_t a, vvp_bit4_t b, vvp_bit4_t&c)
 {
@@ -515,6 +608,7 @@ int edge(vvp_bit4_t from, vvp_bit4_t to)
       return 0;
 }
 
+#if !(SIZEOF_UNSIGNED_LONG == 8 && defined(__SIZEOF_INT128__))
 unsigned long multiply_with_carry(unsigned long a, unsigned long b,
 				  unsigned long&carry)
 {
@@ -556,6 +650,7 @@ unsigned long multiply_with_carry(unsigned long a, unsigned long b,
       carry = (r3 << (CPU_WORD_BITS/2)) + r2;
       return (r1 << (CPU_WORD_BITS/2)) + r00;
 }
+#endif
 
 
 void vvp_send_vec8(vvp_net_ptr_t ptr, const vvp_vector8_t&val)
@@ -698,7 +793,7 @@ void vvp_vector4_t::copy_bits(const vvp_vector4_t&that)
 void vvp_vector4_t::copy_from_big_(const vvp_vector4_t&that)
 {
       unsigned words = (size_+BITS_PER_WORD-1) / BITS_PER_WORD;
-      abits_ptr_ = new unsigned long[2*words];
+      abits_ptr_ = alloc_bits_(words);
       bbits_ptr_ = abits_ptr_ + words;
 
       for (unsigned idx = 0 ;  idx < words ;  idx += 1)
@@ -717,7 +812,7 @@ void vvp_vector4_t::copy_inverted_from_(const vvp_vector4_t&that)
       size_ = that.size_;
       if (size_ > BITS_PER_WORD) {
 	    unsigned words = (size_+BITS_PER_WORD-1) / BITS_PER_WORD;
-	    abits_ptr_ = new unsigned long[2*words];
+	    abits_ptr_ = alloc_bits_(words);
 	    bbits_ptr_ = abits_ptr_ + words;
 
 	    unsigned remaining = size_;
@@ -747,7 +842,7 @@ void vvp_vector4_t::allocate_words_(unsigned long inita, unsigned long initb)
 {
       if (size_ > BITS_PER_WORD) {
 	    unsigned cnt = (size_ + BITS_PER_WORD - 1) / BITS_PER_WORD;
-	    abits_ptr_ = new unsigned long[2*cnt];
+	    abits_ptr_ = alloc_bits_(cnt);
 	    bbits_ptr_ = abits_ptr_ + cnt;
 	    for (unsigned idx = 0 ;  idx < cnt ;  idx += 1)
 		  abits_ptr_[idx] = inita;
@@ -760,6 +855,55 @@ void vvp_vector4_t::allocate_words_(unsigned long inita, unsigned long initb)
       }
 }
 
+vvp_vector4_small_pool_s vvp_vector4_small_pool;
+
+/*
+ * Take over the bit array of that wide vector. This does not release
+ * any storage that this vector may already hold.
+ */
+void vvp_vector4_t::steal_from_(vvp_vector4_t&that)
+{
+      assert(that.size_ > BITS_PER_WORD);
+      size_ = that.size_;
+      abits_ptr_ = that.abits_ptr_;
+      bbits_ptr_ = that.bbits_ptr_;
+
+      that.size_ = 0;
+      that.abits_val_ = WORD_X_ABITS;
+      that.bbits_val_ = WORD_X_BBITS;
+}
+
+void vvp_vector4_t::swap(vvp_vector4_t&that)
+{
+      if (this == &that)
+	    return;
+
+      vvp_vector4_t tmp;
+      if (that.size_ > BITS_PER_WORD) {
+	    tmp.steal_from_(that);
+      } else {
+	    tmp.size_ = that.size_;
+	    tmp.abits_val_ = that.abits_val_;
+	    tmp.bbits_val_ = that.bbits_val_;
+      }
+
+      if (size_ > BITS_PER_WORD) {
+	    that.steal_from_(*this);
+      } else {
+	    that.size_ = size_;
+	    that.abits_val_ = abits_val_;
+	    that.bbits_val_ = bbits_val_;
+      }
+
+      if (tmp.size_ > BITS_PER_WORD) {
+	    steal_from_(tmp);
+      } else {
+	    size_ = tmp.size_;
+	    abits_val_ = tmp.abits_val_;
+	    bbits_val_ = tmp.bbits_val_;
+      }
+}
+
 vvp_vector4_t::vvp_vector4_t(unsigned size__, double val)
 : size_(size__)
 {
@@ -997,7 +1141,7 @@ void vvp_vector4_t::resize(unsigned newsize, vvp_bit4_t pad_bit)
 		  return;
 	    }
 
-	    unsigned long*newbits = new unsigned long[2*newcnt];
+	    unsigned long*newbits = alloc_bits_(newcnt);
 
 	    if (cnt > 1) {
 		  unsigned trans = cnt;
@@ -1009,7 +1153,7 @@ void vvp_vector4_t::resize(unsigned newsize, vvp_bit4_t pad_bit)
 		  for (unsigned idx = 0 ;  idx < trans ;  idx += 1)
 			newbits[newcnt+idx] = bbits_ptr_[idx];
 
-		  delete[]abits_ptr_;
+		  free_bits_(abits_ptr_, cnt);
 
 	    } else {
 		  newbits[0] = abits_val_;
@@ -1037,7 +1181,7 @@ void vvp_vector4_t::resize(unsigned newsize, vvp_bit4_t pad_bit)
 	    if (cnt > 1) {
 		  unsigned long newvala = abits_ptr_[0];
 		  unsigned long newvalb = bbits_ptr_[0];
-		  delete[]abits_ptr_;
+		  free_bits_();
 		  abits_val_ = newvala;
 		  bbits_val_ = newvalb;
 	    }
@@ -1053,6 +1197,78 @@ void vvp_vector4_t::resize(unsigned newsize, vvp_bit4_t pad_bit)
       }
 }
 
+void vvp_vector4_t::get_vpi_vecval(s_vpi_vecval*val) const
+{
+      unsigned nwords = (size_ + 31) / 32;
+      if (nwords == 0)
+	    return;
+
+      if (size_ <= BITS_PER_WORD) {
+	    unsigned long atmp = abits_val_;
+	    unsigned long btmp = bbits_val_;
+	    for (unsigned idx = 0 ;  idx < nwords ;  idx += 1) {
+		  val[idx].aval = atmp & 0xffffffffUL;
+		  val[idx].bval = btmp & 0xffffffffUL;
+		    // Shift in two steps, since a word may be 32 bits.
+		  atmp = (atmp >> 16) >> 16;
+		  btmp = (btmp >> 16) >> 16;
+	    }
+      } else {
+	    for (unsigned idx = 0 ;  idx < nwords ;  idx += 1) {
+		  unsigned word = idx*32 / BITS_PER_WORD;
+		  unsigned shift = idx*32 % BITS_PER_WORD;
+		  val[idx].aval = (abits_ptr_[word] >> shift) & 0xffffffffUL;
+		  val[idx].bval = (bbits_ptr_[word] >> shift) & 0xffffffffUL;
+	    }
+      }
+
+	// Clear the bits past the end of the vector.
+      if (size_ % 32) {
+	    PLI_INT32 mask = (1U << (size_ % 32)) - 1;
+	    val[nwords-1].aval &= mask;
+	    val[nwords-1].bval &= mask;
+      }
+}
+
+void vvp_vector4_t::get_vpi_vecval(s_vpi_vecval*val, unsigned base,
+                                   unsigned wid) const
+{
+      assert(base + wid <= size_);
+      if (base == 0 && wid == size_) {
+	    get_vpi_vecval(val);
+	    return;
+      }
+
+      unsigned nwords = (wid + 31) / 32;
+      if (nwords == 0)
+	    return;
+
+      const unsigned long*abits = size_ > BITS_PER_WORD? abits_ptr_ : &abits_val_;
+      const unsigned long*bbits = size_ > BITS_PER_WORD? bbits_ptr_ : &bbits_val_;
+      unsigned nsrc = (size_ + BITS_PER_WORD - 1) / BITS_PER_WORD;
+
+      for (unsigned idx = 0 ;  idx < nwords ;  idx += 1) {
+	    unsigned adr = base + idx*32;
+	    unsigned word = adr / BITS_PER_WORD;
+	    unsigned shift = adr % BITS_PER_WORD;
+	    unsigned long atmp = abits[word] >> shift;
+	    unsigned long btmp = bbits[word] >> shift;
+	      // The 32 bits may straddle two words.
+	    if (shift + 32 > BITS_PER_WORD && word+1 < nsrc) {
+		  atmp |= abits[word+1] << (BITS_PER_WORD - shift);
+		  btmp |= bbits[word+1] << (BITS_PER_WORD - shift);
+	    }
+	    val[idx].aval = atmp & 0xffffffffUL;
+	    val[idx].bval = btmp & 0xffffffffUL;
+      }
+
+	// Clear the bits past the end of the part.
+      if (wid % 32) {
+	    PLI_INT32 mask = (1U << (wid % 32)) - 1;
+	    val[nwords-1].aval &= mask;
+	    val[nwords-1].bval &= mask;
+      }
+}
 
 unsigned long* vvp_vector4_t::subarray(unsigned adr, unsigned wid, bool xz_to_0) const
 {
@@ -1414,6 +1630,63 @@ bool vvp_vector4_t::set_vec(unsigned adr, const vvp_vector4_t&that)
       return diff_flag;
 }
 
+/*
+ * Set cnt bits of this vector, starting at adr, from the bits of that
+ * vector starting at src. The bits past the end of that vector are
+ * taken as BIT4_X, as with the subvector constructor. This copies as
+ * many bits at a time as the word boundaries of both vectors allow.
+ */
+bool vvp_vector4_t::set_vec(unsigned adr, const vvp_vector4_t&that,
+			    unsigned src, unsigned cnt)
+{
+      assert(adr+cnt <= size_);
+      bool diff_flag = false;
+
+      unsigned long*dst_a = size_ > BITS_PER_WORD? abits_ptr_ : &abits_val_;
+      unsigned long*dst_b = size_ > BITS_PER_WORD? bbits_ptr_ : &bbits_val_;
+      const unsigned long*src_a = that.size_ > BITS_PER_WORD
+	    ? that.abits_ptr_ : &that.abits_val_;
+      const unsigned long*src_b = that.size_ > BITS_PER_WORD
+	    ? that.bbits_ptr_ : &that.bbits_val_;
+
+      while (cnt > 0) {
+	    unsigned soff = src % BITS_PER_WORD;
+	    unsigned doff = adr % BITS_PER_WORD;
+	    unsigned trans = cnt;
+	    if (trans > BITS_PER_WORD - doff)
+		  trans = BITS_PER_WORD - doff;
+	    if (src < that.size_) {
+		  if (trans > BITS_PER_WORD - soff)
+			trans = BITS_PER_WORD - soff;
+		  if (trans > that.size_ - src)
+			trans = that.size_ - src;
+	    }
+
+	    unsigned long mask = trans < BITS_PER_WORD? (1UL << trans) - 1 : -1UL;
+	    unsigned long abits = mask, bbits = mask;
+	    if (src < that.size_) {
+		  abits = (src_a[src / BITS_PER_WORD] >> soff) & mask;
+		  bbits = (src_b[src / BITS_PER_WORD] >> soff) & mask;
+	    }
+
+	    unsigned long&da = dst_a[adr / BITS_PER_WORD];
+	    unsigned long&db = dst_b[adr / BITS_PER_WORD];
+	    unsigned long tmp_a = (da & ~(mask << doff)) | (abits << doff);
+	    unsigned long tmp_b = (db & ~(mask << doff)) | (bbits << doff);
+	    if (tmp_a != da || tmp_b != db) {
+		  diff_flag = true;
+		  da = tmp_a;
+		  db = tmp_b;
+	    }
+
+	    adr += trans;
+	    src += trans;
+	    cnt -= trans;
+      }
+
+      return diff_flag;
+}
+
 /*
  * Add that vector to this vector. Do it in the Verilog way, which
  * means if we detect any X or Z bits, change the entire results to
@@ -1670,45 +1943,342 @@ void vvp_vector4_t::mul(const vvp_vector4_t&that)
 	    }
       }
 
-	// Calculate the result into a res array. We need to keep is
-	// separate from the "this" array because we are making
-	// multiple passes.
-      unsigned long*res = new unsigned long[cnt];
-      for (int idx = 0 ; idx < cnt ; idx += 1)
-	    res[idx] = 0;
-
-      for (int mul_a = 0 ; mul_a < cnt ; mul_a += 1) {
+	// Multiply in place, working from the most significant word
+	// of this down. Each partial product only lands on words at
+	// or above the word of this that it comes from, and the words
+	// below still hold the original multiplicand.
+      abits_ptr_[cnt-1] &= mask;
+      unsigned long rtop = that.abits_ptr_[cnt-1] & mask;
+      for (int mul_a = cnt-1 ; mul_a >= 0 ; mul_a -= 1) {
 	    unsigned long lval = abits_ptr_[mul_a];
-	    if (mul_a == (cnt-1))
-		  lval &= mask;
+	    abits_ptr_[mul_a] = 0;
+	    if (lval == 0)
+		  continue;
 
+	    unsigned long carry = 0;
 	    for (int mul_b = 0 ; mul_b < (cnt-mul_a) ; mul_b += 1) {
-		  unsigned long rval = that.abits_ptr_[mul_b];
-		  if (mul_b == (cnt-1))
-			rval &= mask;
+		  unsigned long rval = mul_b == (cnt-1)? rtop : that.abits_ptr_[mul_b];
+		  unsigned long high;
+		  unsigned long low = multiply_with_carry(lval, rval, high);
+		  unsigned long c1 = 0, c2 = 0;
+		  low = add_with_carry(low, carry, c1);
+		  abits_ptr_[mul_a+mul_b] = add_with_carry(abits_ptr_[mul_a+mul_b], low, c2);
+		  carry = high + c1 + c2;
+	    }
+      }
+
+	// We know a-priori that the bbits are zero and unchanged.
+      abits_ptr_[cnt-1] &= mask;
+}
+
+/*
+ * The wide divide works on arrays of words, using the classic long
+ * division algorithm (Knuth, TAOCP vol. 2, 4.3.1, algorithm D) that
+ * estimates each quotient word from the top two words of the
+ * remainder. The estimate needs a double word divide, so without a
+ * double word type the remainder is instead built one bit at a time.
+ */
+#if SIZEOF_UNSIGNED_LONG == 8 && defined(__SIZEOF_INT128__)
+__extension__ typedef unsigned __int128 vvp_dword_t;
+# define HAVE_VVP_DWORD 1
+#elif SIZEOF_UNSIGNED_LONG == 4
+typedef uint64_t vvp_dword_t;
+# define HAVE_VVP_DWORD 1
+#endif
 
-		  unsigned long sum;
-		  unsigned long tmp = multiply_with_carry(lval, rval, sum);
-		  int base = mul_a + mul_b;
+static const unsigned WORD_BITS = 8*sizeof(unsigned long);
+
+	// Divides narrower than this many words keep their work
+	// arrays on the stack.
+static const unsigned DIV_STACK_WORDS = 32;
+
+static inline void negate_words(unsigned long*val, unsigned words)
+{
+      unsigned long carry = 1;
+      for (unsigned idx = 0 ; idx < words ; idx += 1)
+	    val[idx] = add_with_carry(0, ~val[idx], carry);
+}
+
+static inline unsigned significant_words(const unsigned long*val, unsigned words)
+{
+      while (words > 0 && val[words-1] == 0)
+	    words -= 1;
+      return words;
+}
+
+/*
+ * Divide the m word number u by the n word number v, where n <= m
+ * and the top word of v is not zero. The quotient (m-n+1 words) goes
+ * to q and the remainder (n words) to r, either of which may be
+ * nil. The work array must have room for m+n+1 words, and q and r
+ * may be the words of u.
+ */
+static void divide_words(const unsigned long*u, unsigned m,
+			 const unsigned long*v, unsigned n,
+			 unsigned long*q, unsigned long*r,
+			 unsigned long*work)
+{
+#ifdef HAVE_VVP_DWORD
+      if (n == 1) {
+	    unsigned long rem = 0;
+	    for (unsigned idx = m ; idx > 0 ; idx -= 1) {
+		  vvp_dword_t num = ((vvp_dword_t)rem << WORD_BITS) | u[idx-1];
+		  unsigned long quo = (unsigned long)(num / v[0]);
+		  rem = (unsigned long)(num - (vvp_dword_t)quo * v[0]);
+		  if (q) q[idx-1] = quo;
+	    }
+	    if (r) r[0] = rem;
+	    return;
+      }
+
+	// Normalize so that the top bit of the divisor is set. This
+	// keeps the quotient estimates at most 2 too large.
+      unsigned long*un = work;
+      unsigned long*vn = work + m + 1;
+      unsigned shift = 0;
+      while ((v[n-1] << shift) >> (WORD_BITS-1) == 0)
+	    shift += 1;
+
+      for (unsigned idx = n-1 ; idx > 0 ; idx -= 1)
+	    vn[idx] = (v[idx] << shift)
+		  | (shift? v[idx-1] >> (WORD_BITS-shift) : 0);
+      vn[0] = v[0] << shift;
+
+      un[m] = shift? u[m-1] >> (WORD_BITS-shift) : 0;
+      for (unsigned idx = m-1 ; idx > 0 ; idx -= 1)
+	    un[idx] = (u[idx] << shift)
+		  | (shift? u[idx-1] >> (WORD_BITS-shift) : 0);
+      un[0] = u[0] << shift;
+
+      const vvp_dword_t base = (vvp_dword_t)1 << WORD_BITS;
+      for (unsigned jdx = m-n+1 ; jdx > 0 ; jdx -= 1) {
+	    unsigned j = jdx-1;
+
+	      // Estimate the quotient word from the top words, and
+	      // correct the estimate with the next divisor word.
+	    vvp_dword_t num = ((vvp_dword_t)un[j+n] << WORD_BITS) | un[j+n-1];
+	    vvp_dword_t qhat = num / vn[n-1];
+	    vvp_dword_t rhat = num - qhat * vn[n-1];
+	    while (qhat >= base
+		   || qhat * vn[n-2] > ((rhat << WORD_BITS) | un[j+n-2])) {
+		  qhat -= 1;
+		  rhat += vn[n-1];
+		  if (rhat >= base)
+			break;
+	    }
+
+	      // Multiply and subtract.
+	    unsigned long borrow = 0;
+	    for (unsigned idx = 0 ; idx < n ; idx += 1) {
+		  vvp_dword_t prod = qhat * vn[idx] + borrow;
+		  unsigned long low = (unsigned long)prod;
+		  borrow = (unsigned long)(prod >> WORD_BITS);
+		  if (un[idx+j] < low)
+			borrow += 1;
+		  un[idx+j] -= low;
+	    }
+	    bool negative = un[j+n] < borrow;
+	    un[j+n] -= borrow;
+
+	      // The estimate was still one too large, so add back.
+	    if (negative) {
+		  qhat -= 1;
 		  unsigned long carry = 0;
-		  res[base] = add_with_carry(res[base], tmp, carry);
-		  for (int add_idx = base+1 ; add_idx < cnt ; add_idx += 1) {
-			res[add_idx] = add_with_carry(res[add_idx], sum, carry);
-			sum = 0;
+		  for (unsigned idx = 0 ; idx < n ; idx += 1)
+			un[idx+j] = add_with_carry(un[idx+j], vn[idx], carry);
+		  un[j+n] += carry;
+	    }
+
+	    if (q) q[j] = (unsigned long)qhat;
+      }
+
+      if (r) {
+	    for (unsigned idx = 0 ; idx < n ; idx += 1)
+		  r[idx] = (un[idx] >> shift)
+			| (shift? un[idx+1] << (WORD_BITS-shift) : 0);
+      }
+#else
+	// Shift the dividend into the remainder a bit at a time, and
+	// subtract the divisor whenever it fits.
+      unsigned long*rem = work;
+      unsigned long*quo = work + n + 1;
+      for (unsigned idx = 0 ; idx <= n ; idx += 1)
+	    rem[idx] = 0;
+      for (unsigned idx = 0 ; idx < m ; idx += 1)
+	    quo[idx] = 0;
+
+      for (unsigned bit = m*WORD_BITS ; bit > 0 ; bit -= 1) {
+	    unsigned long in = (u[(bit-1)/WORD_BITS] >> ((bit-1)%WORD_BITS)) & 1;
+	    for (unsigned idx = 0 ; idx <= n ; idx += 1) {
+		  unsigned long out = rem[idx] >> (WORD_BITS-1);
+		  rem[idx] = (rem[idx] << 1) | in;
+		  in = out;
+	    }
+
+	    bool fits = rem[n] != 0;
+	    if (! fits) {
+		  unsigned idx = n;
+		  while (idx > 0 && rem[idx-1] == v[idx-1])
+			idx -= 1;
+		  fits = idx == 0 || rem[idx-1] > v[idx-1];
+	    }
+	    if (! fits)
+		  continue;
+
+	    unsigned long carry = 1;
+	    for (unsigned idx = 0 ; idx < n ; idx += 1)
+		  rem[idx] = add_with_carry(rem[idx], ~v[idx], carry);
+	    rem[n] = 0;
+	    quo[(bit-1)/WORD_BITS] |= 1UL << ((bit-1)%WORD_BITS);
+      }
+
+      if (q) {
+	    for (unsigned idx = 0 ; idx <= m-n ; idx += 1)
+		  q[idx] = quo[idx];
+      }
+      if (r) {
+	    for (unsigned idx = 0 ; idx < n ; idx += 1)
+		  r[idx] = rem[idx];
+      }
+#endif
+}
+
+/*
+ * Replace this with this/that (or with this%that if rem_flag is
+ * true) in the Verilog way: any X or Z bit, or a divide by zero,
+ * makes the whole result X. Signed values are divided as magnitudes
+ * and the quotient rounded toward zero, and the remainder takes the
+ * sign of the dividend.
+ */
+void vvp_vector4_t::div_mod_(const vvp_vector4_t&that, bool signed_flag, bool rem_flag)
+{
+      assert(size_ == that.size_);
+      if (size_ == 0)
+	    return;
+
+      const unsigned words = (size_ + BITS_PER_WORD - 1) / BITS_PER_WORD;
+      const unsigned tail = size_ % BITS_PER_WORD;
+      const unsigned long mask = tail? ~(-1UL << tail) : ~0UL;
+
+      unsigned long*ap = size_ <= BITS_PER_WORD? &abits_val_ : abits_ptr_;
+      unsigned long*bp = size_ <= BITS_PER_WORD? &bbits_val_ : bbits_ptr_;
+      const unsigned long*tap = size_ <= BITS_PER_WORD? &that.abits_val_ : that.abits_ptr_;
+      const unsigned long*tbp = size_ <= BITS_PER_WORD? &that.bbits_val_ : that.bbits_ptr_;
+
+      bool x_flag = false;
+      for (unsigned idx = 0 ; idx < words && !x_flag ; idx += 1) {
+	    unsigned long xz = bp[idx] | tbp[idx];
+	    if (idx == words-1) xz &= mask;
+	    if (xz) x_flag = true;
+      }
+
+	// A value that fits in a word uses the native operators.
+      if (!x_flag && words == 1) {
+	    unsigned long lval = ap[0] & mask;
+	    unsigned long rval = tap[0] & mask;
+	    if (rval == 0) {
+		  x_flag = true;
+	    } else if (signed_flag) {
+		  if (tail) {
+			unsigned long sign = 1UL << (tail-1);
+			lval = (lval ^ sign) - sign;
+			rval = (rval ^ sign) - sign;
 		  }
+		    // Dividing the most negative value by -1
+		    // overflows the native divide.
+		  if (rval == ~0UL)
+			lval = rem_flag? 0 : -lval;
+		  else if (rem_flag)
+			lval = (unsigned long)((long)lval % (long)rval);
+		  else
+			lval = (unsigned long)((long)lval / (long)rval);
+		  ap[0] = lval & mask;
+		  return;
+	    } else {
+		  ap[0] = rem_flag? lval % rval : lval / rval;
+		  return;
+	    }
+      }
+
+      if (x_flag) {
+	    for (unsigned idx = 0 ; idx < words ; idx += 1) {
+		  ap[idx] = WORD_X_ABITS;
+		  bp[idx] = WORD_X_BBITS;
 	    }
+	    ap[words-1] &= mask;
+	    bp[words-1] &= mask;
+	    return;
       }
 
-	// Replace the "this" value with the calculated result. We
-	// know a-priori that the bbits are zero and unchanged.
-      res[cnt-1] &= mask;
-      for (int idx = 0 ; idx < cnt ; idx += 1)
-	    abits_ptr_[idx] = res[idx];
+	// The work array holds copies of the operands, which are
+	// sign extended and made positive for a signed divide, and
+	// the work space of the divide.
+      unsigned long stack_work[4*DIV_STACK_WORDS+1];
+      unsigned long*work = stack_work;
+      if (words > DIV_STACK_WORDS)
+	    work = new unsigned long[4*words+1];
 
-      delete[]res;
-      return;
+      unsigned long*uw = work;
+      unsigned long*vw = work + words;
+      for (unsigned idx = 0 ; idx < words ; idx += 1) {
+	    uw[idx] = ap[idx];
+	    vw[idx] = tap[idx];
+      }
+      uw[words-1] &= mask;
+      vw[words-1] &= mask;
+
+      bool neg_u = false, neg_v = false;
+      if (signed_flag) {
+	    unsigned long sign = tail? 1UL << (tail-1) : 1UL << (BITS_PER_WORD-1);
+	    neg_u = (uw[words-1] & sign) != 0;
+	    neg_v = (vw[words-1] & sign) != 0;
+	    if (neg_u) {
+		  uw[words-1] |= ~mask;
+		  negate_words(uw, words);
+	    }
+	    if (neg_v) {
+		  vw[words-1] |= ~mask;
+		  negate_words(vw, words);
+	    }
+      }
+
+      unsigned m = significant_words(uw, words);
+      unsigned n = significant_words(vw, words);
+      if (n == 0) {
+	    for (unsigned idx = 0 ; idx < words ; idx += 1) {
+		  ap[idx] = WORD_X_ABITS;
+		  bp[idx] = WORD_X_BBITS;
+	    }
+	    ap[words-1] &= mask;
+	    bp[words-1] &= mask;
+	    if (work != stack_work) delete[]work;
+	    return;
+      }
+
+      for (unsigned idx = 0 ; idx < words ; idx += 1)
+	    ap[idx] = 0;
 
+      bool negate;
+      if (rem_flag) {
+	    negate = neg_u;
+	    if (m < n) {
+		  for (unsigned idx = 0 ; idx < m ; idx += 1)
+			ap[idx] = uw[idx];
+	    } else {
+		  divide_words(uw, m, vw, n, 0, ap, work + 2*words);
+	    }
+      } else {
+	    negate = neg_u != neg_v;
+	    if (m >= n)
+		  divide_words(uw, m, vw, n, ap, 0, work + 2*words);
+      }
+
+      if (negate)
+	    negate_words(ap, words);
+      ap[words-1] &= mask;
 
+      if (work != stack_work)
+	    delete[]work;
 }
 
 bool vvp_vector4_t::eeq(const vvp_vector4_t&that) const
@@ -1805,6 +2375,32 @@ bool vvp_vector4_t::has_xz() const
       return false;
 }
 
+bool vvp_vector4_t::is_hiz() const
+{
+	// A Z bit has a clear abit and a set bbit.
+      if (size_ <= BITS_PER_WORD) {
+	    if (size_ == 0)
+		  return true;
+	    unsigned long mask = -1UL >> (BITS_PER_WORD - size_);
+	    return (abits_val_&mask) == 0 && (bbits_val_&mask) == mask;
+      }
+
+      unsigned words = size_ / BITS_PER_WORD;
+      for (unsigned idx = 0 ; idx < words ; idx += 1) {
+	    if (abits_ptr_[idx] != 0 || bbits_ptr_[idx] != WORD_Z_BBITS)
+		  return false;
+      }
+
+      unsigned long mask = size_%BITS_PER_WORD;
+      if (mask > 0) {
+	    mask = -1UL >> (BITS_PER_WORD - mask);
+	    return (abits_ptr_[words]&mask) == 0
+		  && (bbits_ptr_[words]&mask) == mask;
+      }
+
+      return true;
+}
+
 void vvp_vector4_t::change_z2x()
 {
 	// This method relies on the fact that both BIT4_X and BIT4_Z
@@ -2334,6 +2930,149 @@ vvp_vector4_t vvp_vector4array_aa::get_word(unsigned index) const
       return get_word_(cell);
 }
 
+vvp_vector4array_sparse::vvp_vector4array_sparse(unsigned width__, unsigned words__)
+: vvp_vector4array_t(width__, words__),
+  pages_((words__ + PAGE_WORDS-1) / PAGE_WORDS, (unsigned long*)0),
+  pages_allocated_(0)
+{
+      cnt_ = (width_ + vvp_vector4_t::BITS_PER_WORD-1)/vvp_vector4_t::BITS_PER_WORD;
+}
+
+vvp_vector4array_sparse::~vvp_vector4array_sparse()
+{
+      for (size_t idx = 0 ; idx < pages_.size() ; idx += 1)
+	    delete[]pages_[idx];
+}
+
+void vvp_vector4array_sparse::set_word(unsigned index, const vvp_vector4_t&that)
+{
+      assert(index < words_);
+      assert(that.size_ == width_);
+
+      unsigned long*&page = pages_[index / PAGE_WORDS];
+      if (page == 0) {
+	      // Writing X to an unwritten word changes nothing, so
+	      // leave the page unallocated.
+	    if (that.has_xz() && that.eeq(vvp_vector4_t(width_, BIT4_X)))
+		  return;
+
+	    page = new unsigned long[2*cnt_*PAGE_WORDS];
+	    for (unsigned idx = 0 ; idx < cnt_*PAGE_WORDS ; idx += 1) {
+		  page[2*idx+0] = vvp_vector4_t::WORD_X_ABITS;
+		  page[2*idx+1] = vvp_vector4_t::WORD_X_BBITS;
+	    }
+	    pages_allocated_ += 1;
+      }
+
+	// Each word is its abits words followed by its bbits words.
+      unsigned long*cell = page + 2*cnt_*(index % PAGE_WORDS);
+      if (width_ <= vvp_vector4_t::BITS_PER_WORD) {
+	    cell[0] = that.abits_val_;
+	    cell[1] = that.bbits_val_;
+	    return;
+      }
+
+      for (unsigned idx = 0 ; idx < cnt_ ; idx += 1) {
+	    cell[idx] = that.abits_ptr_[idx];
+	    cell[cnt_+idx] = that.bbits_ptr_[idx];
+      }
+}
+
+vvp_vector4_t vvp_vector4array_sparse::get_word(unsigned index) const
+{
+      if (index >= words_)
+	    return vvp_vector4_t(width_, BIT4_X);
+
+      const unsigned long*page = pages_[index / PAGE_WORDS];
+      if (page == 0)
+	    return vvp_vector4_t(width_, BIT4_X);
+
+      const unsigned long*cell = page + 2*cnt_*(index % PAGE_WORDS);
+      if (width_ <= vvp_vector4_t::BITS_PER_WORD) {
+	    vvp_vector4_t res;
+	    res.size_ = width_;
+	    res.abits_val_ = cell[0];
+	    res.bbits_val_ = cell[1];
+	    return res;
+      }
+
+      vvp_vector4_t res (width_, BIT4_X);
+      for (unsigned idx = 0 ; idx < cnt_ ; idx += 1) {
+	    res.abits_ptr_[idx] = cell[idx];
+	    res.bbits_ptr_[idx] = cell[cnt_+idx];
+      }
+      return res;
+}
+
+unsigned vvp_vector4array_sparse::next_allocated_word(unsigned index) const
+{
+      for (size_t pdx = index / PAGE_WORDS ; pdx < pages_.size() ; pdx += 1) {
+	    if (pages_[pdx] == 0)
+		  continue;
+	    unsigned first = pdx * PAGE_WORDS;
+	    return index > first? index : first;
+      }
+      return words_;
+}
+
+vvp_vector4array_packed::vvp_vector4array_packed(unsigned width__, unsigned words__)
+: vvp_vector4array_t(width__, words__)
+{
+      assert(width_ > 0 && width_ <= MAX_WIDTH);
+
+      slot_shift_ = 0;
+      while ((1U << slot_shift_) < width_)
+	    slot_shift_ += 1;
+
+      per_shift_ = 0;
+      while ((1UL << (per_shift_+1)) <= vvp_vector4_t::BITS_PER_WORD)
+	    per_shift_ += 1;
+      per_shift_ -= slot_shift_;
+
+      mask_ = (1UL << width_) - 1;
+
+      plane_ = (words_ + (1U << per_shift_) - 1) >> per_shift_;
+      bits_ = new unsigned long[2*plane_];
+
+	// All the words start out X.
+      for (unsigned idx = 0 ; idx < 2*plane_ ; idx += 1)
+	    bits_[idx] = vvp_vector4_t::WORD_X_ABITS;
+}
+
+vvp_vector4array_packed::~vvp_vector4array_packed()
+{
+      delete[]bits_;
+}
+
+void vvp_vector4array_packed::set_word(unsigned index, const vvp_vector4_t&that)
+{
+      assert(index < words_);
+      assert(that.size_ == width_);
+
+      unsigned pos = index >> per_shift_;
+      unsigned off = (index - (pos << per_shift_)) << slot_shift_;
+      unsigned long keep = ~(mask_ << off);
+
+      bits_[pos] = (bits_[pos] & keep) | ((that.abits_val_ & mask_) << off);
+      pos += plane_;
+      bits_[pos] = (bits_[pos] & keep) | ((that.bbits_val_ & mask_) << off);
+}
+
+vvp_vector4_t vvp_vector4array_packed::get_word(unsigned index) const
+{
+      if (index >= words_)
+	    return vvp_vector4_t(width_, BIT4_X);
+
+      unsigned pos = index >> per_shift_;
+      unsigned off = (index - (pos << per_shift_)) << slot_shift_;
+
+      vvp_vector4_t res;
+      res.size_ = width_;
+      res.abits_val_ = (bits_[pos] >> off) & mask_;
+      res.bbits_val_ = (bits_[pos+plane_] >> off) & mask_;
+      return res;
+}
+
 vvp_vector2_t::vvp_vector2_t()
 {
       vec_ = 0;
@@ -3061,15 +3800,21 @@ vvp_vector8_t::vvp_vector8_t(const vvp_vector4_t&that,
       if (size_ == 0)
 	    return;
 
+	// All the bits have the same strengths, so there are only
+	// four possible scalar values.
+      unsigned char table[4];
+      for (unsigned idx = 0 ;  idx < 4 ;  idx += 1)
+	    table[idx] = vvp_scalar_t((vvp_bit4_t)idx, str0, str1).raw();
+
       if (size_ <= sizeof(val_)) {
 	    ptr_ = 0; // Prefill all val_ bytes
-	    for (unsigned idx = 0 ; idx < size_ ; idx += 1)
-		  val_[idx] = vvp_scalar_t(that.value(idx),str0, str1).raw();
       } else {
 	    ptr_ = new unsigned char[size_];
-	    for (unsigned idx = 0 ;  idx < size_ ;  idx += 1)
-		  ptr_[idx] = vvp_scalar_t(that.value(idx), str0, str1).raw();
       }
+
+      unsigned char*bits = bytes_();
+      for (unsigned idx = 0 ;  idx < size_ ;  idx += 1)
+	    bits[idx] = table[that.value(idx)];
 }
 
 vvp_vector8_t::vvp_vector8_t(const vvp_vector2_t&that,
@@ -3347,6 +4092,16 @@ void vvp_net_fun_t::force_flag(bool)
 {
 }
 
+bool vvp_net_fun_t::checkpoint_save(checkpoint_out&)
+{
+      return false;
+}
+
+void vvp_net_fun_t::checkpoint_load(checkpoint_in&in, vvp_net_t*)
+{
+      in.corrupt("functor state for a functor that has none");
+}
+
 /* **** vvp_fun_drive methods **** */
 
 vvp_fun_drive::vvp_fun_drive(unsigned str0, unsigned str1)
@@ -3686,6 +4441,105 @@ vvp_scalar_t fully_featured_resolv_(vvp_scalar_t a, vvp_scalar_t b)
       return res;
 }
 
+/*
+ * The vvp_vector8_t keeps a vvp_scalar_t byte for each bit, so the
+ * following functions work on 8 bits at a time by treating the bytes
+ * as the lanes of a 64 bit word. The words are assembled a byte at a
+ * time so that lane N is always bit N of the vector, whatever the byte
+ * order of the machine, and the compiler turns that into plain loads
+ * and stores where it can.
+ */
+static const uint64_t LANE_HIGH = 0x8080808080808080ULL;
+static const uint64_t LANE_LOW7 = 0x7f7f7f7f7f7f7f7fULL;
+static const uint64_t LANE_STRS = 0x7777777777777777ULL;
+
+static inline uint64_t load_lanes(const unsigned char*ptr)
+{
+      uint64_t val = 0;
+      for (unsigned idx = 0 ;  idx < 8 ;  idx += 1)
+	    val |= (uint64_t)ptr[idx] << (8*idx);
+      return val;
+}
+
+static inline void store_lanes(unsigned char*ptr, uint64_t val)
+{
+      for (unsigned idx = 0 ;  idx < 8 ;  idx += 1)
+	    ptr[idx] = (val >> (8*idx)) & 0xff;
+}
+
+  // Set the high bit of each lane that has no strength, i.e. HiZ. The
+  // strength bits of a lane are at most 0x77, so adding 0x7f sets the
+  // high bit without carrying into the next lane if any are set.
+static inline uint64_t lanes_hiz(uint64_t val)
+{
+      return ~((val & LANE_STRS) + LANE_LOW7) & LANE_HIGH;
+}
+
+  // Set the high bit of each lane that is zero.
+static inline uint64_t lanes_zero(uint64_t val)
+{
+      return ~(((val & LANE_LOW7) + LANE_LOW7) | val) & LANE_HIGH;
+}
+
+  // Gather the high bits of the lanes into an 8 bit number, with lane
+  // N in bit N.
+static inline unsigned long gather_lanes(uint64_t val)
+{
+      return (((val >> 7) * 0x0102040810204080ULL) >> 56) & 0xff;
+}
+
+vvp_vector8_t resolve(const vvp_vector8_t&a, const vvp_vector8_t&b)
+{
+      assert(a.size() == b.size());
+      vvp_vector8_t out (a.size());
+
+      const unsigned char*abits = a.bytes_();
+      const unsigned char*bbits = b.bytes_();
+      unsigned char*obits = out.bytes_();
+
+      unsigned idx = 0;
+      for ( ; idx+8 <= out.size() ;  idx += 8) {
+	    uint64_t aval = load_lanes(abits+idx);
+	    uint64_t bval = load_lanes(bbits+idx);
+	    uint64_t hiz_a = lanes_hiz(aval);
+	      // The common cases are that one side is HiZ or that
+	      // both sides are the same. These select the a value,
+	      // unless the a value is HiZ.
+	    uint64_t easy = hiz_a | lanes_hiz(bval) | lanes_zero(aval^bval);
+	    if (easy == LANE_HIGH) {
+		  uint64_t take_b = (hiz_a >> 7) * 0xff;
+		  store_lanes(obits+idx, (bval & take_b) | (aval & ~take_b));
+		  continue;
+	    }
+
+	    for (unsigned bit = idx ;  bit < idx+8 ;  bit += 1)
+		  out.set_bit(bit, resolve(a.value(bit), b.value(bit)));
+      }
+
+      for ( ; idx < out.size() ;  idx += 1)
+	    out.set_bit(idx, resolve(a.value(idx), b.value(idx)));
+
+      return out;
+}
+
+bool vvp_vector8_t::is_hiz() const
+{
+      const unsigned char*bits = bytes_();
+
+      unsigned idx = 0;
+      for ( ; idx+8 <= size_ ;  idx += 8) {
+	    if (lanes_hiz(load_lanes(bits+idx)) != LANE_HIGH)
+		  return false;
+      }
+
+      for ( ; idx < size_ ;  idx += 1) {
+	    if (! value(idx).is_hiz())
+		  return false;
+      }
+
+      return true;
+}
+
 vvp_vector8_t resistive_reduction(const vvp_vector8_t&that)
 {
       static unsigned rstr[8] = {
@@ -3699,15 +4553,28 @@ vvp_vector8_t resistive_reduction(const vvp_vector8_t&that)
 	    5  /* Supply drive       --> Pull drive */
       };
 
+	// The reduction of each scalar only depends on its own
+	// value, so make a table of all the possible results the
+	// first time through.
+      static unsigned char reduced[256];
+      static bool reduced_ready = false;
+      if (! reduced_ready) {
+	    for (unsigned idx = 0 ;  idx < 256 ;  idx += 1) {
+		  vvp_scalar_t bit ((unsigned char)idx);
+		  bit = vvp_scalar_t(bit.value(),
+				     rstr[bit.strength0()],
+				     rstr[bit.strength1()]);
+		  reduced[idx] = bit.raw();
+	    }
+	    reduced_ready = true;
+      }
+
       vvp_vector8_t res (that.size());
 
-      for (unsigned idx = 0 ;  idx < res.size() ;  idx += 1) {
-	    vvp_scalar_t bit = that.value(idx);
-	    bit = vvp_scalar_t(bit.value(),
-			       rstr[bit.strength0()],
-			       rstr[bit.strength1()]);
-	    res.set_bit(idx, bit);
-      }
+      const unsigned char*src = that.bytes_();
+      unsigned char*dst = res.bytes_();
+      for (unsigned idx = 0 ;  idx < res.size() ;  idx += 1)
+	    dst[idx] = reduced[src[idx]];
 
       return res;
 }
@@ -3715,8 +4582,51 @@ vvp_vector8_t resistive_reduction(const vvp_vector8_t&that)
 vvp_vector4_t reduce4(const vvp_vector8_t&that)
 {
       vvp_vector4_t out (that.size());
-      for (unsigned idx = 0 ;  idx < out.size() ;  idx += 1)
-	    out.set_bit(idx, that.value(idx).value());
+      if (out.size() == 0)
+	    return out;
+
+      unsigned long*abits;
+      unsigned long*bbits;
+      unsigned words;
+      if (out.size() <= vvp_vector4_t::BITS_PER_WORD) {
+	    abits = &out.abits_val_;
+	    bbits = &out.bbits_val_;
+	    words = 1;
+      } else {
+	    abits = out.abits_ptr_;
+	    bbits = out.bbits_ptr_;
+	    words = (out.size() + vvp_vector4_t::BITS_PER_WORD - 1)
+		  / vvp_vector4_t::BITS_PER_WORD;
+      }
+
+      for (unsigned idx = 0 ;  idx < words ;  idx += 1) {
+	    abits[idx] = 0;
+	    bbits[idx] = 0;
+      }
+
+	// A lane is HiZ (a=0 b=1) if it has no strength, otherwise
+	// the 0x80 and 0x08 value bits are both clear for 0 (a=0 b=0),
+	// both set for 1 (a=1 b=0) and differ for X (a=1 b=1).
+      const unsigned char*src = that.bytes_();
+      unsigned idx = 0;
+      for ( ; idx+8 <= out.size() ;  idx += 8) {
+	    uint64_t val = load_lanes(src+idx);
+	    uint64_t hiz = lanes_hiz(val);
+	    uint64_t hi = val & LANE_HIGH;
+	    uint64_t lo = (val << 4) & LANE_HIGH;
+	    unsigned word = idx / vvp_vector4_t::BITS_PER_WORD;
+	    unsigned shift = idx % vvp_vector4_t::BITS_PER_WORD;
+	    abits[word] |= gather_lanes(~hiz & (hi|lo)) << shift;
+	    bbits[word] |= gather_lanes(hiz | (hi^lo)) << shift;
+      }
+
+      for ( ; idx < out.size() ;  idx += 1) {
+	    unsigned long bit = that.value(idx).value();
+	    unsigned word = idx / vvp_vector4_t::BITS_PER_WORD;
+	    unsigned shift = idx % vvp_vector4_t::BITS_PER_WORD;
+	    abits[word] |= (bit & 1UL) << shift;
+	    bbits[word] |= (bit >> 1) << shift;
+      }
 
       return out;
 }
@@ -28,6 +28,7 @@
 # include  <cstdlib>
 # include  <cstring>
 # include  <string>
+# include  <vector>
 # include  <new>
 # include  <cassert>
 
@@ -61,6 +62,10 @@ class  vvp_fun_part;
 
 class  vvp_delay_t;
 
+/* Checkpoint files (see checkpoint.h). */
+class  checkpoint_out;
+class  checkpoint_in;
+
 /*
  * Storage for items declared in automatically allocated scopes (i.e. automatic
  * tasks and functions). The first two slots in each context are reserved for
@@ -217,20 +222,31 @@ inline void update_driver_counts(vvp_bit4_t bit, unsigned counts[3])
 static inline unsigned long add_with_carry(unsigned long a, unsigned long b,
 					   unsigned long&carry)
 {
-      unsigned long tmp = b + carry;
-      unsigned long sum = a + tmp;
-      carry = 0;
-      if (tmp < b)
-	    carry = 1;
-      if (sum < tmp)
-	    carry = 1;
-      if (sum < a)
-	    carry = 1;
+	// The carry in is 0 or 1, so at most one of the two adds
+	// can carry out. Compilers turn this into an add with carry.
+      unsigned long sum = a + b;
+      unsigned long out = sum < a;
+      sum += carry;
+      carry = out | (sum < carry);
       return sum;
 }
 
+/*
+ * Return the low word of a*b, and the high word in carry.
+ */
+#if SIZEOF_UNSIGNED_LONG == 8 && defined(__SIZEOF_INT128__)
+static inline unsigned long multiply_with_carry(unsigned long a, unsigned long b,
+						unsigned long&carry)
+{
+      __extension__ typedef unsigned __int128 dword_t;
+      dword_t prod = (dword_t)a * b;
+      carry = (unsigned long)(prod >> 64);
+      return (unsigned long)prod;
+}
+#else
 extern unsigned long multiply_with_carry(unsigned long a, unsigned long b,
 					 unsigned long&carry);
+#endif
 
 /*
  * This class represents scalar values collected into vectors. The
@@ -244,9 +260,13 @@ extern unsigned long multiply_with_carry(unsigned long a, unsigned long b,
 class vvp_vector4_t {
 
       friend vvp_vector4_t operator ~(const vvp_vector4_t&that);
+      friend vvp_vector4_t reduce4(const vvp_vector8_t&that);
       friend class vvp_vector4array_t;
       friend class vvp_vector4array_sa;
       friend class vvp_vector4array_aa;
+      friend class vvp_vector4array_sparse;
+      friend class vvp_vector4array_packed;
+      friend struct vvp_vector4_small_pool_s;
 
     public:
       static const vvp_vector4_t nil;
@@ -267,9 +287,20 @@ class vvp_vector4_t {
       vvp_vector4_t(const vvp_vector4_t&that);
       vvp_vector4_t(const vvp_vector4_t&that, bool invert_flag);
       vvp_vector4_t& operator= (const vvp_vector4_t&that);
+#if __cplusplus >= 201103L
+	// Moving a wide vector steals its bit arrays. The moved from
+	// vector is left as a zero width vector.
+      vvp_vector4_t(vvp_vector4_t&&that) noexcept;
+      vvp_vector4_t& operator= (vvp_vector4_t&&that) noexcept;
+#endif
 
       ~vvp_vector4_t();
 
+	// Exchange the values of the two vectors. This does not
+	// allocate, so can be used to move values around without
+	// copying them.
+      void swap(vvp_vector4_t&that);
+
       inline unsigned size() const { return size_; }
       void resize(unsigned new_size, vvp_bit4_t pad_bit = BIT4_X);
 
@@ -282,11 +313,27 @@ class vvp_vector4_t {
 	// in the array.
       unsigned long*subarray(unsigned idx, unsigned size, bool xz_to_0 =false) const;
       void setarray(unsigned idx, unsigned size, const unsigned long*val);
+	// Get the 2-value bits of a vector that fits in a single
+	// word. This returns false if the vector is empty, wider than
+	// a word, or has any X or Z bits.
+      bool get_word2(unsigned long&val) const;
+	// Copy the bits into VPI aval/bval words, 32 bits at a time
+	// starting with the least significant bits. The encoding of
+	// the abits/bbits matches the VPI encoding, so this copies
+	// whole words. The val array must have (size()+31)/32 words.
+      void get_vpi_vecval(s_vpi_vecval*val) const;
+	// Copy the wid bits starting at base the same way, without
+	// making a subvalue. The val array must have (wid+31)/32 words.
+      void get_vpi_vecval(s_vpi_vecval*val, unsigned base, unsigned wid) const;
 
 	// Set a 4-value bit or subvector into the vector. Return true
 	// if any bits of the vector change as a result of this operation.
       void set_bit(unsigned idx, vvp_bit4_t val);
       bool set_vec(unsigned idx, const vvp_vector4_t&that);
+	// Set cnt bits starting at idx from the bits of that vector
+	// starting at src, padding past the end of that with BIT4_X.
+      bool set_vec(unsigned idx, const vvp_vector4_t&that,
+		   unsigned src, unsigned cnt);
 
         // Get the bits from another vector, but keep my size.
       void copy_bits(const vvp_vector4_t&that);
@@ -303,6 +350,13 @@ class vvp_vector4_t {
 	// Multiply this by that in the Verilog way.
       void mul(const vvp_vector4_t&that);
 
+	// Divide this by that, or replace this with the remainder, in
+	// the Verilog way.
+      void div(const vvp_vector4_t&that, bool signed_flag)
+      { div_mod_(that, signed_flag, false); }
+      void mod(const vvp_vector4_t&that, bool signed_flag)
+      { div_mod_(that, signed_flag, true); }
+
 	// Test that the vectors are exactly equal
       bool eeq(const vvp_vector4_t&that) const;
 
@@ -312,6 +366,9 @@ class vvp_vector4_t {
 	// Return true if there is an X or Z anywhere in the vector.
       bool has_xz() const;
 
+	// Return true if all the bits of the vector are Z.
+      bool is_hiz() const;
+
 	// Change all Z bits to X bits.
       void change_z2x();
 
@@ -349,6 +406,12 @@ class vvp_vector4_t {
 #error "WORD_X_xBITS not defined for this architecture?"
 #endif
 
+	// Vectors wider than a word but no wider than this many words
+	// take their bit arrays from a free list of the running
+	// thread instead of the heap.
+      enum { SMALL_WORDS = 4 };
+      enum { SMALL_POOL_MAX = 1024 };
+
 	// Initialize and operator= use this private method to copy
 	// the data from that object into this object.
       void copy_from_(const vvp_vector4_t&that);
@@ -357,6 +420,18 @@ class vvp_vector4_t {
 
       void allocate_words_(unsigned long inita, unsigned long initb);
 
+      void div_mod_(const vvp_vector4_t&that, bool signed_flag, bool rem_flag);
+
+	// Get storage for the abits and bbits arrays of a vector
+	// with this many words, and release the storage of this
+	// vector. These only apply to vectors wider than a word.
+      static inline unsigned long*alloc_bits_(unsigned words);
+      static inline void free_bits_(unsigned long*bits, unsigned words);
+      inline void free_bits_();
+	// Take over the bits of that (wide) vector, which is left
+	// as a zero width vector.
+      void steal_from_(vvp_vector4_t&that);
+
 	// Values in the vvp_vector4_t are stored split across two
 	// arrays. For each bit in the vector, there is an abit and a
 	// bbit. the encoding of a vvp_vector4_t is:
@@ -367,6 +442,11 @@ class vvp_vector4_t {
 	// BIT4_1    1    0    value is 0. This makes detecting XZ fast.)
 	// BIT4_X    1    1
 	// BIT4_Z    0    1
+	//
+	// Vectors that fit in a word use the abits_val_ and
+	// bbits_val_ words. Wider vectors point abits_ptr_ at an
+	// array of 2*words, and bbits_ptr_ at the second half of
+	// that array.
 
       unsigned size_;
       union {
@@ -379,11 +459,89 @@ class vvp_vector4_t {
       };
 };
 
+/*
+ * The released bit arrays of the small wide vectors are kept on free
+ * lists, one for each word count, with the link in the first word of
+ * the array. Only the simulation thread creates and destroys vectors,
+ * so the lists are plain globals and need no lock.
+ */
+struct vvp_vector4_small_pool_s {
+      unsigned long*head[vvp_vector4_t::SMALL_WORDS+1];
+      unsigned count[vvp_vector4_t::SMALL_WORDS+1];
+};
+extern vvp_vector4_small_pool_s vvp_vector4_small_pool;
+
+inline unsigned long* vvp_vector4_t::alloc_bits_(unsigned words)
+{
+      if (words <= SMALL_WORDS) {
+	    vvp_vector4_small_pool_s&pool = vvp_vector4_small_pool;
+	    if (unsigned long*bits = pool.head[words]) {
+		  pool.head[words] = reinterpret_cast<unsigned long*>(bits[0]);
+		  pool.count[words] -= 1;
+		  return bits;
+	    }
+      }
+      return new unsigned long[2*words];
+}
+
+inline void vvp_vector4_t::free_bits_(unsigned long*bits, unsigned words)
+{
+      if (words <= SMALL_WORDS) {
+	    vvp_vector4_small_pool_s&pool = vvp_vector4_small_pool;
+	    if (pool.count[words] < SMALL_POOL_MAX) {
+		  bits[0] = reinterpret_cast<unsigned long>(pool.head[words]);
+		  pool.head[words] = bits;
+		  pool.count[words] += 1;
+		  return;
+	    }
+      }
+      delete[] bits;
+}
+
+inline void vvp_vector4_t::free_bits_()
+{
+	// bbits_ptr_ actually points half-way into a double-length
+	// array started at abits_ptr_
+      if (size_ > BITS_PER_WORD)
+	    free_bits_(abits_ptr_, (size_+BITS_PER_WORD-1) / BITS_PER_WORD);
+}
+
 inline vvp_vector4_t::vvp_vector4_t(const vvp_vector4_t&that)
 {
       copy_from_(that);
 }
 
+#if __cplusplus >= 201103L
+inline vvp_vector4_t::vvp_vector4_t(vvp_vector4_t&&that) noexcept
+{
+      if (that.size_ > BITS_PER_WORD) {
+	    steal_from_(that);
+      } else {
+	    size_ = that.size_;
+	    abits_val_ = that.abits_val_;
+	    bbits_val_ = that.bbits_val_;
+      }
+}
+
+inline vvp_vector4_t& vvp_vector4_t::operator= (vvp_vector4_t&&that) noexcept
+{
+      if (this == &that)
+	    return *this;
+
+      if (that.size_ > BITS_PER_WORD) {
+	    free_bits_();
+	    steal_from_(that);
+	    return *this;
+      }
+
+      free_bits_();
+      size_ = that.size_;
+      abits_val_ = that.abits_val_;
+      bbits_val_ = that.bbits_val_;
+      return *this;
+}
+#endif
+
 inline vvp_vector4_t::vvp_vector4_t(const vvp_vector4_t&that, bool invert_flag)
 {
       if (invert_flag)
@@ -412,11 +570,7 @@ inline vvp_vector4_t::vvp_vector4_t(unsigned size__, vvp_bit4_t val)
 
 inline vvp_vector4_t::~vvp_vector4_t()
 {
-      if (size_ > BITS_PER_WORD) {
-	    delete[] abits_ptr_;
-	      // bbits_ptr_ actually points half-way into a
-	      // double-length array started at abits_ptr_
-      }
+      free_bits_();
 }
 
 inline vvp_vector4_t& vvp_vector4_t::operator= (const vvp_vector4_t&that)
@@ -424,9 +578,21 @@ inline vvp_vector4_t& vvp_vector4_t::operator= (const vvp_vector4_t&that)
       if (this == &that)
 	    return *this;
 
-      if (size_ > BITS_PER_WORD)
-	    delete[] abits_ptr_;
+	// If the word count is unchanged, then reuse the existing
+	// bit arrays instead of reallocating them.
+      if (size_ > BITS_PER_WORD && that.size_ > BITS_PER_WORD) {
+	    unsigned words = (size_+BITS_PER_WORD-1) / BITS_PER_WORD;
+	    if (words == (that.size_+BITS_PER_WORD-1) / BITS_PER_WORD) {
+		  size_ = that.size_;
+		  for (unsigned idx = 0 ;  idx < words ;  idx += 1)
+			abits_ptr_[idx] = that.abits_ptr_[idx];
+		  for (unsigned idx = 0 ;  idx < words ;  idx += 1)
+			bbits_ptr_[idx] = that.bbits_ptr_[idx];
+		  return *this;
+	    }
+      }
 
+      free_bits_();
       copy_from_(that);
 
       return *this;
@@ -523,6 +689,19 @@ inline void vvp_vector4_t::set_bit(unsigned idx, vvp_bit4_t val)
       }
 }
 
+inline bool vvp_vector4_t::get_word2(unsigned long&val) const
+{
+      if (size_ == 0 || size_ > BITS_PER_WORD)
+	    return false;
+
+      unsigned long mask = -1UL >> (BITS_PER_WORD - size_);
+      if (bbits_val_ & mask)
+	    return false;
+
+      val = abits_val_ & mask;
+      return true;
+}
+
 inline vvp_vector4_t operator ~ (const vvp_vector4_t&that)
 {
       vvp_vector4_t res (that, true);
@@ -643,6 +822,74 @@ class vvp_vector4array_aa : public vvp_vector4array_t, public automatic_hooks_s
       unsigned context_idx_;
 };
 
+/*
+ * Sparse vvp_vector4array_t
+ *
+ * This is for memories that are too large to allocate all at once,
+ * such as models of DRAM devices, where the simulation usually only
+ * touches a small part of the address space. The words are kept in
+ * pages of PAGE_WORDS words that are allocated when a word in the page
+ * is first written with a value other than all X. A page that was
+ * never written reads as all X, so all the unwritten pages share the
+ * nil page pointer. The bits of a page are contiguous, so words that
+ * are wider than a machine word do not need a heap block each.
+ */
+class vvp_vector4array_sparse : public vvp_vector4array_t {
+
+    public:
+      enum { PAGE_WORDS = 1024 };
+
+      vvp_vector4array_sparse(unsigned width, unsigned words);
+      ~vvp_vector4array_sparse();
+
+      vvp_vector4_t get_word(unsigned idx) const;
+      void set_word(unsigned idx, const vvp_vector4_t&that);
+
+	// Return the first word at or after idx that is in an
+	// allocated page, or words() if there is none.
+      unsigned next_allocated_word(unsigned idx) const;
+      unsigned pages_allocated() const { return pages_allocated_; }
+
+    private:
+	// The number of abits (and of bbits) words in an array word.
+      unsigned cnt_;
+      std::vector<unsigned long*> pages_;
+      unsigned pages_allocated_;
+};
+
+/*
+ * Packed vvp_vector4array_t
+ *
+ * This is for memories of narrow words, such as ROM tables and
+ * register files of bytes, that would otherwise take two unsigned
+ * longs per word. The abits of all the words are packed into one bit
+ * plane and the bbits into another that follows it. Each word takes a
+ * slot of a power of 2 bits that is at least the width, so no word
+ * straddles two unsigned longs and a word is read or written with a
+ * single shift and mask in each plane.
+ */
+class vvp_vector4array_packed : public vvp_vector4array_t {
+
+    public:
+	// The widest word that this array can hold.
+      enum { MAX_WIDTH = 8 };
+
+      vvp_vector4array_packed(unsigned width, unsigned words);
+      ~vvp_vector4array_packed();
+
+      vvp_vector4_t get_word(unsigned idx) const;
+      void set_word(unsigned idx, const vvp_vector4_t&that);
+
+    private:
+	// log2 of the slot width, and of the slots per unsigned long.
+      unsigned slot_shift_;
+      unsigned per_shift_;
+      unsigned long mask_;
+	// The abits plane, followed by the bbits plane at plane_.
+      unsigned long*bits_;
+      unsigned plane_;
+};
+
 /* vvp_vector2_t
  */
 class vvp_vector2_t {
@@ -817,6 +1064,11 @@ class vvp_scalar_t {
 	// so allow vvp_vector8_t access to the raw encoding so that
 	// it can do compact vectoring of vvp_scalar_t objects.
       friend class vvp_vector8_t;
+      friend vvp_vector8_t resistive_reduction(const vvp_vector8_t&);
+	// Checkpoints save the raw encoding, which also keeps the
+	// strength ranges of ambiguous values.
+      friend class checkpoint_out;
+      friend class checkpoint_in;
       explicit vvp_scalar_t(unsigned char val) : value_(val) { }
       unsigned char raw() const { return value_; }
 
@@ -902,6 +1154,9 @@ extern ostream& operator<< (ostream&, vvp_scalar_t);
 class vvp_vector8_t {
 
       friend vvp_vector8_t part_expand(const vvp_vector8_t&, unsigned, unsigned);
+      friend vvp_vector8_t resolve(const vvp_vector8_t&, const vvp_vector8_t&);
+      friend vvp_vector8_t resistive_reduction(const vvp_vector8_t&);
+      friend vvp_vector4_t reduce4(const vvp_vector8_t&);
 
     public:
       explicit vvp_vector8_t(unsigned size =0);
@@ -929,8 +1184,23 @@ class vvp_vector8_t {
 	// Test that the vectors are exactly equal
       bool eeq(const vvp_vector8_t&that) const;
 
+	// Return true if all the bits of the vector are HiZ.
+      bool is_hiz() const;
+
       vvp_vector8_t(const vvp_vector8_t&that);
       vvp_vector8_t& operator= (const vvp_vector8_t&that);
+#if __cplusplus >= 201103L
+	// Moving a wide vector steals its byte array. The moved from
+	// vector is left as a zero width vector.
+      vvp_vector8_t(vvp_vector8_t&&that) noexcept;
+      vvp_vector8_t& operator= (vvp_vector8_t&&that) noexcept;
+#endif
+
+    private:
+	// The raw vvp_scalar_t bytes, wherever they are stored.
+      unsigned char*bytes_() { return size_ <= sizeof(val_)? val_ : ptr_; }
+      const unsigned char*bytes_() const
+      { return size_ <= sizeof(val_)? val_ : ptr_; }
 
     private:
       unsigned size_;
@@ -942,17 +1212,7 @@ class vvp_vector8_t {
 
   /* Resolve uses the default Verilog resolver algorithm to resolve
      two drive vectors to a single output. */
-inline vvp_vector8_t resolve(const vvp_vector8_t&a, const vvp_vector8_t&b)
-{
-      assert(a.size() == b.size());
-      vvp_vector8_t out (a.size());
-
-      for (unsigned idx = 0 ;  idx < out.size() ;  idx += 1) {
-	    out.set_bit(idx, resolve(a.value(idx), b.value(idx)));
-      }
-
-      return out;
-}
+extern vvp_vector8_t resolve(const vvp_vector8_t&a, const vvp_vector8_t&b);
 
   /* This function implements the strength reduction implied by
      Verilog standard resistive devices. */
@@ -986,6 +1246,37 @@ inline vvp_vector8_t::~vvp_vector8_t()
 	    delete[]ptr_;
 }
 
+#if __cplusplus >= 201103L
+inline vvp_vector8_t::vvp_vector8_t(vvp_vector8_t&&that) noexcept
+: size_(that.size_)
+{
+      if (size_ <= sizeof(val_)) {
+	    memcpy(val_, that.val_, sizeof(val_));
+      } else {
+	    ptr_ = that.ptr_;
+	    that.size_ = 0;
+      }
+}
+
+inline vvp_vector8_t& vvp_vector8_t::operator= (vvp_vector8_t&&that) noexcept
+{
+      if (this == &that)
+	    return *this;
+
+      if (size_ > sizeof(val_))
+	    delete[]ptr_;
+
+      size_ = that.size_;
+      if (size_ <= sizeof(val_)) {
+	    memcpy(val_, that.val_, sizeof(val_));
+      } else {
+	    ptr_ = that.ptr_;
+	    that.size_ = 0;
+      }
+      return *this;
+}
+#endif
+
 inline vvp_scalar_t vvp_vector8_t::value(unsigned idx) const
 {
       assert(idx < size_);
@@ -1106,7 +1397,16 @@ template <class T> ostream& operator << (ostream&out, vvp_sub_pointer_t<T> val)
  * all the fan-out chain, delivering the specified value. The send_*()
  * methods of the vvp_net_t class are similar, but they follow the
  * output, possibly filtered, from the vvp_net_t.
+ *
+ * The vvp_net_t objects, their functors and their filters are all
+ * permanently allocated from the one vvp_net_heap. The compiler
+ * creates the net, functor and filter of a node together, and the
+ * nodes of a scope together, so this keeps the parts of a node that
+ * propagation touches next to each other in memory instead of in
+ * three separate pools.
  */
+extern permaheap vvp_net_heap;
+
 class vvp_net_t {
     public:
       vvp_net_t();
@@ -1152,6 +1452,21 @@ class vvp_net_t {
     public: // Method to support $countdrivers
       void count_drivers(unsigned idx, unsigned counts[4]);
 
+    public: // Methods to support analysis of the netlist.
+	// Get the first link of the fan-out of this net. The rest
+	// of the fan-out is found by following the port[] links.
+      vvp_net_ptr_t fanout() const { return out_; }
+	// Get all the vvp_net_t objects that have been allocated.
+      static void get_all_nets(std::vector<vvp_net_t*>&nets);
+	// Get the distances in memory from the nets to their fanout
+	// nets and to their functors, for the statistics.
+      struct layout_s {
+	    unsigned long count;
+	    unsigned long near;
+	    size_t median;
+      };
+      static void layout_stats(layout_s&fanout, layout_s&funs);
+
     private:
       vvp_net_ptr_t out_;
 
@@ -1230,6 +1545,14 @@ class vvp_net_fun_t {
 	// do something about it.
       virtual void force_flag(bool run_now);
 
+	// Save the state of the functor that propagating the saved
+	// values through the net would not recreate, and return true
+	// if there is any. The checkpoint_load method reads it back
+	// into the functor of the net, and propagates the output that
+	// the functor had. Most functors keep no such state.
+      virtual bool checkpoint_save(checkpoint_out&out);
+      virtual void checkpoint_load(checkpoint_in&in, vvp_net_t*net);
+
    protected:
       void recv_vec4_pv_(vvp_net_ptr_t p, const vvp_vector4_t&bit,
 			 unsigned base, unsigned wid, unsigned vwid,
@@ -1238,14 +1561,9 @@ class vvp_net_fun_t {
 			 unsigned base, unsigned wid, unsigned vwid);
 
     public: // These objects are only permallocated.
-      static void* operator new(std::size_t size) { return heap_.alloc(size); }
+      static void* operator new(std::size_t size) { return vvp_net_heap.alloc(size); }
       static void operator delete(void*); // not implemented
 
-      static std::size_t heap_total() { return heap_.heap_total(); }
-
-    protected:
-      static permaheap heap_;
-
     private: // not implemented
       vvp_net_fun_t(const vvp_net_fun_t&);
       vvp_net_fun_t& operator= (const vvp_net_fun_t&);
@@ -1300,6 +1618,9 @@ class vvp_net_fil_t  : public vvp_vpi_callback {
       void force_link(vvp_net_t*dst, vvp_net_t*src);
       void force_unlink(void);
 
+	// True if any bit of the output is forced.
+      bool force_active() const { return ! test_force_mask_is_zero(); }
+
       virtual unsigned filter_size() const =0;
 
     public:
@@ -1310,15 +1631,16 @@ class vvp_net_fil_t  : public vvp_vpi_callback {
       virtual void force_fil_vec8(const vvp_vector8_t&val, const vvp_vector2_t&mask) =0;
       virtual void force_fil_real(double val, const vvp_vector2_t&mask) =0;
 
+	// Save the force of the filter to a checkpoint, and force the
+	// net again from the checkpoint. Only the filters that keep
+	// their forced value can do this, so the default refuses.
+      virtual void checkpoint_save_force(checkpoint_out&out) const;
+      virtual void checkpoint_load_force(checkpoint_in&in, vvp_net_t*net);
+
     public: // These objects are only permallocated.
-      static void* operator new(std::size_t size) { return heap_.alloc(size); }
+      static void* operator new(std::size_t size) { return vvp_net_heap.alloc(size); }
       static void operator delete(void*); // not implemented
 
-      static size_t heap_total() { return heap_.heap_total(); }
-
-    private:
-      static permaheap heap_;
-
     private: // not implemented
       vvp_net_fil_t(const vvp_net_fil_t&);
       vvp_net_fil_t& operator= (const vvp_net_fil_t&);
@@ -1333,6 +1655,13 @@ class vvp_net_fil_t  : public vvp_vpi_callback {
 	// Test bits of the filter force mask;
       bool test_force_mask(unsigned bit) const;
       bool test_force_mask_is_zero() const;
+	// Save and load the force mask, the source of a %force/link
+	// and the pending force propagation, for the
+	// checkpoint_*_force methods.
+      void checkpoint_save_mask_(checkpoint_out&out) const;
+      vvp_vector2_t checkpoint_load_mask_(checkpoint_in&in, unsigned wid,
+					  vvp_net_t*&src, bool&propagate);
+      void checkpoint_load_propagate_(bool flag) { force_propagate_ = flag; }
 
 	// This template method is used by derived classes to process
 	// the val through the force mask. The force value is the
@@ -1382,6 +1711,8 @@ class vvp_fun_concat  : public vvp_net_fun_t {
 		     unsigned w2, unsigned w3);
       ~vvp_fun_concat();
 
+      unsigned width(unsigned port) const { return wid_[port]; }
+
       void recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
                      vvp_context_t context);
 
@@ -1497,6 +1828,8 @@ class vvp_fun_extend_signed  : public vvp_net_fun_t {
       explicit vvp_fun_extend_signed(unsigned wid);
       ~vvp_fun_extend_signed();
 
+      unsigned width() const { return width_; }
+
       void recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
                      vvp_context_t context);
 
@@ -1588,6 +1921,9 @@ class vvp_wide_fun_t : public vvp_net_fun_t {
 			unsigned base, unsigned wid, unsigned vwid,
                         vvp_context_t context);
 
+	// Get the core that this input functor feeds.
+      vvp_wide_fun_core* core() const { return core_; }
+
     private:
       vvp_wide_fun_core*core_;
       unsigned port_base_;
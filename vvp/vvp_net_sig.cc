@@ -22,6 +22,7 @@
 # include  "vvp_net_sig.h"
 # include  "statistics.h"
 # include  "vpi_priv.h"
+# include  "checkpoint.h"
 # include  <vector>
 # include  <cassert>
 #ifdef CHECK_WITH_VALGRIND
@@ -117,6 +118,11 @@ double vvp_signal_value::real_value() const
       return 0;
 }
 
+const vvp_vector4_t* vvp_signal_value::vec4_value_ptr() const
+{
+      return 0;
+}
+
 void vvp_net_t::force_vec4(const vvp_vector4_t&val, const vvp_vector2_t&mask)
 {
       assert(fil);
@@ -284,6 +290,26 @@ void vvp_fun_signal_base::deassign()
       assign_mask_ = vvp_vector2_t();
 }
 
+void vvp_fun_signal_base::checkpoint_save_assign(checkpoint_out&out) const
+{
+      out.put_uint(continuous_assign_active_? 1 : 0);
+      out.put_vec2(assign_mask_);
+      out.put_net(cassign_link);
+}
+
+/*
+ * The signal already holds the assigned value, so this only has to
+ * block the normal input again and link the source back to port 1.
+ */
+void vvp_fun_signal_base::checkpoint_load_assign(checkpoint_in&in, vvp_net_t*net)
+{
+      continuous_assign_active_ = in.get_uint() != 0;
+      assign_mask_ = in.get_vec2();
+      cassign_link = in.get_net();
+      if (cassign_link)
+	    cassign_link->link(vvp_net_ptr_t(net, 1));
+}
+
 void vvp_fun_signal_base::deassign_pv(unsigned base, unsigned wid)
 {
       for (unsigned idx = 0 ;  idx < wid ;  idx += 1) {
@@ -436,6 +462,12 @@ void vvp_fun_signal4_aa::vec4_value(vvp_vector4_t&val) const
       val = *bits4;
 }
 
+const vvp_vector4_t*vvp_fun_signal4_aa::vec4_value_ptr() const
+{
+      return static_cast<vvp_vector4_t*>
+            (vthread_get_rd_context_item(context_idx_));
+}
+
 const vvp_vector4_t&vvp_fun_signal4_aa::vec4_unfiltered_value() const
 {
       vvp_vector4_t*bits4 = static_cast<vvp_vector4_t*>
@@ -584,7 +616,7 @@ void vvp_fun_signal_real_aa::vec4_value(vvp_vector4_t&) const
 
 void* vvp_fun_signal_real_aa::operator new(std::size_t size)
 {
-      return vvp_net_fun_t::heap_.alloc(size);
+      return vvp_net_heap.alloc(size);
 }
 
 void vvp_fun_signal_real_aa::operator delete(void*)
@@ -701,7 +733,7 @@ const std::string& vvp_fun_signal_string_aa::get_string() const
 
 void* vvp_fun_signal_string_aa::operator new(std::size_t size)
 {
-      return vvp_net_fun_t::heap_.alloc(size);
+      return vvp_net_heap.alloc(size);
 }
 
 void vvp_fun_signal_string_aa::operator delete(void*)
@@ -812,7 +844,7 @@ void vvp_fun_signal_object_aa::vec4_value(vvp_vector4_t&) const
 
 void* vvp_fun_signal_object_aa::operator new(std::size_t size)
 {
-      return vvp_net_fun_t::heap_.alloc(size);
+      return vvp_net_heap.alloc(size);
 }
 
 void vvp_fun_signal_object_aa::operator delete(void*)
@@ -1011,6 +1043,41 @@ void vvp_wire_vec4::release_pv(vvp_net_ptr_t ptr, unsigned base, unsigned wid, b
       }
 }
 
+/*
+ * A checkpoint keeps the forced bits. The unforced bits of the value
+ * that is forced again keep the current value of the net, as in the
+ * force_vector4_event_s of the scheduler.
+ */
+void vvp_wire_vec4::checkpoint_save_force(checkpoint_out&out) const
+{
+      checkpoint_save_mask_(out);
+      out.put_vec4(force4_);
+}
+
+void vvp_wire_vec4::checkpoint_load_force(checkpoint_in&in, vvp_net_t*net)
+{
+      vvp_net_t*src;
+      bool propagate;
+      vvp_vector2_t mask = checkpoint_load_mask_(in, bits4_.size(),
+						   src, propagate);
+      vvp_vector4_t val = in.get_vec4();
+      if (val.size() != bits4_.size())
+	    in.corrupt("forced value does not fit the net");
+
+      vvp_vector4_t tmp;
+      vec4_value(tmp);
+      for (unsigned idx = 0 ; idx < mask.size() ; idx += 1) {
+	    if (mask.value(idx))
+		  tmp.set_bit(idx, val.value(idx));
+      }
+      net->force_vec4(tmp, mask);
+      if (src)
+	    force_link(net, src);
+	// Forcing the value again propagated it, so put back whether
+	// the saved run still had to.
+      checkpoint_load_propagate_(propagate);
+}
+
 unsigned vvp_wire_vec4::value_size() const
 {
       return bits4_.size();
@@ -1044,6 +1111,14 @@ void vvp_wire_vec4::vec4_value(vvp_vector4_t&val) const
 	    val.set_bit(idx, filtered_value_(idx));
 }
 
+const vvp_vector4_t* vvp_wire_vec4::vec4_value_ptr() const
+{
+	// Forced bits are not in the driven value.
+      if (test_force_mask_is_zero())
+	    return &bits4_;
+      return 0;
+}
+
 vvp_bit4_t vvp_wire_vec4::driven_value(unsigned idx) const
 {
       return bits4_.value(idx);
@@ -1177,6 +1252,33 @@ void vvp_wire_vec8::release_pv(vvp_net_ptr_t ptr, unsigned base, unsigned wid, b
       }
 }
 
+void vvp_wire_vec8::checkpoint_save_force(checkpoint_out&out) const
+{
+      checkpoint_save_mask_(out);
+      out.put_vec8(force8_);
+}
+
+void vvp_wire_vec8::checkpoint_load_force(checkpoint_in&in, vvp_net_t*net)
+{
+      vvp_net_t*src;
+      bool propagate;
+      vvp_vector2_t mask = checkpoint_load_mask_(in, bits8_.size(),
+						   src, propagate);
+      vvp_vector8_t val = in.get_vec8();
+      if (val.size() != bits8_.size())
+	    in.corrupt("forced value does not fit the net");
+
+      vvp_vector8_t tmp = vec8_value();
+      for (unsigned idx = 0 ; idx < mask.size() ; idx += 1) {
+	    if (mask.value(idx))
+		  tmp.set_bit(idx, val.value(idx));
+      }
+      net->force_vec8(tmp, mask);
+      if (src)
+	    force_link(net, src);
+      checkpoint_load_propagate_(propagate);
+}
+
 unsigned vvp_wire_vec8::value_size() const
 {
       return bits8_.size();
@@ -1297,6 +1399,24 @@ void vvp_wire_real::release_pv(vvp_net_ptr_t, unsigned, unsigned, bool)
 #endif
 }
 
+void vvp_wire_real::checkpoint_save_force(checkpoint_out&out) const
+{
+      checkpoint_save_mask_(out);
+      out.put_real(force_);
+}
+
+void vvp_wire_real::checkpoint_load_force(checkpoint_in&in, vvp_net_t*net)
+{
+      vvp_net_t*src;
+      bool propagate;
+      vvp_vector2_t mask = checkpoint_load_mask_(in, 1, src, propagate);
+      double val = in.get_real();
+      net->force_real(val, mask);
+      if (src)
+	    force_link(net, src);
+      checkpoint_load_propagate_(propagate);
+}
+
 unsigned vvp_wire_real::value_size() const
 {
       assert(0);
@@ -82,6 +82,17 @@ class vvp_fun_signal_base : public vvp_net_fun_t {
 	   %deassign instructions can undo the link as needed. */
       class vvp_net_t*cassign_link;
 
+	// True while a %cassign holds any bit of the signal.
+      bool assign_active() const
+	    { return continuous_assign_active_ || assign_mask_.size() != 0; }
+
+	// Save the procedural continuous assignment of an assigned
+	// signal to a checkpoint, and put it back from one. The
+	// assigned value is the value of the signal, so that is
+	// restored with the rest.
+      void checkpoint_save_assign(checkpoint_out&out) const;
+      void checkpoint_load_assign(checkpoint_in&in, vvp_net_t*net);
+
     protected:
       bool continuous_assign_active_;
       vvp_vector2_t assign_mask_;
@@ -103,6 +114,10 @@ class vvp_signal_value {
       virtual vvp_scalar_t scalar_value(unsigned idx) const =0;
       virtual void vec4_value(vvp_vector4_t&) const =0;
       virtual double real_value() const;
+	// Return the stored vector if it is the value of the signal,
+	// so that it can be read in place, or nil if the value must
+	// be computed by vec4_value().
+      virtual const vvp_vector4_t* vec4_value_ptr() const;
 
       virtual void get_signal_value(struct t_vpi_value*vp);
 };
@@ -185,10 +200,11 @@ class vvp_fun_signal4_aa : public vvp_fun_signal_vec, public automatic_signal_ba
       vvp_bit4_t value(unsigned idx) const;
       vvp_scalar_t scalar_value(unsigned idx) const;
       void vec4_value(vvp_vector4_t&) const;
+      const vvp_vector4_t* vec4_value_ptr() const;
       const vvp_vector4_t& vec4_unfiltered_value() const;
 
     public: // These objects are only permallocated.
-      static void* operator new(std::size_t size) { return vvp_net_fun_t::heap_.alloc(size); }
+      static void* operator new(std::size_t size) { return vvp_net_heap.alloc(size); }
       static void operator delete(void*obj);
 
     private:
@@ -440,12 +456,15 @@ class vvp_wire_vec4 : public vvp_wire_base {
       void force_fil_real(double val, const vvp_vector2_t&mask);
       void release(vvp_net_ptr_t ptr, bool net_flag);
       void release_pv(vvp_net_ptr_t ptr, unsigned base, unsigned wid, bool net_flag);
+      void checkpoint_save_force(checkpoint_out&out) const;
+      void checkpoint_load_force(checkpoint_in&in, vvp_net_t*net);
 
 	// Implementation of vvp_signal_value methods
       unsigned value_size() const;
       vvp_bit4_t value(unsigned idx) const;
       vvp_scalar_t scalar_value(unsigned idx) const;
       void vec4_value(vvp_vector4_t&) const;
+      const vvp_vector4_t* vec4_value_ptr() const;
 
         // Support for $countdrivers
       vvp_bit4_t driven_value(unsigned idx) const;
@@ -485,6 +504,8 @@ class vvp_wire_vec8 : public vvp_wire_base {
       void force_fil_real(double val, const vvp_vector2_t&mask);
       void release(vvp_net_ptr_t ptr, bool net_flag);
       void release_pv(vvp_net_ptr_t ptr, unsigned base, unsigned wid, bool net_flag);
+      void checkpoint_save_force(checkpoint_out&out) const;
+      void checkpoint_load_force(checkpoint_in&in, vvp_net_t*net);
 
 	// Implementation of vvp_signal_value methods
       unsigned value_size() const;
@@ -524,6 +545,8 @@ class vvp_wire_real : public vvp_wire_base {
       void force_fil_real(double val, const vvp_vector2_t&mask);
       void release(vvp_net_ptr_t ptr, bool net_flag);
       void release_pv(vvp_net_ptr_t ptr, unsigned base, unsigned wid, bool net_flag);
+      void checkpoint_save_force(checkpoint_out&out) const;
+      void checkpoint_load_force(checkpoint_in&in, vvp_net_t*net);
 
 	// Implementation of vvp_signal_value methods
       unsigned value_size() const;